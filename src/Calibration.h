@@ -0,0 +1,78 @@
+/*******************************************************************************
+ * Calibration
+ * - Travel calibration of a channel (appcmd "calibrate"): home to the CLOSED limit switch, run to the OPEN limit
+ *   switch, and run back to CLOSED. The steps are run by the motor task (MotorCalibrate), one run at a time.
+ * - Records the rotations and travel time per direction, and the motor current, from the motor journal runs.
+ * - Derives the max open rotations, the open and max run timeouts and the current limit from the measurements.
+ * - Progress and result are published by the main loop (reportCalibration).
+********************************************************************************/
+#include <ArduinoJson.h>
+
+/*******************************************************************************
+ * calibrationActive
+ * - True if a calibration of the channel is requested or in progress.
+********************************************************************************/
+bool calibrationActive(BlindChannel* ch) {
+  calPhase phase = ch->cal.Phase;
+  return ch->cal.Request || phase == calHoming || phase == calOpening || phase == calClosing;
+}
+
+/*******************************************************************************
+ * calibrationPhaseName
+ * - Short name for a calibration phase, as used in the MQTT payloads.
+********************************************************************************/
+const char* calibrationPhaseName(calPhase phase) {
+  switch (phase) {
+    case calHoming :   return "homing";
+    case calOpening :  return "opening";
+    case calClosing :  return "closing";
+    case calDone :     return "done";
+    case calFailed :   return "failed";
+    default :          return "idle";
+  }
+}
+
+/*******************************************************************************
+ * calibrationDerive
+ * - Derive the channel settings from the calibration measurements. Settings that were not measured are left as is.
+********************************************************************************/
+void calibrationDerive(const Calibration& cal, ChannelConfig* cfg) {
+  unsigned long longest = max(cal.OpenTime, cal.CloseTime);
+
+  cfg->Open_MaxRotations = cal.Rotations;                                          // 0 if no rotation sensor is fitted.
+  cfg->Open_Duration = (cal.OpenTime * calTimeMargin / 100 + 999) / 1000;            // seconds, rounded up
+  cfg->MaxRunDuration = (longest * calTimeMargin / 100 + 999) / 1000;                // seconds, rounded up
+  if (cal.PeakCurrent > 0) {
+    cfg->MaxCurrentLimit = min(cal.PeakCurrent * calCurrentMargin / 100, 4095);
+  }
+  cfg->Cal_OpenTime = cal.OpenTime;
+  cfg->Cal_CloseTime = cal.CloseTime;
+  cfg->Cal_Current = cal.MeanCurrent;
+}
+
+/*******************************************************************************
+ * calibrationToJson
+ * - Add the calibration progress of the channel to the provided JSON object. Includes the results when done.
+********************************************************************************/
+void calibrationToJson(JsonObject obj, BlindChannel* ch) {
+  const Calibration& cal = ch->cal;
+
+  obj["ch"] = ch->Index;
+  obj["phase"] = calibrationPhaseName(cal.Phase);
+  obj["elapsed_ms"] = millis() - cal.StartTime;
+  if (cal.Phase == calFailed) {
+    obj["reason"] = stopReasonName(cal.FailReason);
+  }
+  if (cal.Phase == calDone) {
+    obj["rot"] = cal.Rotations;
+    obj["open_ms"] = cal.OpenTime;
+    obj["close_ms"] = cal.CloseTime;
+    obj["iMean"] = cal.MeanCurrent;
+    obj["iPeak"] = cal.PeakCurrent;
+    JsonObject cfg = obj.createNestedObject("cfg");                                 // settings derived and stored
+    cfg["MaxOpenRotations"] = ch->Cfg.Open_MaxRotations;
+    cfg["OpenDuration"] = ch->Cfg.Open_Duration;
+    cfg["MaxRunDuration"] = ch->Cfg.MaxRunDuration;
+    cfg["MaxCurrentLimit"] = ch->Cfg.MaxCurrentLimit;
+  }
+}
@@ -0,0 +1,124 @@
+/*******************************************************************************
+ * DeadReckoning
+ * - Time-based position estimate for channels without a rotation sensor (MaxOpenRotations = 0).
+ * - The position is kept in permille of the travel (0 = closed, 1000 = open), and integrated by the motion control
+ *   task from the run time and the duty cycle. This assumes the motor speed is roughly proportional to the duty cycle.
+ * - The full speed per direction comes from the calibrated travel times (appcmd "calibrate"), so the difference
+ *   between lifting and lowering the blinds is taken into account. The time lost in the soft-start ramp is
+ *   taken off the calibrated times, as that ramp was part of the calibration runs.
+ * - The estimate is re-synced at the limit switches. The error found there is kept as accuracy figure. The estimate
+ *   is not clamped to the travel while moving, so also an estimate that reached the end too early counts as error.
+********************************************************************************/
+#include <ArduinoJson.h>
+
+// Soft-start ramp from rampStartDuty to 100%: duration, and the travel time lost compared to running at full speed.
+const float estRampTime = (255 - rampStartDuty) * rampStepDuration;                                  // milliseconds
+const float estRampLoss = estRampTime * (1.0 - (rampStartDuty + 255) / 2.0 / 255);                  // milliseconds
+
+struct DeadReckonStats {
+  uint32_t Count;                                 // Number of re-syncs at a limit switch after moving.
+  int LastError;                                  // Estimate minus actual position at the last re-sync (permille).
+  int MaxError;                                   // Largest absolute error seen (permille).
+  uint32_t SumError;                              // Sum of the absolute errors (permille), for the average.
+};
+
+DeadReckonStats estStats[maxChannels];
+
+/*******************************************************************************
+ * deadReckonCalibrated
+ * - True if the channel has no rotation sensor, and its travel times were calibrated.
+********************************************************************************/
+bool deadReckonCalibrated(BlindChannel* ch) {
+  return ch->Cfg.Open_MaxRotations == 0 && ch->Cfg.Cal_OpenTime > estRampLoss && ch->Cfg.Cal_CloseTime > estRampLoss;
+}
+
+/*******************************************************************************
+ * deadReckonReady
+ * - True if the estimated position of the channel can be used (calibrated, and synced at a limit switch since boot).
+********************************************************************************/
+bool deadReckonReady(BlindChannel* ch) {
+  return deadReckonCalibrated(ch) && ch->estValid;
+}
+
+/*******************************************************************************
+ * deadReckonSync
+ * - Re-sync the estimate at a limit switch (position 0 or 1000), and record the error if the blinds moved.
+********************************************************************************/
+void deadReckonSync(BlindChannel* ch, int position) {
+  if (ch->estValid && ch->estMoved) {
+    DeadReckonStats& stats = estStats[ch->Index];
+    int error = round(ch->estPosition) - position;
+    stats.Count++;
+    stats.LastError = error;
+    stats.SumError += abs(error);
+    if (abs(error) > stats.MaxError) stats.MaxError = abs(error);
+  }
+  ch->estPosition = position;
+  ch->estValid = true;
+  ch->estMoved = false;
+}
+
+/*******************************************************************************
+ * deadReckonUpdate
+ * - Integrate the position of the channel since the last update (called from the fixed-rate motion control task).
+ * - Returns true if an MQTT move reached its target position. Targets at the ends (0 and 1000) are not stopped
+ *   on, those moves run on to the limit switch to re-sync.
+********************************************************************************/
+bool deadReckonUpdate(BlindChannel* ch, unsigned long now) {
+  unsigned long elapsed = now - ch->estLastUpdate;
+  ch->estLastUpdate = now;
+
+  // Re-sync at a limit switch. While running, only at the switch in the direction of travel (the switch flags
+  // are only refreshed for that direction).
+  bool running = ch->mtr.IsRunning;
+  blindsAction action = ch->mtr.Action;
+  if (ch->swcClosed.Set && (!running || action == actBlindsClose)) {
+    if (ch->estPosition != 0 || !ch->estValid) deadReckonSync(ch, 0);
+  } else if (ch->swcOpen.Set && (!running || action == actBlindsOpen)) {
+    if (ch->estPosition != 1000 || !ch->estValid) deadReckonSync(ch, 1000);
+  }
+
+  if (!running || !deadReckonCalibrated(ch)) return false;
+  if ((action == actBlindsOpen && ch->swcOpen.Set) || (action == actBlindsClose && ch->swcClosed.Set)) return false;
+
+  // Not clamped at 0 and 1000: an estimate that runs past the end before the switch is reached is an error, and is
+  // recorded as such by the re-sync.
+  float fullTime = (action == actBlindsOpen ? ch->Cfg.Cal_OpenTime : ch->Cfg.Cal_CloseTime) - estRampLoss;
+  float delta = 1000.0 * elapsed * ch->dutyCycle / 255 / fullTime;
+  if (action == actBlindsOpen) {
+    ch->estPosition += delta;
+  } else if (action == actBlindsClose) {
+    ch->estPosition -= delta;
+  }
+  ch->estMoved = true;
+
+  int target = ch->mtr.targetPosition;
+  if (!ch->estValid || ch->mtr.Owner != ownMQTT || target <= 0 || target >= 1000) return false;
+  return (action == actBlindsOpen && ch->estPosition >= target) || (action == actBlindsClose && ch->estPosition <= target);
+}
+
+/*******************************************************************************
+ * deadReckonPosition
+ * - Estimated position of the channel (permille of the travel, 0..1000), or -1 if not known.
+********************************************************************************/
+int deadReckonPosition(BlindChannel* ch) {
+  return deadReckonReady(ch) ? constrain((int) round(ch->estPosition), 0, 1000) : -1;
+}
+
+/*******************************************************************************
+ * deadReckonToJson
+ * - Add the re-sync error figures (permille) of each channel using the estimate: [n, last, avg, max].
+********************************************************************************/
+void deadReckonToJson(JsonObject obj) {
+  char key[4];
+  for (int i = 0; i < channelCount; i++) {
+    const DeadReckonStats& stats = estStats[i];
+    if (stats.Count == 0) continue;
+    snprintf(key, sizeof(key), "%d", i);
+    JsonArray errors = obj.createNestedArray(key);
+    errors.add(stats.Count);
+    errors.add(stats.LastError);
+    errors.add(stats.SumError / stats.Count);
+    errors.add(stats.MaxError);
+  }
+}
@@ -0,0 +1,74 @@
+/*******************************************************************************
+ * Debounce
+ * - Integrator debouncer, one per input (both limit switches and both buttons of each channel).
+ * - All inputs are sampled at a fixed rate (debounceSampleInterval) from a periodic timer on the timer wheel, so the
+ *   debounce time no longer depends on how often the motor task gets to look at an input.
+ * - The integrator counts up while the raw input differs from the debounced state, and down while it agrees.
+ *   The state flips once the count reaches the press time (to active) or the release time (to inactive).
+ * - Edges are flagged (Pressed/Released) for the consumer, with their timestamp. The reaction time
+ *   (first raw change to debounced edge) is kept per input type.
+********************************************************************************/
+#include <ArduinoJson.h>
+
+enum debounceType {dbcLimit, dbcButton, dbcCOUNT};
+
+struct DebounceStats {
+  uint32_t Count;                                 // Number of debounced edges.
+  uint32_t Sum;                                   // Sum of the reaction times (us).
+  uint32_t Max;                                   // Longest reaction time (us).
+};
+
+DebounceStats debounceStats[dbcCOUNT];
+
+/*******************************************************************************
+ * debounceInit
+ * - Start the debouncer in the current state of the input, without flagging an edge.
+********************************************************************************/
+void debounceInit(Debouncer& dbc, bool active) {
+  dbc.State = active;
+  dbc.Count = 0;
+  dbc.Pressed = false;
+  dbc.Released = false;
+}
+
+/*******************************************************************************
+ * debounceSample
+ * - Feed one raw sample (true = active, i.e. pulled low). The times are in samples.
+ * - Returns true if the debounced state changed.
+********************************************************************************/
+bool debounceSample(Debouncer& dbc, bool raw, int pressSamples, int releaseSamples, debounceType type, int64_t now) {
+  if (raw == dbc.State) {
+    if (dbc.Count > 0) dbc.Count--;
+    return false;
+  }
+
+  if (dbc.Count == 0) dbc.ChangeStart = now;
+  dbc.Count++;
+  if (dbc.Count < (raw ? pressSamples : releaseSamples)) return false;
+
+  dbc.State = raw;
+  dbc.Count = 0;
+  dbc.EdgeTime = now;
+  if (raw) { dbc.Pressed = true; } else { dbc.Released = true; }
+
+  DebounceStats& stats = debounceStats[type];
+  uint32_t reaction = now - dbc.ChangeStart;
+  stats.Count++;
+  stats.Sum += reaction;
+  if (reaction > stats.Max) stats.Max = reaction;
+  return true;
+}
+
+/*******************************************************************************
+ * debounceToJson
+ * - Add the reaction time per input type to the provided JSON object: [n, avg, max] (us).
+********************************************************************************/
+void debounceToJson(JsonObject obj) {
+  const char* names[dbcCOUNT] = {"limit", "button"};
+  for (int i = 0; i < dbcCOUNT; i++) {
+    JsonArray times = obj.createNestedArray(names[i]);
+    times.add(debounceStats[i].Count);
+    times.add(debounceStats[i].Count > 0 ? debounceStats[i].Sum / debounceStats[i].Count : 0);
+    times.add(debounceStats[i].Max);
+  }
+}
@@ -0,0 +1,130 @@
+/*******************************************************************************
+ * Gesture
+ * - Button gesture recogniser, one per button. Fed from the motor task with the debounced press and release
+ *   edges of the button (timestamped by onTimerDebounce), and the time. Never blocks or waits.
+ * - Gestures, with the thresholds per channel (ButtonHold, ButtonLong, ButtonDouble. 0 = gesture disabled):
+ *   - press:   pressed. The motor task starts the motor in the direction of the button, or stops it if running.
+ *   - click:   released before the hold time. The run continues (full open/close).
+ *   - double:  pressed again within the double-click time after a click. Move to the preset position.
+ *   - hold:    still pressed at the hold time. Jog: the run stops on release.
+ *   - long:    still pressed at the long-press time. The run is latched (full open/close), release does not stop it.
+ *              Also recognised with hold disabled (straight from press).
+ *   - jogend:  released while jogging.
+ * - The recognition latency is kept per gesture: from the debounced edge (or the moment the hold/long threshold
+ *   was passed) to the gesture reported to the motor task.
+********************************************************************************/
+#include <ArduinoJson.h>
+
+portMUX_TYPE muxGesture = portMUX_INITIALIZER_UNLOCKED;   // Button edge flags, between onTimerDebounce and the motor task.
+
+struct GestureStats {
+  uint32_t Count;                                 // Number of gestures recognised.
+  uint32_t Sum;                                   // Sum of the recognition latencies (us).
+  uint32_t Max;                                   // Longest recognition latency (us).
+};
+
+GestureStats gestureStats[gesCOUNT];
+
+/*******************************************************************************
+ * gestureName
+ * - Short name for a gesture, as used in the MQTT payloads.
+********************************************************************************/
+const char* gestureName(gestureEvent event) {
+  switch (event) {
+    case gesPress :   return "press";
+    case gesClick :   return "click";
+    case gesDouble :  return "double";
+    case gesHold :    return "hold";
+    case gesLong :    return "long";
+    case gesJogEnd :  return "jogend";
+    default :         return "none";
+  }
+}
+
+/*******************************************************************************
+ * gestureIgnore
+ * - Ignore the rest of the current press (no hold, long-press or click). Ends on release.
+********************************************************************************/
+void gestureIgnore(Gesture& gst) {
+  gst.Phase = gphIgnore;
+}
+
+/*******************************************************************************
+ * gestureUpdate
+ * - Feed the next button edge (one per call), or the passing of time, to the recogniser of the button.
+ * - Returns the gesture recognised, or gesNone.
+********************************************************************************/
+gestureEvent gestureUpdate(Gesture& gst, Debouncer& in, const ChannelConfig& cfg, int64_t now) {
+  bool pressed = false;
+  bool released = false;
+  portENTER_CRITICAL(&muxGesture);
+  if (in.Pressed) {
+    pressed = true;
+    in.Pressed = false;
+  } else if (in.Released) {
+    released = true;
+    in.Released = false;
+  }
+  int64_t edge = in.EdgeTime;
+  portEXIT_CRITICAL(&muxGesture);
+
+  int64_t holdTime = cfg.ButtonHold * 1000LL;
+  int64_t longTime = cfg.ButtonLong * 1000LL;
+  int64_t doubleTime = cfg.ButtonDouble * 1000LL;
+  gestureEvent event = gesNone;
+  int64_t since = edge;
+
+  if (pressed) {
+    if (gst.Phase == gphClicked && doubleTime > 0 && edge - gst.ReleaseTime <= doubleTime) {
+      event = gesDouble;
+      gst.Phase = gphIgnore;
+    } else {
+      event = gesPress;
+      gst.Phase = gphPressed;
+    }
+    gst.PressTime = edge;
+  } else if (released) {
+    if (gst.Phase == gphPressed) {
+      event = gesClick;
+      gst.Phase = gphClicked;
+      gst.ReleaseTime = edge;
+    } else {
+      if (gst.Phase == gphJog) event = gesJogEnd;
+      gst.Phase = gphIdle;
+    }
+  } else if (gst.Phase == gphPressed && holdTime > 0 && now - gst.PressTime >= holdTime) {
+    event = gesHold;
+    gst.Phase = gphJog;
+    since = gst.PressTime + holdTime;
+  } else if ((gst.Phase == gphJog || (gst.Phase == gphPressed && holdTime == 0)) && longTime > holdTime &&
+             now - gst.PressTime >= longTime) {
+    event = gesLong;
+    gst.Phase = gphLatched;
+    since = gst.PressTime + longTime;
+  } else if (gst.Phase == gphClicked && now - gst.ReleaseTime > doubleTime) {
+    gst.Phase = gphIdle;                          // No second click.
+  }
+
+  if (event != gesNone) {
+    GestureStats& stats = gestureStats[event];
+    uint32_t latency = now - since;
+    stats.Count++;
+    stats.Sum += latency;
+    if (latency > stats.Max) stats.Max = latency;
+  }
+  return event;
+}
+
+/*******************************************************************************
+ * gestureToJson
+ * - Add the recognition latency per gesture to the provided JSON object: [n, avg, max] (us).
+********************************************************************************/
+void gestureToJson(JsonObject obj) {
+  for (int i = gesPress; i < gesCOUNT; i++) {
+    const GestureStats& stats = gestureStats[i];
+    JsonArray times = obj.createNestedArray(gestureName((gestureEvent) i));
+    times.add(stats.Count);
+    times.add(stats.Count > 0 ? stats.Sum / stats.Count : 0);
+    times.add(stats.Max);
+  }
+}
@@ -0,0 +1,181 @@
+/*******************************************************************************
+ * GroupMove
+ * - Tracks a synchronised move of several blinds channels (MQTT group command).
+ * - The motor task starts all member motors in the same pass, and applies their first PWM duty cycle back-to-back.
+ * - Measures the start skew (first to last PWM applied) and the arrival skew (first to last member stopped).
+ * - For "sync" moves the max duty cycle per channel is scaled to its distance, so all members arrive together.
+ *   This assumes the motor speed is roughly proportional to the duty cycle.
+ * - A member too short to be scaled (clamped at groupMinDuty) would still arrive early. Its start is held instead
+ *   (groupHoldTime, on a timer of the channel in main), if its speed was learned. Held members, and clamped
+ *   members that could not be held (may arrive early), are reported per group move.
+********************************************************************************/
+#include <ArduinoJson.h>
+
+struct GroupMoveStats {
+  uint32_t Count;                                 // Number of completed group moves.
+  uint32_t StartSkew;                             // Start skew of the last group move (us).
+  unsigned long ArrivalSkew;                      // Arrival skew of the last group move (ms).
+  unsigned long MaxArrivalSkew;                   // Largest arrival skew seen (ms).
+  uint8_t Held;                                   // Members (bit mask) of the last group move whose start was held.
+  uint8_t Early;                                  // Members (bit mask) of the last group move clamped but not held.
+};
+
+volatile bool groupPending = false;               // A group move is waiting to be started by the motor task.
+uint8_t groupMembers = 0;                         // Channels (bit mask) of the pending group move.
+bool groupSync = false;                           // Scale the speed of each member so they arrive together.
+uint8_t groupRunning = 0;                         // Members (bit mask) of the active group move still running.
+uint8_t groupHeld = 0;                            // Members (bit mask) of the active group move not started yet.
+volatile uint8_t groupDue = 0;                    // Held members (bit mask) whose hold time expired, to start.
+unsigned long groupFirstArrival = 0;              // Timestamp the first member of the active group move stopped (millis).
+GroupMoveStats groupStats;
+
+portMUX_TYPE muxGroup = portMUX_INITIALIZER_UNLOCKED;
+
+/*******************************************************************************
+ * groupMoveActive
+ * - True if a group move is pending or still running.
+********************************************************************************/
+bool groupMoveActive() {
+  return groupPending || groupRunning != 0;
+}
+
+/*******************************************************************************
+ * groupBegin
+ * - Flag a group move for the motor task. The member actions must already be set.
+********************************************************************************/
+void groupBegin(uint8_t members, bool sync) {
+  groupMembers = members;
+  groupSync = sync;
+  groupPending = true;
+}
+
+/*******************************************************************************
+ * groupDutyMax
+ * - Max duty cycle of a member of a "sync" group move, scaled to its distance so all members arrive together
+ *   (the longest move runs at 100%). Not below groupMinDuty, so a short move may still arrive first.
+ * - Members with an unknown distance (0) run at full speed.
+********************************************************************************/
+int groupDutyMax(int distance, int maxDistance) {
+  if (maxDistance <= 0 || distance <= 0) return 255;
+  return max(groupMinDuty, 255 * distance / maxDistance);
+}
+
+/*******************************************************************************
+ * groupClamped
+ * - True if the duty cycle of a member of a "sync" group move is clamped at groupMinDuty (groupDutyMax): it would
+ *   arrive before the longest move.
+********************************************************************************/
+bool groupClamped(int distance, int maxDistance) {
+  return maxDistance > 0 && distance > 0 && 255 * distance / maxDistance < groupMinDuty;
+}
+
+/*******************************************************************************
+ * groupHoldTime
+ * - Time to hold the start of a member of a "sync" group move that is clamped at groupMinDuty (groupDutyMax), so
+ *   it arrives with the longest move instead of early (ms). 0 if it is not clamped.
+ * - Speed: learned speed of the member at full duty (rotations/second). Not learned (0): no hold, see groupClamped.
+********************************************************************************/
+unsigned long groupHoldTime(int distance, int maxDistance, float speed) {
+  if (!groupClamped(distance, maxDistance) || speed <= 0) return 0;
+  return (unsigned long) (1000 * (maxDistance - distance * 255.0 / groupMinDuty) / speed);
+}
+
+/*******************************************************************************
+ * groupStarted
+ * - Record which members were started, and the start skew (us). Called by the motor task.
+ * - Held: members not started yet (groupRelease). Early: members clamped at groupMinDuty that are not held.
+********************************************************************************/
+void groupStarted(uint8_t running, uint32_t skewUs, uint8_t held = 0, uint8_t early = 0) {
+  portENTER_CRITICAL(&muxGroup);
+  groupRunning = running | held;
+  groupHeld = held;
+  groupDue = 0;
+  groupFirstArrival = 0;
+  groupStats.StartSkew = skewUs;
+  groupStats.Held = held;
+  groupStats.Early = early;
+  groupPending = false;
+  portEXIT_CRITICAL(&muxGroup);
+}
+
+/*******************************************************************************
+ * groupHoldExpired
+ * - The hold time of a held member expired: flag it for the motor task (groupTakeDue). Timer callback.
+********************************************************************************/
+void groupHoldExpired(int channel) {
+  portENTER_CRITICAL(&muxGroup);
+  if (groupHeld & (1 << channel)) groupDue |= (1 << channel);
+  portEXIT_CRITICAL(&muxGroup);
+}
+
+/*******************************************************************************
+ * groupTakeDue
+ * - Take the held members whose hold time expired (bit mask): they are no longer held, the caller starts them.
+********************************************************************************/
+uint8_t groupTakeDue() {
+  portENTER_CRITICAL(&muxGroup);
+  uint8_t due = groupDue & groupHeld;
+  groupHeld &= ~due;
+  groupDue = 0;
+  portEXIT_CRITICAL(&muxGroup);
+  return due;
+}
+
+/*******************************************************************************
+ * groupUnhold
+ * - Drop the hold of a member, as the channel is started or stopped otherwise. True if it was held.
+ *   The member still counts as running until it stops (groupArrived).
+********************************************************************************/
+bool groupUnhold(int channel) {
+  portENTER_CRITICAL(&muxGroup);
+  bool held = groupHeld & (1 << channel);
+  groupHeld &= ~(1 << channel);
+  groupDue &= ~(1 << channel);
+  portEXIT_CRITICAL(&muxGroup);
+  return held;
+}
+
+/*******************************************************************************
+ * groupArrived
+ * - Record that a channel stopped. Completes the group move when the last member stopped.
+********************************************************************************/
+void groupArrived(int channel) {
+  bool completed = false;
+  unsigned long now = millis();
+
+  portENTER_CRITICAL(&muxGroup);
+  if (groupRunning & (1 << channel)) {
+    if (groupFirstArrival == 0) groupFirstArrival = now;
+    groupRunning &= ~(1 << channel);
+    if (groupRunning == 0) {
+      groupStats.ArrivalSkew = now - groupFirstArrival;
+      if (groupStats.ArrivalSkew > groupStats.MaxArrivalSkew) groupStats.MaxArrivalSkew = groupStats.ArrivalSkew;
+      groupStats.Count++;
+      completed = true;
+    }
+  }
+  portEXIT_CRITICAL(&muxGroup);
+
+  if (completed) {
+    Serial.printf(" - Group move done: start skew=%uus, arrival skew=%lums\n", groupStats.StartSkew, groupStats.ArrivalSkew);
+  }
+}
+
+/*******************************************************************************
+ * groupToJson
+ * - Add the group move skew figures to the provided JSON object, and the members (bit masks) of the last group move
+ *   whose start was held, or that were clamped but could not be held ("sync").
+********************************************************************************/
+void groupToJson(JsonObject obj) {
+  GroupMoveStats stats;
+  portENTER_CRITICAL(&muxGroup);
+  stats = groupStats;
+  portEXIT_CRITICAL(&muxGroup);
+
+  obj["n"] = stats.Count;
+  obj["start_us"] = stats.StartSkew;
+  obj["arrive_ms"] = stats.ArrivalSkew;
+  obj["arrive_max_ms"] = stats.MaxArrivalSkew;
+  obj["held"] = stats.Held;
+  obj["early"] = stats.Early;
+}
@@ -0,0 +1,89 @@
+/*******************************************************************************
+ * Homing
+ * - Re-establish the position of a channel when it is unknown (e.g. cold boot with the blinds part-open),
+ *   by running to the reference switch. The run is done by the motor task (MotorHoming).
+ * - With a rotation sensor, or a calibrated travel (time-based estimate), the CLOSED limit switch is the reference.
+ *   A channel that boots at the OPEN limit switch already knows its position.
+ * - The policy is set per channel (HomingMode): none, on the first command that needs the position,
+ *   immediately at boot, or at a scheduled (quiet) time of day. A command received while homing is queued,
+ *   and executed once homed. The latest command wins.
+ * - The result and the homing time are published by the main loop (reportHoming).
+********************************************************************************/
+#include <ArduinoJson.h>
+
+/*******************************************************************************
+ * homingModeName
+ * - Short name for a homing mode, as used in the appcmd and the MQTT payloads.
+********************************************************************************/
+const char* homingModeName(homingMode mode) {
+  switch (mode) {
+    case homCommand :    return "command";
+    case homBoot :       return "boot";
+    case homScheduled :  return "scheduled";
+    default :            return "none";
+  }
+}
+
+/*******************************************************************************
+ * homingNeeded
+ * - True if the position of the channel is used, but not known.
+********************************************************************************/
+bool homingNeeded(BlindChannel* ch) {
+  if (ch->Cfg.Open_MaxRotations > 0) {
+    return ch->mtr.currentPosition < 0;
+  }
+  if (deadReckonCalibrated(ch)) {
+    return !ch->estValid && !ch->swcClosed.Set && !ch->swcOpen.Set;
+  }
+  return false;                                   // Only full open/close, the position is not used.
+}
+
+/*******************************************************************************
+ * homingActive
+ * - True if a homing of the channel is requested or running.
+********************************************************************************/
+bool homingActive(BlindChannel* ch) {
+  return ch->homing.Request || ch->homing.Active;
+}
+
+/*******************************************************************************
+ * homingRequest
+ * - Request the homing of the channel, by the given trigger.
+********************************************************************************/
+void homingRequest(BlindChannel* ch, homingMode trigger) {
+  if (homingActive(ch)) return;
+  ch->homing.Trigger = trigger;
+  ch->homing.Request = true;
+}
+
+/*******************************************************************************
+ * homingQueue
+ * - Queue a command that needs the (unknown) position, and home first. Only if homing on command is enabled,
+ *   or a homing is already in progress.
+ * - Returns false if the command was not queued.
+********************************************************************************/
+bool homingQueue(BlindChannel* ch, blindsAction action, int target) {
+  if (ch->Cfg.HomingMode != homCommand && !homingActive(ch)) return false;
+
+  ch->homing.QueuedTarget = target;
+  ch->homing.QueuedAction = action;
+  homingRequest(ch, homCommand);
+  return true;
+}
+
+/*******************************************************************************
+ * homingToJson
+ * - Add the result of the last homing of the channel to the provided JSON object.
+********************************************************************************/
+void homingToJson(JsonObject obj, BlindChannel* ch) {
+  const Homing& homing = ch->homing;
+
+  obj["ch"] = ch->Index;
+  obj["trigger"] = homingModeName(homing.Trigger);
+  obj["result"] = homing.Success ? "ok" : "failed";
+  if (!homing.Success) {
+    obj["reason"] = stopReasonName(homing.FailReason);
+  }
+  obj["ms"] = homing.Duration;
+  obj["pos"] = (ch->Cfg.Open_MaxRotations > 0) ? ch->mtr.currentPosition : deadReckonPosition(ch);
+}
@@ -0,0 +1,228 @@
+/*******************************************************************************
+ * HttpApi
+ * - Local HTTP/REST API, so the blinds can be controlled and read without the MQTT broker.
+ * - Runs on the ESP-IDF HTTP server (esp_http_server): its own task on the network core, a fixed number of
+ *   connections (httpMaxConnections), and fixed size request buffers. The least recently used connection is
+ *   closed when a new one arrives and all are in use.
+ * - JSON responses are streamed in chunks of httpChunkSize (chunked transfer encoding), so a response of any
+ *   length needs no response buffer.
+ * - The endpoints are registered by main (httpRegister). Commands are not executed by the server task: they are
+ *   queued (httpCommands) and taken by the main loop, which passes them to remoteBlindsAction, like the
+ *   MQTT action topic. The request is answered with 202 once queued.
+ * - Reads are not done by the server task either: the query is queued (httpQueries), the main loop builds the
+ *   answer in httpAnswer (under httpAnswerLock, no locking needed against the loop's own data), and the server
+ *   task streams it. No answer within httpQueryTimeout (loop busy, e.g. an MQTT reconnect) is answered with 504.
+ * - The latency trace (LatencyTrace.h) of a command starts when the main loop takes it from the queue, not in the
+ *   server task: that runs on the other core, and the cycle counts of the two cores are not comparable.
+********************************************************************************/
+#include <esp_http_server.h>
+#include <ArduinoJson.h>
+
+struct HttpCommand {
+  int Channel;                                    // Channel index.
+  char Action[httpBodyLength];                    // Action, as received on the MQTT action topic (e.g. "open:50").
+};
+
+enum httpQueryKind {hqPosition, hqState, hqConfig, hqMetrics};
+
+struct HttpQuery {
+  httpQueryKind Kind;                             // What to answer.
+  int Channel;                                    // Channel index (position, config).
+  uint32_t Seq;                                   // Query number, to match the answer.
+};
+
+httpd_handle_t httpServer = NULL;
+QueueHandle_t httpCommands = NULL;                // Commands for the main loop.
+QueueHandle_t httpQueries = NULL;                 // Queries for the main loop.
+SemaphoreHandle_t httpAnswerLock = NULL;          // Mutex: httpAnswer and httpAnswerSeq.
+SemaphoreHandle_t httpAnswerReady = NULL;         // Given by the main loop when an answer was built.
+StaticJsonDocument<httpAnswerSize> httpAnswer;    // Answer to the last query, built by the main loop.
+uint32_t httpAnswerSeq = 0;                       // Query the answer belongs to.
+uint32_t httpQuerySeq = 0;                        // Last query number (server task only).
+
+/*******************************************************************************
+ * HttpChunkWriter
+ * - Print that collects the serialized JSON in chunks, and sends each full chunk as a chunk of the response.
+ * - After a failed send the rest is dropped, the error is kept (Error).
+********************************************************************************/
+class HttpChunkWriter : public Print {
+public:
+  esp_err_t Error = ESP_OK;
+
+  HttpChunkWriter(httpd_req_t* req) : _req(req), _length(0) {}
+
+  size_t write(uint8_t c) override {
+    _buffer[_length++] = c;
+    if (_length == sizeof(_buffer)) flush();
+    return 1;
+  }
+
+  size_t write(const uint8_t* data, size_t size) override {
+    for (size_t i = 0; i < size; i++) write(data[i]);
+    return size;
+  }
+
+  void flush() {
+    if (_length > 0 && Error == ESP_OK) Error = httpd_resp_send_chunk(_req, _buffer, _length);
+    _length = 0;
+  }
+
+private:
+  httpd_req_t* _req;
+  char _buffer[httpChunkSize];
+  size_t _length;
+};
+
+/*******************************************************************************
+ * httpSetup
+ * - Start the HTTP server, and create the command and query queues.
+ * - Returns false if the server could not be started.
+********************************************************************************/
+bool httpSetup() {
+  httpCommands = xQueueCreate(httpQueueLength, sizeof(HttpCommand));
+  httpQueries = xQueueCreate(1, sizeof(HttpQuery));
+  httpAnswerLock = xSemaphoreCreateMutex();
+  httpAnswerReady = xSemaphoreCreateBinary();
+
+  httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+  config.server_port = httpPort;
+  config.max_open_sockets = httpMaxConnections;
+  config.lru_purge_enable = true;
+  config.stack_size = stackHttpTask;
+  config.task_priority = prioHttpTask;
+  config.core_id = coreHttpTask;
+  config.max_uri_handlers = httpMaxEndpoints;
+  if (httpd_start(&httpServer, &config) != ESP_OK) {
+    httpServer = NULL;
+    return false;
+  }
+  return true;
+}
+
+/*******************************************************************************
+ * httpRegister
+ * - Register the handler of an endpoint.
+********************************************************************************/
+void httpRegister(const char* uri, httpd_method_t method, esp_err_t (*handler)(httpd_req_t*)) {
+  if (httpServer == NULL) return;
+  httpd_uri_t endpoint = {};
+  endpoint.uri = uri;
+  endpoint.method = method;
+  endpoint.handler = handler;
+  httpd_register_uri_handler(httpServer, &endpoint);
+}
+
+/*******************************************************************************
+ * httpChannel
+ * - Channel index from the "ch" query parameter (default 0 when there is no query or no "ch").
+ * - Returns -1 if it is not a valid channel: not a number, out of range, or a query or value that does not fit
+ *   the buffers (truncated).
+********************************************************************************/
+int httpChannel(httpd_req_t* req) {
+  char query[32];
+  char value[4];
+  esp_err_t err = httpd_req_get_url_query_str(req, query, sizeof(query));
+  if (err == ESP_OK) err = httpd_query_key_value(query, "ch", value, sizeof(value));
+  if (err == ESP_ERR_NOT_FOUND) return 0;
+  int ch;
+  if (err != ESP_OK || !settingInt(value, 0, channelCount - 1, &ch)) return -1;
+  return ch;
+}
+
+/*******************************************************************************
+ * httpBody
+ * - Read the request body into the buffer (terminated). Returns false if it is empty, too long or not received.
+********************************************************************************/
+bool httpBody(httpd_req_t* req, char* buffer, size_t size) {
+  if (req->content_len == 0 || req->content_len >= size) return false;
+  size_t received = 0;
+  while (received < req->content_len) {
+    int n = httpd_req_recv(req, buffer + received, req->content_len - received);
+    if (n <= 0) return false;
+    received += n;
+  }
+  buffer[received] = 0;
+  return true;
+}
+
+/*******************************************************************************
+ * httpSendJson
+ * - Stream the document as the response. A document that ran out of capacity is incomplete: 500, not sent.
+********************************************************************************/
+esp_err_t httpSendJson(httpd_req_t* req, JsonDocument& doc) {
+  if (doc.overflowed()) return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "response too large");
+
+  httpd_resp_set_type(req, "application/json");
+  HttpChunkWriter writer(req);
+  serializeJson(doc, writer);
+  writer.flush();
+  if (writer.Error != ESP_OK) return writer.Error;
+  return httpd_resp_send_chunk(req, NULL, 0);                 // End of the chunked response.
+}
+
+/*******************************************************************************
+ * httpQueueCommand
+ * - Queue an action for the main loop, and answer the request: 202 if queued, 503 if the queue is full.
+********************************************************************************/
+esp_err_t httpQueueCommand(httpd_req_t* req, int ch, const char* action) {
+  HttpCommand cmd;
+  cmd.Channel = ch;
+  strncpy(cmd.Action, action, sizeof(cmd.Action) - 1);
+  cmd.Action[sizeof(cmd.Action) - 1] = 0;
+  if (xQueueSend(httpCommands, &cmd, 0) != pdTRUE) {
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    return httpd_resp_sendstr(req, "busy");
+  }
+
+  StaticJsonDocument<96> doc;
+  doc["ch"] = ch;
+  doc["queued"] = cmd.Action;
+  httpd_resp_set_status(req, "202 Accepted");
+  return httpSendJson(req, doc);
+}
+
+/*******************************************************************************
+ * httpQuery
+ * - Queue a query for the main loop, wait for its answer and send it. 503 if a query is already queued,
+ *   504 if the main loop did not answer within httpQueryTimeout. A query the loop has not taken yet is then
+ *   withdrawn, so the next request is not refused and the loop does not build an answer nobody waits for.
+ *   Server task.
+********************************************************************************/
+esp_err_t httpQuery(httpd_req_t* req, httpQueryKind kind, int ch) {
+  HttpQuery query = {kind, ch, ++httpQuerySeq};
+  xSemaphoreTake(httpAnswerReady, 0);                       // Drop the late answer of a query that timed out.
+  if (xQueueSend(httpQueries, &query, 0) != pdTRUE) {
+    httpd_resp_set_status(req, "503 Service Unavailable");
+    return httpd_resp_sendstr(req, "busy");
+  }
+
+  while (xSemaphoreTake(httpAnswerReady, pdMS_TO_TICKS(httpQueryTimeout)) == pdTRUE) {
+    xSemaphoreTake(httpAnswerLock, portMAX_DELAY);
+    if (httpAnswerSeq == query.Seq) {
+      esp_err_t err = httpSendJson(req, httpAnswer);
+      xSemaphoreGive(httpAnswerLock);
+      return err;
+    }
+    xSemaphoreGive(httpAnswerLock);                         // Late answer of an earlier query: keep waiting.
+  }
+  xQueueReceive(httpQueries, &query, 0);                    // Not taken by the main loop: withdraw it.
+  httpd_resp_set_status(req, "504 Gateway Timeout");
+  return httpd_resp_sendstr(req, "no answer");
+}
+
+/*******************************************************************************
+ * httpAnswerQueries
+ * - Build the answer of the queued query (if any) with the provided function, and hand it to the server task.
+ *   Main loop.
+********************************************************************************/
+void httpAnswerQueries(void (*build)(JsonObject, const HttpQuery&)) {
+  HttpQuery query;
+  if (httpQueries == NULL || xQueueReceive(httpQueries, &query, 0) != pdTRUE) return;
+
+  xSemaphoreTake(httpAnswerLock, portMAX_DELAY);
+  httpAnswer.clear();
+  build(httpAnswer.to<JsonObject>(), query);
+  httpAnswerSeq = query.Seq;
+  xSemaphoreGive(httpAnswerLock);
+  xSemaphoreGive(httpAnswerReady);
+}
@@ -0,0 +1,130 @@
+/*******************************************************************************
+ * JsonDelta
+ * - Change tracking of the top-level fields of a JSON message (config, app_state), so that a periodic publish
+ *   only carries the fields that changed since the last publish (delta topic).
+ * - Per field only a hash of the name and of the serialized value is kept (DeltaTracker), not the values.
+ *   A changed nested object or array is published as a whole.
+ * - A full snapshot (getconfig, getstate, and every deltaSnapshotInterval) records all fields as the new baseline.
+ *   Without a baseline a delta can not be made, and a snapshot is due. The caller drops the baseline when a
+ *   publish fails, so changes that did not go out are not lost, and on every MQTT connect (missed deltas).
+ * - A message that goes to several topics with their own snapshots (the shared settings, in the retained config of
+ *   every channel) has a tracker per topic, and its delta is made against all of them (deltaReduceAny).
+********************************************************************************/
+#include <ArduinoJson.h>
+
+DeltaTracker stateDelta;                          // app_state fields last published
+
+/*******************************************************************************
+ * DeltaHash
+ * - Print that computes the FNV-1a hash of what is written to it (the serialized value, no buffer).
+********************************************************************************/
+class DeltaHash : public Print {
+public:
+  uint32_t Hash = 2166136261u;
+
+  size_t write(uint8_t c) override {
+    Hash = (Hash ^ c) * 16777619u;
+    return 1;
+  }
+
+  size_t write(const uint8_t* data, size_t size) override {
+    for (size_t i = 0; i < size; i++) write(data[i]);
+    return size;
+  }
+};
+
+/*******************************************************************************
+ * deltaChanged
+ * - Record the field in the tracker. Returns true if it is new or its value changed since it was last recorded.
+ * - A field that does not fit in the tracker (deltaMaxFields) is always reported as changed.
+********************************************************************************/
+bool deltaChanged(DeltaTracker& t, const char* key, JsonVariant value) {
+  DeltaHash keyHash;
+  keyHash.print(key);
+  DeltaHash valueHash;
+  serializeJson(value, valueHash);
+
+  for (int i = 0; i < t.Count; i++) {
+    if (t.Fields[i].Key == keyHash.Hash) {
+      if (t.Fields[i].Value == valueHash.Hash) return false;
+      t.Fields[i].Value = valueHash.Hash;
+      return true;
+    }
+  }
+  if (t.Count < deltaMaxFields) {
+    t.Fields[t.Count].Key = keyHash.Hash;
+    t.Fields[t.Count].Value = valueHash.Hash;
+    t.Count++;
+  }
+  return true;
+}
+
+/*******************************************************************************
+ * deltaSnapshotDue
+ * - True if the next publish must be a full snapshot: no baseline yet, or deltaSnapshotInterval expired.
+********************************************************************************/
+bool deltaSnapshotDue(DeltaTracker& t) {
+  return !t.Baseline || (millis() - t.SnapshotTime) / 60000 >= (unsigned long) deltaSnapshotInterval;
+}
+
+/*******************************************************************************
+ * deltaSnapshot
+ * - Record all fields of the (full) message as the new baseline.
+********************************************************************************/
+void deltaSnapshot(DeltaTracker& t, JsonObject obj) {
+  for (JsonPair field : obj) {
+    deltaChanged(t, field.key().c_str(), field.value());
+  }
+  t.Baseline = true;
+  t.SnapshotTime = millis();
+}
+
+/*******************************************************************************
+ * deltaReduce
+ * - Remove the unchanged fields from the message, leaving the delta. The field "keep" (if any) always stays,
+ *   e.g. the channel number of a config delta.
+ * - Returns the number of changed fields (0 = nothing to publish).
+********************************************************************************/
+int deltaReduce(DeltaTracker& t, JsonObject obj, const char* keep = NULL) {
+  const char* unchanged[deltaMaxFields];
+  int removals = 0;
+  int changed = 0;
+
+  for (JsonPair field : obj) {
+    const char* key = field.key().c_str();
+    if (keep != NULL && strcmp(key, keep) == 0) continue;
+    if (deltaChanged(t, key, field.value())) {
+      changed++;
+    } else if (removals < deltaMaxFields) {
+      unchanged[removals++] = key;
+    }
+  }
+  for (int i = 0; i < removals; i++) obj.remove(unchanged[i]);   // Names stay valid: removing does not free the pool.
+  return changed;
+}
+
+/*******************************************************************************
+ * deltaReduceAny
+ * - deltaReduce against the trackers of several topics: a field stays if it changed for any of them, and is
+ *   recorded in all. Trackers without a baseline are skipped (their topic gets a snapshot).
+ * - Returns the number of fields left (0 = nothing to publish).
+********************************************************************************/
+int deltaReduceAny(DeltaTracker* trackers[], int count, JsonObject obj) {
+  const char* unchanged[deltaMaxFields];
+  int removals = 0;
+  int changed = 0;
+
+  for (JsonPair field : obj) {
+    bool fieldChanged = false;
+    for (int i = 0; i < count; i++) {
+      if (trackers[i]->Baseline && deltaChanged(*trackers[i], field.key().c_str(), field.value())) fieldChanged = true;
+    }
+    if (fieldChanged) {
+      changed++;
+    } else if (removals < deltaMaxFields) {
+      unchanged[removals++] = field.key().c_str();
+    }
+  }
+  for (int i = 0; i < removals; i++) obj.remove(unchanged[i]);
+  return changed;
+}
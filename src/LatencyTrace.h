@@ -0,0 +1,145 @@
+/*******************************************************************************
+ * LatencyTrace
+ * - Timestamps an MQTT blinds command at each stage between receipt and PWM applied:
+ *     MQTT_callback -> remoteBlindsAction -> loop_MotorActions -> MotorStart -> ledcWrite
+ * - Timestamps are CPU cycle counts, which are per core. Every stage is marked on core 1 (the MQTT loop, also for
+ *   the HTTP API commands, and the motor task), so the counts are comparable. Never mark a stage from core 0.
+ * - Each stage delta (and the total) is added to a fixed-bucket histogram, giving p50/p99/max without storing samples.
+ * - Buckets are log-linear in micro-seconds: each power of 2 is split into latencySubBuckets linear sub-buckets
+ *   (values below latencySubBuckets us have a bucket each). A percentile is reported as the upper bound of its
+ *   bucket, at most 1/latencySubBuckets (12.5%) over the exact value.
+********************************************************************************/
+#include <ArduinoJson.h>
+
+enum latencyStage {latReceived, latQueued, latPicked, latStarted, latApplied, latCOUNT};
+
+const int latencySubBits = 3;                     // 2^3 = 8 linear sub-buckets per power of 2.
+const int latencySubBuckets = 1 << latencySubBits;
+const int latencyOctaves = 24;                    // 2^24 us = ~16 seconds upper bucket (anything slower lands in the last bucket).
+const int latencyBuckets = (latencyOctaves - latencySubBits + 1) * latencySubBuckets;
+
+struct LatencyHistogram {
+  uint32_t Count;                                 // Number of samples.
+  uint32_t Max;                                   // Largest sample (us).
+  uint32_t Bucket[latencyBuckets];                // Number of samples per bucket.
+};
+
+LatencyHistogram latencyHist[latCOUNT];           // Histogram per stage delta (index = stage reached). Index 0 (latReceived) holds the total.
+uint32_t latencyStamp[latCOUNT];                  // Cycle count at which each stage of the current trace was reached.
+int latencyLastStage = -1;                        // Last stage reached by the current trace (-1 = no trace active).
+
+portMUX_TYPE muxLatency = portMUX_INITIALIZER_UNLOCKED;
+
+/*******************************************************************************
+ * latencyBucket / latencyBucketUpper
+ * - Bucket of a sample (us): the power of 2 it is in, and the linear sub-bucket within it.
+ * - Largest sample (us) of a bucket.
+********************************************************************************/
+int latencyBucket(uint32_t us) {
+  if (us < (uint32_t) latencySubBuckets) return us;
+  int shift = 31 - __builtin_clz(us) - latencySubBits;
+  int bucket = (shift + 1) * latencySubBuckets + (us >> shift) - latencySubBuckets;
+  return (bucket < latencyBuckets) ? bucket : latencyBuckets - 1;
+}
+
+uint32_t latencyBucketUpper(int bucket) {
+  if (bucket < latencySubBuckets) return bucket;
+  int shift = bucket / latencySubBuckets - 1;
+  return ((uint32_t) (bucket % latencySubBuckets + latencySubBuckets + 1) << shift) - 1;
+}
+
+/*******************************************************************************
+ * latencyAdd
+ * - Add a sample (us) to a histogram.
+********************************************************************************/
+void latencyAdd(LatencyHistogram& hist, uint32_t us) {
+  hist.Bucket[latencyBucket(us)]++;
+  hist.Count++;
+  if (us > hist.Max) hist.Max = us;
+}
+
+/*******************************************************************************
+ * latencyMark
+ * - Record that the command reached the given stage.
+ * - "latReceived" starts a new trace. Other stages are only recorded if they directly follow the previous stage,
+ *   so e.g. button-initiated motor starts (that never passed through MQTT) are not traced.
+ * - When the final stage is reached the stage deltas are added to the histograms.
+********************************************************************************/
+void latencyMark(latencyStage stage) {
+  uint32_t now = ESP.getCycleCount();
+
+  portENTER_CRITICAL(&muxLatency);
+  if (stage == latReceived) {
+    latencyStamp[latReceived] = now;
+    latencyLastStage = latReceived;
+  } else if (latencyLastStage == stage - 1) {
+    latencyStamp[stage] = now;
+    latencyLastStage = stage;
+    if (stage == latApplied) {
+      uint32_t cyclesPerUs = getCpuFrequencyMhz();
+      for (int i = latQueued; i < latCOUNT; i++) {
+        latencyAdd(latencyHist[i], (latencyStamp[i] - latencyStamp[i-1]) / cyclesPerUs);
+      }
+      latencyAdd(latencyHist[latReceived], (latencyStamp[latApplied] - latencyStamp[latReceived]) / cyclesPerUs);
+      latencyLastStage = -1;
+    }
+  }
+  portEXIT_CRITICAL(&muxLatency);
+}
+
+/*******************************************************************************
+ * latencyPercentile
+ * - Approximate percentile (us) from a histogram: upper bound of the bucket holding the percentile, capped at the max.
+********************************************************************************/
+uint32_t latencyPercentile(const LatencyHistogram& hist, int percentile) {
+  if (hist.Count == 0) return 0;
+  uint32_t target = (hist.Count * percentile + 99) / 100;
+  uint32_t cumulative = 0;
+  for (int i = 0; i < latencyBuckets; i++) {
+    cumulative += hist.Bucket[i];
+    if (cumulative >= target) {
+      uint32_t upper = latencyBucketUpper(i);
+      return (upper < hist.Max) ? upper : hist.Max;
+    }
+  }
+  return hist.Max;
+}
+
+/*******************************************************************************
+ * latencyToJson
+ * - Add the count/p50/p99/max of a histogram to the provided JSON object.
+********************************************************************************/
+void latencyToJson(JsonObject obj, int stage) {
+  LatencyHistogram hist;
+  portENTER_CRITICAL(&muxLatency);
+  hist = latencyHist[stage];
+  portEXIT_CRITICAL(&muxLatency);
+
+  obj["n"] = hist.Count;
+  obj["p50"] = latencyPercentile(hist, 50);
+  obj["p99"] = latencyPercentile(hist, 99);
+  obj["max"] = hist.Max;
+}
+
+/*******************************************************************************
+ * latencyStagesToJson
+ * - Add the histogram summary for every stage delta, and the total, to the provided JSON object.
+********************************************************************************/
+void latencyStagesToJson(JsonObject obj) {
+  latencyToJson(obj.createNestedObject("queue"), latQueued);        // MQTT_callback -> action flagged for motor task
+  latencyToJson(obj.createNestedObject("pickup"), latPicked);       // action flagged -> picked up by loop_MotorActions
+  latencyToJson(obj.createNestedObject("start"), latStarted);       // picked up -> MotorStart
+  latencyToJson(obj.createNestedObject("pwm"), latApplied);         // MotorStart -> first PWM duty cycle applied
+  latencyToJson(obj.createNestedObject("total"), latReceived);      // MQTT_callback -> first PWM duty cycle applied
+}
+
+/*******************************************************************************
+ * latencyReset
+ * - Clear all histograms.
+********************************************************************************/
+void latencyReset() {
+  portENTER_CRITICAL(&muxLatency);
+  memset(latencyHist, 0, sizeof(latencyHist));
+  latencyLastStage = -1;
+  portEXIT_CRITICAL(&muxLatency);
+}
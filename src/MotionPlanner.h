@@ -0,0 +1,289 @@
+/*******************************************************************************
+ * MotionPlanner
+ * - Trapezoidal (accelerate / cruise / decelerate) duty cycle profile for MQTT position moves.
+ * - The plan is made from the distance to travel (targetPosition - currentPosition) and the learned motor speed.
+ * - planControl runs from the fixed-rate motion control task. It sets the duty cycle from the planned speed,
+ *   corrected by the planned-versus-actual position error. The rotation count still stops the motor at the target.
+ * - The motor speed (at full duty cycle) is learned from the time between rotations while running at full duty.
+ *   Moves are not planned until the speed of the channel was learned.
+ * - The error is sampled during the move, and published as a summary when the move completes.
+ * - A new target in the same direction re-plans the rest of the move from the planned position and speed. A target
+ *   in the other direction reverses the motor: decelerate, dead-time, restart (retargetMove, retargetStep).
+********************************************************************************/
+#include <ArduinoJson.h>
+
+portMUX_TYPE muxPlan = portMUX_INITIALIZER_UNLOCKED;
+
+/*******************************************************************************
+ * planLearnSpeed
+ * - Update the learned speed (rotations/second at full duty) when a new rotation was counted.
+ * - Only intervals between two rotations both seen at full duty cycle are used.
+********************************************************************************/
+void planLearnSpeed(BlindChannel* ch) {
+  int position = ch->mtr.currentPosition;
+
+  if (!ch->mtr.IsRunning) {
+    ch->learnPosition = position;
+    ch->learnTime = 0;
+    return;
+  }
+  if (position != ch->learnPosition) {
+    unsigned long rotationTime = ch->lastRotationDebounceTime;
+    bool fullDuty = (ch->dutyCycle >= 255);
+    if (fullDuty && ch->learnTime != 0 && rotationTime > ch->learnTime) {
+      float speed = 1000.0 / (rotationTime - ch->learnTime);
+      ch->learnedSpeed = (ch->learnedSpeed == 0) ? speed : ch->learnedSpeed * 0.8 + speed * 0.2;
+    }
+    ch->learnPosition = position;
+    ch->learnTime = fullDuty ? rotationTime : 0;
+  }
+}
+
+/*******************************************************************************
+ * planPosition
+ * - Planned distance travelled (rotations) and speed (rotations/second) at t seconds into the move.
+ * - The current profile starts at Tstart, at distance Offset and speed V0 (all 0 unless retargeted).
+********************************************************************************/
+float planPosition(const MotionPlan& plan, float t, float* speed) {
+  float accDistance = plan.Offset + (plan.V0 + plan.Vmax) * plan.Tacc / 2;
+  float total = plan.Tacc + plan.Tcruise + plan.Tdec;
+
+  t = max(t - plan.Tstart, 0.0f);
+  if (t < plan.Tacc) {
+    *speed = plan.V0 + (plan.Vmax - plan.V0) * t / plan.Tacc;
+    return plan.Offset + plan.V0 * t + (plan.Vmax - plan.V0) * t * t / (2 * plan.Tacc);
+  } else if (t < plan.Tacc + plan.Tcruise) {
+    *speed = plan.Vmax;
+    return accDistance + plan.Vmax * (t - plan.Tacc);
+  } else if (t < total) {
+    float left = total - t;
+    *speed = plan.Vmax * left / plan.Tdec;
+    return plan.Distance - plan.Vmax * left * left / (2 * plan.Tdec);
+  }
+  *speed = 0;
+  return plan.Distance;
+}
+
+/*******************************************************************************
+ * planStart
+ * - Plan the move of the channel, if it is a position move and the speed was learned.
+ * - Returns true if the planner controls the move (no soft-start ramp needed).
+********************************************************************************/
+bool planStart(BlindChannel* ch) {
+  MotionPlan& plan = ch->plan;
+  int distance = abs(ch->mtr.targetPosition - ch->mtr.currentPosition);
+
+  if ( ch->mtr.Owner != ownMQTT || ch->Cfg.Open_MaxRotations <= 0 || ch->learnedSpeed <= 0 ||
+       ch->mtr.targetPosition < 0 || ch->mtr.currentPosition < 0 || distance == 0 ) {
+    return false;
+  }
+
+  plan.StartTime = millis();
+  plan.StopTime = 0;
+  plan.StartPosition = ch->mtr.currentPosition;
+  plan.Distance = distance;
+  plan.Tstart = 0;
+  plan.Offset = 0;
+  plan.V0 = 0;
+  plan.Vmax = ch->learnedSpeed * ch->dutyMax / 255;
+  plan.Tacc = planAccelTime / 1000.0;
+  plan.Tdec = planDecelTime / 1000.0;
+  float rampDistance = plan.Vmax * (plan.Tacc + plan.Tdec) / 2;
+  if (rampDistance > distance) {
+    // Short move: no cruise phase, lower the peak speed (triangular profile).
+    plan.Vmax = 2 * distance / (plan.Tacc + plan.Tdec);
+    plan.Tcruise = 0;
+  } else {
+    plan.Tcruise = (distance - rampDistance) / plan.Vmax;
+  }
+  plan.Error = 0;
+  plan.MaxError = 0;
+  plan.SampleCount = 0;
+  plan.LastSample = plan.StartTime;
+  plan.Done = false;
+  plan.Active = true;
+  return true;
+}
+
+/*******************************************************************************
+ * planRetarget
+ * - The target of the planned move changed, in the same direction. Re-plan the rest of the move from the planned
+ *   position and speed now, at the acceleration and deceleration rates of a full move (planAccelTime,
+ *   planDecelTime at the learned speed): to the peak speed that still stops at the target, cruising if that is
+ *   above the max speed.
+ * - If the new target is closer than the stopping distance at the normal rate, the deceleration starts right away
+ *   (harder), so the plan still ends at the target at speed 0. A target the plan already passed ends the plan.
+********************************************************************************/
+void planRetarget(BlindChannel* ch) {
+  MotionPlan& plan = ch->plan;
+  if (!plan.Active) return;
+
+  float t = (millis() - plan.StartTime) / 1000.0;
+  float speed;
+  float position = planPosition(plan, t, &speed);
+  float vCap = ch->learnedSpeed * ch->dutyMax / 255;
+  float accRate = vCap * 1000 / planAccelTime;
+  float decRate = vCap * 1000 / planDecelTime;
+
+  plan.Distance = abs(ch->mtr.targetPosition - plan.StartPosition);
+  plan.Tstart = t;
+  plan.Offset = position;
+  plan.V0 = speed;
+  float left = plan.Distance - position;
+  if (left <= 0) {
+    plan.Offset = plan.Distance;                  // Passed: nothing left to plan.
+    plan.V0 = plan.Vmax = 0;
+    plan.Tacc = plan.Tcruise = plan.Tdec = 0;
+    return;
+  }
+  if (left <= speed * speed / (2 * decRate)) {
+    plan.Vmax = speed;                            // Decelerate right away, over the distance left.
+    plan.Tacc = plan.Tcruise = 0;
+    plan.Tdec = 2 * left / speed;
+    return;
+  }
+
+  float peak = sqrtf((left + speed * speed / (2 * accRate)) / (1 / (2 * accRate) + 1 / (2 * decRate)));
+  plan.Vmax = min(peak, max(vCap, speed));
+  plan.Tacc = (plan.Vmax - speed) / accRate;
+  plan.Tdec = plan.Vmax / decRate;
+  float rampDistance = (speed + plan.Vmax) * plan.Tacc / 2 + plan.Vmax * plan.Tdec / 2;
+  plan.Tcruise = max((left - rampDistance) / plan.Vmax, 0.0f);
+}
+
+/*******************************************************************************
+ * planControl
+ * - Control step: set the duty cycle from the planned speed plus the position error correction.
+ * - After the planned duration the motor keeps turning at the minimum duty until the rotation count stops it.
+********************************************************************************/
+void planControl(BlindChannel* ch) {
+  MotionPlan& plan = ch->plan;
+  unsigned long now = millis();
+  float speed;
+  float planned = planPosition(plan, (now - plan.StartTime) / 1000.0, &speed);
+  int actual = abs(ch->mtr.currentPosition - plan.StartPosition);
+
+  plan.Error = planned - actual;
+  if (fabs(plan.Error) > plan.MaxError) plan.MaxError = fabs(plan.Error);
+  if (now - plan.LastSample >= planSampleInterval && plan.SampleCount < planMaxSamples) {
+    plan.Samples[plan.SampleCount++] = (int16_t) round(plan.Error * 10);
+    plan.LastSample = now;
+  }
+
+  int duty = round(255 * speed / ch->learnedSpeed + planKp * plan.Error);
+  duty = constrain(duty, planMinDuty, ch->dutyMax);
+
+  portENTER_CRITICAL(&muxPlan);
+  if (plan.Active) {
+    driverDuty(ch, ch->mtr.Action, duty);
+    ch->dutyCycle = duty;
+  }
+  portEXIT_CRITICAL(&muxPlan);
+}
+
+/*******************************************************************************
+ * planStop
+ * - End the planned move (called when the motor is stopped), and flag its summary for publishing.
+********************************************************************************/
+void planStop(BlindChannel* ch) {
+  portENTER_CRITICAL(&muxPlan);
+  bool wasActive = ch->plan.Active;
+  ch->plan.Active = false;
+  portEXIT_CRITICAL(&muxPlan);
+
+  if (wasActive) {
+    ch->plan.StopTime = millis();
+    ch->plan.Error = ch->plan.Distance - abs(ch->mtr.currentPosition - ch->plan.StartPosition);
+    ch->plan.Done = true;
+  }
+}
+
+/*******************************************************************************
+ * retargetMove
+ * - A new MQTT target arrived while the motor is running (e.g. HA slider dragged).
+ * - Same direction: just move the target (and re-plan the move, planRetarget).
+ * - Other direction: decelerate, wait the dead-time, then restart in the other direction (see retargetStep).
+ * - During a reversal, newer targets replace the pending one. The direction is decided when restarting.
+********************************************************************************/
+void retargetMove(BlindChannel* ch, blindsAction action, int target) {
+  if (ch->retarget.Phase != rtgNone) {
+    ch->retarget.Action = action;
+    ch->retarget.Target = target;
+    Serial.printf(" - Retarget ch%d: pending reversal now to %d\n", ch->Index, target);
+  } else if (action == ch->mtr.Action) {
+    ch->mtr.targetPosition = target;
+    planRetarget(ch);
+    Serial.printf(" - Retarget ch%d: same direction, target %d\n", ch->Index, target);
+  } else {
+    planStop(ch);                                       // The planner no longer controls the duty cycle.
+    ch->rampActive = false;
+    wheelCancel(ch->tmrRamp);
+    ch->retarget.Action = action;
+    ch->retarget.Target = target;
+    ch->retarget.StartDuty = ch->dutyCycle;
+    ch->retarget.PhaseStart = millis();
+    ch->retarget.Phase = rtgDecel;
+    Serial.printf(" - Retarget ch%d: reversing to %d\n", ch->Index, target);
+  }
+}
+
+/*******************************************************************************
+ * retargetStep
+ * - Step the direction reversal of a retargeted move. Position: current position of the channel (-1 = unknown).
+ * - Decel: lower the duty cycle to 0 over retargetDecelTime, then rtsStop: the caller stops the motor (journal:
+ *   "Retarget"), the dead-time starts.
+ * - Dead-time: after retargetDeadTime, rtsStart: the motor action is set towards the latest target, the caller
+ *   starts the motor. Not if something else started the motor meanwhile, it is already there, or at the limit.
+********************************************************************************/
+retargetStepResult retargetStep(BlindChannel* ch, int position) {
+  unsigned long elapsed = millis() - ch->retarget.PhaseStart;
+
+  if (ch->retarget.Phase == rtgDecel) {
+    if (elapsed < retargetDecelTime) {
+      ch->dutyCycle = ch->retarget.StartDuty * (retargetDecelTime - elapsed) / retargetDecelTime;
+      driverDuty(ch, ch->mtr.Action, ch->dutyCycle);
+      return rtsNone;
+    }
+    ch->retarget.PhaseStart = millis();
+    ch->retarget.Phase = rtgDeadTime;
+    return rtsStop;
+  }
+  if (ch->retarget.Phase != rtgDeadTime || elapsed < retargetDeadTime) return rtsNone;
+
+  ch->retarget.Phase = rtgNone;
+  if (ch->mtr.IsRunning) return rtsNone;                // Something else (e.g. a button) started the motor in the meantime.
+
+  blindsAction action = ch->retarget.Action;
+  if (ch->retarget.Target >= 0 && position >= 0) {
+    if (ch->retarget.Target == position) return rtsNone;                // Already there.
+    action = (ch->retarget.Target > position) ? actBlindsOpen : actBlindsClose;
+  }
+  if ( (action == actBlindsOpen && ch->swcOpen.Set) || (action == actBlindsClose && ch->swcClosed.Set) ) return rtsNone;
+
+  ch->mtr.Action = action;
+  ch->mtr.targetPosition = ch->retarget.Target;
+  ch->mtr.AllowToRun = true;
+  ch->mtr.Owner = ownMQTT;
+  return rtsStart;
+}
+
+/*******************************************************************************
+ * planToJson
+ * - Add the summary of the last planned move of the channel to the provided JSON object.
+********************************************************************************/
+void planToJson(JsonObject obj, BlindChannel* ch) {
+  const MotionPlan& plan = ch->plan;
+
+  obj["ch"] = ch->Index;
+  obj["dist"] = plan.Distance;
+  obj["speed"] = round(ch->learnedSpeed * 100) / 100;                           // learned speed (rotations/second)
+  obj["vmax"] = round(plan.Vmax * 100) / 100;                                   // planned cruise speed (rotations/second)
+  obj["plan_ms"] = (int) ((plan.Tstart + plan.Tacc + plan.Tcruise + plan.Tdec) * 1000);
+  obj["run_ms"] = plan.StopTime - plan.StartTime;
+  obj["maxErr"] = round(plan.MaxError * 10) / 10;                               // rotations
+  obj["endErr"] = round(plan.Error * 10) / 10;                                  // rotations short of (+) or past (-) the target
+  JsonArray samples = obj.createNestedArray("err");                             // error samples (tenths of a rotation)
+  for (int i = 0; i < plan.SampleCount; i++) {
+    samples.add(plan.Samples[i]);
+  }
+}
@@ -0,0 +1,262 @@
+/*******************************************************************************
+ * MotorDriver
+ * - Drives the IBT-2 H-bridge of a channel, behind MotorStart/MotorStop. The backend is selected in configuration.h:
+ *   - LEDC (default): PWM on RPWM (open) or LPWM (close), the other output low. R_EN/L_EN enable the driver.
+ *   - MCPWM (MOTOR_DRIVER_MCPWM): locked anti-phase. LPWM is the hardware complement of RPWM with dead-time,
+ *     50% duty is standstill. A fault input (active low) forces both outputs low, cycle by cycle.
+ * - With either backend the fault input also stops the motor in software (isrDriverFault in main).
+ * - Stop modes: coast (driver disabled, motor spins down freely), or brake (both low-side switches on for
+ *   driverBrakeTime, then disabled).
+ * - The stopping distance (rotations counted after the stop) is measured per mode, to compare brake and coast.
+ * - Limit switch cut-off: the limit switch interrupts drop R_EN/L_EN straight away (driverCutoff), by writing the GPIO
+ *   registers from IRAM. The motor task stops the motor as usual afterwards. The time from interrupt entry to enable
+ *   low, and from there to the stop processed by the motor task, is measured.
+********************************************************************************/
+#include <ArduinoJson.h>
+#include <soc/gpio_struct.h>
+#ifdef MOTOR_DRIVER_MCPWM
+#include <driver/mcpwm.h>
+#endif
+
+unsigned long stopDistanceSum[maxChannels][2];    // Rotations counted after stops, per channel and mode (0 = coast, 1 = brake).
+unsigned long stopDistanceCount[maxChannels][2];  // Number of measured stops, per channel and mode.
+
+struct CutoffStats {
+  uint32_t Count;                                 // Number of limit switch cut-offs.
+  uint32_t SumCycles;                             // Interrupt entry to enable pins low (CPU cycles).
+  uint32_t MaxCycles;
+  uint32_t SumStop;                               // Enable pins low to stop processed by the motor task (us).
+  uint32_t MaxStop;
+};
+
+CutoffStats cutoffStats;
+
+#ifdef MOTOR_DRIVER_MCPWM
+// Channels 0-2 use the timers of MCPWM unit 0, channel 3 uses unit 1.
+#define DRIVER_UNIT(ch)   ((ch)->Index < 3 ? MCPWM_UNIT_0 : MCPWM_UNIT_1)
+#define DRIVER_TIMER(ch)  ((mcpwm_timer_t) ((ch)->Index % 3))
+#endif
+
+/*******************************************************************************
+ * driverOnBrakeTimer
+ * - The brake time passed: flag the driver to be disabled by driverService. Timer wheel callback (tmrBrake).
+********************************************************************************/
+void driverOnBrakeTimer(void* arg) {
+  ((BlindChannel*) arg)->brakeRelease = true;
+}
+
+/*******************************************************************************
+ * driverSetup
+ * - Configure the driver pins and the PWM backend of the channel. Driver disabled.
+********************************************************************************/
+void driverSetup(BlindChannel* ch) {
+  pinMode(ch->Pin->REN, OUTPUT);                           // Enable RIGHT rotation
+  pinMode(ch->Pin->LEN, OUTPUT);                           // Enable LEFT rotation
+  digitalWrite(ch->Pin->REN, LOW);
+  digitalWrite(ch->Pin->LEN, LOW);
+  wheelInit(ch->tmrBrake, driverOnBrakeTimer, ch);
+  ch->enMask = ch->enMask1 = 0;
+  for (int pin : {ch->Pin->REN, ch->Pin->LEN}) {
+    if (pin < 32) { ch->enMask |= 1UL << pin; } else { ch->enMask1 |= 1UL << (pin - 32); }
+  }
+
+#ifdef MOTOR_DRIVER_MCPWM
+  mcpwm_unit_t unit = DRIVER_UNIT(ch);
+  mcpwm_timer_t timer = DRIVER_TIMER(ch);
+  mcpwm_gpio_init(unit, (mcpwm_io_signals_t) (MCPWM0A + timer * 2), ch->Pin->RPWM);
+  mcpwm_gpio_init(unit, (mcpwm_io_signals_t) (MCPWM0B + timer * 2), ch->Pin->LPWM);
+
+  mcpwm_config_t pwmConfig = {};
+  pwmConfig.frequency = pwmFrequency;
+  pwmConfig.cmpr_a = 50;
+  pwmConfig.counter_mode = MCPWM_UP_COUNTER;
+  pwmConfig.duty_mode = MCPWM_DUTY_MODE_0;
+  mcpwm_init(unit, timer, &pwmConfig);
+  mcpwm_deadtime_enable(unit, timer, MCPWM_ACTIVE_HIGH_COMPLIMENT_MODE, mcpwmDeadTime, mcpwmDeadTime);
+
+  if (ch->Pin->Fault >= 0) {
+    mcpwm_gpio_init(unit, (mcpwm_io_signals_t) (MCPWM_FAULT_0 + timer), ch->Pin->Fault);
+    gpio_pullup_en((gpio_num_t) ch->Pin->Fault);
+    mcpwm_fault_init(unit, MCPWM_LOW_LEVEL_TGR, (mcpwm_fault_signal_t) timer);
+    mcpwm_fault_set_cyc_mode(unit, timer, (mcpwm_fault_signal_t) timer, MCPWM_FORCE_MCPWMXA_LOW, MCPWM_FORCE_MCPWMXB_LOW);
+  }
+  mcpwm_set_signal_low(unit, timer, MCPWM_OPR_A);
+  mcpwm_set_signal_low(unit, timer, MCPWM_OPR_B);
+#else
+  pinMode(ch->Pin->RPWM, OUTPUT);                          // RIGHT pulse width modulation
+  pinMode(ch->Pin->LPWM, OUTPUT);                          // LEFT pulse width modulation
+  ledcSetup(ch->pwmChannel_Open, pwmFrequency, pwmResolution);
+  ledcSetup(ch->pwmChannel_Close, pwmFrequency, pwmResolution);
+  ledcAttachPin(ch->Pin->RPWM, ch->pwmChannel_Open);
+  ledcAttachPin(ch->Pin->LPWM, ch->pwmChannel_Close);
+  if (ch->Pin->Fault >= 0) pinMode(ch->Pin->Fault, INPUT_PULLUP);   // Fault input: software stop only (isrDriverFault)
+#endif
+}
+
+/*******************************************************************************
+ * driverEnable
+ * - Enable the driver (both Left and Right must be enabled for the motor to run), at zero speed.
+********************************************************************************/
+void driverEnable(BlindChannel* ch) {
+  wheelCancel(ch->tmrBrake);                               // A new run ends any brake in progress.
+  ch->brakeRelease = false;
+#ifdef MOTOR_DRIVER_MCPWM
+  // Standstill (50%) before enabling, else the low outputs would brake.
+  mcpwm_set_duty(DRIVER_UNIT(ch), DRIVER_TIMER(ch), MCPWM_OPR_A, 50);
+  mcpwm_set_duty_type(DRIVER_UNIT(ch), DRIVER_TIMER(ch), MCPWM_OPR_A, MCPWM_DUTY_MODE_0);
+#endif
+  digitalWrite(ch->Pin->LEN, HIGH);
+  digitalWrite(ch->Pin->REN, HIGH);
+}
+
+/*******************************************************************************
+ * driverDuty
+ * - Set the motor speed (duty cycle 0-255) in the given direction.
+********************************************************************************/
+void driverDuty(BlindChannel* ch, blindsAction direction, int duty) {
+#ifdef MOTOR_DRIVER_MCPWM
+  // Locked anti-phase: 50% is standstill, 100% full speed open, 0% full speed close.
+  float percent = 50.0 + (direction == actBlindsOpen ? 50.0 : -50.0) * duty / 255;
+  mcpwm_set_duty(DRIVER_UNIT(ch), DRIVER_TIMER(ch), MCPWM_OPR_A, percent);
+#else
+  if (direction == actBlindsOpen) {
+    ledcWrite(ch->pwmChannel_Close, 0);
+    ledcWrite(ch->pwmChannel_Open, duty);
+  } else {
+    ledcWrite(ch->pwmChannel_Open, 0);
+    ledcWrite(ch->pwmChannel_Close, duty);
+  }
+#endif
+}
+
+/*******************************************************************************
+ * driverStop
+ * - Stop the motor: brake (both low-side switches on) if configured for the channel and it was running, else coast.
+ * - Start measuring the stopping distance.
+********************************************************************************/
+void driverStop(BlindChannel* ch, bool wasRunning) {
+  bool brake = wasRunning && ch->Cfg.BrakeOnStop;
+
+  if (!brake) {
+    // Set driver card enable pins low to immediately stop (coast) the motor.
+    digitalWrite(ch->Pin->REN, LOW);
+    digitalWrite(ch->Pin->LEN, LOW);
+  }
+#ifdef MOTOR_DRIVER_MCPWM
+  mcpwm_set_signal_low(DRIVER_UNIT(ch), DRIVER_TIMER(ch), MCPWM_OPR_A);
+  mcpwm_set_signal_low(DRIVER_UNIT(ch), DRIVER_TIMER(ch), MCPWM_OPR_B);
+#else
+  ledcWrite(ch->pwmChannel_Open, 0);
+  ledcWrite(ch->pwmChannel_Close, 0);
+#endif
+  if (brake) {
+    // Both outputs low with the driver enabled: both low-side switches on (brake). Disabled by driverService.
+    // (Re-enable, in case a limit switch cut-off already disabled the driver.)
+    digitalWrite(ch->Pin->REN, HIGH);
+    digitalWrite(ch->Pin->LEN, HIGH);
+    wheelArm(ch->tmrBrake, driverBrakeTime);
+  }
+
+  if (wasRunning && ch->Cfg.Open_MaxRotations > 0) {
+    ch->stopMeasureStart = millis();
+    ch->stopMeasureRotations = journalRotations[ch->Index];
+    ch->stopMeasureBrake = brake;
+  }
+
+  if (ch->cutoffTime != 0) {
+    uint32_t stopDelay = esp_timer_get_time() - ch->cutoffTime;
+    cutoffStats.SumStop += stopDelay;
+    if (stopDelay > cutoffStats.MaxStop) cutoffStats.MaxStop = stopDelay;
+    ch->cutoffTime = 0;
+  }
+}
+
+/*******************************************************************************
+ * driverInputLow
+ * - Read an input pin straight from the GPIO register. Safe to call from interrupts.
+********************************************************************************/
+bool IRAM_ATTR driverInputLow(int pin) {
+  return pin < 32 ? !(GPIO.in & (1UL << pin)) : !(GPIO.in1.data & (1UL << (pin - 32)));
+}
+
+/*******************************************************************************
+ * driverDisable
+ * - Disable the driver of the channel at once (coast), by clearing R_EN/L_EN in the GPIO output registers.
+ *   The PWM outputs are left to driverStop, called by the motor task when it processes the stop.
+ * - Safe to call from interrupts and timer callbacks.
+********************************************************************************/
+void IRAM_ATTR driverDisable(BlindChannel* ch) {
+  if (ch->enMask) GPIO.out_w1tc = ch->enMask;
+  if (ch->enMask1) GPIO.out1_w1tc.val = ch->enMask1;
+}
+
+/*******************************************************************************
+ * driverCutoff
+ * - Disable the driver (driverDisable), and record the timing.
+ * - Called from the limit switch interrupts.
+********************************************************************************/
+void IRAM_ATTR driverCutoff(BlindChannel* ch, uint32_t entryCycles) {
+  driverDisable(ch);
+  uint32_t cycles = ESP.getCycleCount() - entryCycles;
+
+  if (ch->cutoffTime == 0) {
+    ch->cutoffTime = esp_timer_get_time();
+    cutoffStats.Count++;
+    cutoffStats.SumCycles += cycles;
+    if (cycles > cutoffStats.MaxCycles) cutoffStats.MaxCycles = cycles;
+  }
+}
+
+/*******************************************************************************
+ * driverService
+ * - Release the brake after driverBrakeTime, and complete the stopping distance measurement.
+ * - Called from the motor task.
+********************************************************************************/
+void driverService(BlindChannel* ch) {
+  if (ch->brakeRelease) {
+    ch->brakeRelease = false;
+    digitalWrite(ch->Pin->REN, LOW);
+    digitalWrite(ch->Pin->LEN, LOW);
+  }
+  if (ch->stopMeasureStart != 0 && millis() - ch->stopMeasureStart >= driverStopSettleTime) {
+    int mode = ch->stopMeasureBrake ? 1 : 0;
+    stopDistanceSum[ch->Index][mode] += journalRotations[ch->Index] - ch->stopMeasureRotations;
+    stopDistanceCount[ch->Index][mode]++;
+    ch->stopMeasureStart = 0;
+  }
+}
+
+/*******************************************************************************
+ * driverStopDistanceToJson
+ * - Add the average stopping distance per mode (rotations) of each channel: [coast, n, brake, n].
+********************************************************************************/
+void driverStopDistanceToJson(JsonObject obj) {
+  char key[4];
+  for (int i = 0; i < channelCount; i++) {
+    snprintf(key, sizeof(key), "%d", i);
+    JsonArray modes = obj.createNestedArray(key);
+    for (int mode = 0; mode < 2; mode++) {
+      unsigned long n = stopDistanceCount[i][mode];
+      modes.add( n > 0 ? round(stopDistanceSum[i][mode] * 100.0 / n) / 100 : 0 );
+      modes.add(n);
+    }
+  }
+}
+
+/*******************************************************************************
+ * driverCutoffToJson
+ * - Add the limit switch cut-off timing to the provided JSON object: count, interrupt entry to enable low (ns),
+ *   and enable low to stop processed by the motor task (us). Times as [avg, max].
+********************************************************************************/
+void driverCutoffToJson(JsonObject obj) {
+  CutoffStats stats = cutoffStats;
+  uint32_t mhz = getCpuFrequencyMhz();
+
+  obj["n"] = stats.Count;
+  JsonArray enLow = obj.createNestedArray("enLow_ns");
+  enLow.add(stats.Count > 0 ? stats.SumCycles * 1000ULL / stats.Count / mhz : 0);
+  enLow.add(stats.MaxCycles * 1000ULL / mhz);
+  JsonArray stop = obj.createNestedArray("stop_us");
+  stop.add(stats.Count > 0 ? stats.SumStop / stats.Count : 0);
+  stop.add(stats.MaxStop);
+}
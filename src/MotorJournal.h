@@ -0,0 +1,194 @@
+/*******************************************************************************
+ * MotorJournal
+ * - Records every motor run (who started it, how far it went, what current it drew, why it stopped).
+ * - Runs are kept in a small ring buffer that is published in batches over MQTT.
+ * - Cumulative stop reason counters are kept for the app_state telemetry.
+********************************************************************************/
+#include <ArduinoJson.h>
+
+struct MotorRun {
+  int Channel;                                    // Blinds channel of the motor.
+  actionOwner Owner;                              // Who or What started the motor.
+  blindsAction Action;                            // Direction the motor was running (open or close).
+  unsigned long StartTime;                        // Timestamp when the motor was started (millis).
+  unsigned long StopTime;                         // Timestamp when the motor was stopped (millis).
+  int Rotations;                                  // Number of axis rotations counted during the run.
+  int StartPosition;                              // Blinds position when the motor was started.
+  int EndPosition;                                // Blinds position when the motor was stopped.
+  int PeakCurrent;                                // Highest current sample during the run (raw analog reading).
+  int MeanCurrent;                                // Average of all current samples during the run (raw analog reading).
+  stopReason Reason;                              // What caused the motor to stop.
+};
+
+MotorRun journalRuns[journalSize];                // Ring buffer of completed motor runs.
+int journalHead = 0;                              // Index where the next completed run will be written.
+int journalUnpublished = 0;                       // Number of completed runs not yet published.
+unsigned long journalStopCount[stpCOUNT];         // Cumulative number of stops per stop reason (since boot).
+
+MotorRun journalActive[maxChannels];              // The run currently in progress, per channel.
+bool journalRunActive[maxChannels];               // A run is in progress, per channel.
+volatile int journalRotations[maxChannels];       // Rotations counted during the active run. Updated from the rotation ISR.
+unsigned long journalCurrentSum[maxChannels];     // Sum of current samples for the active run.
+unsigned int journalCurrentSamples[maxChannels];  // Number of current samples for the active run.
+
+portMUX_TYPE muxJournal = portMUX_INITIALIZER_UNLOCKED;
+
+/*******************************************************************************
+ * stopReasonName
+ * - Short name for a stop reason, as used in the MQTT payloads.
+********************************************************************************/
+const char* stopReasonName(stopReason reason) {
+  switch (reason) {
+    case stpLimitOpen :   return "LimitOpen";
+    case stpLimitClosed : return "LimitClosed";
+    case stpButton :      return "Button";
+    case stpTimerOpen :   return "TimerOpen";
+    case stpTimerMaster : return "TimerMaster";
+    case stpRotations :   return "Rotations";
+    case stpMaxCurrent :  return "MaxCurrent";
+    case stpMQTT :        return "MQTT";
+    case stpRetarget :    return "Retarget";
+    case stpFault :       return "Fault";
+    case stpEstimate :    return "Estimate";
+    case stpWatchdog :    return "Watchdog";
+    case stpOTA :         return "OTA";
+    default :             return "Unknown";
+  }
+}
+
+/*******************************************************************************
+ * journalRunStart
+ * - Start recording a new motor run. Called when the motor is started.
+********************************************************************************/
+void journalRunStart(int channel, actionOwner owner, blindsAction action, int position) {
+  portENTER_CRITICAL(&muxJournal);
+  MotorRun& run = journalActive[channel];
+  run.Channel = channel;
+  run.Owner = owner;
+  run.Action = action;
+  run.StartTime = millis();
+  run.StopTime = 0;
+  run.Rotations = 0;
+  run.StartPosition = position;
+  run.EndPosition = position;
+  run.PeakCurrent = 0;
+  run.MeanCurrent = 0;
+  run.Reason = stpUNDEF;
+  journalRotations[channel] = 0;
+  journalCurrentSum[channel] = 0;
+  journalCurrentSamples[channel] = 0;
+  journalRunActive[channel] = true;
+  portEXIT_CRITICAL(&muxJournal);
+}
+
+/*******************************************************************************
+ * journalRotation
+ * - Count an axis rotation for the active run. Safe to call from the rotation ISR.
+********************************************************************************/
+void IRAM_ATTR journalRotation(int channel) {
+  journalRotations[channel]++;
+}
+
+/*******************************************************************************
+ * journalCurrentSample
+ * - Add a motor current sample (raw analog reading) to the active run.
+********************************************************************************/
+void journalCurrentSample(int channel, int current) {
+  portENTER_CRITICAL(&muxJournal);
+  if (journalRunActive[channel]) {
+    if (current > journalActive[channel].PeakCurrent) journalActive[channel].PeakCurrent = current;
+    journalCurrentSum[channel] += current;
+    journalCurrentSamples[channel]++;
+  }
+  portEXIT_CRITICAL(&muxJournal);
+}
+
+/*******************************************************************************
+ * journalRunStop
+ * - Complete the active run and store it in the ring buffer. Called when the motor is stopped.
+********************************************************************************/
+void journalRunStop(int channel, stopReason reason, int position) {
+  portENTER_CRITICAL(&muxJournal);
+  if (journalRunActive[channel]) {
+    MotorRun& run = journalActive[channel];
+    run.StopTime = millis();
+    run.Rotations = journalRotations[channel];
+    run.EndPosition = position;
+    run.Reason = reason;
+    if (journalCurrentSamples[channel] > 0) {
+      run.MeanCurrent = journalCurrentSum[channel] / journalCurrentSamples[channel];
+    }
+    journalRuns[journalHead] = run;
+    journalHead = (journalHead + 1) % journalSize;
+    if (journalUnpublished < journalSize) journalUnpublished++;     // Oldest unpublished run is overwritten when the buffer is full.
+    journalRunActive[channel] = false;
+    journalStopCount[reason]++;
+  }
+  portEXIT_CRITICAL(&muxJournal);
+}
+
+/*******************************************************************************
+ * journalLastRun
+ * - Copy the most recently completed run of the channel. Returns false if there is none in the buffer.
+********************************************************************************/
+bool journalLastRun(int channel, MotorRun* run) {
+  bool found = false;
+
+  portENTER_CRITICAL(&muxJournal);
+  for (int i = 1; i <= journalSize && !found; i++) {
+    const MotorRun& entry = journalRuns[(journalHead - i + journalSize) % journalSize];
+    if (entry.Channel == channel && entry.StopTime != 0) {
+      *run = entry;
+      found = true;
+    }
+  }
+  portEXIT_CRITICAL(&muxJournal);
+  return found;
+}
+
+/*******************************************************************************
+ * journalToJson
+ * - Add up to "maxRuns" unpublished runs (oldest first) to the provided JSON array, and mark them as published.
+ * - Returns the number of runs added.
+********************************************************************************/
+int journalToJson(JsonArray runs, int maxRuns) {
+  MotorRun batch[journalBatchSize];
+  int count;
+
+  if (maxRuns > journalBatchSize) maxRuns = journalBatchSize;
+
+  // Copy the runs out under the lock, serialize without holding it.
+  portENTER_CRITICAL(&muxJournal);
+  count = min(journalUnpublished, maxRuns);
+  for (int i = 0; i < count; i++) {
+    batch[i] = journalRuns[(journalHead - journalUnpublished + i + journalSize) % journalSize];
+  }
+  journalUnpublished -= count;
+  portEXIT_CRITICAL(&muxJournal);
+
+  for (int i = 0; i < count; i++) {
+    JsonObject run = runs.createNestedObject();
+    run["ch"] = batch[i].Channel;
+    run["own"] = (int) batch[i].Owner;
+    run["act"] = (int) batch[i].Action;
+    run["start"] = batch[i].StartTime;
+    run["stop"] = batch[i].StopTime;
+    run["rot"] = batch[i].Rotations;
+    run["pos0"] = batch[i].StartPosition;
+    run["pos1"] = batch[i].EndPosition;
+    run["iPeak"] = batch[i].PeakCurrent;
+    run["iMean"] = batch[i].MeanCurrent;
+    run["rsn"] = stopReasonName(batch[i].Reason);
+  }
+  return count;
+}
+
+/*******************************************************************************
+ * journalStopCountsToJson
+ * - Add the cumulative stop reason counters to the provided JSON object.
+********************************************************************************/
+void journalStopCountsToJson(JsonObject counts) {
+  for (int i = stpUNDEF; i < stpCOUNT; i++) {
+    counts[stopReasonName((stopReason) i)] = journalStopCount[i];
+  }
+}
@@ -0,0 +1,109 @@
+/*******************************************************************************
+ * MotorWatchdog
+ * - Supervision of the motor task (loop_MotorActions), which is the only task that stops the motor.
+ * - The task is registered with the task watchdog, which is set to panic (restart) if the task does not feed it
+ *   for taskWatchdogTimeout. The task feeds a heartbeat on every pass.
+ * - A supervisor on its own hardware timer (watchdogTimer, ISR isrTimerWatchdog in main) checks the heartbeat
+ *   every heartbeatCheckInterval. It does not depend on the timer wheel or the esp_timer task, and its interrupt
+ *   is allocated on core watchdogCore, not the core of the motor task, so a motor task that hangs with interrupts
+ *   disabled does not block it. If the heartbeat is older than heartbeatTimeout while a motor runs, the ISR cuts
+ *   the enable pins of the running channels (driverDisable). The motor task completes the stop (stpWatchdog) if
+ *   it recovers.
+ * - The heartbeat is the low 32 bits of the time (us): written and read in one access from either core, and the
+ *   gap wraps correctly (after 71 minutes).
+ * - The largest heartbeat gap seen and the number of fail-safe trips are kept.
+********************************************************************************/
+#include <ArduinoJson.h>
+#include <esp_task_wdt.h>
+#include <esp_ipc.h>
+
+volatile uint32_t motorHeartbeat;                 // Last pass of the motor task (us, low 32 bits).
+volatile bool heartbeatStarted;                   // The motor task registered: heartbeat valid.
+uint32_t heartbeatMaxGap;                         // Largest heartbeat gap seen by the supervisor (us).
+uint32_t watchdogTrips;                           // Number of times the fail-safe cut the motors.
+volatile bool watchdogTripped;                    // A trip not yet reported by the main loop.
+hw_timer_t* tmrWatchdog = NULL;                   // Supervisor timer.
+
+/*******************************************************************************
+ * watchdogRegister
+ * - Set the task watchdog to panic after taskWatchdogTimeout, register the calling task (the motor task) with it,
+ *   and start its heartbeat.
+ * - Returns false if the task watchdog could not be set up (the heartbeat supervisor still runs).
+********************************************************************************/
+bool watchdogRegister() {
+  bool ok = esp_task_wdt_init(taskWatchdogTimeout, true) == ESP_OK &&
+            esp_task_wdt_add(NULL) == ESP_OK;
+  motorHeartbeat = (uint32_t) esp_timer_get_time();
+  heartbeatStarted = true;
+  return ok;
+}
+
+/*******************************************************************************
+ * watchdogAttach / watchdogStart
+ * - Start the supervisor timer: the ISR is called every heartbeatCheckInterval.
+ * - The interrupt is allocated on the core that attaches it, so that is done on watchdogCore (esp_ipc).
+********************************************************************************/
+void watchdogAttach(void* isr) {
+  tmrWatchdog = timerBegin(watchdogTimer, 80, true);                        // Pre-scale 80 (of 80MHz): 1us, count up.
+  timerAttachInterrupt(tmrWatchdog, (void (*)()) isr, true);                // Edge.
+  timerAlarmWrite(tmrWatchdog, heartbeatCheckInterval * 1000, true);         // Auto-reload.
+  timerAlarmEnable(tmrWatchdog);
+}
+
+void watchdogStart(void (*isr)()) {
+  esp_ipc_call_blocking(watchdogCore, watchdogAttach, (void*) isr);
+}
+
+/*******************************************************************************
+ * watchdogFeed
+ * - Motor task pass completed: feed the task watchdog and the heartbeat.
+********************************************************************************/
+void watchdogFeed() {
+  esp_task_wdt_reset();
+  motorHeartbeat = (uint32_t) esp_timer_get_time();
+}
+
+/*******************************************************************************
+ * heartbeatAge
+ * - Time since the last heartbeat of the motor task (us). 0 if it did not start yet.
+********************************************************************************/
+uint32_t IRAM_ATTR heartbeatAge(int64_t now) {
+  if (!heartbeatStarted) return 0;
+  return (uint32_t) now - motorHeartbeat;
+}
+
+/*******************************************************************************
+ * watchdogMissed
+ * - True if the heartbeat of the motor task is older than heartbeatTimeout. Records the gap.
+********************************************************************************/
+bool IRAM_ATTR watchdogMissed(int64_t now) {
+  uint32_t gap = heartbeatAge(now);
+  if (gap > heartbeatMaxGap) heartbeatMaxGap = gap;
+  return gap > heartbeatTimeout * 1000UL;
+}
+
+/*******************************************************************************
+ * watchdogFailSafe
+ * - True once per hang: the heartbeat was missed (watchdogMissed), and the fail-safe was not done yet for this
+ *   hang. Called by the supervisor ISR, which then cuts the running motors.
+********************************************************************************/
+bool IRAM_ATTR watchdogFailSafe(int64_t now) {
+  static bool failSafe = false;                   // Fail-safe done for the current hang.
+
+  if (!watchdogMissed(now)) {
+    failSafe = false;
+    return false;
+  }
+  if (failSafe) return false;
+  failSafe = true;
+  return true;
+}
+
+/*******************************************************************************
+ * watchdogToJson
+ * - Add the heartbeat figures to the provided JSON array: [max gap (ms), fail-safe trips].
+********************************************************************************/
+void watchdogToJson(JsonArray arr) {
+  arr.add(heartbeatMaxGap / 1000);
+  arr.add(watchdogTrips);
+}
@@ -0,0 +1,92 @@
+/*******************************************************************************
+ * MqttPublish
+ * - Publish JSON documents serialized straight into the MQTT client: beginPublish with the measured length,
+ *   the payload in small chunks (mqttChunkSize), endPublish. No payload sized buffer on the stack, and the client
+ *   buffer (sized once at boot) only has to hold the MQTT header of these publishes.
+ * - The time per publish (us) and the largest payload are kept, for app_state. With PUBLISH_BUFFERED defined the
+ *   payload is serialized into a buffer and published in one go instead, to compare time and loop stack.
+********************************************************************************/
+#include <PubSubClient.h>
+#include <ArduinoJson.h>
+
+struct PublishStats {
+  uint32_t Count;                                 // Number of JSON publishes.
+  uint32_t Sum;                                   // Sum of the publish times (us).
+  uint32_t Max;                                   // Longest publish time (us).
+  uint32_t MaxLength;                             // Largest payload (bytes).
+};
+
+PublishStats publishStats;
+
+/*******************************************************************************
+ * MqttChunkWriter
+ * - Print that collects the serialized JSON in chunks, and writes each full chunk to the MQTT client
+ *   (one socket write per chunk instead of per character).
+********************************************************************************/
+class MqttChunkWriter : public Print {
+public:
+  MqttChunkWriter(PubSubClient& client) : _client(client), _length(0) {}
+
+  size_t write(uint8_t c) override {
+    _buffer[_length++] = c;
+    if (_length == sizeof(_buffer)) flush();
+    return 1;
+  }
+
+  size_t write(const uint8_t* data, size_t size) override {
+    for (size_t i = 0; i < size; i++) write(data[i]);
+    return size;
+  }
+
+  void flush() {
+    if (_length > 0) _client.write(_buffer, _length);
+    _length = 0;
+  }
+
+private:
+  PubSubClient& _client;
+  uint8_t _buffer[mqttChunkSize];
+  size_t _length;
+};
+
+/*******************************************************************************
+ * publishJson
+ * - Publish the document on the topic. Returns the payload length, or 0 if the publish failed.
+********************************************************************************/
+size_t publishJson(PubSubClient& client, const char* topic, JsonDocument& doc, bool retained = false) {
+  int64_t start = esp_timer_get_time();
+  size_t length = measureJson(doc);
+  bool ok;
+
+#ifdef PUBLISH_BUFFERED
+  char buffer[mqttBufferSize];
+  length = serializeJson(doc, buffer, sizeof(buffer));
+  ok = client.publish(topic, (const uint8_t*) buffer, length, retained);
+#else
+  ok = client.beginPublish(topic, length, retained);
+  if (ok) {
+    MqttChunkWriter writer(client);
+    serializeJson(doc, writer);
+    writer.flush();
+    ok = client.endPublish() == 1;
+  }
+#endif
+
+  uint32_t elapsed = esp_timer_get_time() - start;
+  publishStats.Count++;
+  publishStats.Sum += elapsed;
+  if (elapsed > publishStats.Max) publishStats.Max = elapsed;
+  if (length > publishStats.MaxLength) publishStats.MaxLength = length;
+  return ok ? length : 0;
+}
+
+/*******************************************************************************
+ * publishToJson
+ * - Add the publish figures to the provided JSON array: [n, avg, max (us), largest payload (bytes)].
+********************************************************************************/
+void publishToJson(JsonArray arr) {
+  arr.add(publishStats.Count);
+  arr.add(publishStats.Count > 0 ? publishStats.Sum / publishStats.Count : 0);
+  arr.add(publishStats.Max);
+  arr.add(publishStats.MaxLength);
+}
@@ -1,15 +1,340 @@
 #include <ESPmDNS.h>
 #include <WiFiUdp.h>
 #include <ArduinoOTA.h>
+#include <Update.h>
+#include <HTTPClient.h>
+#include <esp_ota_ops.h>
+#include <rom/miniz.h>
+#include <ArduinoJson.h>
+
+TaskHandle_t taskOTA = NULL;           // Task handle for the OTA task.
+
+/*******************************************************************************
+ * OTA update state
+ * - While an update runs the motor control is locked: the motor task stops the running motors (stpOTA) and starts
+ *   nothing until the update ends. The transfer only starts once the motor task reports all motors stopped.
+ * - Progress and result are published by the main loop (reportOta), which also restarts into the new image.
+ * - Timings: handle() call (or pull request) to the first data received (includes the session set-up), the total
+ *   update time and, for a pulled image, the time spent receiving, inflating and writing the flash.
+********************************************************************************/
+struct OtaStatus {
+  volatile otaPhase Phase;             // Phase of the current (or last) update.
+  volatile bool Locked;                // Motor control locked for the update.
+  volatile bool MotorsStopped;         // Set by the motor task once no motor runs while locked.
+  volatile bool Publish;               // Progress or result not yet published by the main loop.
+  volatile int Progress;               // Last published progress (percent).
+  int Error;                           // ota_error_t of a failed update.
+  uint32_t Size;                       // Image size (bytes).
+  uint32_t Received;                   // Bytes received over the air (compressed size of a compressed image).
+  unsigned long PollTime;              // Start of the current ArduinoOTA.handle() call (millis).
+  unsigned long StartTime;             // Update started (millis).
+  unsigned long ToStart;               // handle() call to the first data received (milliseconds).
+  unsigned long Duration;              // Total update time (milliseconds).
+  unsigned long RxTime;                // Pulled image: time waiting for data (milliseconds).
+  unsigned long InflateTime;           // Pulled image: time decompressing (milliseconds).
+  unsigned long FlashTime;             // Pulled image: time writing the OTA partition (milliseconds).
+  volatile bool PullRequest;           // Pull the image from PullUrl (appcmd "update").
+  char PullUrl[otaUrlLength];          // URL of the image to pull. ".zz" = zlib compressed.
+};
+
+OtaStatus otaStatus;
+bool otaVerifyPending = false;         // Running a new image that still has to be validated (rollback enabled).
+uint8_t otaRxBuffer[otaRxBufferSize];  // Pulled image: data as received (compressed or not).
+
+/*******************************************************************************
+ * otaLock
+ * - Start an update: lock the motor control, and wait for the motor task to stop the motors.
+ * - Returns false if the motors did not stop within otaStopTimeout (the caller abandons the update).
+********************************************************************************/
+bool otaLock() {
+  otaStatus.StartTime = millis();
+  otaStatus.Progress = 0;
+  otaStatus.Size = 0;
+  otaStatus.Received = 0;
+  otaStatus.ToStart = 0;
+  otaStatus.RxTime = 0;
+  otaStatus.InflateTime = 0;
+  otaStatus.FlashTime = 0;
+  otaStatus.Phase = otaStarting;
+  otaStatus.MotorsStopped = false;
+  otaStatus.Locked = true;
+  otaStatus.Publish = true;
+  while (!otaStatus.MotorsStopped && millis() - otaStatus.StartTime < otaStopTimeout) {
+    delay(10);
+  }
+  if (!otaStatus.MotorsStopped) {
+    Serial.println("OTA refused: motors did not stop");
+    return false;
+  }
+  otaStatus.Phase = otaRunning;
+  return true;
+}
+
+/*******************************************************************************
+ * otaFinish / otaFail
+ * - End of an update. Done: control stays locked, the main loop restarts into the new image.
+ *   Failed: the old image keeps running, so the motor control is released.
+********************************************************************************/
+void otaFinish() {
+  otaStatus.Duration = millis() - otaStatus.StartTime;
+  otaStatus.Progress = 100;
+  otaStatus.Phase = otaDone;
+  otaStatus.Publish = true;
+}
+
+void otaFail(int error) {
+  otaStatus.Duration = otaStatus.Locked ? millis() - otaStatus.StartTime : 0;    // 0: failed before the start.
+  otaStatus.Error = error;
+  otaStatus.Phase = otaFailed;
+  otaStatus.Locked = false;
+  otaStatus.Publish = true;
+}
+
+/*******************************************************************************
+ * otaProgress
+ * - Record the update progress (bytes of the image written so far). Flags a publish every otaProgressStep.
+********************************************************************************/
+void otaProgress(uint32_t progress, uint32_t total) {
+  if (total == 0) return;
+  int percent = (uint64_t) progress * 100 / total;
+  if (otaStatus.ToStart == 0 && progress > 0) {
+    otaStatus.ToStart = millis() - otaStatus.PollTime;
+  }
+  if (percent >= otaStatus.Progress + otaProgressStep) {
+    otaStatus.Progress = percent;
+    otaStatus.Publish = true;
+  }
+}
+
+/*******************************************************************************
+ * otaWrite
+ * - Write a block of the (decompressed) image to the OTA partition, timed.
+********************************************************************************/
+bool otaWrite(uint8_t* data, size_t length) {
+  unsigned long start = millis();
+  size_t written = Update.write(data, length);
+  otaStatus.FlashTime += millis() - start;
+  otaStatus.Size += written;
+  return written == length;
+}
+
+/*******************************************************************************
+ * otaInflate
+ * - Stream a zlib compressed image from the client into the OTA partition, with the ROM inflater.
+ *   The 32KB output buffer doubles as the inflate dictionary: each decompressed block is written from it.
+ * - Returns false on a receive, decompress or flash write error.
+********************************************************************************/
+bool otaInflate(WiFiClient* stream, uint32_t length) {
+  tinfl_decompressor* inflator = (tinfl_decompressor*) malloc(sizeof(tinfl_decompressor));
+  uint8_t* dict = (uint8_t*) malloc(TINFL_LZ_DICT_SIZE);
+  if (inflator == nullptr || dict == nullptr) {
+    free(inflator);
+    free(dict);
+    Serial.println("OTA: no memory to inflate");
+    return false;
+  }
+  tinfl_init(inflator);
+
+  bool ok = true;
+  size_t inAvail = 0;
+  size_t inOffset = 0;
+  size_t dictOffset = 0;
+  tinfl_status status = TINFL_STATUS_NEEDS_MORE_INPUT;
+  while (ok && status > TINFL_STATUS_DONE) {
+    if (inAvail == 0 && otaStatus.Received < length) {
+      unsigned long start = millis();
+      inAvail = stream->readBytes(otaRxBuffer, min((uint32_t) sizeof(otaRxBuffer), length - otaStatus.Received));
+      otaStatus.RxTime += millis() - start;
+      otaStatus.Received += inAvail;
+      inOffset = 0;
+      if (inAvail == 0) { ok = false; break; }                // Receive timeout.
+    }
+
+    unsigned long start = millis();
+    size_t inBytes = inAvail;
+    size_t outBytes = TINFL_LZ_DICT_SIZE - dictOffset;
+    uint32_t flags = TINFL_FLAG_PARSE_ZLIB_HEADER | (otaStatus.Received < length ? TINFL_FLAG_HAS_MORE_INPUT : 0);
+    status = tinfl_decompress(inflator, otaRxBuffer + inOffset, &inBytes, dict, dict + dictOffset, &outBytes, flags);
+    otaStatus.InflateTime += millis() - start;
+    inOffset += inBytes;
+    inAvail -= inBytes;
+
+    if (outBytes > 0) {
+      ok = otaWrite(dict + dictOffset, outBytes);
+      dictOffset = (dictOffset + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+    }
+    otaProgress(otaStatus.Received, length);
+  }
+
+  free(inflator);
+  free(dict);
+  return ok && status == TINFL_STATUS_DONE;
+}
+
+/*******************************************************************************
+ * otaPull
+ * - Pull an image over HTTP (appcmd "update:<url>") and write it to the OTA partition. A ".zz" image is
+ *   zlib compressed (tools/ota_image.py), and inflated while it is received: less data over a weak link.
+ * - The MD5 of the (decompressed) image is taken from the x-MD5 header, as sent by `tools/ota_image.py serve`.
+ *   An image without it is refused, Update.end fails if the written image does not match.
+ * - Runs in the OTA task, with the motor control locked like an ArduinoOTA update.
+********************************************************************************/
+void otaPull(const char* url) {
+  if (!otaLock()) {
+    otaFail(OTA_BEGIN_ERROR);
+    return;
+  }
+  Serial.printf("OTA: pull %s\n", url);
+
+  HTTPClient http;
+  const char* headers[] = {"x-MD5"};
+  http.begin(url);
+  http.collectHeaders(headers, 1);
+  int code = http.GET();
+  int length = http.getSize();
+  if (code != HTTP_CODE_OK || length <= 0) {
+    Serial.printf("OTA: HTTP %d, size %d\n", code, length);
+    http.end();
+    otaFail(OTA_CONNECT_ERROR);
+    return;
+  }
+
+  String md5 = http.header("x-MD5");
+  bool compressed = strlen(url) > 3 && strcmp(url + strlen(url) - 3, ".zz") == 0;
+  if (md5.length() != 32) {
+    Serial.println("OTA: no image MD5 (x-MD5 header)");
+    http.end();
+    otaFail(OTA_BEGIN_ERROR);
+    return;
+  }
+  if (!Update.begin(compressed ? UPDATE_SIZE_UNKNOWN : length)) {
+    http.end();
+    otaFail(OTA_BEGIN_ERROR);
+    return;
+  }
+  Update.setMD5(md5.c_str());                             // Checked by Update.end.
+
+  WiFiClient* stream = http.getStreamPtr();
+  bool ok = true;
+  if (compressed) {
+    ok = otaInflate(stream, length);
+  } else {
+    while (ok && otaStatus.Received < (uint32_t) length) {
+      unsigned long start = millis();
+      size_t n = stream->readBytes(otaRxBuffer, min((uint32_t) sizeof(otaRxBuffer), length - otaStatus.Received));
+      otaStatus.RxTime += millis() - start;
+      otaStatus.Received += n;
+      ok = n > 0 && otaWrite(otaRxBuffer, n);
+      otaProgress(otaStatus.Received, length);
+    }
+  }
+  http.end();
+
+  if (!ok) {
+    Update.abort();
+    otaFail(OTA_RECEIVE_ERROR);
+  } else if (!Update.end(true)) {
+    otaFail(OTA_END_ERROR);
+  } else {
+    otaFinish();
+  }
+  Serial.printf("OTA: %s, %u bytes received, %u bytes written, rx=%lums inflate=%lums flash=%lums total=%lums\n",
+                otaStatus.Phase == otaDone ? "pulled" : "failed", otaStatus.Received, otaStatus.Size,
+                otaStatus.RxTime, otaStatus.InflateTime, otaStatus.FlashTime, otaStatus.Duration);
+}
 
 /******************************************************************************* 
  * ota_handle
- * - forever loop to process OTA events
+ * - forever loop to process OTA events. ArduinoOTA has no event callback for the invitation, so it is checked
+ *   every otaPollInterval. An accepted invitation runs the whole transfer inside handle(). A pull request
+ *   ("update:<url>") is run from here as well, so all updates are done by this task.
 ********************************************************************************/
 void ota_handle( void * parameter ) {
   for (;;) {
-    ArduinoOTA.handle();
-    delay(3500);
+    otaStatus.PollTime = millis();
+    if (otaStatus.PullRequest) {
+      otaPull(otaStatus.PullUrl);
+      otaStatus.PullRequest = false;
+    } else {
+      ArduinoOTA.handle();
+    }
+    delay(otaPollInterval);
+  }
+}
+
+/*******************************************************************************
+ * otaPhaseName
+ * - Short name for an OTA phase, as used in the MQTT payloads.
+********************************************************************************/
+const char* otaPhaseName(otaPhase phase) {
+  switch (phase) {
+    case otaStarting :   return "stopping";
+    case otaRunning :    return "running";
+    case otaDone :       return "done";
+    case otaFailed :     return "failed";
+    case otaValidated :  return "validated";
+    default :            return "idle";
+  }
+}
+
+/*******************************************************************************
+ * otaToJson
+ * - Add the OTA progress (or result) to the provided JSON object.
+********************************************************************************/
+void otaToJson(JsonObject obj) {
+  obj["phase"] = otaPhaseName(otaStatus.Phase);
+  obj["pct"] = otaStatus.Progress;
+  obj["size"] = otaStatus.Size;
+  obj["start_ms"] = otaStatus.ToStart;
+  if (otaStatus.Phase == otaDone || otaStatus.Phase == otaFailed) {
+    obj["total_ms"] = otaStatus.Duration;
+    if (otaStatus.Received > 0) {                       // Pulled image: received bytes and time per stage.
+      obj["rx"] = otaStatus.Received;
+      obj["rx_ms"] = otaStatus.RxTime;
+      obj["inflate_ms"] = otaStatus.InflateTime;
+      obj["flash_ms"] = otaStatus.FlashTime;
+    }
+  }
+  if (otaStatus.Phase == otaFailed) {
+    obj["error"] = otaStatus.Error;
+  }
+}
+
+/*******************************************************************************
+ * verifyRollbackLater
+ * - Arduino core hook: do not validate a new image at boot, it is validated by otaValidate once MQTT is
+ *   connected and the motor self-check passed. Only effective with a rollback enabled bootloader.
+********************************************************************************/
+extern "C" bool verifyRollbackLater() {
+  return true;
+}
+
+/*******************************************************************************
+ * otaCheckPending
+ * - Find out if the running image is new, and waits for validation (otaVerifyPending).
+********************************************************************************/
+void otaCheckPending() {
+  esp_ota_img_states_t state;
+  otaVerifyPending = esp_ota_get_state_partition(esp_ota_get_running_partition(), &state) == ESP_OK &&
+                     state == ESP_OTA_IMG_PENDING_VERIFY;
+  if (otaVerifyPending) Serial.println("OTA: new image, pending validation");
+}
+
+/*******************************************************************************
+ * otaValidate
+ * - Keep the new image (valid), or roll back to the previous one (restarts).
+********************************************************************************/
+void otaValidate(bool valid) {
+  otaVerifyPending = false;
+  if (valid) {
+    esp_ota_mark_app_valid_cancel_rollback();
+    otaStatus.Phase = otaValidated;
+    otaStatus.Publish = true;
+    Serial.println("OTA: new image validated");
+  } else {
+    Serial.println("OTA: new image not validated. Rollback!");
+    delay(100);
+    esp_ota_mark_app_invalid_rollback_and_reboot();
   }
 }
 
@@ -49,17 +374,27 @@ void setupOTA(const char* nameprefix) {
 
       // NOTE: if updating SPIFFS this would be the place to unmount SPIFFS using SPIFFS.end()
       Serial.println("Start updating " + type);
+
+      // Lock the motor control, and wait for the motor task to stop the motors before any data is received.
+      if (!otaLock()) {
+        Update.abort();                                   // Fails the transfer, reported by onError.
+      }
     });
     
     ArduinoOTA.onEnd([]() {
       Serial.println("\nEnd");
+      otaFinish();
     });
     
     ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
-      Serial.printf("Progress: %u%%\r", (progress / (total / 100)));
+      if (total == 0) return;
+      Serial.printf("Progress: %u%%\r", (unsigned int) ((uint64_t) progress * 100 / total));
+      otaStatus.Size = total;
+      otaProgress(progress, total);
     });
     
     ArduinoOTA.onError([](ota_error_t error) {
+      otaFail(error);
       Serial.printf("Error[%u]: ", error);
       if (error == OTA_AUTH_ERROR) Serial.println("\nAuth Failed");
       else if (error == OTA_BEGIN_ERROR) Serial.println("\nBegin Failed");
@@ -68,18 +403,20 @@ void setupOTA(const char* nameprefix) {
       else if (error == OTA_END_ERROR) Serial.println("\nEnd Failed");
     });
 
+    ArduinoOTA.setRebootOnSuccess(false);                 // Restart by the main loop, after the result is published.
     ArduinoOTA.begin();
 
     Serial.println("OTA Initialized");
 
   #if defined(ESP32)
-    xTaskCreate(
+    xTaskCreatePinnedToCore(
       ota_handle,         /* Task function. */
       "OTA_HANDLE",       /* String with name of task. */
-      10000,              /* Stack size in bytes. */
+      stackOTATask,       /* Stack size in bytes. */
       NULL,               /* Parameter passed as input of the task */
-      1,                  /* Priority of the task. */
-      NULL);              /* Task handle. */
+      prioOTATask,        /* Priority of the task. */
+      &taskOTA,           /* Task handle. */
+      coreOTATask);       /* Core where the task should run (network side). */
   #endif
   }
 }
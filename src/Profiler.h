@@ -0,0 +1,166 @@
+/*******************************************************************************
+ * Profiler
+ * - Lightweight scoped section profiler based on the CPU cycle counter.
+ * - Accumulates count and min/avg/max cycles per named section.
+ * - Place PROFILE_SECTION(<section>) at the start of a block; the section ends when the block is left.
+ * - Only compiled in if PROFILE_SECTIONS is defined (configuration.h). Otherwise the macro expands to nothing.
+ * - Each section must only be profiled from one task. Stats are read without locking, a dump taken
+ *   while a section is being updated may be off by one sample.
+ * - Interrupt routines: PROFILE_ISR(<isr>) at the start of the routine records its entry-to-exit cycles
+ *   (n/last/avg/max). Only compiled in if PROFILE_ISRS is defined, as it adds to every interrupt.
+********************************************************************************/
+
+enum profSection {
+  prfCurrentSense,              // loop: motor current sense
+  prfBlindsState,               // loop: publish blinds state
+  prfSensorReports,             // loop: temperature and lux reports
+  prfStateReport,               // loop: app state report
+  prfMqttLoop,                  // loop: MQTT client loop (includes processing received messages)
+  prfMqttReconnect,             // loop: WiFi/MQTT reconnect
+  prfMotorLimits,               // loop_MotorActions: limit switches
+  prfMotorButtons,              // loop_MotorActions: open/close buttons
+  prfMotorCommands,             // loop_MotorActions: MQTT actions
+  prfMotorStop,                 // loop_MotorActions: stop motor
+  prfMotionControl,             // loop_MotionControl: motion planner control step (all channels)
+  prfCOUNT
+};
+
+const char* profSectionName[prfCOUNT] = {
+  "CurSense", "BlindsSt", "Sensors", "StateRpt", "MqttLoop", "Reconnect",
+  "M.Limits", "M.Buttons", "M.Cmds", "M.Stop", "Motion"
+};
+
+enum isrSection {
+  isrRotations,                 // isrMotorRotations
+  isrLimits,                    // isrLimitOpen, isrLimitClosed
+  isrFault,                     // isrDriverFault
+  isrCOUNT
+};
+
+const char* isrSectionName[isrCOUNT] = {
+  "I.Rotate", "I.Limits", "I.Fault"
+};
+
+#ifdef PROFILE_SECTIONS
+
+struct ProfileStats {
+  uint32_t Count;                                 // Number of times the section was run.
+  uint32_t Min;                                   // Fewest cycles spent in the section.
+  uint32_t Max;                                   // Most cycles spent in the section.
+  uint64_t Total;                                 // Total cycles spent in the section (for the average).
+};
+
+ProfileStats profileStats[prfCOUNT];
+
+class ProfileScope {
+  public:
+    ProfileScope(profSection section) : _section(section), _start(ESP.getCycleCount()) {}
+    ~ProfileScope() {
+      uint32_t cycles = ESP.getCycleCount() - _start;
+      ProfileStats& stats = profileStats[_section];
+      if (stats.Count == 0 || cycles < stats.Min) stats.Min = cycles;
+      if (cycles > stats.Max) stats.Max = cycles;
+      stats.Total += cycles;
+      stats.Count++;
+    }
+  private:
+    profSection _section;
+    uint32_t _start;
+};
+
+#define PROFILE_SECTION(section) ProfileScope _profileScope(section)
+
+/*******************************************************************************
+ * profileToText
+ * - Write the profile stats as a compact table (cycles) into the provided buffer.
+ * - Returns the number of characters written.
+********************************************************************************/
+size_t profileToText(char* buffer, size_t bufLength) {
+  size_t n = snprintf(buffer, bufLength, "%-9s %8s %10s %10s %10s\n", "section", "n", "min", "avg", "max");
+  for (int i = 0; i < prfCOUNT && n < bufLength; i++) {
+    ProfileStats stats = profileStats[i];
+    uint32_t avg = (stats.Count > 0) ? (uint32_t)(stats.Total / stats.Count) : 0;
+    n += snprintf(buffer + n, bufLength - n, "%-9s %8u %10u %10u %10u\n", profSectionName[i], stats.Count, stats.Min, avg, stats.Max);
+  }
+  return (n < bufLength) ? n : bufLength - 1;
+}
+
+/*******************************************************************************
+ * profileReset
+ * - Clear the profile stats.
+********************************************************************************/
+void profileReset() {
+  memset(profileStats, 0, sizeof(profileStats));
+}
+
+#else
+
+#define PROFILE_SECTION(section)
+
+size_t profileToText(char* buffer, size_t bufLength) {
+  return snprintf(buffer, bufLength, "profiler disabled (PROFILE_SECTIONS not defined)");
+}
+
+void profileReset() {}
+
+#endif
+
+#ifdef PROFILE_ISRS
+
+struct IsrStats {
+  uint32_t Count;                                 // Number of interrupts.
+  uint32_t Last;                                  // Cycles spent in the last one.
+  uint32_t Max;                                   // Most cycles spent in one.
+  uint64_t Total;                                 // Total cycles (for the average).
+};
+
+IsrStats isrStats[isrCOUNT];
+
+class IsrProfileScope {
+  public:
+    inline __attribute__((always_inline)) IsrProfileScope(isrSection section) : _section(section), _start(ESP.getCycleCount()) {}
+    inline __attribute__((always_inline)) ~IsrProfileScope() {
+      uint32_t cycles = ESP.getCycleCount() - _start;
+      IsrStats& stats = isrStats[_section];
+      stats.Last = cycles;
+      if (cycles > stats.Max) stats.Max = cycles;
+      stats.Total += cycles;
+      stats.Count++;
+    }
+  private:
+    isrSection _section;
+    uint32_t _start;
+};
+
+#define PROFILE_ISR(isr) IsrProfileScope _isrScope(isr)
+
+/*******************************************************************************
+ * profileIsrToText
+ * - Write the interrupt routine stats as a compact table (cycles) into the provided buffer.
+ * - Returns the number of characters written.
+********************************************************************************/
+size_t profileIsrToText(char* buffer, size_t bufLength) {
+  size_t n = snprintf(buffer, bufLength, "%-9s %8s %10s %10s %10s\n", "isr", "n", "last", "avg", "max");
+  for (int i = 0; i < isrCOUNT && n < bufLength; i++) {
+    IsrStats stats = isrStats[i];
+    uint32_t avg = (stats.Count > 0) ? (uint32_t)(stats.Total / stats.Count) : 0;
+    n += snprintf(buffer + n, bufLength - n, "%-9s %8u %10u %10u %10u\n", isrSectionName[i], stats.Count, stats.Last, avg, stats.Max);
+  }
+  return (n < bufLength) ? n : bufLength - 1;
+}
+
+void profileIsrReset() {
+  memset(isrStats, 0, sizeof(isrStats));
+}
+
+#else
+
+#define PROFILE_ISR(isr)
+
+size_t profileIsrToText(char* buffer, size_t bufLength) {
+  return snprintf(buffer, bufLength, "isr profiler disabled (PROFILE_ISRS not defined)");
+}
+
+void profileIsrReset() {}
+
+#endif
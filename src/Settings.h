@@ -0,0 +1,133 @@
+/*******************************************************************************
+ * Settings
+ * - Parsing of the setting values received in commands, and storing them in NVS (Preferences).
+ * - updatePreferences only checks that a value has the stored type. The range of a setting is checked by the
+ *   command that sets it (settingInt), e.g. ButtonPreset allows -1 (none), the durations do not.
+ * - The WiFi credentials are kept in fixed size buffers (Config). A command only replaces them when both the SSID
+ *   and the password are valid and fit (parseWiFiSetup).
+********************************************************************************/
+#include <ctype.h>
+#include <errno.h>
+#include <Preferences.h>
+
+Preferences preferences;
+
+/**************************************************************************
+ * settingInt
+ * - Parse a setting value that must be a whole number within minValue..maxValue (no trailing characters).
+ * - Returns false, and leaves value untouched, if it is not.
+ **************************************************************************/
+bool settingInt(const char* text, long minValue, long maxValue, int* value) {
+  char* p;
+  errno = 0;
+  long parsed = strtol(text, &p, 10);
+  if (p == text || *p != 0 || errno != 0 || parsed < minValue || parsed > maxValue) {
+    Serial.printf("- settingInt: NOT VALID [%s] (%ld..%ld)\n", text, minValue, maxValue);
+    return false;
+  }
+  *value = (int) parsed;
+  return true;
+}
+
+/**************************************************************************
+ * setCredential
+ * - Copy a (not necessarily terminated) credential into a fixed size config buffer.
+ * - Returns false, and leaves the buffer untouched, if the value does not fit.
+ **************************************************************************/
+bool setCredential(char* dest, size_t destLength, const char* value, size_t valueLength) {
+  if (valueLength >= destLength) {
+    Serial.printf("- setCredential: value too long (%u, max %u)\n", (unsigned) valueLength, (unsigned) destLength-1);
+    return false;
+  }
+  memcpy(dest, value, valueLength);
+  dest[valueLength] = '\0';
+  return true;
+}
+
+/**************************************************************************
+ * parseWiFiSetup
+ * - Parse the value of a WiFiSetup command: "<ssid>/<password>" (split at the first "/"), or "default".
+ *   The value is the raw MQTT payload (length given, not terminated, may hold any byte).
+ * - The SSID must not be empty. The password is empty (open network), 8..63 characters (WPA passphrase) or
+ *   64 hex digits (WPA key). Control characters (a NUL would cut the stored value short) are refused.
+ * - Only on credSet are ssid and password (credSSIDLength, credPasswordLength) replaced. On credDefault the
+ *   caller sets the defaults.
+ **************************************************************************/
+credResult parseWiFiSetup(const char* value, size_t length, char* ssid, char* password) {
+  if (length == 7 && memcmp(value, "default", 7) == 0) return credDefault;
+
+  const char* split = (const char*) memchr(value, '/', length);
+  if (split == NULL || split == value) return credInvalid;
+  size_t ssidLength = split - value;
+  size_t passwordLength = length - ssidLength - 1;
+  for (size_t i = 0; i < length; i++) {
+    if ((uint8_t) value[i] < 0x20 || value[i] == 0x7F) return credInvalid;
+  }
+  if (ssidLength >= credSSIDLength || passwordLength >= credPasswordLength) return credTooLong;
+  if (passwordLength > 0 && passwordLength < 8) return credInvalid;
+  if (passwordLength == 64) {
+    for (size_t i = 0; i < passwordLength; i++) {
+      if (!isxdigit((uint8_t) split[1 + i])) return credInvalid;
+    }
+  }
+
+  setCredential(ssid, credSSIDLength, value, ssidLength);
+  setCredential(password, credPasswordLength, split + 1, passwordLength);
+  return credSet;
+}
+
+/**************************************************************************
+ * updatePreferences
+ * - Update/set the provided setting in NVM, in the given namespace ("app" or channel namespace).
+ **************************************************************************/
+void updatePreferences(const char* nameSpace, const char* confKey, const char* newValue, const char* confType ) {
+
+  preferences.begin(nameSpace, false);    // opens namespace preferences in read-write mode
+
+  // Set a INTEGER setting (any int, the caller checks the range of the setting)
+  if ( strcmp(confType, "int") == 0) {
+    int   iValue = 0;
+    if (settingInt(newValue, INT32_MIN, INT32_MAX, &iValue)) {
+      Serial.printf("- updatePreferences: int=%d\n", iValue);
+      preferences.putInt(confKey,  iValue);
+      #ifdef TELNET_DEBUG
+        TelnetStream.printf("UpdatePreferences: Key=%s, Value=%d\n", confKey, iValue);
+      #endif
+    } else {
+      Serial.printf("- updatePreferences: NOT VALID int [%s]\n", newValue);
+    }
+  }
+  // Set a FLOAT setting
+  else if ( strcmp(confType, "float") == 0) {
+    char* p;
+    float   iValue = 0.0;
+    iValue = strtof(newValue, &p);
+    if (iValue >= 0) {                        // only support positive nr's. also:   if (*p == 0) {
+      Serial.printf("- updatePreferences: float=%f\n", iValue);
+      preferences.putFloat(confKey,  iValue);
+      #ifdef TELNET_DEBUG
+        TelnetStream.printf("UpdatePreferences: Key=%s, Value=%f\n", confKey, iValue);
+      #endif
+    } else {
+      Serial.printf("- updatePreferences: NOT VALID long [%s]\n", newValue);
+    }
+  }
+  // Set a STRING setting
+  else if (strcmp(confType, "string") == 0) {
+    Serial.println("- updatePreferences: char");
+    preferences.putString(confKey, newValue);
+    #ifdef TELNET_DEBUG
+      TelnetStream.printf("UpdatePreferences: Key=%s, Value=%s\n", confKey, newValue);
+    #endif
+  }
+  else if (strcmp(confType, "bool") == 0) {
+    Serial.printf("- updatePreferences: bool [%s]\n", newValue);
+    preferences.putBool(confKey, strcasecmp(newValue, "true") == 0 || strcmp(newValue, "1") == 0 );
+    #ifdef TELNET_DEBUG
+      TelnetStream.printf("UpdatePreferences: Key=%s, Value=%s\n", confKey, newValue);
+    #endif
+  } else {
+    Serial.printf("- updatePreferences: type unknown [%s]\n", confType);
+  }
+  preferences.end();                  // closes the namespace
+}
@@ -0,0 +1,131 @@
+/*******************************************************************************
+ * TaskMonitor
+ * - Collects stack high-water marks of the registered tasks, and heap statistics.
+ * - Recommends a stack size per task (used stack + 25% + safety margin), so over-sized stacks can be reclaimed.
+ * - Measures the wake-up jitter of the fixed-rate control task: how late each tick is on its schedule.
+ * - NOTE: on ESP32 the FreeRTOS stack sizes and high-water marks are in BYTES (not words).
+********************************************************************************/
+#include <ArduinoJson.h>
+#include <esp_heap_caps.h>
+
+const int monitorMaxTasks = 5;                    // Max number of tasks that can be registered.
+const int monitorStackMargin = 512;               // Safety margin added to the recommended stack size (bytes).
+
+struct MonitoredTask {
+  const char* Name;                               // Name as reported in app_state.
+  TaskHandle_t Handle;                            // Task handle.
+  uint32_t StackSize;                             // Stack size the task was created with (bytes).
+  uint32_t MinFreeStack;                          // Lowest free stack seen (bytes). High-water mark.
+};
+
+struct HeapStats {
+  uint32_t FreeHeap;                              // Currently free heap (bytes).
+  uint32_t MinFreeHeap;                           // Lowest free heap since boot (bytes).
+  uint32_t LargestFreeBlock;                      // Largest block that can currently be allocated (bytes).
+  int Fragmentation;                              // 100 - (largest block / free heap) (%).
+};
+
+struct TaskJitter {
+  uint32_t Count;                                 // Number of ticks measured.
+  uint64_t Sum;                                   // Sum of the deviations from the period (us).
+  uint32_t Max;                                   // Largest deviation (us).
+  uint32_t Late;                                  // Ticks off by more than jitterLateThreshold.
+  int64_t NextWake;                               // Scheduled time of the next tick (us), 0 = none yet.
+  volatile bool ResetRequest;                     // Clear the figures on the next tick (done by the measured task).
+};
+
+MonitoredTask monitorTasks[monitorMaxTasks];
+int monitorTaskCount = 0;
+HeapStats monitorHeap;
+TaskJitter motionJitter;                          // Motion control task tick.
+
+/*******************************************************************************
+ * taskMonitorRegister
+ * - Add a task to be monitored.
+********************************************************************************/
+void taskMonitorRegister(const char* name, TaskHandle_t handle, uint32_t stackSize) {
+  if (monitorTaskCount < monitorMaxTasks && handle != NULL) {
+    monitorTasks[monitorTaskCount].Name = name;
+    monitorTasks[monitorTaskCount].Handle = handle;
+    monitorTasks[monitorTaskCount].StackSize = stackSize;
+    monitorTasks[monitorTaskCount].MinFreeStack = stackSize;
+    monitorTaskCount++;
+  }
+}
+
+/*******************************************************************************
+ * taskMonitorCollect
+ * - Sample the stack high-water marks and heap statistics.
+********************************************************************************/
+void taskMonitorCollect() {
+  for (int i = 0; i < monitorTaskCount; i++) {
+    uint32_t freeStack = uxTaskGetStackHighWaterMark(monitorTasks[i].Handle);
+    if (freeStack < monitorTasks[i].MinFreeStack) monitorTasks[i].MinFreeStack = freeStack;
+  }
+
+  monitorHeap.FreeHeap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  monitorHeap.MinFreeHeap = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+  monitorHeap.LargestFreeBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  monitorHeap.Fragmentation = (monitorHeap.FreeHeap > 0) ? 100 - (int)((uint64_t)monitorHeap.LargestFreeBlock * 100 / monitorHeap.FreeHeap) : 0;
+}
+
+/*******************************************************************************
+ * taskMonitorRecommendedStack
+ * - Recommended stack size (bytes) for a task: used stack + 25% + margin, rounded up to 256 bytes.
+********************************************************************************/
+uint32_t taskMonitorRecommendedStack(const MonitoredTask& task) {
+  uint32_t used = task.StackSize - task.MinFreeStack;
+  uint32_t recommended = used + used / 4 + monitorStackMargin;
+  return (recommended + 255) & ~255UL;
+}
+
+/*******************************************************************************
+ * taskMonitorToJson
+ * - Add the per-task stack figures (size, min free, recommended) to the provided JSON object.
+********************************************************************************/
+void taskMonitorToJson(JsonObject tasks) {
+  for (int i = 0; i < monitorTaskCount; i++) {
+    JsonArray task = tasks.createNestedArray(monitorTasks[i].Name);
+    task.add(monitorTasks[i].StackSize);
+    task.add(monitorTasks[i].MinFreeStack);
+    task.add(taskMonitorRecommendedStack(monitorTasks[i]));
+  }
+}
+
+/*******************************************************************************
+ * taskJitterSample
+ * - Record one tick of a fixed-rate task, woken at "now" (us). Called by the measured task itself, right after
+ *   its delay (vTaskDelayUntil, which keeps the schedule: the tick after a late one is on time again).
+ * - The deviation is the time from the scheduled tick (the first tick plus whole periods). Measuring the time
+ *   between two ticks instead would count each late tick twice: late, and the next one early.
+********************************************************************************/
+void taskJitterSample(TaskJitter& jitter, int64_t now, uint32_t periodUs) {
+  if (jitter.ResetRequest) {
+    jitter.Count = 0;
+    jitter.Sum = 0;
+    jitter.Max = 0;
+    jitter.Late = 0;
+    jitter.NextWake = 0;
+    jitter.ResetRequest = false;
+  }
+  if (jitter.NextWake != 0) {
+    int64_t deviation = now - jitter.NextWake;
+    uint32_t absDeviation = (uint32_t) (deviation < 0 ? -deviation : deviation);
+    jitter.Count++;
+    jitter.Sum += absDeviation;
+    if (absDeviation > jitter.Max) jitter.Max = absDeviation;
+    if (absDeviation > (uint32_t) jitterLateThreshold) jitter.Late++;
+  }
+  jitter.NextWake = (jitter.NextWake != 0 ? jitter.NextWake : now) + periodUs;
+}
+
+/*******************************************************************************
+ * taskJitterToJson
+ * - Add the jitter figures to the provided JSON array: [n, avg, max, late] (us).
+********************************************************************************/
+void taskJitterToJson(JsonArray arr, const TaskJitter& jitter) {
+  arr.add(jitter.Count);
+  arr.add(jitter.Count > 0 ? (uint32_t) (jitter.Sum / jitter.Count) : 0);
+  arr.add(jitter.Max);
+  arr.add(jitter.Late);
+}
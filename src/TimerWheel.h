@@ -0,0 +1,140 @@
+/*******************************************************************************
+ * TimerWheel
+ * - Hashed timer wheel for the motor deadlines (open and max run timeouts, soft-start steps, brake release),
+ *   driven by one periodic esp_timer (wheelTick). Adding a deadline costs a WheelTimer, not an esp_timer or
+ *   a hardware timer.
+ * - wheelSlots slots of one tick each. A timer is linked in the slot it expires in, with the number of full wheel
+ *   turns still to go. Arm and cancel are O(1), a tick only visits the timers of one slot.
+ * - A tick collects the expired timers with the wheel locked (at most wheelMaxDue, the rest move to the next
+ *   tick), and calls them after unlocking, from the esp_timer task. Callbacks stay short (set flags for the motor
+ *   task, no logging), but may take locks and arm or cancel timers. Periodic timers are re-armed by the wheel.
+ * - Arming or cancelling bumps the generation of a timer: an expiry collected before that is not called.
+ *   wheelCancel waits for a callback of the timer that is running on the esp_timer task, so once it returns
+ *   the callback is not called anymore.
+********************************************************************************/
+#include <esp_timer.h>
+
+static_assert((wheelSlots & (wheelSlots - 1)) == 0, "wheelSlots must be a power of 2");
+
+portMUX_TYPE muxWheel = portMUX_INITIALIZER_UNLOCKED;
+WheelTimer* wheelSlot[wheelSlots];                // Head of the timer list of each slot.
+uint32_t wheelNow;                                // Ticks since start, the current slot is wheelNow % wheelSlots.
+esp_timer_handle_t tmrWheel;                      // Periodic timer advancing the wheel.
+TaskHandle_t wheelTask;                           // Task calling the callbacks (the esp_timer task).
+
+/*******************************************************************************
+ * wheelLink / wheelUnlink
+ * - Add or remove a timer to/from its slot list. Wheel must be locked.
+********************************************************************************/
+void wheelLink(WheelTimer& t, uint32_t ticks) {
+  if (ticks == 0) ticks = 1;                                // Earliest: the next tick.
+  uint32_t expiry = wheelNow + ticks;
+  t.Slot = expiry & (wheelSlots - 1);
+  t.Rounds = (expiry - wheelNow - 1) / wheelSlots;
+  t.Prev = nullptr;
+  t.Next = wheelSlot[t.Slot];
+  if (t.Next) t.Next->Prev = &t;
+  wheelSlot[t.Slot] = &t;
+  t.Armed = true;
+}
+
+void wheelUnlink(WheelTimer& t) {
+  if (t.Prev) { t.Prev->Next = t.Next; } else { wheelSlot[t.Slot] = t.Next; }
+  if (t.Next) t.Next->Prev = t.Prev;
+  t.Next = t.Prev = nullptr;
+  t.Armed = false;
+}
+
+/*******************************************************************************
+ * wheelInit
+ * - Set up a timer with its callback (and the argument passed to it). Not armed.
+********************************************************************************/
+void wheelInit(WheelTimer& t, WheelCallback callback, void* arg) {
+  t = WheelTimer();
+  t.Callback = callback;
+  t.Arg = arg;
+}
+
+/*******************************************************************************
+ * wheelArm
+ * - (Re)start the timer: expire after "delay" milliseconds, and every "period" milliseconds after that (0 = once).
+********************************************************************************/
+void wheelArm(WheelTimer& t, uint32_t delay, uint32_t period = 0) {
+  portENTER_CRITICAL(&muxWheel);
+  if (t.Armed) wheelUnlink(t);
+  t.Generation++;
+  t.Period = (period + wheelTick - 1) / wheelTick;
+  wheelLink(t, (delay + wheelTick - 1) / wheelTick);
+  portEXIT_CRITICAL(&muxWheel);
+}
+
+/*******************************************************************************
+ * wheelCancel
+ * - Stop the timer. Once cancelled its callback is not called anymore.
+********************************************************************************/
+void wheelCancel(WheelTimer& t) {
+  portENTER_CRITICAL(&muxWheel);
+  if (t.Armed) wheelUnlink(t);
+  t.Generation++;
+  portEXIT_CRITICAL(&muxWheel);
+  if (xTaskGetCurrentTaskHandle() != wheelTask) {
+    while (t.Running) {}                                    // Callback running on the other core: a few us.
+  }
+}
+
+/*******************************************************************************
+ * onTimerWheel
+ * - Advance the wheel one tick, and call the timers expiring in the new slot (after unlocking the wheel).
+ * - esp_timer callback (every wheelTick).
+********************************************************************************/
+void onTimerWheel(void* arg) {
+  WheelTimer* due[wheelMaxDue];
+  uint32_t dueGeneration[wheelMaxDue];
+  int count = 0;
+
+  wheelTask = xTaskGetCurrentTaskHandle();
+  portENTER_CRITICAL(&muxWheel);
+  wheelNow++;
+  WheelTimer* t = wheelSlot[wheelNow & (wheelSlots - 1)];
+  while (t) {
+    WheelTimer* next = t->Next;
+    if (t->Rounds > 0) {
+      t->Rounds--;
+    } else if (count == wheelMaxDue) {
+      wheelUnlink(*t);
+      wheelLink(*t, 1);                                     // No room this tick: expires on the next one.
+    } else {
+      wheelUnlink(*t);
+      if (t->Period > 0) wheelLink(*t, t->Period);      // Periodic: lands in a later slot, not visited again this tick.
+      due[count] = t;
+      dueGeneration[count] = t->Generation;
+      count++;
+    }
+    t = next;
+  }
+  portEXIT_CRITICAL(&muxWheel);
+
+  for (int i = 0; i < count; i++) {
+    t = due[i];
+    portENTER_CRITICAL(&muxWheel);
+    bool call = t->Generation == dueGeneration[i];          // Not armed again or cancelled since it expired.
+    t->Running = call;
+    portEXIT_CRITICAL(&muxWheel);
+    if (call) {
+      t->Callback(t->Arg);
+      t->Running = false;
+    }
+  }
+}
+
+/*******************************************************************************
+ * wheelSetup
+ * - Start the periodic timer that advances the wheel.
+********************************************************************************/
+void wheelSetup() {
+  esp_timer_create_args_t wheelArgs = {};
+  wheelArgs.callback = &onTimerWheel;
+  wheelArgs.name = "timerWheel";
+  esp_timer_create(&wheelArgs, &tmrWheel);
+  esp_timer_start_periodic(tmrWheel, wheelTick * 1000ULL);
+}
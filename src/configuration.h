@@ -1,35 +1,134 @@
 const char* SKETCH_VERSION = "v221016.0";
 
 #define TELNET_DEBUG                               // Stream debug statements to UDP Telnet if defined
+//#define PROFILE_SECTIONS                         // Profile loop sections (CPU cycles) if defined. Report with "getprofile".
+//#define PROFILE_ISRS                             // Profile the interrupt routines (CPU cycles) if defined. Report with "getprofile".
+//#define WATCHDOG_TEST                            // Enable the "simhang:<ms>" appcmd, to test the motor task watchdog fail-safe.
+//#define JITTER_TEST                              // Enable the "netload:<s>" appcmd, to measure the control tick jitter under WiFi/MQTT load.
+//#define MOTOR_DRIVER_MCPWM                       // Drive the IBT-2 with MCPWM (complementary, dead-time, fault input) instead of LEDC.
+//#define PUBLISH_BUFFERED                         // Publish JSON from a buffer (previous way) instead of streaming, to compare publish time and loop stack.
 
 const char* default_ssid = "<Default SSID>";       // SSID
 const char* default_password = "<Default PWD>";    // PSK
 const char* mqtt_server = "<MQTT Broker IP>";      // MQTT Broker IP address
 const char* mqtt_pwd = "<MQTT PWD>";               // MQTT Broker password
+const char* ntp_server = "pool.ntp.org";           // NTP server, for the scheduled homing time
+const char* ntp_timezone = "CET-1CEST,M3.5.0,M10.5.0/3";   // POSIX timezone of the HomingTime
 
 // Pins
 // (default GPIO 21)                    // - Sensor SDA (SDI) -> ESP32.SDA  
 // (default GPIO 22)                    // - Sensor SCL (SCK) -> ESP32.SCL  
-const int pin_RPWM = 25;                // PWM output pin 25  -> connect to IBT-2 pin 1 (RPWM)
-const int pin_LPWM = 26;                // PWM output pin 26  -> connect to IBT-2 pin 2 (LPWM)
-const int pin_REN = 14;                 // DO output pin 14   -> connect to IBT-2 pin 3 (R_EN)
-const int pin_LEN = 27;                 // DO output pin 27   -> connect to IBT-2 pin 4 (L_EN)
-const int pin_iSense = 32;              // ADC input pin 23   -> connect to IBT-2 pins 5 & 6 (R_IS + L_IS) + 10k to ground.
-const int pin_MotorRotations = 13;      // Motor Rotation Pulse counter (Hall sensor or other switch pulled down per count)
-const int pin_BtnOpen = 18;             // DI input pin 18  -> Button for manual blinds OPEN (up)
-const int pin_BtnClose = 19;            // DI input pin 19  -> Button for manual blinds CLOSE (down)
-const int pin_StopOpen = 16;            // DI input pin 16. -> Limit Switch OPEN (top reached)
-const int pin_StopClosed = 17;          // DI input pin 17  -> Limit Switch CLOSED (bottom reached)
-//const int pin_StopOpenMid = 4?;       // DI input pin ?.  -> Limit Switch 3. (middle)             Currently not used.
 const int pin_Buzzer = 5;               // DO output pin 5. -> Active Buzzer.
 
+// Blinds channels. One entry per motor (IBT-2 driver) connected to this ESP32.
+// Each channel gets its own MQTT topics ("<Topic>/action", "<Topic>/state", ..) and configuration settings.
+struct ChannelPins {
+  const char* Topic;                    // MQTT topic base of the channel
+  int RPWM;                             // PWM output       -> connect to IBT-2 pin 1 (RPWM)
+  int LPWM;                             // PWM output       -> connect to IBT-2 pin 2 (LPWM)
+  int REN;                              // DO output        -> connect to IBT-2 pin 3 (R_EN)
+  int LEN;                              // DO output        -> connect to IBT-2 pin 4 (L_EN)
+  int iSense;                           // ADC input        -> connect to IBT-2 pins 5 & 6 (R_IS + L_IS) + 10k to ground. (ADC1 pins only, ADC2 is used by WiFi)
+  int MotorRotations;                   // DI input         -> Motor Rotation Pulse counter (Hall sensor or other switch pulled down per count)
+  int BtnOpen;                          // DI input         -> Button for manual blinds OPEN (up)
+  int BtnClose;                         // DI input         -> Button for manual blinds CLOSE (down)
+  int StopOpen;                         // DI input         -> Limit Switch OPEN (top reached)
+  int StopClosed;                       // DI input         -> Limit Switch CLOSED (bottom reached)
+  int Fault;                            // DI input         -> Driver fault, active low (-1 = none)
+};
+
+const ChannelPins channelPins[] = {
+  // Topic                 RPWM LPWM REN LEN iSense Rot BtnO BtnC StopO StopC Fault
+  { "livingroom/blinds",    25,  26,  14, 27,  32,   13,  18,  19,  16,   17,   -1 },
+//{ "livingroom/blinds2",   ..,  ..,  .., ..,  33,   ..,  ..,  ..,  ..,   ..,   -1 },
+};
+const int maxChannels = 4;              // Max number of blinds channels supported (2 LEDC channels each)
+const int channelCount = sizeof(channelPins) / sizeof(channelPins[0]);
+static_assert(channelCount <= maxChannels, "Too many blinds channels defined");
+
 const int pwmResolution = 8;            // PWM frequency resolution
 const int pwmFrequency = 20000;         // PWM frequency (in Hz)
-const int pwmChannel_Open = 0;          // Channel for OPEN (RIGHT) PWM timer
-const int pwmChannel_Close = 1;         // Channel for DOWN (LEFT) PWM timer
+const int rampStepDuration = 5;         // Soft-start: time between PWM duty cycle steps (milliseconds)
+const int rampStartDuty = 50;           // Soft-start: first PWM duty cycle
+const int groupMinDuty = 120;           // Group move: lowest max duty cycle when scaling speeds to arrive together
+const int planControlPeriod = 10;       // Motion planner: control task period (milliseconds)
+const int planAccelTime = 600;          // Motion planner: time to accelerate to cruise speed (milliseconds)
+const int planDecelTime = 800;          // Motion planner: time to decelerate from cruise speed (milliseconds)
+const int planMinDuty = 90;             // Motion planner: lowest duty cycle at which the motor still turns under load
+const int planKp = 25;                  // Motion planner: duty cycle correction per rotation behind/ahead of plan
+const int planSampleInterval = 250;     // Motion planner: interval between planned-versus-actual error samples (milliseconds)
+const int planMaxSamples = 32;          // Motion planner: max number of error samples per move
+const int retargetDecelTime = 300;      // Retarget: time to decelerate before reversing direction (milliseconds)
+const int retargetDeadTime = 250;       // Retarget: time with the driver off before reversing direction (milliseconds)
+const int wheelTick = 1;               // Timer wheel: tick of the motor deadlines (milliseconds)
+const int heartbeatCheckInterval = 100; // Motor task supervisor: interval between heartbeat checks (milliseconds)
+const int heartbeatTimeout = 500;       // Motor task supervisor: heartbeat age that cuts the running motors (milliseconds)
+const int watchdogTimer = 0;            // Motor task supervisor: hardware timer of the heartbeat check (0-3)
+const int watchdogCore = 0;             // Motor task supervisor: core the timer interrupt runs on (not the motor task core)
+const int taskWatchdogTimeout = 5;      // Task watchdog: restart if the motor task does not feed it for x seconds
+const int wheelSlots = 256;             // Timer wheel: number of slots (power of 2), one wheel turn = wheelSlots ticks
+const int wheelMaxDue = 16;             // Timer wheel: max timers called per tick (more move to the next tick)
+const int driverBrakeTime = 500;        // Brake stop: time both low-side switches are kept on before the driver is disabled (milliseconds)
+const int driverStopSettleTime = 1500;  // Time after a stop in which rotations count towards the stopping distance (milliseconds)
+const int mcpwmDeadTime = 10;           // MCPWM: dead-time between the complementary outputs (x 100ns)
+const int calPauseTime = 1000;          // Calibration: pause between the runs (milliseconds)
+const int calMaxTravelTime = 180;       // Calibration: max duration of one run, replaces MaxRunDuration while calibrating (seconds)
+const int calTimeMargin = 125;          // Calibration: timeouts derived as measured travel time + margin (percent)
+const int calCurrentMargin = 130;       // Calibration: current limit derived as measured peak current + margin (percent)
 const int wifiMaxRetry = 10;            // Number of times to try and reconnect WiFi, per call.
 const int mqttMaxRetry = 2;             // Number of times to try and reconnect MQTT.
+const int mqttReconnectInterval = 5000; // Interval between MQTT reconnect attempts while the broker is down (milliseconds)
+const int httpPort = 80;                // HTTP API: port
+const int httpMaxConnections = 3;       // HTTP API: max open connections (least recently used one is closed)
+const int httpMaxEndpoints = 8;         // HTTP API: max number of endpoints
+const int httpBodyLength = 24;          // HTTP API: max request body (bytes), also the max length of a queued action
+const int httpQueueLength = 4;          // HTTP API: commands queued for the main loop
+const int httpChunkSize = 256;          // HTTP API: JSON responses are streamed in chunks of this size (bytes)
+const int httpAnswerSize = 1536;        // HTTP API: capacity of the answer document built by the main loop (bytes)
+const int httpQueryTimeout = 2000;      // HTTP API: max wait for the main loop to answer a query (milliseconds)
+const int credSSIDLength = 33;          // Max WLAN SSID length (32 characters + terminator).
+const int credPasswordLength = 65;      // Max WLAN password length (64 characters + terminator).
+const int topicLength = 48;             // Max length of a channel MQTT topic.
+const int mqttBufferSize = 1024;        // MQTT client buffer size (bytes), set once at boot. Default of 256 is too small for the profile text.
+const int mqttChunkSize = 64;           // JSON publishes are streamed to the MQTT client in chunks of this size (bytes)
+const int debounceSampleInterval = 1;   // Interval between button and limit switch samples (milliseconds, timer wheel: multiple of wheelTick)
 const int currentSenseInterval = 200;   // Interval between current sense checks to prevent overcurrent. (milliseconds) 
+const int taskMonitorInterval = 60;     // Interval between task stack and heap samples. (seconds)
+const int deltaMaxFields = 32;          // Delta publishing: max top-level fields tracked per JSON message (config, app_state)
+const int deltaSnapshotInterval = 60;   // Delta publishing: full config/app_state snapshot at least this often (minutes)
+
+// Task stacks: deepest call path (static frame sizes) plus the library calls on it (printf family ~1.5 KB), the
+// task context, then sized like taskMonitorRecommendedStack (+ 25% + 512). Check against the app_state high-water marks.
+const int stackMotorTask = 3584;        // Stack size of the motor actions task (bytes). Logs with Serial.printf (est. 2.4 KB)
+const int stackOTATask = 10000;         // Stack size of the OTA task (bytes). ArduinoOTA/Update est. 5 KB, an https pull runs TLS here
+const int stackMotionTask = 2048;       // Stack size of the motion control task (bytes). No printf in this task (est. 0.9 KB)
+const int stackHttpTask = 4608;         // Stack size of the HTTP server task (bytes). Answers are built by the main loop (est. 3.2 KB)
+#ifdef CONFIG_ARDUINO_LOOP_STACK_SIZE
+const int stackLoopTask = CONFIG_ARDUINO_LOOP_STACK_SIZE;   // Stack size of the Arduino loop task (bytes)
+#else
+const int stackLoopTask = 8192;         // Stack size of the Arduino loop task (bytes)
+#endif
+
+// Task layout: core and priority of each task. Core 0 runs the WiFi/lwIP stack (priority 18+), so only the
+// network side goes there. Core 1 runs the control tasks above the Arduino loop task (MQTT, sensors and reports,
+// priority 1 on ARDUINO_RUNNING_CORE). The control tasks must block every pass, or the loop task starves.
+const int coreMotionTask = 1;           // Core of the fixed-rate motion control task
+const int prioMotionTask = 4;           // Priority of the motion control task (highest: keeps the control period)
+const int coreMotorTask = 1;            // Core of the motor actions task
+const int prioMotorTask = 3;            // Priority of the motor actions task
+const int coreOTATask = 0;              // Core of the OTA task (network side)
+const int prioOTATask = 1;              // Priority of the OTA task (below the WiFi stack)
+const int coreHttpTask = 0;             // Core of the HTTP server task (network side)
+const int prioHttpTask = 1;             // Priority of the HTTP server task (below the WiFi stack)
+const int motorTaskInterval = 1;        // Pause after each motor task pass, lets the loop task run (milliseconds)
+const int jitterLateThreshold = 1000;   // Control tick later than this counts as late (microseconds, one RTOS tick)
+const int otaPollInterval = 100;        // OTA: interval between checks for an OTA invitation (milliseconds)
+const int otaStopTimeout = 2000;        // OTA: max wait for the motors to stop before the update is refused (milliseconds)
+const int otaProgressStep = 10;         // OTA: publish the progress every x percent
+const int otaUrlLength = 128;           // OTA: max length of the URL of a pulled image (appcmd "update")
+const int otaRxBufferSize = 1024;       // OTA: receive buffer of a pulled image (bytes)
+const int otaValidateTimeout = 180;     // OTA: new image not validated (MQTT + motor self-check) within this time is rolled back (seconds)
+const int netLoadPayload = 512;         // JITTER_TEST: size of each MQTT message published by "netload" (bytes)
 
 const int BleepTimeOn = 80;             // Buzzer "on" duration
 const int BleepTimeOff = 110;           // Buzzer "off" duration
@@ -37,7 +136,19 @@ const int BleepTimeOff = 110;           // Buzzer "off" duration
 const int luxLowLevelThreshold = 25;    // Report Lux level with each time interval when it starts to get dark.
 
 enum blindsAction {actUNDEF, actBlindsOpen, actBlindsClose, actBlindsStop};
-enum actionOwner {ownUNDEF, ownMQTT, ownButton, ownLimit};
+enum actionOwner {ownUNDEF, ownMQTT, ownButton, ownLimit, ownCalibrate, ownHoming};
+enum stopReason {stpUNDEF, stpLimitOpen, stpLimitClosed, stpButton, stpTimerOpen, stpTimerMaster, stpRotations, stpMaxCurrent, stpMQTT, stpRetarget, stpFault, stpEstimate, stpWatchdog, stpOTA, stpCOUNT};
+enum retargetPhase {rtgNone, rtgDecel, rtgDeadTime};
+enum retargetStepResult {rtsNone, rtsStop, rtsStart};
+enum calPhase {calIdle, calHoming, calOpening, calClosing, calDone, calFailed};
+enum homingMode {homNone, homCommand, homBoot, homScheduled};
+enum gestureEvent {gesNone, gesPress, gesClick, gesDouble, gesHold, gesLong, gesJogEnd, gesCOUNT};
+enum gesturePhase {gphIdle, gphPressed, gphJog, gphLatched, gphClicked, gphIgnore};
+enum otaPhase {otaIdle, otaStarting, otaRunning, otaDone, otaFailed, otaValidated};
+enum credResult {credInvalid, credTooLong, credSet, credDefault};
+
+const int journalSize = 16;             // Number of motor runs kept in the journal ring buffer.
+const int journalBatchSize = 4;         // Publish the journal once this many runs are waiting to be reported.
 
 /* Naming Convention
  *  btn  -> Button
@@ -50,42 +161,161 @@ enum actionOwner {ownUNDEF, ownMQTT, ownButton, ownLimit};
  *  tmp  -> Temperature sensor
 */
 
-#define MQTT_PUB_BLINDSSTATE    "livingroom/blinds/state"           // PUBLISH: current Blinds state                    (open/closed + %)
-#define MQTT_PUB_CONFIG         "livingroom/blinds/config"          // PUBLISH: configuration settings                  (JSON settings)
+// Channel topics: appended to the channel topic base (e.g. "livingroom/blinds" + "/state")
+#define MQTT_PUB_BLINDSSTATE    "/state"                            // PUBLISH: current Blinds state                    (open/closed + %)
+#define MQTT_PUB_CONFIG         "/config"                           // PUBLISH: configuration settings                  (JSON settings)
+#define MQTT_PUB_CONFIG_DELTA   "/config/delta"                     // PUBLISH: changed configuration settings          (JSON settings)
+#define MQTT_SUB_BLINDSACTION   "/action"                           // SUBSCRIBE: blinds action (open/close/stop)
+#define MQTT_SUB_APPCMD         "/appcmd"                           // SUBSCRIBE: app configuration and action commands
+
+// Device topics
 #define MQTT_PUB_APPSTATE       "livingroom/blinds/app_state"       // PUBLISH: telemetry metrics                       (JSON parameters)
+#define MQTT_PUB_APPSTATE_DELTA "livingroom/blinds/app_state/delta" // PUBLISH: changed telemetry metrics               (JSON parameters)
+#define MQTT_PUB_APPCONFIG_DELTA "livingroom/blinds/app_config/delta" // PUBLISH: changed shared settings          (JSON settings)
 #define MQTT_PUB_LUX            "livingroom/lightlevel/state"       // PUBLISH: current Lux reading                     (value)
 #define MQTT_PUB_TEMP           "livingroom/temperature/state"      // PUBLISH: current temperate reading               (value)
 #define MQTT_PUB_HUMIDITY       "livingroom/humidity/state"         // PUBLISH: current humidity reading                (value)
+#define MQTT_PUB_JOURNAL        "livingroom/blinds/journal"         // PUBLISH: motor run journal                       (JSON array of runs)
+#define MQTT_PUB_LATENCY        "livingroom/blinds/latency"         // PUBLISH: command latency per stage               (JSON parameters)
+#define MQTT_PUB_PROFILE        "livingroom/blinds/profile"         // PUBLISH: loop section profile                    (text table)
+#define MQTT_PUB_MOTION         "livingroom/blinds/motion"          // PUBLISH: planned-versus-actual per position move (JSON parameters)
+#define MQTT_PUB_CALIBRATION    "livingroom/blinds/calibration"     // PUBLISH: travel calibration progress and result (JSON parameters)
+#define MQTT_PUB_HOMING         "livingroom/blinds/homing"          // PUBLISH: homing result and duration              (JSON parameters)
+#define MQTT_PUB_OTA            "livingroom/blinds/ota"             // PUBLISH: OTA update progress and result          (JSON parameters)
+#define MQTT_PUB_NETLOAD        "livingroom/blinds/netload"         // PUBLISH: filler traffic of the jitter test       (JITTER_TEST "netload")
 
-#define MQTT_SUB_BLINDSACTION   "livingroom/blinds/action"          // SUBSCRIBE: blinds action (open/close/stop)
-#define MQTT_SUB_APPCMD         "livingroom/blinds/appcmd"          // SUBSCRIBE: app configuration and action commands
+#define MQTT_SUB_GROUP          "livingroom/blinds/group"           // SUBSCRIBE: synchronised move of several channels
 #define MQTT_SUB_NOTIFY         "all/notify/bleep"                  // SUBSCRIBE: string pattern to beep the buzzer
 
 struct BlindsAction {
   volatile bool NewAction;                        // New/unprocessed action flag. E.g. from MQTT
   volatile blindsAction Action;                   // Requested action to perform.
+  volatile int Target;                            // Requested target position (rotations, or permille if estimated). Latest request wins.
+  volatile bool Group;                            // Action is part of a group move (started by the motor task for all members at once).
+};
+
+struct Debouncer {
+  volatile bool State;                            // Debounced state (true = active, pulled low).
+  volatile bool Pressed;                          // Edge to active seen, not yet handled.
+  volatile bool Released;                         // Edge to inactive seen, not yet handled.
+  uint16_t Count;                                 // Integrator: raw samples that differed from the state.
+  int64_t ChangeStart;                            // Timestamp of the first raw sample of the change (us).
+  volatile int64_t EdgeTime;                      // Timestamp of the last debounced edge (us).
+};
+
+struct Gesture {
+  gesturePhase Phase;                             // Where the button is in a gesture.
+  int64_t PressTime;                              // Timestamp of the last press (us).
+  int64_t ReleaseTime;                            // Timestamp of the last click release (us).
+};
+
+typedef void (*WheelCallback)(void* arg);
+
+struct WheelTimer {
+  WheelTimer* Next;                               // Slot list (intrusive, doubly linked)
+  WheelTimer* Prev;
+  uint16_t Slot;                                  // Slot the timer is linked in
+  uint32_t Rounds;                                // Full wheel turns left before it expires
+  uint32_t Period;                                // Re-arm period (ticks. 0 = one-shot)
+  bool Armed;
+  uint32_t Generation;                            // Bumped by arm and cancel: drops an expiry collected before
+  volatile bool Running;                          // Callback in progress (esp_timer task)
+  WheelCallback Callback;                         // Called when expired, from the esp_timer task: keep it short.
+  void* Arg;
 };
 
 struct Button {
-  volatile bool Changed;                          // Button status changed (pressed/released).
-  volatile unsigned long lastDebounceTime;        // Timestamp when button status changed. Used for debouncing.
   volatile unsigned long lastStopTime;            // Timestamp of last time that button stopped motor.
+  Debouncer Input;                                // Debouncer of the button input.
+  Gesture Gest;                                   // Gesture recogniser of the button.
 };
 
 struct Switch {
   volatile bool Set;                              // The Limit Switch is set (don't use open/close naming to avoid confusion)
   volatile unsigned long lastDebounceTime;        // Timestamp when limit switch was closed. Used for debouncing.
+  Debouncer Input;                                // Debouncer of the limit switch input.
 };
 
 struct Motor {
   volatile bool AllowToRun;                       // Allow motor to start if not running. Stop motor if currently running.
   volatile bool IsRunning;                        // Indication if motor is currently running, or stopped.
-  volatile int targetPosition;                    // Position to where blinds must go.
+  volatile int targetPosition;                    // Position to where blinds must go. (rotations, or permille if estimated)
   volatile int currentPosition;                   // Position where blinds currently are. Based on motor axis rotations.
   volatile blindsAction Action;                   // Action to take when motor is started (open or close).
   volatile actionOwner Owner;                     // Who or What initiated the action.
 };
 
+struct Retarget {
+  retargetPhase Phase;                            // Reversal in progress: decelerating, or waiting for the dead-time.
+  blindsAction Action;                            // Direction requested (used if no target position is known).
+  int Target;                                     // Target position to move to after the reversal.
+  unsigned long PhaseStart;                       // Timestamp the phase started (millis).
+  int StartDuty;                                  // Duty cycle when the deceleration started.
+};
+
+struct MotionPlan {
+  volatile bool Active;                           // The move is controlled by the motion planner.
+  volatile bool Done;                             // A planned move completed, its summary is not yet published.
+  unsigned long StartTime;                        // Timestamp the move started (millis).
+  unsigned long StopTime;                         // Timestamp the move stopped (millis).
+  int StartPosition;                              // Position (rotations) when the move started.
+  int Distance;                                   // Rotations to travel.
+  float Tstart;                                   // Start of the current profile, after the move started (seconds, >0 if retargeted).
+  float Offset;                                   // Planned distance at Tstart (rotations).
+  float V0;                                       // Planned speed at Tstart (rotations/second).
+  float Vmax;                                     // Planned cruise speed (rotations/second).
+  float Tacc;                                     // Acceleration phase, from V0 to Vmax (seconds).
+  float Tcruise;                                  // Cruise phase (seconds).
+  float Tdec;                                     // Deceleration phase (seconds).
+  float Error;                                    // Latest planned minus actual position (rotations).
+  float MaxError;                                 // Largest absolute error during the move (rotations).
+  int16_t Samples[planMaxSamples];                // Error samples (tenths of a rotation).
+  int SampleCount;                                // Number of error samples.
+  unsigned long LastSample;                       // Timestamp of the last error sample (millis).
+};
+
+struct Calibration {
+  volatile bool Request;                          // Calibration requested (MQTT), to be started by the motor task.
+  volatile bool Abort;                            // Abort the calibration in progress (MQTT stop).
+  volatile bool Publish;                          // Progress or result changed, not yet published.
+  bool Saved;                                     // The result was applied to the configuration and stored.
+  volatile calPhase Phase;                        // Current step: home to CLOSED, run to OPEN, run back to CLOSED.
+  bool Waiting;                                   // Pausing before the run of the current phase is started.
+  unsigned long StartTime;                        // Timestamp the calibration started (millis).
+  unsigned long PhaseStart;                       // Timestamp the current run or pause started (millis).
+  int Rotations;                                  // Rotations counted from CLOSED to OPEN (0 = no rotation sensor).
+  unsigned long OpenTime;                         // Travel time CLOSED to OPEN (milliseconds).
+  unsigned long CloseTime;                        // Travel time OPEN to CLOSED (milliseconds).
+  int MeanCurrent;                                // Baseline current while opening (raw analog reading).
+  int PeakCurrent;                                // Highest current sample of both runs (raw analog reading).
+  stopReason FailReason;                          // Why the calibration failed.
+};
+
+struct DeltaField {
+  uint32_t Key;                                   // Hash of the field name.
+  uint32_t Value;                                 // Hash of the last published value.
+};
+
+struct DeltaTracker {
+  DeltaField Fields[deltaMaxFields];              // Fields of the last published message.
+  int Count;                                      // Fields in use.
+  bool Baseline;                                  // A full snapshot was published (since the last MQTT connect).
+  unsigned long SnapshotTime;                     // Timestamp of the last full snapshot (millis).
+};
+
+struct Homing {
+  volatile bool Request;                          // Homing requested, to be started by the motor task.
+  volatile homingMode Trigger;                    // What requested the homing (first command, boot, scheduled time).
+  bool Active;                                    // Homing run in progress.
+  unsigned long StartTime;                        // Timestamp the homing started (millis).
+  unsigned long Duration;                         // Duration of the last homing (milliseconds).
+  bool Success;                                   // The last homing reached the reference switch.
+  stopReason FailReason;                          // Why the last homing failed.
+  volatile blindsAction QueuedAction;             // Command to execute once homed (actUNDEF = none).
+  volatile int QueuedTarget;                      // Target position of the queued command.
+  volatile bool Publish;                          // Result not yet published.
+};
+
 struct Config {
   bool AllowRemoteControl;                        // Allow remote control (MQTT) of the blinds motor. (true/false)
   bool AllowRemoteBleep;                          // Allow buzzer bleep via MQTT. (true/false)
@@ -93,13 +323,84 @@ struct Config {
   int Lux_MinReportDelta;                         // Minimum change from previous upload to report Lux levels
   int Temp_Interval;                              // Interval between Temperature feedback (minutes)
   int State_Interval;                             // Interval between State feedback (minutes) 
-  int DebounceDurSwitches;                        // Debounce time for Button and Limit switches
+  char SSID[credSSIDLength];                      // WLAN SSID
+  char Password[credPasswordLength];              // WLAN password
+};
+
+struct ChannelConfig {
+  int DebounceDurSwitches;                        // Debounce press time for Button and Limit switches (milliseconds)
+  int DebounceDurRelease;                         // Debounce release time for Button and Limit switches (milliseconds)
   int DebounceDurMotor;                           // Debounce time for motor rotation switch
   bool RotationLimits;                            // Blinds considered open/closed based on rotation count. Else open/closed at limit switches.
   int Open_Duration;                              // How long to allow motor to run when opening blinds (seconds)
   int Open_MaxRotations;                          // How many motor axis rotations before blinds are fully open
   int MaxCurrentLimit;                            // Maximum current motor can draw before stopped (raw analog reading)
   int MaxRunDuration;                             // Maximum time that motor can run in any direction (seconds). (prevents running forever when e.g. the blinds cord snaps)
-  char* SSID;                         			      // WLAN SSID
-  char* Password;                     			      // WLAN password
+  bool BrakeOnStop;                               // Brake the motor when stopping (true), else let it coast (false)
+  int Cal_OpenTime;                               // Calibrated travel time CLOSED to OPEN (milliseconds. 0 = not calibrated)
+  int Cal_CloseTime;                              // Calibrated travel time OPEN to CLOSED (milliseconds. 0 = not calibrated)
+  int Cal_Current;                                // Calibrated baseline motor current (raw analog reading)
+  homingMode HomingMode;                          // When to home if the position is unknown (none, first command, boot, scheduled)
+  int HomingTime;                                 // Scheduled homing time (minutes after midnight, local time)
+  int ButtonHold;                                 // Button held this long: jog, stop on release (milliseconds. 0 = disabled)
+  int ButtonLong;                                 // Button held this long: latch the full open/close run (milliseconds. 0 = disabled)
+  int ButtonDouble;                               // Max time between the clicks of a double-click (milliseconds. 0 = disabled)
+  int ButtonPreset;                               // Double-click preset position (percentage open. -1 = none)
+};
+
+struct BlindChannel {
+  int Index;                                      // Channel number (0 .. channelCount-1)
+  const ChannelPins* Pin;                         // Pins used by this channel.
+  int pwmChannel_Open;                            // LEDC channel for OPEN (RIGHT) PWM
+  int pwmChannel_Close;                           // LEDC channel for CLOSE (LEFT) PWM
+  char Namespace[8];                              // NVS preferences namespace of the channel configuration
+  ChannelConfig Cfg;                              // Channel configuration settings
+  Button btnOpen;                                 // Button object for "Blinds OPEN"
+  Button btnClose;                                // Button object for "Blinds CLOSE"
+  Switch swcOpen;                                 // LimitSwitch object for "Blinds OPENED"
+  Switch swcClosed;                               // LimitSwitch object for "Blinds CLOSED"
+  Motor mtr;                                      // Motor object
+  BlindsAction mqttAction;                        // MQTT requested action
+  volatile bool actionStopMotor;                  // Stop motor flag. Set by e.g. limit switches, MQTT, button release, ..
+  volatile stopReason actionStopReason;           // What set the stop motor flag (first one wins).
+  volatile bool publishState;                     // Flag for main loop to publish the blinds state
+  volatile bool presetRequest;                    // Flag for main loop to move to the button preset position (double-click)
+  volatile unsigned long lastRotationDebounceTime;  // Timestamp when last axis rotation was triggered.
+  volatile int64_t rotationEdge;                  // Rotation ISR: timestamp of the last (debounced) rotation pulse (us)
+  volatile uint32_t rotationPulses;               // Rotation ISR: pulses counted (only written by the ISR)
+  uint32_t rotationSeen;                          // Pulses processed by the motor task (MotorRotations)
+  bool rampActive;                                // Soft-start in progress
+  int dutyCycle;                                  // Current soft-start PWM duty cycle
+  int dutyMax;                                    // Duty cycle the soft-start ramps up to (255, or less for a synchronised group move)
+  volatile int rampSteps;                         // Soft-start steps due (counted by tmrRamp)
+  WheelTimer tmrRamp;                             // Soft-start step timer (periodic)
+  float learnedSpeed;                             // Learned motor speed at full duty cycle (rotations/second, 0 = not learned yet)
+  int learnPosition;                              // Position at the last rotation seen by the speed learner
+  unsigned long learnTime;                        // Timestamp of that rotation, if it was at full duty cycle (0 = not)
+  MotionPlan plan;                                // Motion planner state of the current move
+  Retarget retarget;                              // Direction reversal of an MQTT move in progress
+  Calibration cal;                                // Travel calibration of the channel
+  Homing homing;                                  // Homing to the reference switch when the position is unknown
+  DeltaTracker cfgDelta;                          // Config fields last published, for the config delta
+  DeltaTracker appCfgDelta;                       // Shared config fields in this channel's last config, or app_config/delta since
+  float estPosition;                              // Time-based position estimate, no rotation sensor (permille of the travel)
+  bool estValid;                                  // The estimate was synced at a limit switch since boot
+  bool estMoved;                                  // The blinds moved since the last sync
+  unsigned long estLastUpdate;                    // Timestamp of the last estimate update (millis)
+  volatile bool brakeRelease;                     // Brake stop: time to disable the driver (set by tmrBrake)
+  WheelTimer tmrBrake;                            // Brake stop: timer to disable the driver after driverBrakeTime
+  unsigned long stopMeasureStart;                 // Stopping distance measurement started (millis. 0 = not measuring)
+  int stopMeasureRotations;                       // Rotation count at the stop
+  bool stopMeasureBrake;                          // The measured stop was a brake stop
+  uint32_t enMask;                                // R_EN/L_EN bits in the GPIO output register (pins 0-31), for the limit switch cut-off
+  uint32_t enMask1;                               // R_EN/L_EN bits in the GPIO output register (pins 32-39)
+  volatile int64_t cutoffTime;                    // Driver cut off by a limit switch interrupt, stop not processed yet (us. 0 = none)
+  WheelTimer tmrOpen;                             // Timer to stop motor after opening for a max duration
+  WheelTimer tmrMaster;                           // Timer to stop motor after running for a max duration
+  WheelTimer tmrGroup;                            // Timer to start a held member of a "sync" group move
+  char topicState[topicLength];                   // MQTT topics of this channel
+  char topicConfig[topicLength];
+  char topicConfigDelta[topicLength];
+  char topicAction[topicLength];
+  char topicAppCmd[topicLength];
 };
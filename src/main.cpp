@@ -6,15 +6,19 @@
  *  Functionality
  *  - when "Up" button pressed/MQTT cmnd received, motor runs clockwise/right.
  *  - when "Down" button pressed/MQTT cmnd received, motor runs anticlockwise/left.
- *  - when "Up/Down" button released/limit switch triggered, motor stops.
- *  - run motor based on MQTT messages received from HA.
+ *  - when "Up/Down" button pressed again/limit switch triggered, motor stops.
+ *  - button gestures: hold to jog (stops on release), long-press to latch a full open/close, double-click to the preset.
+ *  - run motor based on MQTT messages received from HA, or on requests to the local HTTP API (without the broker).
  *  - at regular intervals, get the light level (pins 21, 22) and publish on MQTT.
  *  - update any status change via MQTT (to Home Assistant).
  *  
  *  Concepts
- *  - Interrupts (Butttons on Pins 16 & 17, limit switches on 18, 19)
+ *  - Interrupts (motor rotations, limit switch cut-off), debounced sampling of buttons and limit switches (fixed rate)
+ *  - Timer wheel for the motor deadlines (open and max run timeouts, soft-start steps, brake release), the debounce
+ *    sampling and the motor task supervisor: one 1 kHz esp_timer
  *  - PWM (driving IBT-2 on Pins 25, 26)  
- *  - Multitasking - running a dedicated loop task for motor actions
+ *  - Multitasking - running a dedicated loop task for motor actions (of all channels)
+ *  - Multiple blinds channels (motor, buttons and limit switches per channel)
  *  - Lux sensor (TSL2561)
  *  - Temperature sensor (AM2320)
  *  - Supports OTA updates
@@ -29,21 +33,43 @@
  *  
  * ------------------------------------
  * MQTT Messages
+ * - Each blinds channel has its own base topic (channelPins in configuration.h), e.g. "livingroom/blinds".
+ *   The action, appcmd, state, config and config/delta topics below exist per channel. Channel settings are stored in the
+ *   "app" namespace for channel 0 and in "ch<n>" for the other channels. Other settings are shared.
  * - Subscribed:
  *   - "livingroom/blinds/action"
  *      -> open:<value>                     : open the Blinds to the indicated percentage.
  *      -> close                            : close the Blinds if they are not closed already.
  *      -> stop                             : stop the Blinds if the motor is currently running.
+ *      (open/close while an MQTT move is running retargets it; reversing decelerates first. Latest target wins.)
+ *      (without rotation sensor, open:<value> uses the time-based position estimate once the travel is calibrated.)
+ *      (if the position is unknown and HomingMode is "command", the channel homes first and then executes the command.)
  *   - "livingroom/blinds/appcmd" 
  *      -> restart                          : restart ESP32
+ *      -> update:<url>                     : pull a firmware image over HTTP and update. ".zz" images are zlib compressed.
  *      -> getstate                         : report the current state and telemetry values (RSSI, Memory, ..)
  *      -> getconfig                        : report the current application configuration
+ *      -> getjournal                       : report the motor runs not yet published
+ *      -> getlatency                       : report the MQTT command to motor start latency per stage (p50/p99/max)
+ *      -> getprofile                       : report the loop section and ISR profile (cycles). Needs PROFILE_SECTIONS / PROFILE_ISRS.
+ *      -> resetprofile                     : clear the loop section profile
+ *      -> simhang:<mseconds>               : simulate a motor task hang, to test the watchdog fail-safe. Needs WATCHDOG_TEST.
+ *      -> netload:<seconds>                : flood MQTT, then report the control tick jitter measured under load. Needs JITTER_TEST.
+ *      -> calibrate                        : measure the travel (rotations, time per direction, current) and derive the limits
  *      -> StateInterval:<minutes>          : set the interval between state updates (0 = disabled)
  *      -> LuxInterval:<minutes>            : set the interval between Lux updates (0 = disabled)
  *      -> TempInterval:<minutes>           : set the interval between Temperature updates (0 = disabled)
  *      -> RotationLimits:<true/false>      : set if blinds is considered open/closed on rotations (true) or at limit switches (false) 
- *      -> DebounceDurSwitches:<mseconds>   : set the debounce time for Buttons and Limit switches (milliseconds)
+ *      -> BrakeOnStop:<true/false>         : set if the motor is braked (true) or left to coast (false) when stopped
+ *      -> HomingMode:<mode>                : set when to home if the position is unknown (none, command, boot, scheduled)
+ *      -> HomingTime:<hh:mm>               : set the time of day for scheduled homing (local time)
+ *      -> DebounceDurSwitches:<mseconds>   : set the debounce press time for Buttons and Limit switches (milliseconds)
+ *      -> DebounceDurRelease:<mseconds>    : set the debounce release time for Buttons and Limit switches (milliseconds)
  *      -> DebounceDurMotor:<mseconds>      : set the debounce time for the motor rotation switch (milliseconds)
+ *      -> ButtonHold:<mseconds>            : set the button hold time to jog, stop on release (0 = disabled)
+ *      -> ButtonLong:<mseconds>            : set the button long-press time to latch a full open/close (0 = disabled)
+ *      -> ButtonDouble:<mseconds>          : set the max time between the clicks of a double-click (0 = disabled)
+ *      -> ButtonPreset:<%>                 : set the double-click preset position (percentage open. -1 = none)
  *      -> OpenDuration:<seconds>           : set max duration the motor will run when OPENING the blinds (0 = check and timer disabled)
  *      -> MaxRunDuration:<seconds>         : set max duration the motor may run in ANY direction (0 = check and timer disabled)
  *      -> MaxOpenRotations:<count>         : set max number of axis rotations that blinds can open (0 = disabled)
@@ -52,22 +78,44 @@
  *      -> AllowRemoteControl:<true/false>  : set control Blinds using MQTT (true), else (false)
  *      -> AllowRemoteBleep:<true/false>    : set if Bleep notifications must be processed (true) or ignored (false)
  *      -> WiFiSetup:SSID/password          : set the SSID and password to be used ("default" for defaults)
+ *   - "livingroom/blinds/group"            : move several channels together
+ *      -> open:<ch>=<%>,<ch>=<%>,..        : start all listed channels in the same motor task pass
+ *      -> sync:<ch>=<%>,<ch>=<%>,..        : same, and scale the speed of each channel so they all arrive together
  *   - "all/notify/bleep"                   : if enabled, sound buzzer based on provided value
  * 
  * - Published:
  *   - "livingroom/blinds/state"            : publish current Blinds state                    (open/closed + %)
  *   - "livingroom/blinds/config"           : publish configuration settings                  (JSON settings)
+ *   - "livingroom/blinds/config/delta"     : publish changed configuration settings          (JSON settings)
  *   - "livingroom/blinds/app_state"        : publish telemetry metrics                       (JSON parameters)
+ *   - "livingroom/blinds/app_state/delta"  : publish changed telemetry metrics               (JSON parameters)
+ *   - "livingroom/blinds/app_config/delta" : publish changed shared settings                 (JSON settings)
+ *   - "livingroom/blinds/journal"          : publish motor run journal                       (JSON array of runs)
+ *   - "livingroom/blinds/latency"          : publish command latency per stage, group move skew, limit cut-off and gestures (JSON)
+ *   - "livingroom/blinds/profile"          : publish loop section profile                    (text table)
+ *   - "livingroom/blinds/motion"           : publish planned-versus-actual of a position move (JSON parameters)
+ *   - "livingroom/blinds/calibration"      : publish travel calibration progress and result  (JSON parameters)
+ *   - "livingroom/blinds/homing"           : publish homing result and duration              (JSON parameters)
+ *   - "livingroom/blinds/ota"              : publish OTA update progress and result          (JSON parameters)
  *   - "livingroom/lux/state"               : publish current Lux reading                     (value)
  *   - "livingroom/temperature/state"       : publish current temperate reading               (value)
  *   - "livingroom/humidity/state"          : publish current humidity reading                (value)
  * ------------------------------------
+ * HTTP API (port 80, "?ch=<n>" selects the channel, default 0)
+ *   - GET  /api/position                   : state and position of the channel                (JSON)
+ *   - POST /api/position                   : move to the position in the body                 (percentage open, 0 = close)
+ *   - POST /api/stop                       : stop the channel
+ *   - GET  /api/state                      : telemetry metrics, as app_state                  (JSON)
+ *   - GET  /api/config                     : configuration settings of the channel, as config (JSON)
+ *   - GET  /api/metrics                    : command latency, group skew, cut-off, gestures   (JSON)
+ * ------------------------------------
  *
  *  TODO
  * 
  * 
  ***********************************************************************************************************/ 
 #include <Arduino.h>
+#include <esp_timer.h>
 #include <Preferences.h>
 #include <WiFi.h>
 #include <PubSubClient.h>
@@ -77,150 +125,241 @@
 #include <soc/rtc_cntl_reg.h>     // disable brownout problems
 #include <rom/rtc.h>
 #include <TelnetStream.h>
-#include "OTA.h"
 #include "configuration.h"
+#include "Settings.h"
+#include "OTA.h"
+#include "MotorJournal.h"
+#include "LatencyTrace.h"
+#include "MqttPublish.h"
+#include "JsonDelta.h"
+#include "Profiler.h"
+#include "TaskMonitor.h"
+#include "GroupMove.h"
+#include "Debounce.h"
+#include "Gesture.h"
+#include "TimerWheel.h"
+#include "MotorDriver.h"
+#include "MotorWatchdog.h"
+#include "MotionPlanner.h"
+#include "DeadReckoning.h"
+#include "Calibration.h"
+#include "Homing.h"
+#include "HttpApi.h"
 
-Preferences preferences;
 WiFiClient espClient;
 PubSubClient clientMQTT(espClient);
 AM2320 th(&Wire);
 BH1750 luxSensor;
 
 TaskHandle_t taskLoopMotorActions;     // Task handle for the loop task that will do all the motor handling.
+TaskHandle_t taskMotionControl;        // Task handle for the fixed-rate motion planner control task.
+WheelTimer tmrDebounce;                // Periodic timer sampling the buttons and limit switches.
 SemaphoreHandle_t semBlindsCheck;      // Semaphore for syncing tasks, to prevent reading/writing global variables at the same time.
 
 
 Config appConfig;                                             // Config object for app configuration settings
-Button btnBlindsOpen = {false, 0};                            // Button object for "Blinds OPEN"
-Button btnBlindsClose = {false, 0};                           // Button object for "Blinds CLOSE"
-Switch swcBlindsOpen = {false, 0};                            // LimitSwitch object for "Blinds OPENED"
-Switch swcBlindsClosed = {false, 0};                          // LimitSwitch object for "Blinds CLOSED"
-Motor mtrBlinds = {false, false, -1, -1, actUNDEF, ownUNDEF}; // Motor object
-BlindsAction mqttBlindsAction = {false, actUNDEF};            // MQTT requested action
-volatile bool actionStopMotor = false;                        // Stop motor flag. Set by e.g. limit switches, MQTT, button release, ..
-bool mqttPublishBlindsState = false;                          // Flag for main loop to publish MQTT Open msg
-unsigned long lastRotationDebounceTime = 0;                   // Timestamp when last axis rotation was triggered.
+BlindChannel blindChannels[channelCount];                     // Blinds channel objects (motor, buttons, limit switches, config, ..)
 int DoBleepTimes = 0;                                         // Let loop do bleep, initiated from e.g. interrupts. 
+#ifdef WATCHDOG_TEST
+volatile int simulateHang = 0;                                // Motor task hang to simulate (milliseconds, "simhang").
+#endif
+#ifdef JITTER_TEST
+unsigned long netLoadUntil = 0;                               // End of the "netload" MQTT flood (millis), 0 = not running.
+uint32_t netLoadCount = 0;                                    // Messages published by the running "netload".
+#endif
 
-unsigned int maxCurrent = 0;                                  // TODO: clean up after testing
-
-hw_timer_t * tmrBlindsOpen = NULL;
-hw_timer_t * tmrBlindsMaster = NULL;
 portMUX_TYPE muxTimer = portMUX_INITIALIZER_UNLOCKED;
-portMUX_TYPE muxButton = portMUX_INITIALIZER_UNLOCKED;
-portMUX_TYPE muxLimit = portMUX_INITIALIZER_UNLOCKED;
 
 // Function forward declarations
-void MotorStart();
-void MotorStop();
+void MotorStart(BlindChannel* ch, bool applyPwm = true);
+void MotorApplyPwm(BlindChannel* ch);
+void MotorStop(BlindChannel* ch, stopReason reason = stpUNDEF);
 void loop_MotorActions (void * parameter);
+void serviceChannel(BlindChannel* ch);
+void groupStart();
+void groupRelease();
+void groupHoldCancel(BlindChannel* ch);
+void loop_MotionControl (void * parameter);
+void MotorRamp(BlindChannel* ch);
+void MotorReverse(BlindChannel* ch);
+void MotorCalibrate(BlindChannel* ch);
+void MotorHoming(BlindChannel* ch);
+void MotorButton(BlindChannel* ch, Button* btn, blindsAction direction);
+void MotorRotations(BlindChannel* ch);
+bool motorSelfCheck();
 void Bleep (const String& BleepMsg);
 void MyBleep(int NrBleeps);
 
 /**************************************************************************
-*  Timer Interrupt routine to stop motor after running for a maximum period.
+*  flagMotorStop
+*  - Set the flag to stop the channel motor, and remember what requested the stop.
+*  - If a stop is already pending the original reason is kept.
+*  - Caller is responsible for any locking. Safe to call from interrupts.
+***************************************************************************/
+void IRAM_ATTR flagMotorStop(BlindChannel* ch, stopReason reason) {
+  if (!ch->actionStopMotor || ch->actionStopReason == stpUNDEF) {
+    ch->actionStopReason = reason;
+  }
+  ch->actionStopMotor = true;                    // Set flag to stop the motor. Will be processed in motor loop.
+}
+
+/**************************************************************************
+*  Timer callback to stop motor after running for a maximum period.
 *  - Safety measure to stop motor from running indefinately should something go wrong (e.g. cord breaks)
+*  - Timer wheel callback (one timer per channel, argument is the channel). Flag only: the stop is logged by MotorStop.
 ***************************************************************************/
-void IRAM_ATTR isrTimerBlindsMaster() {
-  Serial.println(" >>> Blinds Master Timer Interrupt: stop motor!");
-  portENTER_CRITICAL_ISR(&muxTimer);
-  actionStopMotor = true;                        // Set flag to stop the motor. Will be processed in motor loop.
-  portEXIT_CRITICAL_ISR(&muxTimer);
+void onTimerBlindsMaster(void* arg) {
+  BlindChannel* ch = (BlindChannel*) arg;
+  portENTER_CRITICAL(&muxTimer);
+  flagMotorStop(ch, stpTimerMaster);             // Set flag to stop the motor. Will be processed in motor loop.
+  portEXIT_CRITICAL(&muxTimer);
 }
 
 /**************************************************************************
-*  Timer Interrupt routine to stop motor after opening blinds for a certain period.
+*  Timer callback to stop motor after opening blinds for a certain period.
 *  - Safety measure in case "fully open" limit switch does not work
+*  - Timer wheel callback (one timer per channel, argument is the channel). Flag only: the stop is logged by MotorStop.
+***************************************************************************/
+void onTimerBlindsOpen(void* arg) {
+  BlindChannel* ch = (BlindChannel*) arg;
+  if (ch->mtr.Action == actBlindsOpen) {
+    portENTER_CRITICAL(&muxTimer);
+    flagMotorStop(ch, stpTimerOpen);               // Set flag to stop the motor. Will be processed in motor loop.
+    portEXIT_CRITICAL(&muxTimer);
+  }
+}
+
+/**************************************************************************
+*  Timer callback to start a held member of a "sync" group move (GroupMove.h), flagged for the motor task.
+*  - Timer wheel callback (one timer per channel, argument is the channel).
+***************************************************************************/
+void onTimerGroupHold(void* arg) {
+  groupHoldExpired(((BlindChannel*) arg)->Index);
+}
+
+/**************************************************************************
+*  Timer ISR to supervise the motor task (every heartbeatCheckInterval, own hardware timer: MotorWatchdog.h).
+*  - If the motor task missed its heartbeat, cut the enable pins of the running channels directly (once per hang),
+*    as the motor task would not process a stop flag. The stop is completed by the motor task if it recovers.
+*  - The pins are cut before muxTimer is taken, so a motor task that hangs holding it does not delay the cut.
 ***************************************************************************/
-void IRAM_ATTR isrTimerBlindsOpen() {
-  Serial.println(" >> BlindsOpen Timer Interrupt: stop motor");
-  if (mtrBlinds.Action == actBlindsOpen) {
-    portENTER_CRITICAL_ISR(&muxTimer);
-    actionStopMotor = true;                        // Set flag to stop the motor. Will be processed in motor loop.
-    portEXIT_CRITICAL_ISR(&muxTimer);
+void IRAM_ATTR isrTimerWatchdog() {
+  if (!watchdogFailSafe(esp_timer_get_time())) return;
+
+  uint32_t cut = 0;
+  for (int i = 0; i < channelCount; i++) {
+    BlindChannel* ch = &blindChannels[i];
+    if (ch->mtr.IsRunning) {
+      driverDisable(ch);
+      cut |= 1UL << i;
+    }
+  }
+  if (cut == 0) return;
+
+  portENTER_CRITICAL_ISR(&muxTimer);
+  for (int i = 0; i < channelCount; i++) {
+    if (cut & (1UL << i)) flagMotorStop(&blindChannels[i], stpWatchdog);
   }
+  watchdogTrips++;
+  watchdogTripped = true;
+  portEXIT_CRITICAL_ISR(&muxTimer);
+}
+
+/**************************************************************************
+*  Timer callback for the next soft-start step (every rampStepDuration while ramping). Counted for MotorRamp.
+*  - Timer wheel callback (one timer per channel, argument is the channel).
+***************************************************************************/
+void onTimerRampStep(void* arg) {
+  portENTER_CRITICAL(&muxWheel);
+  ((BlindChannel*) arg)->rampSteps++;
+  portEXIT_CRITICAL(&muxWheel);
 }
 
 /**************************************************************************
-*  Interrupt routine for "OPEN" button change (triggered on both press and release).
+*  Timer callback to sample the buttons and limit switches of all channels (every debounceSampleInterval).
+*  - Each input has its own integrator debouncer (Debounce.h). The limit switch state is read by the motor task.
+*  - The debounced button edges are handled by the gesture recogniser in the motor task (Gesture.h).
+*  - Timer wheel callback (one periodic timer for all channels).
 ***************************************************************************/
-void IRAM_ATTR isrButtonBlindsOpen() {
-  portENTER_CRITICAL_ISR(&muxButton);
-  if ( (millis() - btnBlindsOpen.lastDebounceTime) > appConfig.DebounceDurSwitches) {
-    // This is the first OPEN button press in some time, process the change. Else ignore.
-    btnBlindsOpen.lastDebounceTime = millis();
-    btnBlindsOpen.Changed = true;
+void onTimerDebounce(void* arg) {
+  int64_t now = esp_timer_get_time();
+
+  for (int i = 0; i < channelCount; i++) {
+    BlindChannel* ch = &blindChannels[i];
+    int press = max(ch->Cfg.DebounceDurSwitches / debounceSampleInterval, 1);
+    int release = max(ch->Cfg.DebounceDurRelease / debounceSampleInterval, 1);
+
+    debounceSample(ch->swcOpen.Input, digitalRead(ch->Pin->StopOpen) == LOW, press, release, dbcLimit, now);
+    debounceSample(ch->swcClosed.Input, digitalRead(ch->Pin->StopClosed) == LOW, press, release, dbcLimit, now);
+    bool openLow = digitalRead(ch->Pin->BtnOpen) == LOW;
+    bool closeLow = digitalRead(ch->Pin->BtnClose) == LOW;
+    portENTER_CRITICAL(&muxGesture);
+    debounceSample(ch->btnOpen.Input, openLow, press, release, dbcButton, now);
+    debounceSample(ch->btnClose.Input, closeLow, press, release, dbcButton, now);
+    portEXIT_CRITICAL(&muxGesture);
   }
-  portEXIT_CRITICAL_ISR(&muxButton);
+}
+
+
+/**************************************************************************
+*  Interrupt routines
+*  - Bounded and lock-free: no logging, no locks or semaphores, no allocation. Only IRAM code and DRAM data.
+*  - Capture what happened (and when), and defer the work to the motor task.
+*  - With PROFILE_ISRS defined, the entry-to-exit cycles of each routine are recorded (getprofile).
+**************************************************************************/
+
+/**************************************************************************
+*  Interrupt routine for the motor driver fault input (active low).
+*  - With MCPWM the outputs are already forced low by hardware. Stop the motor in software as well.
+**************************************************************************/
+void IRAM_ATTR isrDriverFault(void* arg) {
+  PROFILE_ISR(isrFault);
+  BlindChannel* ch = (BlindChannel*) arg;
+  flagMotorStop(ch, stpFault);
 }
 
 /**************************************************************************
-*  Interrupt routine for "CLOSE" button (triggered on both press and release).
+*  Interrupt routines for the limit switches (active low).
+*  - Cut off the driver at once if the switch in the direction of travel closes, without waiting for the
+*    debounced switch state in the motor task. The motor task completes the stop (MotorStop).
+*  - The input level is checked again, so a short spike on the line does not stop the motor.
 **************************************************************************/
-void IRAM_ATTR isrButtonBlindsClose() {
-  portENTER_CRITICAL_ISR(&muxButton);
-  if ( (millis() - btnBlindsClose.lastDebounceTime) > appConfig.DebounceDurSwitches) {
-    // This is the first CLOSE button press in some time, process the change. Else ignore.
-    btnBlindsClose.lastDebounceTime = millis();
-    btnBlindsClose.Changed = true;
+void IRAM_ATTR isrLimitOpen(void* arg) {
+  uint32_t entry = ESP.getCycleCount();
+  PROFILE_ISR(isrLimits);
+  BlindChannel* ch = (BlindChannel*) arg;
+  if (ch->mtr.IsRunning && ch->mtr.Action == actBlindsOpen && driverInputLow(ch->Pin->StopOpen)) {
+    driverCutoff(ch, entry);
+    flagMotorStop(ch, stpLimitOpen);
   }
-  portEXIT_CRITICAL_ISR(&muxButton);
-}  
+}
 
+void IRAM_ATTR isrLimitClosed(void* arg) {
+  uint32_t entry = ESP.getCycleCount();
+  PROFILE_ISR(isrLimits);
+  BlindChannel* ch = (BlindChannel*) arg;
+  if (ch->mtr.IsRunning && ch->mtr.Action == actBlindsClose && driverInputLow(ch->Pin->StopClosed)) {
+    driverCutoff(ch, entry);
+    flagMotorStop(ch, stpLimitClosed);
+  }
+}
 
 /**************************************************************************
  *  Interrupt routine to count the motor axis rotations to determine blinds open position/percentage.
  *  (Interrupt is declared as "falling" i.e. when pulled down)
  *  This routine also works for a Hall sensor, with no need to debounce.
  *  For a wiper motor, the "internal" slip contacts can be used, but they must be debounced (give two triggers within a second).
+ *  - Only debounces and counts the pulse, with its timestamp. The count is processed by MotorRotations (motor task).
  **************************************************************************/
-void IRAM_ATTR isrMotorRotations() {
-
-  if (appConfig.Open_MaxRotations > 0) {
-    // Only care about rotation count if the max rotations is set.
-    if ( (millis() - lastRotationDebounceTime) > appConfig.DebounceDurMotor) {
-      // This is the first motor rotation trigger in some time. Process it, ignore any subsequent triggers for the debounce duration.
-
-      if (mtrBlinds.Action == actBlindsClose) {
-        // Blinds are CLOSING. Decrease rotation count.
-        if (mtrBlinds.currentPosition > 0) {
-          mtrBlinds.currentPosition--;             // Blinds are closing. Decrease count (only down to zero).
-          Serial.print(" >> ISR Motor: Count Rotations (d) - "); Serial.println(mtrBlinds.currentPosition);
-        }
-        if (mtrBlinds.currentPosition == 0 && appConfig.RotationLimits && mtrBlinds.Owner == ownMQTT) {
-          // The rotation count decreased to zero, and the blinds are now considered closed. (Button close can drop below limit)
-          xSemaphoreTake(semBlindsCheck, portMAX_DELAY);
-          mtrBlinds.AllowToRun = false;
-          actionStopMotor = true;
-          xSemaphoreGive(semBlindsCheck);
-        }
-      } else if (mtrBlinds.Action == actBlindsOpen) {
-        // Blinds are OPENING. Increase rotation count.
-        mtrBlinds.currentPosition++;               // Blinds are opening. Increase count.
-        Serial.print(" >> ISR Motor: Count Rotations (u) - "); Serial.println(mtrBlinds.currentPosition);
-
-        if (mtrBlinds.currentPosition >= appConfig.Open_MaxRotations  && appConfig.RotationLimits && mtrBlinds.Owner == ownMQTT) {
-          // Blinds are opened by MQTT. Blinds rotation reached full open position. Stop motor. (Button open can exceed count limit)
-          Serial.print(" >> ISR Motor: Stop motor. MAX Open rotations reached. "); Serial.print(mtrBlinds.currentPosition);
-          xSemaphoreTake(semBlindsCheck, portMAX_DELAY);
-          mtrBlinds.AllowToRun = false;
-          actionStopMotor = true;
-          xSemaphoreGive(semBlindsCheck);
-        }
-      }
-
-      if (mtrBlinds.Owner == ownMQTT && mtrBlinds.targetPosition >= 0) {
-        if ( (mtrBlinds.currentPosition >= mtrBlinds.targetPosition && mtrBlinds.Action == actBlindsOpen) || (mtrBlinds.currentPosition >= 0 && mtrBlinds.currentPosition <= mtrBlinds.targetPosition && mtrBlinds.Action == actBlindsClose) ) {
-          Serial.print(" >> ISR Motor: Stop motor. TARGET Open rotations reached. "); Serial.println(mtrBlinds.currentPosition);
-          // Blinds are opened/closed by MQTT. Blinds reached target position. Stop motor.
-          xSemaphoreTake(semBlindsCheck, portMAX_DELAY);
-          mtrBlinds.AllowToRun = false;
-          actionStopMotor = true;
-          xSemaphoreGive(semBlindsCheck);
-        }
-      }
-      lastRotationDebounceTime = millis();
-    }
+void IRAM_ATTR isrMotorRotations(void* arg) {
+  PROFILE_ISR(isrRotations);
+  BlindChannel* ch = (BlindChannel*) arg;
+  int64_t now = esp_timer_get_time();
+
+  if (now - ch->rotationEdge > ch->Cfg.DebounceDurMotor * 1000LL) {
+    // This is the first motor rotation trigger in some time. Count it, ignore any subsequent triggers for the debounce duration.
+    ch->rotationEdge = now;
+    ch->rotationPulses++;
   }
 }
 
@@ -338,10 +477,25 @@ int RSSItoPrecentage(int valRSSI) {
 }
 
 /**************************************************************************
- * reportState
- * - Feedback the current app state and telemetry values.
+ * blindsStateToJson
+ * - Add the state of the channel (open/closed) and its position (percentage, "-" if not known) to the JSON object.
+ **************************************************************************/
+void blindsStateToJson(JsonObject obj, BlindChannel* ch) {
+  if (ch->swcClosed.Set) { obj["state"] = "closed"; } else { obj["state"] = "open"; }
+  if (ch->Cfg.Open_MaxRotations > 0 ) {
+    obj["percentage"] = round( ( (float)ch->mtr.currentPosition / (float)ch->Cfg.Open_MaxRotations) * 100 );      
+  } else if (deadReckonPosition(ch) >= 0) {
+    obj["percentage"] = round( deadReckonPosition(ch) / 10.0 );          // Time-based estimate (no rotation sensor)
+  } else {
+    obj["percentage"] = "-";
+  }
+}
+
+/**************************************************************************
+ * stateToJson
+ * - Add the current app state and telemetry values to the JSON object (app_state, HTTP /api/state).
  **************************************************************************/
-void reportState() {
+void stateToJson(JsonObject doc) {
   const int LEN = 30;
   char startReason[LEN];
   char UpTime[LEN];
@@ -350,9 +504,9 @@ void reportState() {
   String ipAddress = WiFi.localIP().toString();
 
   getRestartReason(startReason, LEN);
+  taskMonitorCollect();                                           // refresh stack high-water marks and heap statistics
   sprintf(UpTime, "%01.0fd%01.0f:%02.0f:%02.0f", floor(UptimeSeconds/86400.0), floor(fmod((UptimeSeconds/3600.0),24.0)), floor(fmod(UptimeSeconds,3600.0)/60.0), fmod(UptimeSeconds,60.0));
 
-  StaticJsonDocument<640> doc;
   // Set the values in the document
   doc["Version"] = SKETCH_VERSION;                                // software version of this sketch
   doc["IP Address"] = ipAddress;                                  // device IP address
@@ -363,49 +517,275 @@ void reportState() {
   doc["Uptime"] = UpTime;                                         // day.hours:minutes:seconds since last boot
   doc["Start Reason"] = startReason;                              // reason for last restart
   doc["Free Heap Memory"] = esp_get_free_heap_size();
-  //doc["Min Free Heap"] = esp_get_minimum_free_heap_size();  
-
-  char buffer[640];
-  size_t n = serializeJson(doc, buffer);
-  clientMQTT.publish(MQTT_PUB_APPSTATE, buffer);
-  Serial.print("> State: (size="); Serial.print(n); Serial.println(") ");  Serial.println(buffer);
+  doc["Min Free Heap"] = monitorHeap.MinFreeHeap;                 // lowest free heap since boot
+  doc["Largest Free Block"] = monitorHeap.LargestFreeBlock;       // largest heap block that can be allocated
+  doc["Heap Fragmentation (%)"] = monitorHeap.Fragmentation;      // 100 - largest block / free heap
+  taskMonitorToJson( doc.createNestedObject("Task Stacks") );     // per task: [stack size, min free, recommended size] (bytes)
+  journalStopCountsToJson( doc.createNestedObject("Stop Reasons") );  // cumulative motor stops per reason (since boot)
+  latencyToJson( doc.createNestedObject("Cmd Latency (us)"), latReceived );  // MQTT receipt to PWM applied (count, p50, p99, max)
+  driverStopDistanceToJson( doc.createNestedObject("Stop Distance (rot)") );  // per channel: [coast avg, n, brake avg, n]
+  debounceToJson( doc.createNestedObject("Debounce (us)") );                  // reaction time per input type: [n, avg, max]
+  deadReckonToJson( doc.createNestedObject("Estimate Error (‰)") );            // per channel without rotation sensor: [n, last, avg, max]
+  watchdogToJson( doc.createNestedArray("Motor Heartbeat") );                  // motor task: [max gap (ms), fail-safe trips]
+  taskJitterToJson( doc.createNestedArray("Control Jitter (us)"), motionJitter );  // motion control tick: [n, avg, max, late]
+  publishToJson( doc.createNestedArray("Publish (us)") );         // JSON publishes: [n, avg, max, largest payload (bytes)]
 }
 
 /**************************************************************************
- * reportConfig
- * - Feedback the general settings (that is currently in memory).
+ * reportState
+ * - Feedback the current app state and telemetry values.
+ * - Full snapshot if requested (getstate) or due, else only the values that changed on the delta topic.
  **************************************************************************/
-void reportConfig() {
+void reportState(bool full = false) {
 
-  StaticJsonDocument<512> doc;
-  // Set the values in the document
+  StaticJsonDocument<1536> doc;
+  JsonObject obj = doc.to<JsonObject>();
+  stateToJson(obj);
+
+  const char* topic = MQTT_PUB_APPSTATE;
+  if ( full || deltaSnapshotDue(stateDelta) ) {
+    deltaSnapshot(stateDelta, obj);
+  } else {
+    topic = MQTT_PUB_APPSTATE_DELTA;
+    if ( deltaReduce(stateDelta, obj) == 0 ) return;                   // Nothing changed
+  }
+
+  size_t n = publishJson(clientMQTT, topic, doc);
+  if (n == 0) stateDelta.Baseline = false;                            // Not published: next report is a snapshot
+  Serial.print("> State: (topic="); Serial.print(topic); Serial.print(", size="); Serial.print(n); Serial.println(") ");  serializeJson(doc, Serial); Serial.println();
+}
+
+/**************************************************************************
+ * appConfigToJson
+ * - Add the general settings (shared by all channels) to the JSON object.
+ **************************************************************************/
+void appConfigToJson(JsonObject doc) {
   doc["AllowRemoteControl"] = appConfig.AllowRemoteControl;
   doc["AllowRemoteBleep"] = appConfig.AllowRemoteBleep;
   doc["MinLuxReportDelta"] = appConfig.Lux_MinReportDelta;
   doc["LuxInterval"] = appConfig.Lux_Interval;
   doc["TempInterval"] = appConfig.Temp_Interval;
   doc["StateInterval"] = appConfig.State_Interval;
-  doc["DebounceDurSwitches"] = appConfig.DebounceDurSwitches;
-  doc["DebounceDurMotor"] = appConfig.DebounceDurMotor;
-  doc["RotationLimits"] = appConfig.RotationLimits;
-  doc["OpenDuration"] = appConfig.Open_Duration;
-  doc["MaxOpenRotations"] = appConfig.Open_MaxRotations;
-  doc["MaxCurrentLimit"] = appConfig.MaxCurrentLimit;
-  doc["MaxRunDuration"] = appConfig.MaxRunDuration;
   doc["SSID"] = appConfig.SSID;
   //doc["Password"] = appConfig.Password;   // Perhaps better to not show Pwd in surrounding applications
+}
 
-  char buffer[512];
-  size_t n = serializeJson(doc, buffer);
-  if ( clientMQTT.setBufferSize(512) ) {                      // Increase buffer size, config exceeds default 256 bytes 
-    clientMQTT.publish(MQTT_PUB_CONFIG, buffer, true);        // Publish configuration, retain state
-    Serial.print("> Configuration: (size="); Serial.print(n); Serial.println(") ");  Serial.println(buffer);
-  } else {
-    // Failed to use increased MQTT buffer size (default is 256)
-    Bleep("1x1.1.1");
+/**************************************************************************
+ * channelConfigToJson
+ * - Add the channel settings (that is currently in memory) to the JSON object.
+ **************************************************************************/
+void channelConfigToJson(JsonObject doc, BlindChannel* ch) {
+  doc["DebounceDurSwitches"] = ch->Cfg.DebounceDurSwitches;
+  doc["DebounceDurRelease"] = ch->Cfg.DebounceDurRelease;
+  doc["DebounceDurMotor"] = ch->Cfg.DebounceDurMotor;
+  doc["ButtonHold"] = ch->Cfg.ButtonHold;
+  doc["ButtonLong"] = ch->Cfg.ButtonLong;
+  doc["ButtonDouble"] = ch->Cfg.ButtonDouble;
+  doc["ButtonPreset"] = ch->Cfg.ButtonPreset;
+  doc["RotationLimits"] = ch->Cfg.RotationLimits;
+  doc["BrakeOnStop"] = ch->Cfg.BrakeOnStop;
+  doc["HomingMode"] = homingModeName(ch->Cfg.HomingMode);
+  char homingTime[6];
+  snprintf(homingTime, sizeof(homingTime), "%02d:%02d", ch->Cfg.HomingTime / 60, ch->Cfg.HomingTime % 60);
+  doc["HomingTime"] = homingTime;
+  doc["OpenDuration"] = ch->Cfg.Open_Duration;
+  doc["MaxOpenRotations"] = ch->Cfg.Open_MaxRotations;
+  doc["MaxCurrentLimit"] = ch->Cfg.MaxCurrentLimit;
+  doc["MaxRunDuration"] = ch->Cfg.MaxRunDuration;
+}
+
+/**************************************************************************
+ * configToJson
+ * - Add the general settings and the channel settings (that is currently in memory) to the JSON object.
+ **************************************************************************/
+void configToJson(JsonObject doc, BlindChannel* ch) {
+  doc["Channel"] = ch->Index;
+  appConfigToJson(doc);
+  channelConfigToJson(doc, ch);
+}
+
+/**************************************************************************
+ * reportConfig
+ * - Feedback the general settings and the channel settings (that is currently in memory).
+ * - Full snapshot (retained) if requested (getconfig) or due, else only the changed channel settings on the channel
+ *   config/delta. The shared settings are embedded in the snapshot of each channel, and tracked per channel: a
+ *   change goes out once (no channel) on app_config/delta if any channel's snapshot does not have it yet.
+ **************************************************************************/
+void reportConfig(BlindChannel* ch, bool full = false) {
+
+  StaticJsonDocument<768> doc;
+  JsonObject obj = doc.to<JsonObject>();
+  obj["Channel"] = ch->Index;
+  channelConfigToJson(obj, ch);
+
+  size_t n;
+  if ( full || deltaSnapshotDue(ch->cfgDelta) || deltaSnapshotDue(ch->appCfgDelta) ) {
+    deltaSnapshot(ch->cfgDelta, obj);
+    StaticJsonDocument<256> shared;
+    appConfigToJson(shared.to<JsonObject>());
+    deltaSnapshot(ch->appCfgDelta, shared.as<JsonObject>());
+    appConfigToJson(obj);                                           // The full configuration carries the shared settings too
+    n = publishJson(clientMQTT, ch->topicConfig, doc, true);        // Publish configuration, retain state
+    if (n == 0) ch->cfgDelta.Baseline = ch->appCfgDelta.Baseline = false;   // Not published: next report is a snapshot
+    Serial.print("> Configuration: (size="); Serial.print(n); Serial.println(") ");  serializeJson(doc, Serial); Serial.println();
+  } else if ( deltaReduce(ch->cfgDelta, obj, "Channel") > 0 ) {
+    n = publishJson(clientMQTT, ch->topicConfigDelta, doc);
+    if (n == 0) ch->cfgDelta.Baseline = false;                      // Not published: next report is a snapshot
+    Serial.print("> Configuration: (size="); Serial.print(n); Serial.println(") ");  serializeJson(doc, Serial); Serial.println();
+  }
+
+  DeltaTracker* trackers[channelCount];                             // Shared settings: once, without a channel
+  for (int i = 0; i < channelCount; i++) trackers[i] = &blindChannels[i].appCfgDelta;
+  obj = doc.to<JsonObject>();
+  appConfigToJson(obj);
+  if ( deltaReduceAny(trackers, channelCount, obj) > 0 ) {
+    n = publishJson(clientMQTT, MQTT_PUB_APPCONFIG_DELTA, doc);
+    if (n == 0) {
+      for (int i = 0; i < channelCount; i++) trackers[i]->Baseline = false;
+    }
+    Serial.print("> App Configuration: (size="); Serial.print(n); Serial.println(") ");  serializeJson(doc, Serial); Serial.println();
+  }
+}
+
+/**************************************************************************
+ * reportJournal
+ * - Publish the motor runs that were not yet reported, in batches.
+ **************************************************************************/
+void reportJournal() {
+
+  while (journalUnpublished > 0) {
+    StaticJsonDocument<1024> doc;
+    int n = journalToJson(doc.to<JsonArray>(), journalBatchSize);
+    if (n == 0) break;
+
+    size_t len = publishJson(clientMQTT, MQTT_PUB_JOURNAL, doc);
+    Serial.print("> Journal: (runs="); Serial.print(n); Serial.print(", size="); Serial.print(len); Serial.println(") ");
   }
 }
 
+/**************************************************************************
+ * metricsToJson
+ * - Add the command latency per stage, group move skew, limit cut-off and gesture times to the JSON object.
+ **************************************************************************/
+void metricsToJson(JsonObject doc) {
+  latencyStagesToJson(doc);
+  groupToJson(doc.createNestedObject("group"));                   // start and arrival skew of the last group move
+  driverCutoffToJson(doc.createNestedObject("cutoff"));           // limit switch interrupt to enable low, and to stop processed
+  gestureToJson(doc.createNestedObject("gesture"));               // button edge (or threshold) to gesture recognised
+}
+
+/**************************************************************************
+ * reportLatency
+ * - Feedback the MQTT command latency, per stage between receipt and PWM applied.
+ **************************************************************************/
+void reportLatency() {
+
+  StaticJsonDocument<1280> doc;
+  metricsToJson(doc.to<JsonObject>());
+
+  size_t n = publishJson(clientMQTT, MQTT_PUB_LATENCY, doc);
+  Serial.print("> Latency: (size="); Serial.print(n); Serial.println(") ");  serializeJson(doc, Serial); Serial.println();
+}
+
+/**************************************************************************
+ * reportProfile
+ * - Feedback the loop section profile as a compact table.
+ **************************************************************************/
+void reportProfile() {
+
+  char buffer[960];
+  size_t n = profileToText(buffer, sizeof(buffer));
+  n += snprintf(buffer + n, sizeof(buffer) - n, "\n");
+  n += profileIsrToText(buffer + n, sizeof(buffer) - n);
+  clientMQTT.publish(MQTT_PUB_PROFILE, buffer);
+  Serial.print("> Profile: (size="); Serial.print(n); Serial.println(") ");  Serial.println(buffer);
+#ifdef TELNET_DEBUG
+  TelnetStream.println(buffer);
+#endif
+}
+
+/**************************************************************************
+ * reportMotion
+ * - Feedback the planned-versus-actual summary of the last planned move of the channel.
+ **************************************************************************/
+void reportMotion(BlindChannel* ch) {
+
+  StaticJsonDocument<768> doc;
+  planToJson(doc.to<JsonObject>(), ch);
+
+  size_t n = publishJson(clientMQTT, MQTT_PUB_MOTION, doc);
+  Serial.print("> Motion: (size="); Serial.print(n); Serial.println(") ");  serializeJson(doc, Serial); Serial.println();
+}
+
+/**************************************************************************
+ * reportCalibration
+ * - Feedback the travel calibration progress of the channel, and the result when done.
+ **************************************************************************/
+void reportCalibration(BlindChannel* ch) {
+
+  StaticJsonDocument<384> doc;
+  calibrationToJson(doc.to<JsonObject>(), ch);
+
+  size_t n = publishJson(clientMQTT, MQTT_PUB_CALIBRATION, doc);
+  Serial.print("> Calibration: (size="); Serial.print(n); Serial.println(") ");  serializeJson(doc, Serial); Serial.println();
+}
+
+/**************************************************************************
+ * reportHoming
+ * - Feedback the result and duration of the last homing of the channel.
+ **************************************************************************/
+void reportHoming(BlindChannel* ch) {
+
+  StaticJsonDocument<192> doc;
+  homingToJson(doc.to<JsonObject>(), ch);
+
+  size_t n = publishJson(clientMQTT, MQTT_PUB_HOMING, doc);
+  Serial.print("> Homing: (size="); Serial.print(n); Serial.println(") ");  serializeJson(doc, Serial); Serial.println();
+}
+
+/**************************************************************************
+ * reportOta
+ * - Feedback the progress or result of the OTA update.
+ **************************************************************************/
+void reportOta() {
+
+  StaticJsonDocument<192> doc;
+  otaToJson(doc.to<JsonObject>());
+
+  size_t n = publishJson(clientMQTT, MQTT_PUB_OTA, doc);
+  Serial.print("> OTA: (size="); Serial.print(n); Serial.println(") ");  serializeJson(doc, Serial); Serial.println();
+}
+
+/**************************************************************************
+ * loadChannelConfig
+ * - Get the channel settings on initialisation, from the channel namespace.
+ **************************************************************************/
+void loadChannelConfig(BlindChannel* ch) {
+
+  preferences.begin(ch->Namespace, true);    // opens channel namespace in read-only mode
+
+  ch->Cfg.DebounceDurSwitches = preferences.getInt("DebounceButton", 20);         // Debounce press time for buttons and limit switches.
+  ch->Cfg.DebounceDurRelease = preferences.getInt("DebounceRelease", 50);         // Debounce release time for buttons and limit switches.
+  ch->Cfg.DebounceDurMotor = preferences.getInt("DebounceRotate", 500);           // Debounce time for motor rotation count switch.
+  ch->Cfg.RotationLimits = preferences.getBool("RotationLimits", true);           // Blinds considered open/closed based on rotation count. Else closed at limit switch.
+  ch->Cfg.Open_Duration = preferences.getInt("OpenDuration", 20);                 // How long the motor is allowed to run when opening the blinds (seconds. 0 = disabled).
+  ch->Cfg.Open_MaxRotations = preferences.getInt("MaxOpenRotate", 20);            // How many rotations the motor can make before blinds are fully open (0 = disabled).
+  ch->Cfg.MaxCurrentLimit = preferences.getInt("MaxCurrentLmt", 0);               // Max load current before motor is stopped (raw analog reading. 0 = disabled).
+  ch->Cfg.MaxRunDuration = preferences.getInt("MaxRunDuration", 60);              // Max time motor can run in any direction (seconds).
+  ch->Cfg.BrakeOnStop = preferences.getBool("BrakeOnStop", false);                // Brake the motor when stopping. Else let it coast.
+  ch->Cfg.Cal_OpenTime = preferences.getInt("CalOpenTime", 0);                    // Calibrated travel time to open (milliseconds. 0 = not calibrated).
+  ch->Cfg.Cal_CloseTime = preferences.getInt("CalCloseTime", 0);                  // Calibrated travel time to close (milliseconds. 0 = not calibrated).
+  ch->Cfg.Cal_Current = preferences.getInt("CalCurrent", 0);                      // Calibrated baseline motor current (raw analog reading).
+  ch->Cfg.HomingMode = (homingMode) preferences.getInt("HomingMode", homNone);    // When to home if the position is unknown.
+  ch->Cfg.HomingTime = preferences.getInt("HomingTime", 180);                     // Scheduled homing time (minutes after midnight. 03:00).
+  ch->Cfg.ButtonHold = preferences.getInt("ButtonHold", 600);                     // Button hold time to jog (milliseconds. 0 = disabled).
+  ch->Cfg.ButtonLong = preferences.getInt("ButtonLong", 3000);                    // Button long-press time to latch the run (milliseconds. 0 = disabled).
+  ch->Cfg.ButtonDouble = preferences.getInt("ButtonDouble", 400);                 // Max time between double-click clicks (milliseconds. 0 = disabled).
+  ch->Cfg.ButtonPreset = preferences.getInt("ButtonPreset", -1);                  // Double-click preset position (percentage open. -1 = none).
+
+  preferences.end();
+}
+
 /**************************************************************************
  * loadConfig
  * - Get the settings on initialisation.
@@ -420,26 +800,15 @@ void loadConfig() {
   appConfig.Lux_MinReportDelta = preferences.getInt("LuxMinDelta", 10);             // Minimum change since previous report.
   appConfig.Temp_Interval = preferences.getInt("TempInterval", 0);                  // Interval between Temperature reporting (minutes. 0 = disabled). 
   appConfig.State_Interval = preferences.getInt("StateInterval", 10);               // Interval between state values reporting (minutes. 0 = disabled).
-  appConfig.DebounceDurSwitches = preferences.getInt("DebounceButton", 150);        // Debounce time for buttons and limit switches.
-  appConfig.DebounceDurMotor = preferences.getInt("DebounceRotate", 500);           // Debounce time for motor rotation count switch.
-  appConfig.RotationLimits = preferences.getBool("RotationLimits", true);           // Blinds considered open/closed based on rotation count. Else closed at limit switch.
-  appConfig.Open_Duration = preferences.getInt("OpenDuration", 20);                 // How long the motor is allowed to run when opening the blinds (seconds. 0 = disabled).
-  appConfig.Open_MaxRotations = preferences.getInt("MaxOpenRotate", 20);            // How many rotations the motor can make before blinds are fully open (0 = disabled).
-  appConfig.MaxCurrentLimit = preferences.getInt("MaxCurrentLmt", 0);               // Max load current before motor is stopped (raw analog reading. 0 = disabled).
-  appConfig.MaxRunDuration = preferences.getInt("MaxRunDuration", 60);              // Max time motor can run in any direction (seconds).
 
   String ssid = preferences.getString("SSID", default_ssid); 
   String password = preferences.getString("Password", default_password);
 
-  appConfig.SSID = (char*) malloc(strlen(ssid.c_str() )+1);
-  if (appConfig.SSID != NULL) {
-    strcpy( appConfig.SSID, ssid.c_str() );
-    appConfig.SSID[strlen(ssid.c_str())+1] = '\0';
+  if ( !setCredential(appConfig.SSID, sizeof(appConfig.SSID), ssid.c_str(), ssid.length()) ) {
+    setCredential(appConfig.SSID, sizeof(appConfig.SSID), default_ssid, strlen(default_ssid));
   }
-  appConfig.Password = (char*) malloc(strlen(password.c_str())+1);
-  if (appConfig.Password != NULL) {
-    strcpy( appConfig.Password, password.c_str() );
-    appConfig.SSID[strlen(password.c_str())+1] = '\0';
+  if ( !setCredential(appConfig.Password, sizeof(appConfig.Password), password.c_str(), password.length()) ) {
+    setCredential(appConfig.Password, sizeof(appConfig.Password), default_password, strlen(default_password));
   }
   #ifdef TELNET_DEBUG
     TelnetStream.println("LoadConfig done");
@@ -450,115 +819,134 @@ void loadConfig() {
 }
 
 /**************************************************************************
- * updatePreferences
- * - Update/set the provided setting in NVM.
+ * saveCalibration
+ * - Apply the settings derived from a completed calibration to the channel, and store them in its namespace.
  **************************************************************************/
-void updatePreferences(const char* confKey, const char* newValue, const char* confType ) {
-
-  preferences.begin("app", false);    // opens "app" namespace preferences in read-write mode
-  
-  // Set a INTEGER setting
-  if ( strcmp(confType, "int") == 0) {
-    char* p;
-    int   iValue = 0;
-    iValue = strtol(newValue, &p, 10);  
-    if (iValue >= 0) {                        // only support positive nr's. also:   if (*p == 0) {
-      Serial.printf("- updatePreferences: int=%d\n", iValue);
-      preferences.putInt(confKey,  iValue);
-      #ifdef TELNET_DEBUG
-        TelnetStream.printf("UpdatePreferences: Key=%s, Value=%d\n", confKey, iValue);
-      #endif
-    } else {
-      Serial.printf("- updatePreferences: NOT VALID int [%s]\n", newValue);
-    }
-  }
-  // Set a FLOAT setting
-  else if ( strcmp(confType, "float") == 0) {
-    char* p;
-    float   iValue = 0.0;
-    iValue = strtof(newValue, &p);
-    if (iValue >= 0) {                        // only support positive nr's. also:   if (*p == 0) {
-      Serial.printf("- updatePreferences: float=%f\n", iValue);
-      preferences.putFloat(confKey,  iValue);
-      #ifdef TELNET_DEBUG
-        TelnetStream.printf("UpdatePreferences: Key=%s, Value=%f\n", confKey, iValue);
-      #endif
-    } else {
-      Serial.printf("- updatePreferences: NOT VALID long [%s]\n", newValue);
-    }
-  } 
-  // Set a STRING setting
-  else if (strcmp(confType, "string") == 0) {
-    Serial.println("- updatePreferences: char");
-    preferences.putString(confKey, newValue); 
-    #ifdef TELNET_DEBUG
-      TelnetStream.printf("UpdatePreferences: Key=%s, Value=%s\n", confKey, newValue);
-    #endif
-  } 
-  else if (strcmp(confType, "bool") == 0) {
-    Serial.printf("- updatePreferences: bool [%s]\n", newValue);
-    preferences.putBool(confKey, strcasecmp(newValue, "true") == 0 || strcmp(newValue, "1") == 0 ); 
-    #ifdef TELNET_DEBUG
-      TelnetStream.printf("UpdatePreferences: Key=%s, Value=%s\n", confKey, newValue);
-    #endif
-  } else {
-    Serial.printf("- updatePreferences: type unknown [%s]\n", confType);
-  }
-  preferences.end();                  // closes the namespace
+void saveCalibration(BlindChannel* ch) {
+
+  calibrationDerive(ch->cal, &ch->Cfg);
+
+  preferences.begin(ch->Namespace, false);    // opens channel namespace in read-write mode
+  preferences.putInt("MaxOpenRotate", ch->Cfg.Open_MaxRotations);
+  preferences.putInt("OpenDuration", ch->Cfg.Open_Duration);
+  preferences.putInt("MaxRunDuration", ch->Cfg.MaxRunDuration);
+  preferences.putInt("MaxCurrentLmt", ch->Cfg.MaxCurrentLimit);
+  preferences.putInt("CalOpenTime", ch->Cfg.Cal_OpenTime);
+  preferences.putInt("CalCloseTime", ch->Cfg.Cal_CloseTime);
+  preferences.putInt("CalCurrent", ch->Cfg.Cal_Current);
+  preferences.end();
+  #ifdef TELNET_DEBUG
+    TelnetStream.printf("Calibration ch%d stored: rot=%d, open=%ds, run=%ds, iMax=%d\n", ch->Index,
+                        ch->Cfg.Open_MaxRotations, ch->Cfg.Open_Duration, ch->Cfg.MaxRunDuration, ch->Cfg.MaxCurrentLimit);
+  #endif
 }
 
 /**************************************************************************
  *  remoteBlindsAction
- *  - Process the received MQTT Blinds action
+ *  - Process the received MQTT Blinds action for the channel
+ *  - If "group" is set, the action is left for the motor task to start together with the other group members.
  **************************************************************************/
-void remoteBlindsAction(String msgAction) {
+void remoteBlindsAction(BlindChannel* ch, String msgAction, bool group = false) {
 
   //  "LIVINGROOM/BLINDS/ACTION" 
   //    -> open                         : open the Blinds fully (if currently closed).
   //    -> open:<%>                     : open the Blinds to certain percentage.
   //    -> close                        : close the Blinds if they are not closed already.
   //    -> stop                         : stop the Blinds if the motor is currently running.
+  //    (open and close are ignored while the channel is calibrating, stop aborts the calibration)
+  //    (all actions are ignored during an OTA update, the motors are stopped by the update)
   //
   if (msgAction.length() > 0) {
+    // OTA UPDATE: motor control locked.
+    if (otaStatus.Locked) {
+      Serial.println(" - Not moving: OTA update in progress");
+      TelnetStream.println(" - Not moving: OTA update in progress");
+    }
+
+    // CALIBRATING: only "STOP" is processed.
+    else if (msgAction != "stop" && calibrationActive(ch)) {
+      Serial.println(" - Not moving: calibration in progress");
+      TelnetStream.println(" - Not moving: calibration in progress");
+      Bleep("1x1.1");
+    }
+
+    // ACTION:  "OPEN" (no rotation sensor, time-based position estimate)
+    else if (msgAction.substring(0,4) == "open" && deadReckonCalibrated(ch)) {
+      int target = 1000;
+      int valSplit = msgAction.indexOf(":"); 
+      if (valSplit > 0 && valSplit < msgAction.length() ) {
+        target = constrain( round(msgAction.substring(valSplit+1).toFloat() * 10), 0, 1000 );    // permille of the travel
+      }
+      int position = deadReckonPosition(ch);
+      if (position < 0 && target < 1000 && homingQueue(ch, actBlindsOpen, target)) {
+        Serial.println(" - Position unknown: homing first, then opening");
+      } else if (position < 0 && target < 1000) {
+        Serial.println(" - Not opening: estimated position unknown");
+        TelnetStream.println(" - Not opening: estimated position unknown");
+        Bleep("1x1.1");
+      } else if (position >= 0 && abs(target - position) < 10 && !ch->mtr.IsRunning) {
+        Serial.println(" - Not opening: current and target positions the same");
+        TelnetStream.println(" - Not opening: current and target positions the same");
+        Bleep("1x1.1");
+      } else if (target > position && ch->swcOpen.Set) {
+        Serial.println(" - Not opening: Blinds already fully opened (limit set)");
+        TelnetStream.println(" - Not opening: Blinds already fully opened (limit set)");
+        Bleep("1x1.1");
+      } else {
+        Serial.printf(" - Moving blinds to estimated position: %d/1000\n", target);
+        ch->mqttAction.Action = (target > position) ? actBlindsOpen : actBlindsClose;
+        ch->mqttAction.Target = target;
+        latencyMark(latQueued);
+        ch->mqttAction.Group = group;
+        ch->mqttAction.NewAction = true;
+      }
+    }
+
     // ACTION:  "OPEN"
-    if (msgAction.substring(0,4) == "open" ) {
+    else if (msgAction.substring(0,4) == "open" ) {
       bool okToProceed = true;
+      bool queued = false;                                      // Queued until homed (position unknown).
       // Get the target blinds position (if provided).
-      mtrBlinds.targetPosition = -1;
-      if (msgAction.indexOf(":") > 0 && appConfig.Open_MaxRotations > 0) {
+      int target = -1;
+      if (msgAction.indexOf(":") > 0 && ch->Cfg.Open_MaxRotations > 0) {
         // A target percentage is provided. Determine the rotations based on the max rotations defined to open the blinds.
         int valSplit = msgAction.indexOf(":"); 
         if (valSplit > 0 && valSplit < msgAction.length() ) {
-          mtrBlinds.targetPosition = round( (msgAction.substring(valSplit+1).toFloat() / 100) * (float)appConfig.Open_MaxRotations );
+          target = round( (msgAction.substring(valSplit+1).toFloat() / 100) * (float)ch->Cfg.Open_MaxRotations );
         }
       } else {
-        mtrBlinds.targetPosition = appConfig.Open_MaxRotations;
+        target = ch->Cfg.Open_MaxRotations;
       }  
       // Do some validations.
-      if (appConfig.Open_MaxRotations > 0) {
+      if (ch->Cfg.Open_MaxRotations > 0) {
         // The max open position (nr of axis rotations) is defined. Do additional checks.
-        if (!swcBlindsClosed.Set && mtrBlinds.currentPosition < 0 && mtrBlinds.targetPosition > 0) {
+        if (!ch->swcClosed.Set && ch->mtr.currentPosition < 0 && target > 0) {
           // Blinds are open, but current position is unknown (e.g. after restart when blinds are open = -1). Must full close to sync position again.
           okToProceed = false;
-          Serial.println(" - Not opening: current position unknown");
-          TelnetStream.println(" - Not opening: current position unknown");
-        } else if (!swcBlindsClosed.Set && appConfig.Open_MaxRotations == 0 && appConfig.Open_Duration > 0) {
+          if (homingQueue(ch, actBlindsOpen, target)) {
+            queued = true;
+            Serial.println(" - Position unknown: homing first, then opening");
+          } else {
+            Serial.println(" - Not opening: current position unknown");
+            TelnetStream.println(" - Not opening: current position unknown");
+          }
+        } else if (!ch->swcClosed.Set && ch->Cfg.Open_MaxRotations == 0 && ch->Cfg.Open_Duration > 0) {
           // Blinds are open, no full open position defined, and open timer is defined. 
           // Unknown current position, so timer has no meaning. Ignore the OPEN command (safety feature).
           okToProceed = false;
           Serial.println(" - Not opening: Blinds already open and only using timer ");
           TelnetStream.println(" - Not opening: Blinds already open and only using timer ");
-        } else if (mtrBlinds.targetPosition < 0 || mtrBlinds.targetPosition > appConfig.Open_MaxRotations ) {
+        } else if (target < 0 || target > ch->Cfg.Open_MaxRotations ) {
           // Blinds already at or past max open position. Ignore the OPEN command (safety feature).
           okToProceed = false;
-          Serial.printf(" - Not opening: invalid target below 0 or beyond max open position (%d)\n", mtrBlinds.targetPosition);
+          Serial.printf(" - Not opening: invalid target below 0 or beyond max open position (%d)\n", target);
           TelnetStream.println(" - Not opening: invalid target below 0 or beyond max open position\n");
-        } else if (mtrBlinds.targetPosition == mtrBlinds.currentPosition) {
+        } else if (target == ch->mtr.currentPosition && !ch->mtr.IsRunning) {
           // Target and current positions the same. Ignore OPEN command.
           okToProceed = false;
           Serial.println(" - Not opening: current and target positions the same");
           TelnetStream.println(" - Not opening: current and target positions the same");
-        } else if (mtrBlinds.targetPosition > mtrBlinds.currentPosition && swcBlindsOpen.Set ) {
+        } else if (target > ch->mtr.currentPosition && ch->swcOpen.Set ) {
           // Blinds already fully open. Ignore the OPEN command (safety feature).
           okToProceed = false;
           Serial.println(" - Not opening: Blinds already fully opened (limit)");
@@ -566,56 +954,64 @@ void remoteBlindsAction(String msgAction) {
         }
       }
       if (okToProceed) {
-        if (appConfig.Open_MaxRotations > 0 && mtrBlinds.targetPosition >= 0) {
+        if (ch->Cfg.Open_MaxRotations > 0 && target >= 0) {
           // The number of full open rotations is defined, and a target position is provided.
           // Rotation is based on current position, if blinds must be opened or closed to reach target.
-          if (mtrBlinds.targetPosition > mtrBlinds.currentPosition) {
-            Serial.print(" - Opening blinds to position: "); Serial.println(mtrBlinds.targetPosition);
-            mqttBlindsAction.Action = actBlindsOpen;
+          if (target > ch->mtr.currentPosition) {
+            Serial.print(" - Opening blinds to position: "); Serial.println(target);
+            ch->mqttAction.Action = actBlindsOpen;
           } else {
-            Serial.print(" - Closing blinds to position: "); Serial.println(mtrBlinds.targetPosition);
-            mqttBlindsAction.Action = actBlindsClose;
+            Serial.print(" - Closing blinds to position: "); Serial.println(target);
+            ch->mqttAction.Action = actBlindsClose;
           }
-          mqttBlindsAction.NewAction = true;
+          ch->mqttAction.Target = target;
+          latencyMark(latQueued);
+          ch->mqttAction.Group = group;
+          ch->mqttAction.NewAction = true;
         } else {
           // No target position provided, or no full open position defined. Just fully open blinds (if not already fully open).
-          if (!swcBlindsOpen.Set ) {
-            mtrBlinds.targetPosition = 0;
-            mqttBlindsAction.Action = actBlindsOpen;
-            mqttBlindsAction.NewAction = true;
+          if (!ch->swcOpen.Set ) {
+            ch->mqttAction.Target = 0;
+            ch->mqttAction.Action = actBlindsOpen;
+            latencyMark(latQueued);
+            ch->mqttAction.Group = group;
+            ch->mqttAction.NewAction = true;
           } else {
             // Can't open blinds further if open limit switch is already set.
-            Serial.print(" - Not opening: Blinds already fully opened (limit set)"); Serial.println(mtrBlinds.targetPosition);
+            Serial.print(" - Not opening: Blinds already fully opened (limit set)"); Serial.println(target);
             TelnetStream.println(" - Not opening: Blinds already fully opened (limit set)"); 
             Bleep("1x1.1");
           }
         }
-      } else {
+      } else if (!queued) {
         Bleep("1x1.1");
       }
     }
 
     // ACTION:  "CLOSE"
     else if (msgAction == "close") {
-      if ( swcBlindsClosed.Set || (appConfig.RotationLimits && mtrBlinds.currentPosition == 0) ) {
+      if ( ch->swcClosed.Set || (ch->Cfg.RotationLimits && ch->mtr.currentPosition == 0) ) {
         Serial.println(" - Not closing, Blinds already closed");
         TelnetStream.println(" - Not closing, Blinds already closed");
         Bleep("1x1.1");                                               // raise audible error.
       } else {
-        mtrBlinds.targetPosition = 0;
-        mqttBlindsAction.Action = actBlindsClose;
-        mqttBlindsAction.NewAction = true;
+        ch->mqttAction.Target = 0;
+        ch->mqttAction.Action = actBlindsClose;
+        latencyMark(latQueued);
+        ch->mqttAction.Group = false;
+        ch->mqttAction.NewAction = true;
       }
     }
 
     // ACTION:  "STOP"
     else if (msgAction == "stop") {
-      mtrBlinds.AllowToRun = false;
-      mtrBlinds.Action = actBlindsStop;
-      mtrBlinds.Owner = ownMQTT;
-      mtrBlinds.targetPosition = 0;
+      if (calibrationActive(ch)) ch->cal.Abort = true;             // Also end the calibration (not just the current run).
+      ch->mtr.AllowToRun = false;
+      ch->mtr.Action = actBlindsStop;
+      ch->mtr.Owner = ownMQTT;
+      ch->mtr.targetPosition = 0;
       xSemaphoreTake(semBlindsCheck, portMAX_DELAY);
-        actionStopMotor = true;
+        flagMotorStop(ch, stpMQTT);
       xSemaphoreGive(semBlindsCheck);
     }
 
@@ -627,22 +1023,86 @@ void remoteBlindsAction(String msgAction) {
   }
 }
 
+/**************************************************************************
+ *  remoteGroupAction
+ *  - Process the received MQTT group move: open several channels to their target, started together.
+ *  - Channels that are running, not a valid channel number (settingInt), or with an invalid target, are left out
+ *    of the group.
+ **************************************************************************/
+void remoteGroupAction(String msgAction) {
+
+  //  "LIVINGROOM/BLINDS/GROUP" 
+  //    -> open:<ch>=<%>,<ch>=<%>,..    : open the channels to the percentages, started in the same motor task pass.
+  //    -> sync:<ch>=<%>,<ch>=<%>,..    : same, with the speed scaled per channel so all arrive together.
+  //
+  bool sync = (msgAction.substring(0,5) == "sync:");
+  if ( !sync && msgAction.substring(0,5) != "open:" ) {
+    Serial.printf(" >>> UNKNOWN group action (%s)\n", msgAction.c_str() ); 
+    Bleep("1x1.1.1");                                               // raise audible error.
+    return;
+  }
+  if ( groupMoveActive() ) {
+    Serial.println(" - Group move ignored: previous group move still in progress");
+    Bleep("1x1.1");
+    return;
+  }
+
+  uint8_t members = 0;
+  int pos = 5;
+  while (pos > 0 && pos < msgAction.length()) {
+    int next = msgAction.indexOf(',', pos);
+    String member = (next < 0) ? msgAction.substring(pos) : msgAction.substring(pos, next);
+    int valSplit = member.indexOf('=');
+    int index;
+    if (valSplit > 0 && settingInt(member.substring(0, valSplit).c_str(), 0, channelCount - 1, &index) &&
+        !blindChannels[index].mtr.IsRunning) {
+      BlindChannel* ch = &blindChannels[index];
+      remoteBlindsAction(ch, "open:" + member.substring(valSplit+1), true);
+      if (ch->mqttAction.NewAction && ch->mqttAction.Group) members |= (1 << index);
+    } else {
+      Serial.printf(" - Group: channel ignored (%s)\n", member.c_str());
+    }
+    pos = (next < 0) ? -1 : next + 1;
+  }
+
+  if (members != 0) {
+    groupBegin(members, sync);
+  }
+}
+
 /**************************************************************************
  *  remoteAppAction
  *  - Process the received MQTT application-related action
+ *  - Channel settings are applied to the channel on which topic the action was received.
  **************************************************************************/
-void remoteAppAction(String msgAction) {
+void remoteAppAction(BlindChannel* ch, String msgAction) {
 
   // LIVINGROOM/BLINDS/APPCMD 
   //    -> restart                          : restart ESP32
+  //    -> update:<url>                     : pull a firmware image over HTTP and update. ".zz" images are zlib compressed.
   //    -> getstate                         : report the current state and telemetry values (RSSI, Memory, ..)
   //    -> getconfig                        : report the current application configuration
+  //    -> getjournal                       : report the motor runs not yet published
+  //    -> getlatency                       : report the MQTT command to motor start latency per stage (p50/p99/max)
+  //    -> getprofile                       : report the loop section profile (cycles: n/min/avg/max), and the ISR profile
+  //    -> resetprofile                     : clear the loop section profile
+  //    -> simhang:<mseconds>               : simulate a motor task hang, to test the watchdog fail-safe. Needs WATCHDOG_TEST.
+  //    -> netload:<seconds>                : flood MQTT, then report the control tick jitter measured under load. Needs JITTER_TEST.
+  //    -> calibrate                        : measure the travel (rotations, time per direction, current) and derive the limits
   //    -> StateInterval:<minutes>          : set the interval between state updates (0 = disabled)
   //    -> LuxInterval:<minutes>            : set the interval between Lux updates (0 = disabled)
   //    -> TempInterval:<minutes>           : set the interval between Temperature updates (0 = disabled)
   //    -> RotationLimits:<true/false>      : set if blinds is considered open/closed based on rotations (true) or at limit switch (false) 
-  //    -> DebounceDurSwitches:<mseconds>   : set the debounce time for Buttons and Limit switches (milliseconds)
+  //    -> BrakeOnStop:<true/false>         : set if the motor is braked (true) or left to coast (false) when stopped
+  //    -> HomingMode:<mode>                : set when to home if the position is unknown (none, command, boot, scheduled)
+  //    -> HomingTime:<hh:mm>               : set the time of day for scheduled homing (local time)
+  //    -> DebounceDurSwitches:<mseconds>   : set the debounce press time for Buttons and Limit switches (milliseconds)
+  //    -> DebounceDurRelease:<mseconds>    : set the debounce release time for Buttons and Limit switches (milliseconds)
   //    -> DebounceDurMotor:<mseconds>      : set the debounce time for the motor rotation switch (milliseconds)
+  //    -> ButtonHold:<mseconds>            : set the button hold time to jog, stop on release (0 = disabled)
+  //    -> ButtonLong:<mseconds>            : set the button long-press time to latch a full open/close (0 = disabled)
+  //    -> ButtonDouble:<mseconds>          : set the max time between the clicks of a double-click (0 = disabled)
+  //    -> ButtonPreset:<%>                 : set the double-click preset position (percentage open. -1 = none)
   //    -> OpenDuration:<seconds>           : set max duration the motor will run when OPENING the blinds (0 = check and timer disabled)
   //    -> MaxRunDuration:<seconds>         : set max duration the motor may run in ANY direction (0 = check and timer disabled)
   //    -> MaxOpenRotations:<count>         : set max number of axis rotations that blinds can open (0 = disabled)
@@ -663,27 +1123,101 @@ void remoteAppAction(String msgAction) {
       esp_restart();                                                      // RESTART ESP32 !!!!!
     }
     //
+    // ::   update:<url>  ->>  pull a firmware image over HTTP and update (".zz" = compressed, see tools/ota_image.py)
+    else if (msgAction.substring(0,6) == "update") {
+      Serial.println("\t- MQTT request Firmware Update");
+      int valSplit = msgAction.indexOf(":"); 
+      String url = msgAction.substring(valSplit+1);
+      if (otaStatus.Locked || otaStatus.PullRequest) {
+        Serial.println(" - Not updating: update in progress");
+      } else if (valSplit>0 && url.length() > 0 && url.length() < otaUrlLength) {
+        strcpy(otaStatus.PullUrl, url.c_str());
+        otaStatus.PullRequest = true;                                     // Pulled by the OTA task.
+      }
+    }
+    //
     // ::   getstate  ->>  report the current state and telemetry values (RSSI, Memory, ..)
     else if (msgAction == "getstate") {
       Serial.println("\t- MQTT request State and Telemetry values");
-      reportState();                                                      // Feedback current telemetry values (once)
+      reportState(true);                                                  // Feedback current telemetry values (once, full snapshot)
     }
     //
     // ::   getconfig  ->>  report the current application configuration
     else if (msgAction == "getconfig") {
       Serial.println("\t- MQTT request Configuration values");
-      reportConfig();                                                     // Feedback current configuration (once)
+      reportConfig(ch, true);                                               // Feedback current configuration (once, full snapshot)
+    }
+    //
+    // ::   getjournal  ->>  report the motor runs not yet published
+    else if (msgAction == "getjournal") {
+      Serial.println("\t- MQTT request Motor Journal");
+      reportJournal();                                                    // Feedback unpublished motor runs (once)
+    }
+    //
+    // ::   getlatency  ->>  report the MQTT command to motor start latency per stage
+    else if (msgAction == "getlatency") {
+      Serial.println("\t- MQTT request Command Latency");
+      reportLatency();                                                    // Feedback latency histograms (once)
+    }
+    //
+    // ::   getprofile  ->>  report the loop section profile
+    else if (msgAction == "getprofile") {
+      Serial.println("\t- MQTT request Loop Profile");
+      reportProfile();                                                    // Feedback section profile table (once)
+    }
+    //
+    // ::   calibrate  ->>  measure the travel of the channel, and derive the limits from it
+    else if (msgAction == "calibrate") {
+      Serial.println("\t- MQTT request Travel Calibration");
+      if (ch->mtr.IsRunning || calibrationActive(ch) || groupMoveActive()) {
+        Serial.println(" - Not calibrating: motor running or calibration in progress");
+        Bleep("1x1.1");
+      } else {
+        ch->cal.Request = true;                                           // Started by the motor task.
+      }
+    }
+    //
+    // ::   resetprofile  ->>  clear the loop section profile
+    else if (msgAction == "resetprofile") {
+      Serial.println("\t- MQTT reset Loop Profile");
+      profileReset();
+      profileIsrReset();
+    }
+#ifdef WATCHDOG_TEST
+    //
+    // ::   simhang:<mseconds>  ->>  simulate a motor task hang (test the watchdog fail-safe)
+    else if (msgAction.substring(0,7) == "simhang") {
+      Serial.println("\t- MQTT simulate Motor Task hang");
+      int valSplit = msgAction.indexOf(":"); 
+      if (valSplit>0 && valSplit < msgAction.length() ) {
+        simulateHang = msgAction.substring(valSplit+1).toInt();
+      }
+    }
+#endif
+#ifdef JITTER_TEST
+    //
+    // ::   netload:<seconds>  ->>  flood MQTT for a while, and report the control tick jitter measured under that load
+    else if (msgAction.substring(0,7) == "netload") {
+      Serial.println("\t- MQTT start Network Load (jitter test)");
+      int valSplit = msgAction.indexOf(":"); 
+      if (valSplit>0 && valSplit < msgAction.length() ) {
+        motionJitter.ResetRequest = true;
+        netLoadCount = 0;
+        netLoadUntil = millis() + msgAction.substring(valSplit+1).toInt() * 1000UL;
+      }
     }
+#endif
     //
     // :: StateInterval:<minutes>  ->>  set the interval between state updates (0=disabled)
     else if (msgAction.substring(0,13) == "StateInterval") {
       Serial.print("\t- MQTT set State Interval ");
       int valSplit = msgAction.indexOf(":"); 
-      if (valSplit>0 && valSplit < msgAction.length() ) {
+      int value;
+      if (valSplit>0 && settingInt(msgAction.substring(valSplit+1).c_str(), 0, INT32_MAX, &value) ) {
         // Seems like a valid parameter
-        appConfig.State_Interval = msgAction.substring(valSplit+1).toInt();           // Set State feedback interval (in seconds)
-        updatePreferences("StateInterval", msgAction.substring(valSplit+1).c_str(), "int");
-        reportConfig();                                                               // feedback new configuration settings
+        appConfig.State_Interval = value;                                             // Set State feedback interval (in seconds)
+        updatePreferences("app", "StateInterval", String(value).c_str(), "int");
+        reportConfig(ch);                                                               // feedback new configuration settings
         //Serial.print(" NewVal="); Serial.println(appConfig.State_Interval);
       } else {
         Serial.println(" >>> INVALID INTERVAL!!");
@@ -694,11 +1228,12 @@ void remoteAppAction(String msgAction) {
     else if (msgAction.substring(0,11) == "LuxInterval") {
       Serial.print("\t- MQTT set Lux Interval ");
       int valSplit = msgAction.indexOf(":"); 
-      if (valSplit>0 && valSplit < msgAction.length() ) {
+      int value;
+      if (valSplit>0 && settingInt(msgAction.substring(valSplit+1).c_str(), 0, INT32_MAX, &value) ) {
         // Seems like a valid parameter
-        appConfig.Lux_Interval = msgAction.substring(valSplit+1).toInt();            // Set interval between Lux feedback (in seconds)
-        updatePreferences("LuxInterval", msgAction.substring(valSplit+1).c_str(), "int");
-        reportConfig();                                                               // feedback new configuration settings
+        appConfig.Lux_Interval = value;                                              // Set interval between Lux feedback (in seconds)
+        updatePreferences("app", "LuxInterval", String(value).c_str(), "int");
+        reportConfig(ch);                                                               // feedback new configuration settings
         //Serial.print(" NewVal="); Serial.println(appConfig.Lux_Interval);
       } else {
         Serial.println(" >>> INVALID INTERVAL!!");
@@ -709,11 +1244,12 @@ void remoteAppAction(String msgAction) {
     else if (msgAction.substring(0,12) == "TempInterval") {
       Serial.print("\t- MQTT set Temp Interval ");
       int valSplit = msgAction.indexOf(":"); 
-      if (valSplit>0 && valSplit < msgAction.length() ) {
+      int value;
+      if (valSplit>0 && settingInt(msgAction.substring(valSplit+1).c_str(), 0, INT32_MAX, &value) ) {
         // Seems like a valid parameter
-        appConfig.Temp_Interval = msgAction.substring(valSplit+1).toInt();            // Set interval between temperature feedback (in seconds)
-        updatePreferences("TempInterval", msgAction.substring(valSplit+1).c_str(), "int");
-        reportConfig();                                                               // feedback new configuration settings
+        appConfig.Temp_Interval = value;                                              // Set interval between temperature feedback (in seconds)
+        updatePreferences("app", "TempInterval", String(value).c_str(), "int");
+        reportConfig(ch);                                                               // feedback new configuration settings
         //Serial.print(" NewVal="); Serial.println(appConfig.Temp_Interval);
       } else {
         Serial.println(" >>> INVALID INTERVAL!!");
@@ -724,12 +1260,13 @@ void remoteAppAction(String msgAction) {
     else if (msgAction.substring(0,12) == "OpenDuration") {
       Serial.print("\t- MQTT set Max Open Run Duration ");
       int valSplit = msgAction.indexOf(":"); 
-      if (valSplit>0 && valSplit < msgAction.length() ) {
+      int value;
+      if (valSplit>0 && settingInt(msgAction.substring(valSplit+1).c_str(), 0, INT32_MAX, &value) ) {
         // Seems like a valid parameter
-        appConfig.Open_Duration = msgAction.substring(valSplit+1).toInt();            // Set max open run duration (in seconds)
-        updatePreferences("OpenDuration", msgAction.substring(valSplit+1).c_str(), "int");
-        reportConfig();                                                               // feedback new configuration settings
-        //Serial.print(" NewVal="); Serial.println(appConfig.Open_Duration);
+        ch->Cfg.Open_Duration = value;                                              // Set max open run duration (in seconds)
+        updatePreferences(ch->Namespace, "OpenDuration", String(value).c_str(), "int");
+        reportConfig(ch);                                                               // feedback new configuration settings
+        //Serial.print(" NewVal="); Serial.println(ch->Cfg.Open_Duration);
       } else {
         Serial.println(" >>> INVALID DURATION!!");
       }
@@ -739,12 +1276,13 @@ void remoteAppAction(String msgAction) {
     else if (msgAction.substring(0,14) == "MaxRunDuration") {
       Serial.print("\t- MQTT set Max Run Duration ");
       int valSplit = msgAction.indexOf(":"); 
-      if (valSplit>0 && valSplit < msgAction.length() ) {
+      int value;
+      if (valSplit>0 && settingInt(msgAction.substring(valSplit+1).c_str(), 0, INT32_MAX, &value) ) {
         // Seems like a valid parameter
-        appConfig.MaxRunDuration = msgAction.substring(valSplit+1).toInt();           // Set max run duration (in seconds)
-        updatePreferences("MaxRunDuration", msgAction.substring(valSplit+1).c_str(), "int");
-        reportConfig();                                                               // feedback new configuration settings
-        //Serial.print(" NewVal="); Serial.println(appConfig.MaxRunDuration);
+        ch->Cfg.MaxRunDuration = value;                                             // Set max run duration (in seconds)
+        updatePreferences(ch->Namespace, "MaxRunDuration", String(value).c_str(), "int");
+        reportConfig(ch);                                                               // feedback new configuration settings
+        //Serial.print(" NewVal="); Serial.println(ch->Cfg.MaxRunDuration);
       } else {
         Serial.println(" >>> INVALID DURATION!!");
       }
@@ -754,12 +1292,13 @@ void remoteAppAction(String msgAction) {
     else if (msgAction.substring(0,16) == "MaxOpenRotations") {
       Serial.print("\t- MQTT set Max Open Axis Rotations ");
       int valSplit = msgAction.indexOf(":"); 
-      if (valSplit>0 && valSplit < msgAction.length() ) {
+      int value;
+      if (valSplit>0 && settingInt(msgAction.substring(valSplit+1).c_str(), 0, INT32_MAX, &value) ) {
         // Seems like a valid parameter
-        appConfig.Open_MaxRotations = msgAction.substring(valSplit+1).toInt();        // Set max axis rotations before blinds are fully open
-        updatePreferences("MaxOpenRotate", msgAction.substring(valSplit+1).c_str(), "int");
-        reportConfig();                                                               // feedback new configuration settings
-        //Serial.print(" NewVal="); Serial.println(appConfig.Open_MaxRotations);
+        ch->Cfg.Open_MaxRotations = value;                                          // Set max axis rotations before blinds are fully open
+        updatePreferences(ch->Namespace, "MaxOpenRotate", String(value).c_str(), "int");
+        reportConfig(ch);                                                               // feedback new configuration settings
+        //Serial.print(" NewVal="); Serial.println(ch->Cfg.Open_MaxRotations);
       } else {
         Serial.println(" >>> INVALID OPEN COUNT!!");
       }
@@ -772,74 +1311,210 @@ void remoteAppAction(String msgAction) {
       if (valSplit>0 && valSplit < msgAction.length() ) {
         // Seems like a valid parameter
         if (msgAction.substring(valSplit+1) == "true") {
-          appConfig.RotationLimits = true;                    // Open blinds using (max) rotation count
-          updatePreferences("RotationLimits", "true", "bool" );
+          ch->Cfg.RotationLimits = true;                    // Open blinds using (max) rotation count
+          updatePreferences(ch->Namespace, "RotationLimits", "true", "bool" );
         } else {
-          appConfig.RotationLimits = false;                   // Open blinds ignoring rotation count
-          updatePreferences("RotationLimits", "false", "bool" );
+          ch->Cfg.RotationLimits = false;                   // Open blinds ignoring rotation count
+          updatePreferences(ch->Namespace, "RotationLimits", "false", "bool" );
         }
-        reportConfig();                                                               // feedback new configuration settings
-        //Serial.print(" NewVal="); Serial.println(appConfig.RotationLimits);
+        reportConfig(ch);                                                               // feedback new configuration settings
+        //Serial.print(" NewVal="); Serial.println(ch->Cfg.RotationLimits);
       } else {
         Serial.println(" >>> INVALID BOOLEAN!!");
       }
     }
     //
-    // :: DebounceDurSwitches:<duration>  ->>  set debounce delay used for buttons and limit switches
-    else if (msgAction.substring(0,19) == "DebounceDurSwitches") {
-      Serial.print("\t- MQTT set Limit and Button debounce time ");
+    // ::   BrakeOnStop:<true/false>  ->>  set if the motor is braked (true), else left to coast (false) when stopped
+    else if (msgAction.substring(0,11) == "BrakeOnStop") {
+      Serial.print("\t- MQTT set motor brake on stop ");
       int valSplit = msgAction.indexOf(":"); 
       if (valSplit>0 && valSplit < msgAction.length() ) {
         // Seems like a valid parameter
-        appConfig.DebounceDurSwitches = msgAction.substring(valSplit+1).toInt();
-        updatePreferences("DebounceButton", msgAction.substring(valSplit+1).c_str(), "int");
-        reportConfig();                                                               // feedback new configuration settings
-        //Serial.print(" NewVal="); Serial.println(appConfig.DebounceDurSwitches);
+        if (msgAction.substring(valSplit+1) == "true") {
+          ch->Cfg.BrakeOnStop = true;                       // Brake: both low-side switches on
+          updatePreferences(ch->Namespace, "BrakeOnStop", "true", "bool" );
+        } else {
+          ch->Cfg.BrakeOnStop = false;                      // Coast: driver disabled
+          updatePreferences(ch->Namespace, "BrakeOnStop", "false", "bool" );
+        }
+        reportConfig(ch);                                                               // feedback new configuration settings
       } else {
-        Serial.println(" >>> INVALID DEBOUNCE TIME!!");
+        Serial.println(" >>> INVALID BOOLEAN!!");
       }
-    }  
+    }
     //
-    // :: DebounceDurMotor:<duration>  ->>  set debounce delay used for the motor axis rotation switch
-    else if (msgAction.substring(0,16) == "DebounceDurMotor") {
-      Serial.print("\t- MQTT set Motor Rotation switch debounce time ");
+    // ::   HomingMode:<mode>  ->>  set when to home if the position is unknown (none, command, boot, scheduled)
+    else if (msgAction.substring(0,10) == "HomingMode") {
+      Serial.print("\t- MQTT set Homing Mode ");
       int valSplit = msgAction.indexOf(":"); 
-      if (valSplit>0 && valSplit < msgAction.length() ) {
-        // Seems like a valid parameter
-        appConfig.DebounceDurMotor = msgAction.substring(valSplit+1).toInt();         // Set the rotation switch debounce timeout
-        updatePreferences("DebounceRotate", msgAction.substring(valSplit+1).c_str(), "int");
-        reportConfig();                                                               // feedback new configuration settings
-        //Serial.print(" NewVal="); Serial.println(appConfig.DebounceDurMotor);
+      int mode = -1;
+      for (int m = homNone; m <= homScheduled && valSplit > 0; m++) {
+        if (msgAction.substring(valSplit+1) == homingModeName((homingMode) m)) mode = m;
+      }
+      if (mode >= 0) {
+        ch->Cfg.HomingMode = (homingMode) mode;
+        updatePreferences(ch->Namespace, "HomingMode", String(mode).c_str(), "int");
+        reportConfig(ch);                                                               // feedback new configuration settings
       } else {
-        Serial.println(" >>> INVALID DEBOUNCE TIME!!");
+        Serial.println(" >>> INVALID HOMING MODE!!");
       }
-    }  
+    }
     //
-    // :: MinLuxReportDelta:<lux>  ->>  set the minimum difference in Lux level before publishing MQTT (0=no threshold, interval only)
-    else if (msgAction.substring(0,17) == "MinLuxReportDelta") {
-      Serial.print("\t- MQTT set Min Lux Report Delta ");
+    // ::   HomingTime:<hh:mm>  ->>  set the time of day for scheduled homing (local time)
+    else if (msgAction.substring(0,10) == "HomingTime") {
+      Serial.print("\t- MQTT set Homing Time ");
       int valSplit = msgAction.indexOf(":"); 
-      if (valSplit>0 && valSplit < msgAction.length() ) {
+      int timeSplit = msgAction.indexOf(':', valSplit+1);
+      if (valSplit>0 && timeSplit > valSplit+1 ) {
         // Seems like a valid parameter
-        appConfig.Lux_MinReportDelta = msgAction.substring(valSplit+1).toInt();       // Set min Lux report delta
-        updatePreferences("LuxMinDelta", msgAction.substring(valSplit+1).c_str(), "int");
-        reportConfig();                                                               // feedback new configuration settings
-        //Serial.print(" NewVal="); Serial.println(appConfig.Lux_MinReportDelta);
+        int hours = msgAction.substring(valSplit+1, timeSplit).toInt();
+        int minutes = msgAction.substring(timeSplit+1).toInt();
+        if (hours >= 0 && hours < 24 && minutes >= 0 && minutes < 60) {
+          ch->Cfg.HomingTime = hours * 60 + minutes;
+          updatePreferences(ch->Namespace, "HomingTime", String(ch->Cfg.HomingTime).c_str(), "int");
+          reportConfig(ch);                                                             // feedback new configuration settings
+        } else {
+          Serial.println(" >>> INVALID TIME!!");
+        }
       } else {
-        Serial.println(" >>> INVALID DURATION!!");
+        Serial.println(" >>> INVALID TIME!!");
       }
-    }  
+    }
     //
-    // :: MaxCurrentLimit:<val>  ->>  set the maximum current the motor can draw before it is stopped  (0 = no limit)
-    else if (msgAction.substring(0,15) == "MaxCurrentLimit") {
-      Serial.print("\t- MQTT set Max load current");
+    // :: DebounceDurSwitches:<duration>  ->>  set debounce press time used for buttons and limit switches
+    else if (msgAction.substring(0,19) == "DebounceDurSwitches") {
+      Serial.print("\t- MQTT set Limit and Button debounce press time ");
       int valSplit = msgAction.indexOf(":"); 
-      if (valSplit>0 && valSplit < msgAction.length() ) {
+      int value;
+      if (valSplit>0 && settingInt(msgAction.substring(valSplit+1).c_str(), 0, INT32_MAX, &value) ) {
         // Seems like a valid parameter
-        appConfig.MaxCurrentLimit = msgAction.substring(valSplit+1).toInt();          // Set max load current allowed
-        updatePreferences("MaxCurrentLmt", msgAction.substring(valSplit+1).c_str(), "int");
-        reportConfig();                                                               // feedback new configuration settings
-        //Serial.print(" NewVal="); Serial.println(appConfig.MaxCurrentLimit);
+        ch->Cfg.DebounceDurSwitches = value;
+        updatePreferences(ch->Namespace, "DebounceButton", String(value).c_str(), "int");
+        reportConfig(ch);                                                               // feedback new configuration settings
+        //Serial.print(" NewVal="); Serial.println(ch->Cfg.DebounceDurSwitches);
+      } else {
+        Serial.println(" >>> INVALID DEBOUNCE TIME!!");
+      }
+    }  
+    //
+    // :: DebounceDurRelease:<duration>  ->>  set debounce release time used for buttons and limit switches
+    else if (msgAction.substring(0,18) == "DebounceDurRelease") {
+      Serial.print("\t- MQTT set Limit and Button debounce release time ");
+      int valSplit = msgAction.indexOf(":"); 
+      int value;
+      if (valSplit>0 && settingInt(msgAction.substring(valSplit+1).c_str(), 0, INT32_MAX, &value) ) {
+        // Seems like a valid parameter
+        ch->Cfg.DebounceDurRelease = value;
+        updatePreferences(ch->Namespace, "DebounceRelease", String(value).c_str(), "int");
+        reportConfig(ch);                                                               // feedback new configuration settings
+      } else {
+        Serial.println(" >>> INVALID DEBOUNCE TIME!!");
+      }
+    }  
+    //
+    // :: DebounceDurMotor:<duration>  ->>  set debounce delay used for the motor axis rotation switch
+    else if (msgAction.substring(0,16) == "DebounceDurMotor") {
+      Serial.print("\t- MQTT set Motor Rotation switch debounce time ");
+      int valSplit = msgAction.indexOf(":"); 
+      int value;
+      if (valSplit>0 && settingInt(msgAction.substring(valSplit+1).c_str(), 0, INT32_MAX, &value) ) {
+        // Seems like a valid parameter
+        ch->Cfg.DebounceDurMotor = value;                                           // Set the rotation switch debounce timeout
+        updatePreferences(ch->Namespace, "DebounceRotate", String(value).c_str(), "int");
+        reportConfig(ch);                                                               // feedback new configuration settings
+        //Serial.print(" NewVal="); Serial.println(ch->Cfg.DebounceDurMotor);
+      } else {
+        Serial.println(" >>> INVALID DEBOUNCE TIME!!");
+      }
+    }  
+    //
+    // :: ButtonHold:<duration>  ->>  set the button hold time to jog, stop on release (0 = disabled)
+    else if (msgAction.substring(0,10) == "ButtonHold") {
+      Serial.print("\t- MQTT set Button hold time ");
+      int valSplit = msgAction.indexOf(":"); 
+      int value;
+      if (valSplit>0 && settingInt(msgAction.substring(valSplit+1).c_str(), 0, INT32_MAX, &value) ) {
+        // Seems like a valid parameter
+        ch->Cfg.ButtonHold = value;
+        updatePreferences(ch->Namespace, "ButtonHold", String(value).c_str(), "int");
+        reportConfig(ch);                                                               // feedback new configuration settings
+      } else {
+        Serial.println(" >>> INVALID BUTTON TIME!!");
+      }
+    }
+    //
+    // :: ButtonLong:<duration>  ->>  set the button long-press time to latch a full open/close (0 = disabled)
+    else if (msgAction.substring(0,10) == "ButtonLong") {
+      Serial.print("\t- MQTT set Button long-press time ");
+      int valSplit = msgAction.indexOf(":"); 
+      int value;
+      if (valSplit>0 && settingInt(msgAction.substring(valSplit+1).c_str(), 0, INT32_MAX, &value) ) {
+        // Seems like a valid parameter
+        ch->Cfg.ButtonLong = value;
+        updatePreferences(ch->Namespace, "ButtonLong", String(value).c_str(), "int");
+        reportConfig(ch);                                                               // feedback new configuration settings
+      } else {
+        Serial.println(" >>> INVALID BUTTON TIME!!");
+      }
+    }
+    //
+    // :: ButtonDouble:<duration>  ->>  set the max time between the clicks of a double-click (0 = disabled)
+    else if (msgAction.substring(0,12) == "ButtonDouble") {
+      Serial.print("\t- MQTT set Button double-click time ");
+      int valSplit = msgAction.indexOf(":"); 
+      int value;
+      if (valSplit>0 && settingInt(msgAction.substring(valSplit+1).c_str(), 0, INT32_MAX, &value) ) {
+        // Seems like a valid parameter
+        ch->Cfg.ButtonDouble = value;
+        updatePreferences(ch->Namespace, "ButtonDouble", String(value).c_str(), "int");
+        reportConfig(ch);                                                               // feedback new configuration settings
+      } else {
+        Serial.println(" >>> INVALID BUTTON TIME!!");
+      }
+    }
+    //
+    // :: ButtonPreset:<%>  ->>  set the double-click preset position (percentage open. -1 = none)
+    else if (msgAction.substring(0,12) == "ButtonPreset") {
+      Serial.print("\t- MQTT set Button preset position ");
+      int valSplit = msgAction.indexOf(":"); 
+      int value;
+      if (valSplit>0 && settingInt(msgAction.substring(valSplit+1).c_str(), -1, 100, &value) ) {
+        // Seems like a valid parameter
+        ch->Cfg.ButtonPreset = value;
+        updatePreferences(ch->Namespace, "ButtonPreset", String(value).c_str(), "int");
+        reportConfig(ch);                                                               // feedback new configuration settings
+      } else {
+        Serial.println(" >>> INVALID PRESET POSITION!!");
+      }
+    }
+    //
+    // :: MinLuxReportDelta:<lux>  ->>  set the minimum difference in Lux level before publishing MQTT (0=no threshold, interval only)
+    else if (msgAction.substring(0,17) == "MinLuxReportDelta") {
+      Serial.print("\t- MQTT set Min Lux Report Delta ");
+      int valSplit = msgAction.indexOf(":"); 
+      int value;
+      if (valSplit>0 && settingInt(msgAction.substring(valSplit+1).c_str(), 0, INT32_MAX, &value) ) {
+        // Seems like a valid parameter
+        appConfig.Lux_MinReportDelta = value;                                         // Set min Lux report delta
+        updatePreferences("app", "LuxMinDelta", String(value).c_str(), "int");
+        reportConfig(ch);                                                               // feedback new configuration settings
+        //Serial.print(" NewVal="); Serial.println(appConfig.Lux_MinReportDelta);
+      } else {
+        Serial.println(" >>> INVALID DURATION!!");
+      }
+    }  
+    //
+    // :: MaxCurrentLimit:<val>  ->>  set the maximum current the motor can draw before it is stopped  (0 = no limit)
+    else if (msgAction.substring(0,15) == "MaxCurrentLimit") {
+      Serial.print("\t- MQTT set Max load current");
+      int valSplit = msgAction.indexOf(":"); 
+      int value;
+      if (valSplit>0 && settingInt(msgAction.substring(valSplit+1).c_str(), 0, INT32_MAX, &value) ) {
+        // Seems like a valid parameter
+        ch->Cfg.MaxCurrentLimit = value;                                            // Set max load current allowed
+        updatePreferences(ch->Namespace, "MaxCurrentLmt", String(value).c_str(), "int");
+        reportConfig(ch);                                                               // feedback new configuration settings
+        //Serial.print(" NewVal="); Serial.println(ch->Cfg.MaxCurrentLimit);
       } else {
         Serial.println(" >>> INVALID MAX CURRENT!!");
       }
@@ -853,12 +1528,12 @@ void remoteAppAction(String msgAction) {
         // Seems like a valid parameter
         if (msgAction.substring(valSplit+1) == "true") {
           appConfig.AllowRemoteControl = true;                    // Allow blinds to be controlled remotely
-          updatePreferences("AllowRemoteCtl", "true", "bool" );
+          updatePreferences("app", "AllowRemoteCtl", "true", "bool" );
         } else {
           appConfig.AllowRemoteControl = false;                   // Ignore remote (MQTT) commands
-          updatePreferences("AllowRemoteCtl", "false", "bool" );
+          updatePreferences("app", "AllowRemoteCtl", "false", "bool" );
         }
-        reportConfig();                                                               // feedback new configuration settings
+        reportConfig(ch);                                                               // feedback new configuration settings
         //Serial.print(" NewVal="); Serial.println(appConfig.AllowRemoteControl);
       } else {
         Serial.println(" >>> INVALID BOOLEAN!!");
@@ -873,12 +1548,12 @@ void remoteAppAction(String msgAction) {
         // Seems like a valid parameter
         if (msgAction.substring(valSplit+1) == "true") {
           appConfig.AllowRemoteBleep = true;                      // Support global bleep notifications
-          updatePreferences("AllowRemoteBlp", "true", "bool" );
+          updatePreferences("app", "AllowRemoteBlp", "true", "bool" );
         } else {
           appConfig.AllowRemoteBleep = false;                     // Ignore global (MQTT) bleep messages
-          updatePreferences("AllowRemoteBlp", "false", "bool" );
+          updatePreferences("app", "AllowRemoteBlp", "false", "bool" );
         }
-        reportConfig();                                                               // feedback new configuration settings
+        reportConfig(ch);                                                               // feedback new configuration settings
         //Serial.print(" NewVal="); Serial.println(appConfig.AllowRemoteBleep);
       } else {
         Serial.println(" >>> INVALID BOOLEAN!!");
@@ -886,40 +1561,23 @@ void remoteAppAction(String msgAction) {
     }  
     //
     // ::   WiFiSetup:SSID/password  ->>  set the SSID and password to be used ("default" for default).
-    else if (msgAction.substring(0,9) == "WiFiSetup") {
-      int valSplit = msgAction.indexOf("/"); 
-      if (valSplit>10 && valSplit < msgAction.length() ) {
-        // New SSID and Pwd. Set the new values in config.
-        appConfig.SSID = (char*) malloc((valSplit-10)+1);
-        if (appConfig.SSID != NULL) {
-          strncpy( appConfig.SSID, msgAction.substring(10).c_str(), valSplit-10 );
-          appConfig.SSID[valSplit-10] = '\0';
-        }
-        appConfig.Password = (char*) malloc((msgAction.length()-valSplit)+1);
-        if (appConfig.Password != NULL) {
-          strncpy( appConfig.Password, msgAction.substring(valSplit+1).c_str(), msgAction.length()-valSplit );
-          appConfig.Password[msgAction.length()-valSplit] = '\0';
-        }
-        updatePreferences("SSID", appConfig.SSID, "string");
-        updatePreferences("Password", appConfig.Password, "string");
-        reportConfig();
-      } else if (msgAction.substring(10,17) == "default") {
+    else if (msgAction.substring(0,10) == "WiFiSetup:") {
+      credResult result = parseWiFiSetup(msgAction.c_str() + 10, msgAction.length() - 10, appConfig.SSID, appConfig.Password);
+      if (result == credDefault) {
         // "default". Set the default SSID and Password (reset to defaults).  
-        appConfig.SSID = (char*) malloc (strlen(default_ssid)+1);
-        if (appConfig.SSID != NULL) {
-          strncpy( appConfig.SSID, default_ssid, strlen(default_ssid) );
-          appConfig.SSID[strlen(default_ssid)] = '\0';
-        }
-        appConfig.Password = (char*) malloc (strlen(default_password)+1);
-        if (appConfig.Password != NULL) {
-          strncpy( appConfig.Password, default_password, strlen(default_password) );
-          appConfig.Password[strlen(default_password)] = '\0';
-        }
-        updatePreferences("SSID", appConfig.SSID, "string");
-        updatePreferences("Password", appConfig.Password, "string");
-        reportConfig();
+        setCredential(appConfig.SSID, sizeof(appConfig.SSID), default_ssid, strlen(default_ssid));
+        setCredential(appConfig.Password, sizeof(appConfig.Password), default_password, strlen(default_password));
+      }
+      if (result == credSet || result == credDefault) {
+        updatePreferences("app", "SSID", appConfig.SSID, "string");
+        updatePreferences("app", "Password", appConfig.Password, "string");
+        reportConfig(ch);
+      } else if (result == credTooLong) {
+        Serial.println(" >>> INVALID WiFi config, SSID or password too long!!");
+        Bleep("1x1.1.1");
       } else {
         Serial.println(" >>> INVALID WiFi config!!");
+        Bleep("1x1.1.1");
       }
     }
 
@@ -938,22 +1596,43 @@ void remoteAppAction(String msgAction) {
 void MQTT_callback (char* topic, byte* message, unsigned int length) {
   String msgAction;
 
+  latencyMark(latReceived);                                     // Start latency trace (only completes if the motor is started)
+
   for (int i = 0; i < length; i++) {
     msgAction += (char)message[i];
   }
   Serial.printf("MQTT Message.  Topic: %s - Action: %s\n", topic, msgAction.c_str() );  
 
+  // Find the channel the topic belongs to (if any).
+  BlindChannel* ch = NULL;
+  bool isAction = false;
+  for (int i = 0; i < channelCount && ch == NULL; i++) {
+    if (strcmp(topic, blindChannels[i].topicAction) == 0) {
+      ch = &blindChannels[i];
+      isAction = true;
+    } else if (strcmp(topic, blindChannels[i].topicAppCmd) == 0) {
+      ch = &blindChannels[i];
+    }
+  }
+
   // TOPIC: LIVINGROOM/BLINDS/ACTION
-  if (String(topic) == MQTT_SUB_BLINDSACTION) {
+  if (ch != NULL && isAction) {
     // If Blinds control through MQTT is enabled in the configuration..
     if (appConfig.AllowRemoteControl) {
-      remoteBlindsAction(msgAction);
+      remoteBlindsAction(ch, msgAction);
     }
   }  
 
   // TOPIC: LIVINGROOM/BLINDS/APPCMD 
-  else if (String(topic) == MQTT_SUB_APPCMD ) { 
-    remoteAppAction(msgAction);
+  else if (ch != NULL) { 
+    remoteAppAction(ch, msgAction);
+  }
+
+  // TOPIC: LIVINGROOM/BLINDS/GROUP
+  else if (String(topic) == MQTT_SUB_GROUP) {
+    if (appConfig.AllowRemoteControl) {
+      remoteGroupAction(msgAction);
+    }
   }
 
   // TOPIC:  "ALL/NOTIFY/BLEEP" 
@@ -972,6 +1651,80 @@ void MQTT_callback (char* topic, byte* message, unsigned int length) {
 
 }
 
+/**************************************************************************
+ *  HTTP API handlers (HttpApi.h), run by the HTTP server task. Reads are answered by the main loop (httpQuery).
+ *  - GET  /api/position?ch=<n>  : state and position of the channel
+ *  - POST /api/position?ch=<n>  : move to the position in the body (percentage open, 0 = close)
+ *  - POST /api/stop?ch=<n>      : stop the channel
+ *  - GET  /api/state            : app state and telemetry values (as app_state)
+ *  - GET  /api/config?ch=<n>    : settings of the channel (as config)
+ *  - GET  /api/metrics          : command latency, group move skew, limit cut-off and gestures (as latency)
+ *  Commands are queued for the main loop (remoteBlindsAction), and need AllowRemoteControl like MQTT.
+ **************************************************************************/
+esp_err_t httpGetPosition(httpd_req_t* req) {
+  int ch = httpChannel(req);
+  if (ch < 0) return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "no such channel");
+  return httpQuery(req, hqPosition, ch);
+}
+
+esp_err_t httpSetPosition(httpd_req_t* req) {
+  int ch = httpChannel(req);
+  char body[httpBodyLength];
+  if (ch < 0) return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "no such channel");
+  if (!appConfig.AllowRemoteControl) return httpd_resp_send_err(req, HTTPD_403_FORBIDDEN, "remote control disabled");
+  if (!httpBody(req, body, sizeof(body)) || !isDigit(body[0]) || atoi(body) > 100) {
+    return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "body: percentage open (0-100)");
+  }
+
+  char action[httpBodyLength];
+  int percentage = atoi(body);
+  if (percentage == 0) {
+    strcpy(action, "close");
+  } else {
+    snprintf(action, sizeof(action), "open:%d", percentage);
+  }
+  return httpQueueCommand(req, ch, action);
+}
+
+esp_err_t httpStop(httpd_req_t* req) {
+  int ch = httpChannel(req);
+  if (ch < 0) return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "no such channel");
+  if (!appConfig.AllowRemoteControl) return httpd_resp_send_err(req, HTTPD_403_FORBIDDEN, "remote control disabled");
+  return httpQueueCommand(req, ch, "stop");
+}
+
+esp_err_t httpGetState(httpd_req_t* req) {
+  return httpQuery(req, hqState, 0);
+}
+
+esp_err_t httpGetConfig(httpd_req_t* req) {
+  int ch = httpChannel(req);
+  if (ch < 0) return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "no such channel");
+  return httpQuery(req, hqConfig, ch);
+}
+
+esp_err_t httpGetMetrics(httpd_req_t* req) {
+  return httpQuery(req, hqMetrics, 0);
+}
+
+/**************************************************************************
+ *  httpBuildAnswer
+ *  - Build the answer to an HTTP API query (main loop, see httpAnswerQueries).
+ **************************************************************************/
+void httpBuildAnswer(JsonObject obj, const HttpQuery& query) {
+  BlindChannel* ch = &blindChannels[query.Channel];
+  switch (query.Kind) {
+    case hqPosition :
+      obj["ch"] = query.Channel;
+      blindsStateToJson(obj, ch);
+      obj["running"] = ch->mtr.IsRunning;
+      break;
+    case hqState :   stateToJson(obj); break;
+    case hqConfig :  configToJson(obj, ch); break;
+    case hqMetrics : metricsToJson(obj); break;
+  }
+}
+
 /**************************************************************************
  *  setup_WIFI
  *  - Connect to specified WLAN.
@@ -1025,9 +1778,18 @@ bool setup_MQTT() {
         if ( clientMQTT.connect("ESP32Client", "MQTT", mqtt_pwd) ) {
           Serial.print("- MQTT connected. "); Serial.print(" WiFi="); Serial.println(WiFi.RSSI());
           // Subscribe to the relevant topics
-          clientMQTT.subscribe(MQTT_SUB_BLINDSACTION);
+          for (int ch = 0; ch < channelCount; ch++) {
+            clientMQTT.subscribe(blindChannels[ch].topicAction);
+            clientMQTT.subscribe(blindChannels[ch].topicAppCmd);
+          }
+          clientMQTT.subscribe(MQTT_SUB_GROUP);
           clientMQTT.subscribe(MQTT_SUB_NOTIFY);
-          clientMQTT.subscribe(MQTT_SUB_APPCMD);
+          // New session: deltas may have been missed, so the next config and state reports are full snapshots.
+          stateDelta.Baseline = false;
+          for (int ch = 0; ch < channelCount; ch++) {
+            blindChannels[ch].cfgDelta.Baseline = false;
+            blindChannels[ch].appCfgDelta.Baseline = false;
+          }
 
         } else {
           Serial.print("- MQTT connect failed! rc="); Serial.print(clientMQTT.state());
@@ -1042,6 +1804,52 @@ bool setup_MQTT() {
   return clientMQTT.connected();
 }
 
+/**************************************************************************
+ *  setupChannel
+ *  - Initialise a blinds channel: pins, PWM channels, topics, settings and timers.
+ *  - Channel 0 uses the "app" namespace (backwards compatible), other channels "ch<n>".
+ **************************************************************************/
+void setupChannel(BlindChannel* ch, int index) {
+  ch->Index = index;
+  ch->Pin = &channelPins[index];
+  ch->pwmChannel_Open = index * 2;
+  ch->pwmChannel_Close = index * 2 + 1;
+  if (index == 0) {
+    strcpy(ch->Namespace, "app");
+  } else {
+    snprintf(ch->Namespace, sizeof(ch->Namespace), "ch%d", index);
+  }
+  ch->mtr = {false, false, -1, -1, actUNDEF, ownUNDEF};
+  ch->rampActive = false;
+  ch->dutyMax = 255;
+
+  // Topics are the channel base topic followed by the suffix.
+  snprintf(ch->topicState, topicLength, "%s%s", ch->Pin->Topic, MQTT_PUB_BLINDSSTATE);
+  snprintf(ch->topicConfig, topicLength, "%s%s", ch->Pin->Topic, MQTT_PUB_CONFIG);
+  snprintf(ch->topicConfigDelta, topicLength, "%s%s", ch->Pin->Topic, MQTT_PUB_CONFIG_DELTA);
+  snprintf(ch->topicAction, topicLength, "%s%s", ch->Pin->Topic, MQTT_SUB_BLINDSACTION);
+  snprintf(ch->topicAppCmd, topicLength, "%s%s", ch->Pin->Topic, MQTT_SUB_APPCMD);
+
+  loadChannelConfig(ch);
+
+  // Configure the motor driver (pins and PWM).
+  driverSetup(ch);
+
+  // Configure the pins.
+  pinMode(ch->Pin->BtnOpen, INPUT_PULLUP);                 // OPEN button
+  pinMode(ch->Pin->BtnClose, INPUT_PULLUP);                // CLOSE button
+  pinMode(ch->Pin->StopClosed, INPUT_PULLUP);              // CLOSED limit switch
+  pinMode(ch->Pin->StopOpen, INPUT_PULLUP);                // OPEN limit switch
+  pinMode(ch->Pin->MotorRotations, INPUT_PULLUP);          // Pin used to count motor rotations (wiper motor slip ring)
+
+  // Set up timers to automatically limit motor run duration when opening, to stop motor after running a max duration,
+  // and to step the soft-start. (Timer wheel: no hardware timer or esp_timer per deadline needed.)
+  wheelInit(ch->tmrOpen, onTimerBlindsOpen, ch);
+  wheelInit(ch->tmrMaster, onTimerBlindsMaster, ch);
+  wheelInit(ch->tmrRamp, onTimerRampStep, ch);
+  wheelInit(ch->tmrGroup, onTimerGroupHold, ch);
+}
+
 /**************************************************************************
  *  setup
  *  - Define pins.
@@ -1062,17 +1870,13 @@ void setup() {
   loadConfig();
   Serial.println("Setup: Reading config file done!");
 
-  // Configure the pins.
-  pinMode(pin_RPWM, OUTPUT);                          // RIGHT pulse width modulation
-  pinMode(pin_LPWM, OUTPUT);                          // LEFT pulse width modulation
-  pinMode(pin_REN, OUTPUT);                           // Enable RIGHT rotation
-  pinMode(pin_LEN, OUTPUT);                           // Enable LEFT rotation
+  // Configure the pins, settings and topics of each blinds channel. The timer wheel runs the motor deadlines.
   pinMode(pin_Buzzer, OUTPUT);                        // Active Buzzer 
-  pinMode(pin_BtnOpen, INPUT_PULLUP);                 // OPEN button
-  pinMode(pin_BtnClose, INPUT_PULLUP);                // CLOSE button
-  pinMode(pin_StopClosed, INPUT_PULLUP);              // CLOSED limit switch
-  pinMode(pin_StopOpen, INPUT_PULLUP);                // OPEN limit switch
-  pinMode(pin_MotorRotations, INPUT_PULLUP);          // Pin used to count motor rotations (wiper motor slip ring)
+  wheelSetup();
+  for (int i = 0; i < channelCount; i++) {
+    setupChannel(&blindChannels[i], i);
+  }
+  Serial.printf("Setup: %d blinds channel(s) configured.\n", channelCount);
 
   // Set up WiFi and MQTT.
   if ( !setup_WIFI(false) ) {
@@ -1088,7 +1892,10 @@ void setup() {
     delay(500);
     clientMQTT.setServer(mqtt_server, 1883); 
     clientMQTT.setCallback(MQTT_callback);                               // local function to call when MQTT msg received.
+    clientMQTT.setBufferSize(mqttBufferSize);                            // once at boot: JSON is streamed, text publishes (profile) exceed 256 bytes.
     setup_MQTT();
+    configTzTime(ntp_timezone, ntp_server);                              // Local time, for the scheduled homing.
+
   } else {
     // Reboot and try WiFi connection again.
     Serial.println("\nWiFi NOT CONNECTED!\n");
@@ -1108,38 +1915,53 @@ void setup() {
   luxSensor.begin(BH1750::CONTINUOUS_HIGH_RES_MODE);
   Serial.println("Lux sensor (BH1750) configured.");
   
-  // Configure the PWM detail.
-  ledcSetup(pwmChannel_Open, pwmFrequency, pwmResolution);
-  ledcSetup(pwmChannel_Close, pwmFrequency, pwmResolution);
-  // Attach the channels to the PWM pins.
-  ledcAttachPin(pin_RPWM, pwmChannel_Open);
-  ledcAttachPin(pin_LPWM, pwmChannel_Close);
-
   semBlindsCheck = xSemaphoreCreateMutex();                                     // ??
 
-  // Set up timer to automatically limit motor run duration when opening.
-  tmrBlindsOpen = timerBegin (0, 80, true);                                     // use ESP32 Timer 0, pre-scale 80 (of 80MHz), count up.
-  timerAttachInterrupt (tmrBlindsOpen, &isrTimerBlindsOpen, true);              // attach the function to call when timer interrupt fires. Edge.
-
-  // Set up master timer to automatically stop motor after running a max duration.
-  tmrBlindsMaster = timerBegin (1, 80, true);                                   // use ESP32 Timer 0, pre-scale 80 (of 80MHz), count up.
-  timerAttachInterrupt (tmrBlindsMaster, &isrTimerBlindsMaster, true);          // attach the function to call when timer interrupt fires. Edge.
-
-  // Create the task that will run in a seperate thread on Core 1.
+  // Create the task that will run in a seperate thread, on the control core (task layout in configuration.h).
   // NOTE: the task starts to run immediately after its creation below.
   xTaskCreatePinnedToCore (
       loop_MotorActions,        // Function to be executed by the task 
       "loop_MotorActions",      // Name of the task 
-      2000,                     // Stack size in words 
+      stackMotorTask,           // Stack size in bytes 
       NULL,                     // Task input parameter 
-      1,                        // Priority of the task 
+      prioMotorTask,            // Priority of the task 
       &taskLoopMotorActions,    // Task handle 
-      1);                       // Core where the task should run (Core 1 in this case) 
+      coreMotorTask);           // Core where the task should run 
+
+  // Create the fixed-rate motion control task. Highest priority on the control core, so the control period is kept.
+  xTaskCreatePinnedToCore (
+      loop_MotionControl,       // Function to be executed by the task 
+      "loop_MotionControl",     // Name of the task 
+      stackMotionTask,          // Stack size in bytes 
+      NULL,                     // Task input parameter 
+      prioMotionTask,           // Priority of the task 
+      &taskMotionControl,       // Task handle 
+      coreMotionTask);          // Core where the task should run 
+
+  // Supervise the motor task heartbeat. Cuts the running motors if the motor task hangs (MotorWatchdog.h).
+  watchdogStart(isrTimerWatchdog);
+
+  // Configure the interrupts, per channel (the channel is passed to the interrupt routine).
+  for (int i = 0; i < channelCount; i++) {
+    BlindChannel* ch = &blindChannels[i];
+    attachInterruptArg(ch->Pin->MotorRotations, isrMotorRotations, ch, FALLING);       // Count axis rotation pulses.
+    if (ch->Pin->Fault >= 0) {
+      attachInterruptArg(ch->Pin->Fault, isrDriverFault, ch, FALLING);                 // Motor driver reports a fault.
+    }
+    attachInterruptArg(ch->Pin->StopOpen, isrLimitOpen, ch, FALLING);                  // Cut off the driver at the limit switches.
+    attachInterruptArg(ch->Pin->StopClosed, isrLimitClosed, ch, FALLING);
+  }
 
-  // Configure the interrupts.
-  attachInterrupt(pin_BtnOpen, isrButtonBlindsOpen, FALLING);                    // Blinds go up button pressed/released.
-  attachInterrupt(pin_BtnClose, isrButtonBlindsClose, FALLING);                  // Blinds go down button pressed/released.
-  attachInterrupt(pin_MotorRotations, isrMotorRotations, FALLING);              // Count axis rotation pulses.
+  // Sample the buttons and limit switches at a fixed rate. The debouncers start in the current input state.
+  for (int i = 0; i < channelCount; i++) {
+    BlindChannel* ch = &blindChannels[i];
+    debounceInit(ch->swcOpen.Input, digitalRead(ch->Pin->StopOpen) == LOW);
+    debounceInit(ch->swcClosed.Input, digitalRead(ch->Pin->StopClosed) == LOW);
+    debounceInit(ch->btnOpen.Input, digitalRead(ch->Pin->BtnOpen) == LOW);
+    debounceInit(ch->btnClose.Input, digitalRead(ch->Pin->BtnClose) == LOW);
+  }
+  wheelInit(tmrDebounce, onTimerDebounce, NULL);
+  wheelArm(tmrDebounce, debounceSampleInterval, debounceSampleInterval);
 
   // Show board detail
   esp_chip_info_t espInfo;
@@ -1152,15 +1974,40 @@ void setup() {
   Serial.print("\t- PSRAM: \t"); if (psramFound()) { Serial.println("Yes"); } else { Serial.println("No"); };
 
   // On startup, see if the blinds are (fully) open or closed.
-  swcBlindsClosed.Set = (digitalRead(pin_StopClosed) == LOW);         // Normal high button will be pulled low when pressed. 
-  swcBlindsOpen.Set = (digitalRead(pin_StopOpen) == LOW);             // Normal high button will be pulled low when pressed. 
-  if (swcBlindsClosed.Set) mtrBlinds.currentPosition = 0;             // If closed then set the initial position to 0.
+  for (int i = 0; i < channelCount; i++) {
+    BlindChannel* ch = &blindChannels[i];
+    ch->swcClosed.Set = (digitalRead(ch->Pin->StopClosed) == LOW);         // Normal high button will be pulled low when pressed. 
+    ch->swcOpen.Set = (digitalRead(ch->Pin->StopOpen) == LOW);             // Normal high button will be pulled low when pressed. 
+    if (ch->swcClosed.Set) ch->mtr.currentPosition = 0;                  // If closed then set the initial position to 0.
+    if (ch->swcOpen.Set && ch->Cfg.Open_MaxRotations > 0) ch->mtr.currentPosition = ch->Cfg.Open_MaxRotations;   // Fully open.
+    if (ch->Cfg.HomingMode == homBoot && homingNeeded(ch)) homingRequest(ch, homBoot);        // Started by the motor task.
   
-  // Publish initial state to ensure HA is in sync.
-  mqttPublishBlindsState = true;
+    // Publish initial state to ensure HA is in sync.
+    ch->publishState = true;
+  }
 
+  otaCheckPending();                                            // New OTA image: validated by the main loop, or rolled back.
   setupOTA("BlindsControl");
 
+  // Start the local HTTP API (works without the MQTT broker).
+  if (httpSetup()) {
+    httpRegister("/api/position", HTTP_GET, httpGetPosition);
+    httpRegister("/api/position", HTTP_POST, httpSetPosition);
+    httpRegister("/api/stop", HTTP_POST, httpStop);
+    httpRegister("/api/state", HTTP_GET, httpGetState);
+    httpRegister("/api/config", HTTP_GET, httpGetConfig);
+    httpRegister("/api/metrics", HTTP_GET, httpGetMetrics);
+    Serial.printf("HTTP API started (port %d)\n", httpPort);
+  }
+
+  // Register the tasks for stack high-water mark monitoring. (setup runs in the Arduino loop task)
+  taskMonitorRegister("loop", xTaskGetCurrentTaskHandle(), stackLoopTask);
+  taskMonitorRegister("motor", taskLoopMotorActions, stackMotorTask);
+  taskMonitorRegister("motion", taskMotionControl, stackMotionTask);
+  taskMonitorRegister("ota", taskOTA, stackOTATask);
+  taskMonitorRegister("http", xTaskGetHandle("httpd"), stackHttpTask);
+  taskMonitorCollect();
+
   #ifdef TELNET_DEBUG
     TelnetStream.println("Setup done");
   #endif
@@ -1181,52 +2028,166 @@ void loop() {
   static unsigned long lastTempReport = 0;            // Last Temperature status report (in seconds)
   static unsigned long lastStateReport = 0;           // Last app/wifi status report (in seconds)
   static unsigned long lastCurrentSense = 0;
+  static unsigned long lastTaskMonitor = 0;           // Last task stack and heap sample (in seconds)
+  static unsigned long lastHomingCheck = 0;           // Last scheduled homing time check (millis)
+  static unsigned long lastMqttReconnect = 0;         // Last MQTT reconnect attempt (millis)
 
   if (DoBleepTimes>0) {
     MyBleep(DoBleepTimes);
     DoBleepTimes = 0;
   }
 
-  // Check load current if enabled (>0) and motor is running. Stop motor if limit is exceeded. 
-  if ( appConfig.MaxCurrentLimit > 0 && mtrBlinds.IsRunning) {
-    if  ( millis() - lastCurrentSense > currentSenseInterval ) {
-      int motorCurrent = 0;
-      motorCurrent = analogRead(pin_iSense);
-      Serial.print("Motor Current: "); Serial.print(motorCurrent); Serial.print(", all max = "); Serial.println(maxCurrent);
-      if (motorCurrent > maxCurrent) { maxCurrent = motorCurrent; } // just testing, display largest current up to now
-      if (motorCurrent > appConfig.MaxCurrentLimit) {
-        // Max load current exceeded. Stop motor.
-        xSemaphoreTake(semBlindsCheck, portMAX_DELAY);
-        actionStopMotor = true;
-        xSemaphoreGive(semBlindsCheck);
-        Serial.print(">>> Max current load exceeded! - "); Serial.println(motorCurrent);
-        Bleep("2x1.1.0");   // Audible alarm
+  // Execute the commands received by the HTTP API, through the same path as the MQTT action topic.
+  HttpCommand httpCmd;
+  while (httpCommands != NULL && xQueueReceive(httpCommands, &httpCmd, 0) == pdTRUE) {
+    latencyMark(latReceived);                                         // Start latency trace on this core (as MQTT_callback)
+    Serial.printf("HTTP Command.  Channel: %d - Action: %s\n", httpCmd.Channel, httpCmd.Action);
+    remoteBlindsAction(&blindChannels[httpCmd.Channel], String(httpCmd.Action));
+  }
+  httpAnswerQueries(httpBuildAnswer);                                 // Reads of the HTTP API, built on this task
+
+  // The motor task missed its heartbeat and the fail-safe cut the running motors.
+  if (watchdogTripped) {
+    watchdogTripped = false;
+    Serial.printf(">>> Motor task heartbeat missed: motors cut (trips=%u)\n", watchdogTrips);
+    TelnetStream.println(">>> Motor task heartbeat missed: motors cut");
+    Bleep("2x1.1.0");   // Audible alarm
+  }
+
+  // Sample load current of the running motors (for the run journal). Stop motor if limit is enabled (>0) and exceeded. 
+  if  ( millis() - lastCurrentSense > currentSenseInterval ) {
+    for (int i = 0; i < channelCount; i++) {
+      BlindChannel* ch = &blindChannels[i];
+      if ( ch->mtr.IsRunning ) {
+        PROFILE_SECTION(prfCurrentSense);
+        int motorCurrent = 0;
+        motorCurrent = analogRead(ch->Pin->iSense);
+        journalCurrentSample(ch->Index, motorCurrent);
+        if ( ch->Cfg.MaxCurrentLimit > 0 && motorCurrent > ch->Cfg.MaxCurrentLimit ) {
+          // Max load current exceeded. Stop motor.
+          xSemaphoreTake(semBlindsCheck, portMAX_DELAY);
+          flagMotorStop(ch, stpMaxCurrent);
+          xSemaphoreGive(semBlindsCheck);
+          Serial.printf(">>> Max current load exceeded! - ch%d: %d\n", ch->Index, motorCurrent);
+          Bleep("2x1.1.0");   // Audible alarm
+        }
+      }
+    }
+    lastCurrentSense = millis();
+  }
+
+  // Publish Blinds status of each channel if it changed since last check.
+  for (int i = 0; i < channelCount; i++) {
+    BlindChannel* ch = &blindChannels[i];
+    if (ch->publishState) {
+      PROFILE_SECTION(prfBlindsState);
+      StaticJsonDocument<50> configDoc;
+      if (ch->Cfg.Open_MaxRotations > 0 && ch->swcClosed.Set) { ch->mtr.currentPosition=0; } 
+      blindsStateToJson(configDoc.to<JsonObject>(), ch);
+      //#publishJson(clientMQTT, ch->topicState, configDoc, true);  // publish retain state ??
+      publishJson(clientMQTT, ch->topicState, configDoc);
+      Serial.print(" - MQTT publish Blinds State: ");  Serial.println(ch->topicState);  serializeJson(configDoc, Serial); Serial.println();
+      ch->publishState = false;
+    }
+  }
+
+  // Publish the calibration progress, and store the result of a completed calibration.
+  for (int i = 0; i < channelCount; i++) {
+    BlindChannel* ch = &blindChannels[i];
+    if (ch->cal.Publish) {
+      ch->cal.Publish = false;
+      if (ch->cal.Phase == calDone && !ch->cal.Saved) {
+        saveCalibration(ch);
+        ch->cal.Saved = true;
+        reportConfig(ch);
+      }
+      reportCalibration(ch);
+    }
+  }
+
+  // Publish the homing results. Start the scheduled homing of channels with an unknown position.
+  for (int i = 0; i < channelCount; i++) {
+    BlindChannel* ch = &blindChannels[i];
+    if (ch->homing.Publish) {
+      ch->homing.Publish = false;
+      reportHoming(ch);
+    }
+  }
+  if ( millis() - lastHomingCheck > 30000 ) {
+    struct tm now;
+    if (getLocalTime(&now, 0)) {
+      int minuteOfDay = now.tm_hour * 60 + now.tm_min;
+      for (int i = 0; i < channelCount; i++) {
+        BlindChannel* ch = &blindChannels[i];
+        if ( ch->Cfg.HomingMode == homScheduled && minuteOfDay == ch->Cfg.HomingTime && homingNeeded(ch) && !ch->mtr.IsRunning ) {
+          homingRequest(ch, homScheduled);
+        }
       }
-      lastCurrentSense = millis();
     }
+    lastHomingCheck = millis();
   }
 
-  // Publish Blinds status if it changed since last check.
-  if (mqttPublishBlindsState) {
-    StaticJsonDocument<50> configDoc;
-    if (swcBlindsClosed.Set) { configDoc["state"] = "closed"; } else { configDoc["state"] = "open"; }
-    if (appConfig.Open_MaxRotations > 0 ) {
-      if (swcBlindsClosed.Set) { mtrBlinds.currentPosition=0; } 
-      configDoc["percentage"] = round( ( (float)mtrBlinds.currentPosition / (float)appConfig.Open_MaxRotations) * 100 );      
+  // Publish the OTA progress. Restart into the new image once the update is done and reported.
+  if (otaStatus.Publish) {
+    otaStatus.Publish = false;
+    reportOta();
+    if (otaStatus.Phase == otaDone) {
+      Serial.println("OTA done: restart");
+      delay(500);                                                     // Let the result go out.
+      esp_restart();
+    }
+  }
+
+  // Validate a new OTA image: MQTT connected and the motor self-check passed. Roll back if it fails, or times out.
+  if (otaVerifyPending) {
+    if (clientMQTT.connected()) {
+      otaValidate(motorSelfCheck());
+    } else if (millis() > otaValidateTimeout * 1000UL) {
+      otaValidate(false);
+    }
+  }
+
+  // Move to the button preset position (double-click), as an MQTT "open:<%>" command.
+  for (int i = 0; i < channelCount; i++) {
+    BlindChannel* ch = &blindChannels[i];
+    if (ch->presetRequest) {
+      ch->presetRequest = false;
+      remoteBlindsAction(ch, String("open:") + String(ch->Cfg.ButtonPreset));
+    }
+  }
+
+#ifdef JITTER_TEST
+  // Jitter test: publish filler messages back-to-back until the test ends, then report the state (incl. jitter).
+  if (netLoadUntil != 0) {
+    if ((long) (millis() - netLoadUntil) < 0) {
+      static char filler[netLoadPayload];
+      if (filler[0] == 0) memset(filler, 'x', sizeof(filler) - 1);
+      if (clientMQTT.publish(MQTT_PUB_NETLOAD, filler)) netLoadCount++;
     } else {
-      configDoc["percentage"] = "-";
+      netLoadUntil = 0;
+      Serial.printf("> Network load done: %u messages of %d bytes\n", netLoadCount, netLoadPayload);
+      reportState();
+    }
+  }
+#endif
+
+  // Publish the planned-versus-actual summary of completed planned moves.
+  for (int i = 0; i < channelCount; i++) {
+    if (blindChannels[i].plan.Done) {
+      reportMotion(&blindChannels[i]);
+      blindChannels[i].plan.Done = false;
     }
-    char buffer[50];
-    serializeJson(configDoc, buffer);
-    //#clientMQTT.publish(MQTT_PUB_BLINDSSTATE, buffer, true);          // publish retain state ??
-    clientMQTT.publish(MQTT_PUB_BLINDSSTATE, buffer);
-    Serial.println(" - MQTT publish Blinds State: ");  Serial.println(buffer);
-    mqttPublishBlindsState = false;
+  }
+
+  // Publish the motor run journal once a batch of runs is waiting.
+  if ( journalUnpublished >= journalBatchSize && clientMQTT.connected() ) {
+    reportJournal();
   }
 
   // Measure the Temperature if enabled (>0), and it is the first time or if the reporting interval has expired. 
   if ( appConfig.Temp_Interval > 0 ) {
     if  ( lastTempReport == 0 || ( (millis()/1000 - lastTempReport)/60 > appConfig.Temp_Interval ) ) {
+      PROFILE_SECTION(prfSensorReports);
       reportTemperature();
       lastTempReport = millis()/1000;
     }
@@ -1235,330 +2196,832 @@ void loop() {
   // Measure the light if enabled (>0), and it is the first time or if the reporting interval has expired. 
   if ( appConfig.Lux_Interval > 0 ) {
     if  ( lastLuxReport == 0 || ( (millis()/1000 - lastLuxReport)/60 > appConfig.Lux_Interval ) ) {
+      PROFILE_SECTION(prfSensorReports);
       reportLux();
       lastLuxReport = millis()/1000;
     }
   }
 
-  // Feedback ESP32 State and/or WiFi parameters if  enabled (interval>0) and interval has expired.
+  // Feedback ESP32 State and/or WiFi parameters if  enabled (interval>0) and interval has expired (changed values only).
   if ( appConfig.State_Interval > 0 ) {
     if  ( lastStateReport == 0 || (millis()/1000-lastStateReport)/60 > appConfig.State_Interval ) {
+      PROFILE_SECTION(prfStateReport);
       reportState();
       lastStateReport = millis()/1000;
     }
   }
 
-  // Confirm if enough memory allocated to Task to prevent overflowing the stack.
-  // uxTaskGetStackHighWaterMark2(TaskHandle_t &taskLoopMotorActions) 
+  // Republish the full (retained) configuration of each channel once the snapshot interval expired, or the baseline
+  // was dropped (MQTT connect, failed publish).
+  if ( clientMQTT.connected() ) {
+    for (int i = 0; i < channelCount; i++) {
+      if ( deltaSnapshotDue(blindChannels[i].cfgDelta) || deltaSnapshotDue(blindChannels[i].appCfgDelta) ) reportConfig(&blindChannels[i], true);
+    }
+  }
+
+  // Confirm if enough memory allocated to Tasks to prevent overflowing the stack. Also sample heap usage.
+  if ( lastTaskMonitor == 0 || millis()/1000 - lastTaskMonitor > taskMonitorInterval ) {
+    taskMonitorCollect();
+    lastTaskMonitor = millis()/1000;
+  }
 
-  // Check MQTT and reconnect if necessary.
+  // Check MQTT and reconnect if necessary. Not on every pass: the loop keeps serving the HTTP API while the broker is down.
   if ( !clientMQTT.connected() ) {
-    setup_MQTT();
+    if ( lastMqttReconnect == 0 || millis() - lastMqttReconnect > mqttReconnectInterval ) {
+      PROFILE_SECTION(prfMqttReconnect);
+      setup_MQTT();
+      lastMqttReconnect = millis();
+    }
   } else {
+    PROFILE_SECTION(prfMqttLoop);
     clientMQTT.loop();
   }
 }
 
 /**************************************************************************
- *  CheckLimitSwitch
- *  Return true if the specified limit switch is set. 
- * Actions:
- *  - If switch is pulled low, set low bit to "0" and shift register for each function call. True if value = "F000". 
- *  - If switch is released (high), set low bit to "1" for each call.
- * https://www.best-microcontroller-projects.com/easy_switch_debounce.html
- * 
+ *  loop_MotorActions
+ *  This loop task runs in a seperate thread, on the control core (coreMotorTask), above the main loop priority.
+ *  This task will process the motor actions of all channels, based on flags set in interrupt events.
+ *  WiFi and MQTT-related actions are done from the standard main loop. 
+ *  Pauses motorTaskInterval after each pass: a busy task at this priority would starve the main loop.
  **************************************************************************/
-bool CheckLimitSwitch(uint8_t pinLimitSwitch) {
-static uint16_t swc_dbc = 0;
-//static uint16_t lastb = 0;
+void loop_MotorActions (void * parameter) {
 
-   swc_dbc=(swc_dbc<<1) | digitalRead(pinLimitSwitch) | 0xe000;
-//   if (swc_dbc!=lastb) TelnetStream.println(swc_dbc,HEX); 
-//   lastb = swc_dbc;
-   if (swc_dbc==0xf000) {
-     swc_dbc = 0;
-     return true;
-   } else {return false;}
+  if (!watchdogRegister()) {                                // Supervised: task watchdog and heartbeat (MotorWatchdog.h).
+    Serial.println(">>> Motor task: task watchdog not set up, heartbeat supervisor only");
+  }
+  for (;;) {
+    if (groupPending) {
+      groupStart();
+    }
+    if (groupDue) {
+      groupRelease();
+    }
+    bool running = false;
+    for (int i = 0; i < channelCount; i++) {
+      serviceChannel(&blindChannels[i]);
+      running |= blindChannels[i].mtr.IsRunning;
+    }
+    if (otaStatus.Locked) {
+      otaStatus.MotorsStopped = !running;                   // The OTA update waits for this before receiving data.
+    }
+    watchdogFeed();
+#ifdef WATCHDOG_TEST
+    if (simulateHang > 0) {
+      // Simulated hang: keep the task busy without feeding the heartbeat or the task watchdog.
+      unsigned long start = millis();
+      while (millis() - start < (unsigned long) simulateHang) {}
+      simulateHang = 0;
+    }
+#endif
+    vTaskDelay(pdMS_TO_TICKS(motorTaskInterval));
+  }
 }
 
 /**************************************************************************
- *  loop_MotorActions
- *  This loop task runs in a seperate thread, on Core "1" (if run on core 0 then WiFi/MQTT freezes).
- *  This task will process the motor actions, based on flags set in interrupt events.
- *  WiFi and MQTT-related actions are done from the standard main loop. 
+ *  groupStart
+ *  Start the motors of all channels in the pending group move together.
+ *  - All members are started without PWM first, then the first duty cycle is applied to all of them back-to-back.
+ *  - For a "sync" group, the max duty cycle of each member is scaled to its distance (longest move runs at 100%).
+ *    A member clamped at groupMinDuty is held instead, so it arrives with the longest move (groupRelease starts it).
+ *    Without a learned speed it can't be held: it starts with the others and is reported as early.
+ **************************************************************************/
+void groupStart() {
+  BlindChannel* members[maxChannels];
+  int distance[maxChannels];
+  unsigned long hold[maxChannels];
+  int count = 0;
+  int maxDistance = 0;
+
+  for (int i = 0; i < channelCount; i++) {
+    BlindChannel* ch = &blindChannels[i];
+    if ( (groupMembers & (1 << i)) && ch->mqttAction.NewAction && ch->mqttAction.Group ) {
+      if ( !ch->mtr.IsRunning && !(ch->mqttAction.Action == actBlindsOpen ? ch->swcOpen.Set : ch->swcClosed.Set) ) {
+        ch->mtr.Action = ch->mqttAction.Action;
+        ch->mtr.targetPosition = ch->mqttAction.Target;
+        ch->mtr.AllowToRun = true;
+        ch->mtr.Owner = ownMQTT;
+        distance[count] = 0;
+        if (ch->Cfg.Open_MaxRotations > 0 && ch->mtr.currentPosition >= 0 && ch->mtr.targetPosition >= 0) {
+          distance[count] = abs(ch->mtr.targetPosition - ch->mtr.currentPosition);
+        }
+        if (distance[count] > maxDistance) maxDistance = distance[count];
+        members[count++] = ch;
+      }
+      ch->mqttAction.Action = actUNDEF;
+      ch->mqttAction.Group = false;
+      ch->mqttAction.NewAction = false;
+    }
+  }
+
+  // Enable the drivers and start the timers of all members, without applying PWM yet. Held members wait.
+  uint8_t held = 0;
+  uint8_t early = 0;
+  for (int i = 0; i < count; i++) {
+    hold[i] = 0;
+    if (groupSync) {
+      members[i]->dutyMax = groupDutyMax(distance[i], maxDistance);
+      hold[i] = groupHoldTime(distance[i], maxDistance, members[i]->learnedSpeed);
+      if (hold[i] > 0) held |= (1 << members[i]->Index);
+      else if (groupClamped(distance[i], maxDistance)) early |= (1 << members[i]->Index);
+    }
+    if (hold[i] == 0) MotorStart(members[i], false);
+  }
+
+  // Apply the first duty cycle to all started members in one go.
+  uint8_t running = 0;
+  uint32_t firstPwm = ESP.getCycleCount();
+  for (int i = 0; i < count; i++) {
+    if (members[i]->mtr.IsRunning) {
+      MotorApplyPwm(members[i]);
+      running |= (1 << members[i]->Index);
+    }
+  }
+  uint32_t lastPwm = ESP.getCycleCount();
+
+  groupStarted(running, (lastPwm - firstPwm) / getCpuFrequencyMhz(), held, early);
+  for (int i = 0; i < count; i++) {
+    if (hold[i] > 0) wheelArm(members[i]->tmrGroup, hold[i]);
+  }
+  Serial.printf(" - Group move started: channels=0x%02x, sync=%i, held=0x%02x, early=0x%02x\n", running, groupSync, held, early);
+}
+
+/**************************************************************************
+ *  groupRelease
+ *  Start the held members of a "sync" group move whose hold time expired (flagged by tmrGroup).
+ *  - A member that does not start (e.g. OTA update in progress) is dropped from the group move.
+ **************************************************************************/
+void groupRelease() {
+  uint8_t due = groupTakeDue();
+  for (int i = 0; i < channelCount; i++) {
+    if (due & (1 << i)) {
+      BlindChannel* ch = &blindChannels[i];
+      if (!ch->mtr.IsRunning) MotorStart(ch);
+      if (!ch->mtr.IsRunning) groupArrived(i);
+    }
+  }
+}
+
+/**************************************************************************
+ *  groupHoldCancel
+ *  The channel is started or stopped otherwise: drop the hold of a held group move member, if any.
+ **************************************************************************/
+void groupHoldCancel(BlindChannel* ch) {
+  if (groupUnhold(ch->Index)) {
+    wheelCancel(ch->tmrGroup);
+    ch->dutyMax = 255;
+  }
+}
+
+/**************************************************************************
+ *  loop_MotionControl
+ *  Fixed-rate control task (every planControlPeriod ms), on the control core (coreMotionTask) at the highest priority.
+ *  - Measure the wake-up jitter of each tick (app_state "Control Jitter").
+ *  - Learn the motor speed of each running channel.
+ *  - Run the motion planner control step of each channel with a planned move.
+ *  - Update the time-based position estimate of channels without rotation sensor.
+ **************************************************************************/
+void loop_MotionControl (void * parameter) {
+  TickType_t lastWake = xTaskGetTickCount();
+
+  for (;;) {
+    {
+      PROFILE_SECTION(prfMotionControl);
+      for (int i = 0; i < channelCount; i++) {
+        BlindChannel* ch = &blindChannels[i];
+        planLearnSpeed(ch);
+        if (ch->plan.Active) {
+          planControl(ch);
+        }
+        if (deadReckonUpdate(ch, millis())) {
+          // Estimated target position reached (no rotation sensor).
+          xSemaphoreTake(semBlindsCheck, portMAX_DELAY);
+          ch->mtr.AllowToRun = false;
+          flagMotorStop(ch, stpEstimate);
+          xSemaphoreGive(semBlindsCheck);
+        }
+      }
+    }
+    vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(planControlPeriod));
+    taskJitterSample(motionJitter, esp_timer_get_time(), planControlPeriod * 1000);
+  }
+}
+
+/**************************************************************************
+ *  serviceChannel
+ *  Process the motor actions of one blinds channel. Must not block, all channels share the motor task.
  * Actions:
  *  - Run motor up/down based on Up/Down button changes. 
  *  - Run motor up/down based on MQTT requests.
  *  - Stop motor when Open/Close limit switches are triggered, or button released. 
+ *  - Step the motor soft-start.
  **************************************************************************/
-void loop_MotorActions (void * parameter) {
+void serviceChannel(BlindChannel* ch) {
 
-  for (;;) {
+    // --- ROTATIONS --- (pulses counted by isrMotorRotations)
+    MotorRotations(ch);
+
+    // --- SOFT-START ---
+    if ( ch->rampActive ) {
+      MotorRamp(ch);
+    }
+
+    // --- BRAKE RELEASE / STOPPING DISTANCE ---
+    driverService(ch);
 
+    // --- DIRECTION REVERSAL --- (decelerate, dead-time, restart in the other direction)
+    if ( ch->retarget.Phase != rtgNone ) {
+      MotorReverse(ch);
+    }
 
     // --- LIMIT SWITCHES ---
     // Check limit switch states (only) if motor is running. 
-    if ( mtrBlinds.IsRunning ) {
-      if (mtrBlinds.Action == actBlindsClose) {
+    if ( ch->mtr.IsRunning ) {
+      PROFILE_SECTION(prfMotorLimits);
+      if (ch->mtr.Action == actBlindsClose) {
         // CLOSING. Stop if CLOSED switch is set.
-        swcBlindsClosed.Set = CheckLimitSwitch(pin_StopClosed);
-        if (swcBlindsClosed.Set) {
+        ch->swcClosed.Set = ch->swcClosed.Input.State;           // Debounced by onTimerDebounce.
+        if (ch->swcClosed.Set) {
           // Blinds are closed. Stop the motor.
   #ifdef TELNET_DEBUG
           TelnetStream.println(" - loop: CLOSE switch set. Motor STOP");
   #endif
-          mtrBlinds.currentPosition = 0;  // Consider blinds fully closed if bottom limit switch is set.
-          actionStopMotor = true;
-          swcBlindsOpen.Set = false;      // If the CLOSED limit is hit then the blinds can't be open.
+          ch->mtr.currentPosition = 0;  // Consider blinds fully closed if bottom limit switch is set.
+          flagMotorStop(ch, stpLimitClosed);
+          ch->swcOpen.Set = false;      // If the CLOSED limit is hit then the blinds can't be open.
         }
       }
-      else if (mtrBlinds.Action == actBlindsOpen) {
+      else if (ch->mtr.Action == actBlindsOpen) {
         // OPENING. Stop if OPEN switch is set
-        swcBlindsOpen.Set = CheckLimitSwitch(pin_StopOpen);
-        if (swcBlindsOpen.Set) {
+        ch->swcOpen.Set = ch->swcOpen.Input.State;               // Debounced by onTimerDebounce.
+        if (ch->swcOpen.Set) {
           // Blinds are fully open. Stop the motor.
   #ifdef TELNET_DEBUG
           TelnetStream.println(" - loop: OPEN switch set. Motor STOP");
   #endif
-          //mtrBlinds.currentPosition = 100;  // Consider blinds fully opened if top limit switch is set.
-          actionStopMotor = true;
-          swcBlindsClosed.Set = false;      // If the OPEN limit is hit then the blinds can't be closed.
+          //ch->mtr.currentPosition = 100;  // Consider blinds fully opened if top limit switch is set.
+          flagMotorStop(ch, stpLimitOpen);
+          ch->swcClosed.Set = false;      // If the OPEN limit is hit then the blinds can't be closed.
         }
       }
     }
     
 
-    // --- OPEN BUTTON ---
-    if ( btnBlindsOpen.Changed ) {
-      // The OPEN switch status changed.
-      if ( mtrBlinds.IsRunning ) {
-        // The OPEN button status changed while the motor is running. Stop the motor.
-        // This makes it possible to stop the motor by pressing any button (again) in any direction.
-        btnBlindsOpen.lastStopTime = millis();             // Wait sufficient time before reacting to the button again.
-        actionStopMotor = true;
-        btnBlindsOpen.Changed = false;
-  #ifdef TELNET_DEBUG
-        TelnetStream.print(" - loop: OPEN button changed while running. Motor STOP - " );
-        TelnetStream.println(btnBlindsOpen.lastDebounceTime);
-  #endif
-      } else {
-        // The Motor is NOT running.
-        unsigned long MillisNow = millis();
-        if ( MillisNow - btnBlindsOpen.lastStopTime > 1000 ) {
-          swcBlindsOpen.Set = (digitalRead(pin_StopOpen) == LOW);     // Confirm the blinds open status before proceeding
-          if ( digitalRead(pin_BtnOpen) == LOW ) {
-            // OPEN button was PRESSED (buttons are normal high, and will be pulled low when pressed). 
-  #ifdef TELNET_DEBUG
-            TelnetStream.print(" - loop: OPEN BUTTON pressed @ " ); TelnetStream.println(MillisNow);
-            TelnetStream.print(" -   : diff= " ); TelnetStream.println(MillisNow - btnBlindsOpen.lastDebounceTime);
-            TelnetStream.print(" -   : debounced? " ); TelnetStream.println(MillisNow - btnBlindsOpen.lastDebounceTime > appConfig.DebounceDurSwitches);
-  #endif
-            if ( !mtrBlinds.IsRunning && !swcBlindsOpen.Set ) {
-              // Motor is not running, and blinds not fully open (limit switch not set). Ignore rotation position when using button.
-              // START Motor
-              xSemaphoreTake(semBlindsCheck, portMAX_DELAY);
-              mtrBlinds.Action = actBlindsOpen;
-              mtrBlinds.AllowToRun = true;
-              mtrBlinds.Owner = ownButton;
-              xSemaphoreGive(semBlindsCheck);
-              MotorStart();
-            }
-            else {DoBleepTimes=2;}          // Can't run as requested
-          }
-          btnBlindsOpen.Changed = false;
-        }
+    // --- OTA UPDATE --- (control locked: stop the motor, drop pending commands and requests)
+    if ( otaStatus.Locked ) {
+      if ( ch->mtr.IsRunning ) {
+        xSemaphoreTake(semBlindsCheck, portMAX_DELAY);
+        flagMotorStop(ch, stpOTA);
+        xSemaphoreGive(semBlindsCheck);
       }
+      ch->mqttAction.NewAction = false;
+      ch->homing.Request = false;
+      ch->cal.Request = false;
+      ch->presetRequest = false;
     }
 
-
-    // --- CLOSE BUTTON ---
-    if ( btnBlindsClose.Changed ) {
-      // The CLOSE switch status changed.
-      if ( mtrBlinds.IsRunning ) {
-        // The CLOSE button status changed while the motor is running. Stop the motor.
-        // This makes it possible to stop the motor by pressing any button (again) in any direction.
-        btnBlindsClose.lastStopTime = millis();              // Wait sufficient time before reacting to the button again.
-        actionStopMotor = true;
-        btnBlindsClose.Changed = false;
-  #ifdef TELNET_DEBUG
-        TelnetStream.print(" - loop: CLOSED button changed while running. Motor STOP - " );
-        TelnetStream.println(btnBlindsClose.lastDebounceTime);
-  #endif
-      } else {
-        // The Motor is NOT running.
-        if ( millis() - btnBlindsClose.lastStopTime > 1000 ) {
-          swcBlindsClosed.Set = (digitalRead(pin_StopClosed) == LOW);   // Confirm blinds close status before proceeding
-          if ( digitalRead(pin_BtnClose) == LOW ) {
-          // CLOSE button was PRESSED (buttons are normal high, and will be pulled low when pressed). 
-#ifdef TELNET_DEBUG
-            TelnetStream.print(" - loop: CLOSE BUTTON pressed @ " );
-            TelnetStream.println(millis());
-#endif
-            if ( !mtrBlinds.IsRunning && !swcBlindsClosed.Set ) { 
-              // Motor is not running, and blinds not fully closed (limit switch not set). Ignore rotation position when using button.
-              // START Motor
-              xSemaphoreTake(semBlindsCheck, portMAX_DELAY);
-              mtrBlinds.Action = actBlindsClose;
-              mtrBlinds.AllowToRun = true;
-              mtrBlinds.Owner = ownButton;
-              xSemaphoreGive(semBlindsCheck);
-              MotorStart();
-            }
-            else {DoBleepTimes=2;}          // Can't run as requested
-          }
-        } else {
-          TelnetStream.print(" - loop: CLOSE BUTTON ign - pressed @ " ); TelnetStream.println(millis());
-          TelnetStream.print(" - loop:   diff= " ); TelnetStream.println(millis() - btnBlindsClose.lastDebounceTime);
-          TelnetStream.print(" - loop:   config= " ); TelnetStream.println(appConfig.DebounceDurSwitches);
-        }
-        btnBlindsClose.Changed = false;
-      }
-    }
+    // --- BUTTONS --- (gestures: press, click, double-click, hold-to-jog, long-press)
+    MotorButton(ch, &ch->btnOpen, actBlindsOpen);
+    MotorButton(ch, &ch->btnClose, actBlindsClose);
 
 
-    // --- MQTT action received ---
-    if ( mqttBlindsAction.NewAction ) {
+    // --- MQTT action received --- (group moves are started by groupStart)
+    if ( ch->mqttAction.NewAction && !ch->mqttAction.Group ) {
+      PROFILE_SECTION(prfMotorCommands);
+      latencyMark(latPicked);
+      // -- NEW TARGET while an MQTT move is running (or reversing)
+      if ( (ch->mqttAction.Action == actBlindsOpen || ch->mqttAction.Action == actBlindsClose) &&
+           ( (ch->mtr.IsRunning && ch->mtr.Owner == ownMQTT) || ch->retarget.Phase != rtgNone ) ) {
+        retargetMove(ch, ch->mqttAction.Action, ch->mqttAction.Target);
+      }
       // -- OPEN
-      if ( mqttBlindsAction.Action == actBlindsOpen ) {
+      else if ( ch->mqttAction.Action == actBlindsOpen ) {
   #ifdef TELNET_DEBUG
         TelnetStream.println(" - loop: MQTT OPEN blinds" );
   #endif
-        if ( !mtrBlinds.IsRunning && !swcBlindsOpen.Set ) { 
+        if ( !ch->mtr.IsRunning && !ch->swcOpen.Set ) { 
           // Only OPEN the blinds if they are not already opened.
-          mtrBlinds.Action = mqttBlindsAction.Action;
-          mtrBlinds.AllowToRun = true;
-          mtrBlinds.Owner = ownMQTT;
-          MotorStart();
+          ch->mtr.Action = ch->mqttAction.Action;
+          ch->mtr.targetPosition = ch->mqttAction.Target;
+          ch->mtr.AllowToRun = true;
+          ch->mtr.Owner = ownMQTT;
+          MotorStart(ch);
         }
       }
       // -- CLOSE
-      else if ( mqttBlindsAction.Action == actBlindsClose ) {
+      else if ( ch->mqttAction.Action == actBlindsClose ) {
   #ifdef TELNET_DEBUG
         TelnetStream.println(" - loop: MQTT CLOSE blinds" );
   #endif
-        if ( !mtrBlinds.IsRunning && !swcBlindsClosed.Set ) { 
+        if ( !ch->mtr.IsRunning && !ch->swcClosed.Set ) { 
           // Only CLOSE the blinds if they are not already closed.
-          mtrBlinds.Action = actBlindsClose;
-          mtrBlinds.AllowToRun = true;
-          mtrBlinds.Owner = ownMQTT;
-          MotorStart();
+          ch->mtr.Action = actBlindsClose;
+          ch->mtr.targetPosition = ch->mqttAction.Target;
+          ch->mtr.AllowToRun = true;
+          ch->mtr.Owner = ownMQTT;
+          MotorStart(ch);
         }
       } 
       // -- STOP
-      else if ( mqttBlindsAction.Action == actBlindsStop ) {
+      else if ( ch->mqttAction.Action == actBlindsStop ) {
   #ifdef TELNET_DEBUG
         TelnetStream.println(" - loop: MQTT STOP" );
   #endif
-        MotorStop();
+        MotorStop(ch, stpMQTT);
       }
 
-      mqttBlindsAction.Action = actUNDEF;
-      mqttBlindsAction.NewAction = false;
+      ch->mqttAction.Action = actUNDEF;
+      ch->mqttAction.NewAction = false;
     }
 
     // --- A stop was triggered (could be: limit switch, button release, timer, rotation position, current limit)
-    if (actionStopMotor) {
+    if (ch->actionStopMotor) {
+      PROFILE_SECTION(prfMotorStop);
+      stopReason reason;
       xSemaphoreTake(semBlindsCheck, portMAX_DELAY);
-      actionStopMotor = false;
+      reason = ch->actionStopReason;
+      ch->actionStopMotor = false;
+      ch->actionStopReason = stpUNDEF;
       xSemaphoreGive(semBlindsCheck);
-      Serial.printf(" - loop: StopAction.   IsRunning=%i\n", mtrBlinds.IsRunning );
-      MotorStop(); 
+      Serial.printf(" - loop: StopAction ch%d.   IsRunning=%i, Reason=%s\n", ch->Index, ch->mtr.IsRunning, stopReasonName(reason) );
+      MotorStop(ch, reason); 
     }
 
-  }
+    // --- HOMING --- (after the stop, so a completed run is seen in the same pass)
+    if ( ch->homing.Request || ch->homing.Active ) {
+      MotorHoming(ch);
+    }
+
+    // --- TRAVEL CALIBRATION --- (after the stop, so a completed run is seen in the same pass)
+    if ( ch->cal.Request || ch->cal.Phase == calHoming || ch->cal.Phase == calOpening || ch->cal.Phase == calClosing ) {
+      MotorCalibrate(ch);
+    }
 }
 
 /**************************************************************************
  *  MotorStart
- *  - Soft-start the motor in the indicated direction (based on action). 
+ *  - Start the motor in the indicated direction (based on action), at the soft-start duty cycle.
+ *  - The duty cycle is increased to 100% by MotorRamp, from the motor task, so other channels are not blocked.
+ *  - If "applyPwm" is false the driver is enabled but no PWM is applied yet (group move: see MotorApplyPwm).
  **************************************************************************/
-void MotorStart() {
+void MotorStart(BlindChannel* ch, bool applyPwm) {
   int pwmChannel = -1;
-  bool blindsWasClosed = swcBlindsClosed.Set;
+  bool blindsWasClosed = ch->swcClosed.Set;
 
-  if (mtrBlinds.Action == actBlindsOpen ) {
-    pwmChannel = pwmChannel_Open;
-    Serial.print(" => MotorStart OPEN: IsRunning="); Serial.println(mtrBlinds.IsRunning);
-  } else if (mtrBlinds.Action == actBlindsClose) {
-    pwmChannel = pwmChannel_Close;
-    Serial.print(" => MotorStart CLOSE: IsRunning="); Serial.println(mtrBlinds.IsRunning);
-  }
+  groupHoldCancel(ch);                                                                  // Started otherwise while held in a group move.
 
-  if ( mtrBlinds.AllowToRun && !mtrBlinds.IsRunning && pwmChannel > -1 ) {              // Make sure the motor is not running already, and a valid action is set.
-    mtrBlinds.IsRunning = true;
+  if (ch->mtr.Action == actBlindsOpen ) {
+    pwmChannel = ch->pwmChannel_Open;
+    Serial.print(" => MotorStart OPEN: IsRunning="); Serial.println(ch->mtr.IsRunning);
+  } else if (ch->mtr.Action == actBlindsClose) {
+    pwmChannel = ch->pwmChannel_Close;
+    Serial.print(" => MotorStart CLOSE: IsRunning="); Serial.println(ch->mtr.IsRunning);
+  }
 
-//maxCurrent = 0;  // TODO. cleanup.  reset max current for next run
+  if (otaStatus.Locked) {
+    ch->mtr.AllowToRun = false;                                                         // No runs during an OTA update.
+  }
+  if ( ch->mtr.AllowToRun && !ch->mtr.IsRunning && pwmChannel > -1 ) {              // Make sure the motor is not running already, and a valid action is set.
+    ch->mtr.IsRunning = true;
+    journalRunStart(ch->Index, ch->mtr.Owner, ch->mtr.Action, ch->mtr.currentPosition);    // Start recording the run in the motor journal.
+    latencyMark(latStarted);
 
-    if (mtrBlinds.Owner == ownMQTT && appConfig.Open_Duration > 0) {
+    if (ch->mtr.Owner == ownMQTT && ch->Cfg.Open_Duration > 0) {
       // If remotely opened (MQTT), and timeout configured, then set a timer to automatically stop blinds opening after configured duration.
-      timerAlarmWrite(tmrBlindsOpen, (appConfig.Open_Duration * 1000000), false);       // fire timer after x seconds (in micro-seconds). Once.
-      timerRestart(tmrBlindsOpen);                                                      // reset the timer counter.
-      timerAlarmEnable(tmrBlindsOpen);                                                  // start the timer to automatically stop the motor after x seconds. Remove if upper limit switch exists.
+      wheelArm(ch->tmrOpen, ch->Cfg.Open_Duration * 1000UL);                            // (re)start the timer to fire after x seconds (in milliseconds). Once.
     }
-    if (appConfig.MaxRunDuration > 0) {
-      // Start timer to limit max time motor can run.
-      timerAlarmWrite(tmrBlindsMaster, (appConfig.MaxRunDuration * 1000000), false);    // fire timer after x seconds (in micro-seconds). Once.
-      timerRestart(tmrBlindsMaster);                                                    // reset the timer counter.
-      timerAlarmEnable(tmrBlindsMaster);                                                // start the timer to automatically stop the motor after x seconds. Remove if upper limit switch exists.
+    if (ch->Cfg.MaxRunDuration > 0 && ch->mtr.Owner != ownCalibrate) {
+      // Start timer to limit max time motor can run. (Calibration uses its own limit, as it measures the run time)
+      wheelArm(ch->tmrMaster, ch->Cfg.MaxRunDuration * 1000UL);                         // (re)start the timer to fire after x seconds (in milliseconds). Once.
     }
 
     // START MOTOR: Set ENABLE pins on motor driver board (both Left and Right must be enabled for motor to run)
-    digitalWrite(pin_LEN, HIGH);
-    digitalWrite(pin_REN, HIGH);
-    // Do a soft-start. Start with a low PWM dutycycle and increase to 100% over a short period.
-    for (int dutyCycle=50; dutyCycle <= 255; dutyCycle++) {  
-      // Keep checking to ensure the motor was not stopped during the ramp-up.
-      if (mtrBlinds.AllowToRun) {
-        ledcWrite(pwmChannel, dutyCycle);
-        delay(5);
-      } else {
-        // Some interrupt stopped the motor.
-        break;
-      }
+    driverEnable(ch);
+    // Do a soft-start. Start with a low PWM dutycycle, MotorRamp increases it to 100% over a short period.
+    if (ch->mtr.AllowToRun && applyPwm) {
+      MotorApplyPwm(ch);
+      latencyMark(latApplied);                                                          // First duty cycle applied, completes latency trace.
     }
   }
 
   xSemaphoreTake(semBlindsCheck, portMAX_DELAY);
-    swcBlindsClosed.Set = (digitalRead(pin_StopClosed) == LOW);
-    swcBlindsOpen.Set = (digitalRead(pin_StopOpen) == LOW);             
+    ch->swcClosed.Set = (digitalRead(ch->Pin->StopClosed) == LOW);
+    ch->swcOpen.Set = (digitalRead(ch->Pin->StopOpen) == LOW);             
   xSemaphoreGive(semBlindsCheck);
 
-  if (mtrBlinds.IsRunning && blindsWasClosed && mtrBlinds.Action == actBlindsOpen) {
-    mqttPublishBlindsState = true;              // Set flag to publish interim blinds open status.
+  if (ch->mtr.IsRunning && blindsWasClosed && ch->mtr.Action == actBlindsOpen) {
+    ch->publishState = true;              // Set flag to publish interim blinds open status.
   }
-  Serial.print(" - Motor started: IsRunning="); Serial.print(mtrBlinds.IsRunning); 
+  Serial.print(" - Motor started: IsRunning="); Serial.print(ch->mtr.IsRunning); 
   Serial.print(" WasClosed="); Serial.print(blindsWasClosed);
-  Serial.print(" Action="); Serial.println(mtrBlinds.Action);
+  Serial.print(" Action="); Serial.println(ch->mtr.Action);
   
 }
 
+/**************************************************************************
+ *  MotorApplyPwm
+ *  - Apply the first soft-start duty cycle in the direction of the motor action.
+ *  - Start the soft-start ramp, or hand the move to the motion planner if it is a position move.
+ **************************************************************************/
+void MotorApplyPwm(BlindChannel* ch) {
+  ch->dutyCycle = min(rampStartDuty, ch->dutyMax);
+  driverDuty(ch, ch->mtr.Action, ch->dutyCycle);
+  ch->rampSteps = 0;
+  ch->rampActive = !planStart(ch);                        // Position move: the motion planner sets the duty cycle.
+  if (ch->rampActive) wheelArm(ch->tmrRamp, rampStepDuration, rampStepDuration);
+}
+
+/**************************************************************************
+ *  MotorRamp
+ *  - Soft-start step: increase the PWM duty cycle by one for every ramp step counted by tmrRamp, up to dutyMax (100%).
+ *  - Stop ramping if the motor was stopped during the ramp-up.
+ **************************************************************************/
+void MotorRamp(BlindChannel* ch) {
+  if (!ch->mtr.AllowToRun || !ch->mtr.IsRunning) {
+    // Some interrupt stopped the motor.
+    ch->rampActive = false;
+    wheelCancel(ch->tmrRamp);
+    return;
+  }
+
+  portENTER_CRITICAL(&muxWheel);
+  int steps = ch->rampSteps;
+  ch->rampSteps = 0;
+  portEXIT_CRITICAL(&muxWheel);
+  if (steps > 0) {
+    ch->dutyCycle = min(ch->dutyCycle + steps, ch->dutyMax);
+    driverDuty(ch, ch->mtr.Action, ch->dutyCycle);
+    if (ch->dutyCycle >= ch->dutyMax) {
+      ch->rampActive = false;                                   // Full (or group move) speed reached.
+      wheelCancel(ch->tmrRamp);
+    }
+  }
+}
+
+/**************************************************************************
+ *  MotorReverse
+ *  - Step the direction reversal of a retargeted move (retargetStep, MotionPlanner.h). Must not block (shared
+ *    motor task): stop the motor after the deceleration, start it in the new direction after the dead-time.
+ *  - Without a rotation sensor the direction is taken from the position estimate, if there is one.
+ **************************************************************************/
+void MotorReverse(BlindChannel* ch) {
+  int position = (ch->Cfg.Open_MaxRotations > 0) ? ch->mtr.currentPosition : deadReckonPosition(ch);
+
+  switch (retargetStep(ch, position)) {
+    case rtsStop:  MotorStop(ch, stpRetarget); break;
+    case rtsStart: MotorStart(ch); break;
+    default: break;
+  }
+}
+
+/**************************************************************************
+ *  MotorCalibrate
+ *  - Step the travel calibration of the channel. Must not block (shared motor task).
+ *  - Homing: close to the CLOSED limit (skipped if already closed). Opening: run to the OPEN limit.
+ *    Closing: run back to the CLOSED limit. A pause of calPauseTime precedes each run.
+ *  - Each run must end at the expected limit switch, any other stop (button, MQTT stop, current, timeout) fails it.
+ *  - The measurements are taken from the motor journal entry of the run. The main loop stores the result.
+ **************************************************************************/
+void MotorCalibrate(BlindChannel* ch) {
+  Calibration& cal = ch->cal;
+  stopReason failReason = stpUNDEF;
+  bool failed = false;
+
+  if (cal.Request) {
+    cal.Request = false;
+    cal.Abort = false;
+    cal.Saved = false;
+    cal.Rotations = 0;
+    cal.OpenTime = 0;
+    cal.CloseTime = 0;
+    cal.MeanCurrent = 0;
+    cal.PeakCurrent = 0;
+    cal.StartTime = millis();
+    cal.PhaseStart = cal.StartTime;
+    cal.Waiting = true;
+    cal.Phase = (digitalRead(ch->Pin->StopClosed) == LOW) ? calOpening : calHoming;   // Already home: start opening.
+    cal.Publish = true;
+    Serial.printf(" - Calibration ch%d: started (%s)\n", ch->Index, calibrationPhaseName(cal.Phase));
+    return;
+  }
+
+  if (cal.Abort) {
+    cal.Abort = false;
+    if (ch->mtr.IsRunning) MotorStop(ch, stpMQTT);
+    failReason = stpMQTT;
+    failed = true;
+  }
+  else if (cal.Waiting) {
+    if (ch->mtr.IsRunning) {
+      // Something else (e.g. a button) started the motor during the pause.
+      failReason = (ch->mtr.Owner == ownButton) ? stpButton : stpUNDEF;
+      failed = true;
+    } else if (millis() - cal.PhaseStart >= calPauseTime) {
+      ch->mtr.Action = (cal.Phase == calOpening) ? actBlindsOpen : actBlindsClose;
+      ch->mtr.targetPosition = -1;
+      ch->mtr.AllowToRun = true;
+      ch->mtr.Owner = ownCalibrate;
+      MotorStart(ch);
+      if (ch->mtr.IsRunning) {
+        cal.Waiting = false;
+        cal.PhaseStart = millis();
+        cal.Publish = true;
+      } else {
+        failed = true;
+      }
+    }
+  }
+  else if (ch->mtr.IsRunning) {
+    if (millis() - cal.PhaseStart > calMaxTravelTime * 1000UL) {
+      flagMotorStop(ch, stpTimerMaster);                // Limit switch not reached in time. Fails on the next pass.
+    }
+  }
+  else {
+    // The run of this phase stopped. It must have stopped at the expected limit switch.
+    MotorRun run;
+    stopReason expected = (cal.Phase == calOpening) ? stpLimitOpen : stpLimitClosed;
+    if (!journalLastRun(ch->Index, &run)) run.Reason = stpUNDEF;
+    if (run.Reason != expected) {
+      failReason = run.Reason;
+      failed = true;
+    } else {
+      if (run.PeakCurrent > cal.PeakCurrent) cal.PeakCurrent = run.PeakCurrent;
+      if (cal.Phase == calHoming) {
+        cal.Phase = calOpening;
+      } else if (cal.Phase == calOpening) {
+        cal.Rotations = run.Rotations;
+        cal.OpenTime = run.StopTime - run.StartTime;
+        cal.MeanCurrent = run.MeanCurrent;
+        cal.Phase = calClosing;
+      } else {
+        cal.CloseTime = run.StopTime - run.StartTime;
+        cal.Phase = calDone;
+      }
+      Serial.printf(" - Calibration ch%d: %s\n", ch->Index, calibrationPhaseName(cal.Phase));
+      cal.Waiting = true;
+      cal.PhaseStart = millis();
+      cal.Publish = true;
+    }
+  }
+
+  if (failed) {
+    cal.FailReason = failReason;
+    cal.Phase = calFailed;
+    cal.Publish = true;
+    Serial.printf(" - Calibration ch%d: failed (%s)\n", ch->Index, stopReasonName(failReason));
+    DoBleepTimes = 2;
+  }
+}
+
+/**************************************************************************
+ *  MotorRotations
+ *  - Process the rotation pulses counted by isrMotorRotations since the last call, one by one:
+ *    journal, position count, and stop at the max open position or at the target position of an MQTT move.
+ *  - Called from the motor task, every pass and before a stop is processed (so pulses still count in the run direction).
+ **************************************************************************/
+void MotorRotations(BlindChannel* ch) {
+  uint32_t pulses = ch->rotationPulses - ch->rotationSeen;     // Single writer each side: no lock needed.
+  if (pulses == 0) return;
+  ch->rotationSeen += pulses;
+  ch->lastRotationDebounceTime = ch->rotationEdge / 1000;      // Timestamp of the last rotation (millis), for the speed learner.
+
+  if (ch->Cfg.Open_MaxRotations == 0 && ch->mtr.Owner != ownCalibrate) return;
+  // Only care about rotation count if the max rotations is set, or while calibrating (to find it).
+  for (; pulses > 0; pulses--) {
+    journalRotation(ch->Index);
+
+    if (ch->mtr.Action == actBlindsClose) {
+      // Blinds are CLOSING. Decrease rotation count.
+      if (ch->mtr.currentPosition > 0) {
+        ch->mtr.currentPosition--;             // Blinds are closing. Decrease count (only down to zero).
+        Serial.print(" >> Motor: Count Rotations (d) - "); Serial.println(ch->mtr.currentPosition);
+      }
+      if (ch->mtr.currentPosition == 0 && ch->Cfg.RotationLimits && ch->mtr.Owner == ownMQTT) {
+        // The rotation count decreased to zero, and the blinds are now considered closed. (Button close can drop below limit)
+        xSemaphoreTake(semBlindsCheck, portMAX_DELAY);
+        ch->mtr.AllowToRun = false;
+        flagMotorStop(ch, stpRotations);
+        xSemaphoreGive(semBlindsCheck);
+      }
+    } else if (ch->mtr.Action == actBlindsOpen) {
+      // Blinds are OPENING. Increase rotation count.
+      ch->mtr.currentPosition++;               // Blinds are opening. Increase count.
+      Serial.print(" >> Motor: Count Rotations (u) - "); Serial.println(ch->mtr.currentPosition);
+
+      if (ch->mtr.currentPosition >= ch->Cfg.Open_MaxRotations  && ch->Cfg.RotationLimits && ch->mtr.Owner == ownMQTT) {
+        // Blinds are opened by MQTT. Blinds rotation reached full open position. Stop motor. (Button open can exceed count limit)
+        Serial.print(" >> Motor: Stop motor. MAX Open rotations reached. "); Serial.print(ch->mtr.currentPosition);
+        xSemaphoreTake(semBlindsCheck, portMAX_DELAY);
+        ch->mtr.AllowToRun = false;
+        flagMotorStop(ch, stpRotations);
+        xSemaphoreGive(semBlindsCheck);
+      }
+    }
+
+    if (ch->mtr.Owner == ownMQTT && ch->mtr.targetPosition >= 0) {
+      if ( (ch->mtr.currentPosition >= ch->mtr.targetPosition && ch->mtr.Action == actBlindsOpen) || (ch->mtr.currentPosition >= 0 && ch->mtr.currentPosition <= ch->mtr.targetPosition && ch->mtr.Action == actBlindsClose) ) {
+        Serial.print(" >> Motor: Stop motor. TARGET Open rotations reached. "); Serial.println(ch->mtr.currentPosition);
+        // Blinds are opened/closed by MQTT. Blinds reached target position. Stop motor.
+        xSemaphoreTake(semBlindsCheck, portMAX_DELAY);
+        ch->mtr.AllowToRun = false;
+        flagMotorStop(ch, stpRotations);
+        xSemaphoreGive(semBlindsCheck);
+      }
+    }
+  }
+}
+
+/**************************************************************************
+ *  MotorButton
+ *  - Act on the gestures of a button (Gesture.h). Must not block (shared motor task).
+ *  - A press starts the motor in the direction of the button, or stops it if running (any owner, any direction).
+ *  - Hold: jog, the run stops when the button is released. Long-press: the run is latched and continues.
+ *  - Double-click: stop the run started by the first click, and move to the preset position (by the main loop,
+ *    as an MQTT "open:<%>" command). Without a preset, or without a known position, it is a normal press.
+ **************************************************************************/
+void MotorButton(BlindChannel* ch, Button* btn, blindsAction direction) {
+  gestureEvent event = gestureUpdate(btn->Gest, btn->Input, ch->Cfg, esp_timer_get_time());
+  if (event == gesNone || otaStatus.Locked) return;                 // Gestures are dropped during an OTA update.
+
+  PROFILE_SECTION(prfMotorButtons);
+  bool ownRun = ch->mtr.IsRunning && ch->mtr.Owner == ownButton && ch->mtr.Action == direction;
+#ifdef TELNET_DEBUG
+  TelnetStream.print(" - loop: BUTTON " ); TelnetStream.print(direction == actBlindsOpen ? "OPEN " : "CLOSE ");
+  TelnetStream.print(gestureName(event)); TelnetStream.print(" @ "); TelnetStream.println(millis());
+#endif
+
+  switch (event) {
+    case gesDouble :
+      if (ch->Cfg.ButtonPreset >= 0 && (ch->Cfg.Open_MaxRotations > 0 || deadReckonCalibrated(ch)) &&
+          !homingNeeded(ch) && !calibrationActive(ch)) {
+        if (ch->mtr.IsRunning) MotorStop(ch, stpButton);
+        ch->presetRequest = true;
+        break;
+      }
+      [[fallthrough]];                                  // No preset, or the position is not known: handle as a press.
+    case gesPress :
+      if (ch->mtr.IsRunning) {
+        // Pressed while running. Stop the motor.
+        // This makes it possible to stop the motor by pressing any button (again) in any direction.
+        btn->lastStopTime = millis();                   // Wait sufficient time before reacting to the button again.
+        flagMotorStop(ch, stpButton);
+        gestureIgnore(btn->Gest);
+      } else if (millis() - btn->lastStopTime <= 1000) {
+        gestureIgnore(btn->Gest);                       // Too soon after the button stopped the motor.
+      } else {
+        // Confirm the limit switch status before proceeding. Ignore the rotation position when using the buttons.
+        bool atLimit;
+        if (direction == actBlindsOpen) {
+          atLimit = ch->swcOpen.Set = (digitalRead(ch->Pin->StopOpen) == LOW);
+        } else {
+          atLimit = ch->swcClosed.Set = (digitalRead(ch->Pin->StopClosed) == LOW);
+        }
+        if (!atLimit) {
+          // START Motor
+          xSemaphoreTake(semBlindsCheck, portMAX_DELAY);
+          ch->mtr.Action = direction;
+          ch->mtr.AllowToRun = true;
+          ch->mtr.Owner = ownButton;
+          xSemaphoreGive(semBlindsCheck);
+          MotorStart(ch);
+        } else {
+          DoBleepTimes = 2;                             // Can't run as requested
+          gestureIgnore(btn->Gest);
+        }
+      }
+      break;
+
+    case gesJogEnd :
+      if (ownRun) flagMotorStop(ch, stpButton);         // Released while jogging.
+      break;
+
+    case gesLong :
+      if (ownRun) DoBleepTimes = 1;                     // Latched: the run continues after release.
+      break;
+
+    default :
+      break;                                            // Click, hold: the run continues.
+  }
+}
+
+/**************************************************************************
+ *  MotorHoming
+ *  - Run the channel to its reference switch (CLOSED) to re-establish the position. Must not block (shared motor task).
+ *  - Once homed, the queued command (if any) is handed to the normal MQTT action handling.
+ *  - Any stop other than at the CLOSED limit switch (button, MQTT stop, timer, current) fails the homing.
+ **************************************************************************/
+void MotorHoming(BlindChannel* ch) {
+  Homing& homing = ch->homing;
+  bool done = false;
+  stopReason reason = stpUNDEF;
+
+  if (homing.Request) {
+    homing.Request = false;
+    homing.StartTime = millis();
+    homing.Active = true;
+    if (ch->mtr.IsRunning || calibrationActive(ch)) {
+      done = true;                                      // Busy: leave the position to the run in progress.
+    } else if (digitalRead(ch->Pin->StopClosed) == LOW) {
+      ch->mtr.currentPosition = 0;                      // Already at the reference switch.
+      ch->swcClosed.Set = true;
+      done = true;
+      reason = stpLimitClosed;
+    } else {
+      ch->mtr.Action = actBlindsClose;
+      ch->mtr.targetPosition = -1;
+      ch->mtr.AllowToRun = true;
+      ch->mtr.Owner = ownHoming;
+      MotorStart(ch);
+      done = !ch->mtr.IsRunning;
+      Serial.printf(" - Homing ch%d: started (%s)\n", ch->Index, homingModeName(homing.Trigger));
+    }
+  } else if (!ch->mtr.IsRunning) {
+    // The homing run stopped.
+    MotorRun run;
+    reason = journalLastRun(ch->Index, &run) ? run.Reason : stpUNDEF;
+    done = true;
+  }
+
+  if (done) {
+    homing.Active = false;
+    homing.Duration = millis() - homing.StartTime;
+    homing.Success = (reason == stpLimitClosed);
+    homing.FailReason = reason;
+    homing.Publish = true;
+    Serial.printf(" - Homing ch%d: %s (%s, %lums)\n", ch->Index, homing.Success ? "ok" : "failed", stopReasonName(reason), homing.Duration);
+
+    if (homing.Success && homing.QueuedAction != actUNDEF) {
+      // Execute the queued command from the reference position.
+      ch->mqttAction.Target = homing.QueuedTarget;
+      ch->mqttAction.Action = (homing.QueuedTarget > 0) ? actBlindsOpen : actBlindsClose;
+      ch->mqttAction.Group = false;
+      ch->mqttAction.NewAction = true;
+    }
+    homing.QueuedAction = actUNDEF;
+  }
+}
+
+/**************************************************************************
+ *  motorSelfCheck
+ *  - Check the motor side without moving: motor task alive, no channel with both limit switches active,
+ *    no motor driver fault reported. Validates a new OTA image.
+ **************************************************************************/
+bool motorSelfCheck() {
+  bool ok = true;
+
+  if (heartbeatAge(esp_timer_get_time()) > heartbeatTimeout * 1000UL) {
+    Serial.println(" - Self-check: motor task heartbeat missing");
+    ok = false;
+  }
+  for (int i = 0; i < channelCount; i++) {
+    BlindChannel* ch = &blindChannels[i];
+    if (ch->swcOpen.Input.State && ch->swcClosed.Input.State) {
+      Serial.printf(" - Self-check ch%d: both limit switches active\n", ch->Index);
+      ok = false;
+    }
+    if (ch->Pin->Fault >= 0 && digitalRead(ch->Pin->Fault) == LOW) {
+      Serial.printf(" - Self-check ch%d: motor driver fault\n", ch->Index);
+      ok = false;
+    }
+  }
+  return ok;
+}
+
 /**************************************************************************
  *  MotorStop
  *  - Stop the motor e.g. when a limit switch was triggered.
  *  - Read limit switches to sync status with reality again.
+ *  - Record the completed run (and why it stopped) in the motor journal.
  *  - Set flag to publish Blinds status.
  **************************************************************************/
-void MotorStop() {
-  bool wasMotorRunning = mtrBlinds.IsRunning;
-  // Disable both Right and Left "enable" Pins on motor driver board, and disable PWM. 
+void MotorStop(BlindChannel* ch, stopReason reason) {
+  MotorRotations(ch);                                               // Count the last pulses of the run in its direction.
+  bool wasMotorRunning = ch->mtr.IsRunning;
+  // Stop the motor driver: coast (enable pins low) or brake, and disable PWM. 
   // (always do without checks, as safety measure).
-  digitalWrite(pin_REN, LOW);                                       // Set driver card enable pins low to immediately stop the motor.
-  digitalWrite(pin_LEN, LOW);                                       // Set driver card enable pins low to immediately stop the motor.
-  ledcWrite(pwmChannel_Open, 0);                                    // Stop the "OPEN" PWM channel.
-  ledcWrite(pwmChannel_Close, 0);                                   // Stop the "CLOSE" PWM channel.
-  timerStop(tmrBlindsOpen);                                         // Stop the "open" timer, just in case.
-  timerStop(tmrBlindsMaster);                                       // Stop the "master" timer, just in case.
+  planStop(ch);                                                     // End a planned move, so the planner no longer sets the duty cycle.
+  driverStop(ch, wasMotorRunning);                                  // Coast or brake, and measure the stopping distance.
+  ch->rampActive = false;                                           // Abort any soft-start in progress.
+  wheelCancel(ch->tmrRamp);
+  ch->dutyMax = 255;                                                // Next run at full speed, unless a group move scales it.
+  wheelCancel(ch->tmrOpen);                                         // Stop the "open" timer, just in case.
+  wheelCancel(ch->tmrMaster);                                       // Stop the "master" timer, just in case.
+  groupHoldCancel(ch);                                              // A stop also cancels a held group move start.
   // Reconfirm current situation.
   xSemaphoreTake(semBlindsCheck, portMAX_DELAY);
-    swcBlindsClosed.Set = (digitalRead(pin_StopClosed) == LOW);     // If limit switch closed then normal high is pulled low.
-    swcBlindsOpen.Set = (digitalRead(pin_StopOpen) == LOW);         // If limit switch closed then normal high is pulled low.
-    mtrBlinds.IsRunning = false;                                    // Clear flag that motor is running. Now it can be started again.
-    mtrBlinds.Owner = ownUNDEF;                                     // Clear the previous motor action initiator.
-    mtrBlinds.Action = actUNDEF;                                    // Clear the previous motor aciton.
+    ch->swcClosed.Set = (digitalRead(ch->Pin->StopClosed) == LOW);     // If limit switch closed then normal high is pulled low.
+    ch->swcOpen.Set = (digitalRead(ch->Pin->StopOpen) == LOW);         // If limit switch closed then normal high is pulled low.
+    ch->mtr.IsRunning = false;                                    // Clear flag that motor is running. Now it can be started again.
+    ch->mtr.Owner = ownUNDEF;                                     // Clear the previous motor action initiator.
+    ch->mtr.Action = actUNDEF;                                    // Clear the previous motor aciton.
   xSemaphoreGive(semBlindsCheck);
+  if (reason == stpLimitClosed) ch->mtr.currentPosition = 0;       // Also if the limit switch interrupt stopped the motor first.
+  journalRunStop(ch->Index, reason, ch->mtr.currentPosition);                // Complete the journal record of this run (if the motor was running).
+  groupArrived(ch->Index);                                          // Record the arrival if the channel is part of a group move.
+  if (reason != stpRetarget) ch->retarget.Phase = rtgNone;          // Any other stop cancels a direction reversal in progress.
 
-  mqttPublishBlindsState = true;                                    // Always publish the latest/updated state, regardless if motor was running.
-  Serial.printf(" => MotorStop: Closed=%i, FullOpen=%i, WasRunning=%i\n", swcBlindsClosed.Set, swcBlindsOpen.Set, wasMotorRunning);
+  ch->publishState = true;                                    // Always publish the latest/updated state, regardless if motor was running.
+  Serial.printf(" => MotorStop: Closed=%i, FullOpen=%i, WasRunning=%i, Reason=%s\n", ch->swcClosed.Set, ch->swcOpen.Set, wasMotorRunning, stopReasonName(reason));
 }
 
 /**************************************************************************
@@ -0,0 +1,20 @@
+/*******************************************************************************
+ * HostTest
+ * - Minimal checks for the host tests: CHECK counts and reports a failure and goes on, hostTestDone prints the
+ *   result and gives the exit code of the test.
+********************************************************************************/
+#pragma once
+#include <stdio.h>
+
+inline int hostChecks = 0;
+inline int hostFailures = 0;
+
+#define CHECK(condition) do { \
+    hostChecks++; \
+    if (!(condition)) { hostFailures++; printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); } \
+  } while (0)
+
+inline int hostTestDone(const char* name) {
+  printf("%s: %d checks, %d failed\n", name, hostChecks, hostFailures);
+  return hostFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+/*******************************************************************************
+ * Arduino (host shim)
+ * - The parts of the Arduino core and FreeRTOS the host tests use, on a fake clock: hostClock (microseconds)
+ *   only moves when a test advances it. Critical sections are no-ops (the tests are single threaded).
+ * - Serial output is dropped unless HOST_VERBOSE is set in the environment.
+********************************************************************************/
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+using std::min; using std::max;
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+inline uint64_t hostClock = 0;                                    // Fake time (us).
+inline void hostAdvance(uint64_t us) { hostClock += us; }
+inline unsigned long millis() { return (unsigned long) (hostClock / 1000); }
+inline unsigned long micros() { return (unsigned long) hostClock; }
+inline void (*hostDelayHook)() = nullptr;                         // Called on every delay (another task's work).
+inline void delay(unsigned long ms) { hostAdvance(ms * 1000); if (hostDelayHook) hostDelayHook(); }
+
+class String {
+  std::string S;
+public:
+  String(const char* s = "") : S(s) {}
+  String(const std::string& s) : S(s) {}
+  String(int value) : S(std::to_string(value)) {}
+  String(long value) : S(std::to_string(value)) {}
+  String(unsigned long value) : S(std::to_string(value)) {}
+  const char* c_str() const { return S.c_str(); }
+  unsigned int length() const { return S.size(); }
+  int indexOf(char c, unsigned int from = 0) const { auto i = S.find(c, from); return i == std::string::npos ? -1 : (int) i; }
+  int indexOf(const char* s, unsigned int from = 0) const { auto i = S.find(s, from); return i == std::string::npos ? -1 : (int) i; }
+  String substring(unsigned int from) const { return from >= S.size() ? String() : String(S.substr(from)); }
+  String substring(unsigned int from, unsigned int to) const { return from >= S.size() || to <= from ? String() : String(S.substr(from, to - from)); }
+  long toInt() const { return atol(S.c_str()); }
+  char charAt(unsigned int i) const { return i < S.size() ? S[i] : 0; }
+  bool operator==(const char* s) const { return S == s; }
+  bool operator==(const String& s) const { return S == s.S; }
+  bool operator!=(const char* s) const { return S != s; }
+  String operator+(const String& s) const { return String(S + s.S); }
+  String& operator+=(const String& s) { S += s.S; return *this; }
+  friend String operator+(const char* a, const String& b) { return String(a + b.S); }
+};
+
+typedef struct { int Locked; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+inline void portENTER_CRITICAL(portMUX_TYPE* m) { m->Locked++; }
+inline void portEXIT_CRITICAL(portMUX_TYPE* m) { m->Locked--; }
+inline void portENTER_CRITICAL_ISR(portMUX_TYPE* m) { m->Locked++; }
+inline void portEXIT_CRITICAL_ISR(portMUX_TYPE* m) { m->Locked--; }
+
+inline uint32_t hostCpuMhz = 240;
+inline uint32_t getCpuFrequencyMhz() { return hostCpuMhz; }
+class EspClass {
+public:
+  uint32_t getCycleCount() { return (uint32_t) (hostClock * hostCpuMhz); }      // Wraps like CCOUNT.
+};
+inline EspClass ESP;
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+inline int hostPin[40];                                           // Output level per GPIO.
+inline int hostLedc[16];                                          // Duty cycle per LEDC channel.
+inline void pinMode(int, int) {}
+inline void digitalWrite(int pin, int level) { hostPin[pin] = level; }
+inline int digitalRead(int pin) { return hostPin[pin]; }
+inline void ledcSetup(int, int, int) {}
+inline void ledcAttachPin(int, int) {}
+inline void ledcWrite(int channel, int duty) { hostLedc[channel] = duty; }
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef void* TaskHandle_t;
+inline TaskHandle_t hostTask = (TaskHandle_t) 1;                  // The task a test runs as.
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return hostTask; }
+inline uint32_t hostStackFree[8];                                 // Stack high-water mark per task handle (bytes).
+inline uint32_t uxTaskGetStackHighWaterMark(TaskHandle_t task) { return hostStackFree[(intptr_t) task]; }
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* data, size_t size) {
+    for (size_t i = 0; i < size; i++) write(data[i]);
+    return size;
+  }
+  size_t print(const char* s) { return write((const uint8_t*) s, strlen(s)); }
+  size_t println(const char* s = "") { return print(s) + print("\n"); }
+  size_t println(const String& s) { return println(s.c_str()); }
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    return print(line) * (n >= 0);
+  }
+};
+
+class HostSerial : public Print {
+public:
+  size_t write(uint8_t c) override {
+    static bool verbose = getenv("HOST_VERBOSE") != NULL;
+    if (verbose) putchar(c);
+    return 1;
+  }
+};
+inline HostSerial Serial;
+
+// Hardware timers: one alarm per timer, called by the test (hostTimerTick) instead of an interrupt.
+struct hw_timer_t { void (*Isr)(); uint64_t Alarm; bool Enabled; };
+inline hw_timer_t hostTimer[4];
+inline hw_timer_t* timerBegin(uint8_t num, uint16_t, bool) { return &hostTimer[num]; }
+inline void timerAttachInterrupt(hw_timer_t* timer, void (*fn)(), bool) { timer->Isr = fn; }
+inline void timerAlarmWrite(hw_timer_t* timer, uint64_t alarm, bool) { timer->Alarm = alarm; }
+inline void timerAlarmEnable(hw_timer_t* timer) { timer->Enabled = true; }
+inline void hostTimerTick() {                                     // Call the ISR of each timer whose alarm is due.
+  for (hw_timer_t& t : hostTimer) if (t.Enabled && t.Alarm && hostClock % t.Alarm == 0) t.Isr();
+}
@@ -0,0 +1,342 @@
+/*******************************************************************************
+ * ArduinoJson (host shim)
+ * - The subset of ArduinoJson 6 the firmware headers use: documents, objects, arrays, values, serializeJson and
+ *   measureJson. Nodes live on the heap, but the document counts the memory ArduinoJson would use on the ESP32
+ *   (16 bytes per value, copied strings) and refuses what does not fit, setting overflowed() like the library.
+ * - Strings passed as const char* are kept by pointer (not counted), char* and String are copied.
+********************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+class JsonDocument;
+
+struct JsonNode {
+  enum Kind { Null, Bool, Int, Float, Text, Object, Array } Type = Null;
+  bool B = false;
+  long long I = 0;
+  double F = 0;
+  std::string S;
+  std::vector<std::pair<const char*, std::unique_ptr<JsonNode>>> Members;   // Keys are kept by the document.
+  std::vector<std::unique_ptr<JsonNode>> Items;
+  JsonDocument* Doc = nullptr;
+};
+
+class JsonDocument {
+public:
+  explicit JsonDocument(size_t capacity) : Capacity(capacity) { Root.Doc = this; }
+  JsonDocument(const JsonDocument&) = delete;
+
+  bool reserve(size_t bytes) {
+    if (Used + bytes > Capacity) { Overflowed = true; return false; }
+    Used += bytes;
+    return true;
+  }
+  void clear() { Root = JsonNode(); Root.Doc = this; Keys.clear(); Used = 0; Overflowed = false; }
+  // Key storage that stays valid until the document is cleared, like the memory pool (remove does not free it).
+  const char* keep(const char* key) { Keys.emplace_back(key); return Keys.back().c_str(); }
+  bool overflowed() const { return Overflowed; }
+  size_t memoryUsage() const { return Used; }
+  size_t capacity() const { return Capacity; }
+
+  template <typename T> T to();
+  template <typename T> T as();
+
+  JsonNode Root;
+
+private:
+  std::deque<std::string> Keys;
+  size_t Capacity;
+  size_t Used = 0;
+  bool Overflowed = false;
+};
+
+template <size_t N>
+class StaticJsonDocument : public JsonDocument {
+public:
+  StaticJsonDocument() : JsonDocument(N) {}
+};
+
+class DynamicJsonDocument : public JsonDocument {
+public:
+  explicit DynamicJsonDocument(size_t capacity) : JsonDocument(capacity) {}
+};
+
+const size_t jsonSlotSize = 16;                   // Size of a value (and its key) in ArduinoJson on a 32-bit MCU.
+
+class JsonString {
+public:
+  JsonString(const char* s = nullptr) : S(s) {}
+  const char* c_str() const { return S; }
+  bool operator==(const char* other) const { return S && other && strcmp(S, other) == 0; }
+private:
+  const char* S;
+};
+
+class JsonObject;
+class JsonArray;
+
+class JsonVariant {
+public:
+  JsonVariant(JsonNode* node = nullptr) : Node(node) {}
+
+  bool isNull() const { return Node == nullptr || Node->Type == JsonNode::Null; }
+  JsonNode* node() const { return Node; }
+
+  JsonVariant& operator=(bool value) { if (Node) { reset(); Node->Type = JsonNode::Bool; Node->B = value; } return *this; }
+  JsonVariant& operator=(double value) { if (Node) { reset(); Node->Type = JsonNode::Float; Node->F = value; } return *this; }
+  JsonVariant& operator=(float value) { return *this = (double) value; }
+  JsonVariant& operator=(const char* value) { if (Node) { reset(); Node->Type = JsonNode::Text; Node->S = value ? value : ""; } return *this; }
+  JsonVariant& operator=(char* value) { return copyText(value); }
+  JsonVariant& operator=(const String& value) { return copyText(value.c_str()); }
+  template <size_t N> JsonVariant& operator=(char (&value)[N]) { return copyText(value); }
+  template <typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+  JsonVariant& operator=(T value) { if (Node) { reset(); Node->Type = JsonNode::Int; Node->I = (long long) value; } return *this; }
+  JsonVariant& operator=(const JsonVariant& other) { if (Node && other.Node && Node != other.Node) copyFrom(*other.Node); return *this; }
+
+  template <typename T> T as() const;
+  JsonVariant operator[](const char* key) const;
+  JsonVariant operator[](int i) const;
+
+private:
+  void reset() { Node->Members.clear(); Node->Items.clear(); Node->S.clear(); }
+  JsonVariant& copyText(const char* value) {
+    if (Node && Node->Doc->reserve(strlen(value) + 1)) { reset(); Node->Type = JsonNode::Text; Node->S = value; }
+    return *this;
+  }
+  void copyFrom(const JsonNode& source);
+
+  JsonNode* Node;
+};
+
+class JsonPair {
+public:
+  JsonPair(const std::pair<const char*, std::unique_ptr<JsonNode>>* member) : Member(member) {}
+  JsonString key() const { return JsonString(Member->first); }
+  JsonVariant value() const { return JsonVariant(Member->second.get()); }
+private:
+  const std::pair<const char*, std::unique_ptr<JsonNode>>* Member;
+};
+
+inline JsonNode* jsonNewNode(JsonDocument* doc) {
+  if (!doc->reserve(jsonSlotSize)) return nullptr;
+  JsonNode* node = new JsonNode();
+  node->Doc = doc;
+  return node;
+}
+
+class JsonArray {
+public:
+  JsonArray(JsonNode* node = nullptr) : Node(node && node->Type == JsonNode::Array ? node : nullptr) {}
+  bool isNull() const { return Node == nullptr; }
+  size_t size() const { return Node ? Node->Items.size() : 0; }
+  operator JsonVariant() const { return JsonVariant(Node); }
+
+  template <typename T> bool add(const T& value) {
+    JsonVariant item = addItem();
+    if (item.node() == nullptr) return false;
+    item = value;
+    return true;
+  }
+  bool add(const char* value) { JsonVariant item = addItem(); item = value; return item.node() != nullptr; }
+  JsonObject createNestedObject();
+  JsonArray createNestedArray();
+  JsonVariant operator[](size_t i) const { return Node && i < Node->Items.size() ? JsonVariant(Node->Items[i].get()) : JsonVariant(); }
+
+private:
+  JsonVariant addItem() {
+    if (!Node) return JsonVariant();
+    JsonNode* item = jsonNewNode(Node->Doc);
+    if (!item) return JsonVariant();
+    Node->Items.emplace_back(item);
+    return JsonVariant(item);
+  }
+  JsonNode* Node;
+};
+
+class JsonObject {
+public:
+  class iterator {
+  public:
+    iterator(JsonNode* node, size_t i) : Node(node), I(i) {}
+    JsonPair operator*() const { return JsonPair(&Node->Members[I]); }
+    iterator& operator++() { I++; return *this; }
+    bool operator!=(const iterator& other) const { return I != other.I; }
+  private:
+    JsonNode* Node;
+    size_t I;
+  };
+
+  JsonObject(JsonNode* node = nullptr) : Node(node && node->Type == JsonNode::Object ? node : nullptr) {}
+  bool isNull() const { return Node == nullptr; }
+  size_t size() const { return Node ? Node->Members.size() : 0; }
+  operator JsonVariant() const { return JsonVariant(Node); }
+
+  iterator begin() const { return iterator(Node, 0); }
+  iterator end() const { return iterator(Node, Node ? Node->Members.size() : 0); }
+
+  JsonVariant operator[](const char* key) const { return member(key, true); }
+  JsonVariant operator[](const String& key) const { return member(key.c_str(), true); }
+  JsonVariant operator[](JsonString key) const { return member(key.c_str(), true); }
+  bool containsKey(const char* key) const { return !member(key, false).isNull(); }
+
+  void remove(const char* key) {
+    if (!Node) return;
+    for (size_t i = 0; i < Node->Members.size(); i++) {
+      if (strcmp(Node->Members[i].first, key) == 0) { Node->Members.erase(Node->Members.begin() + i); return; }
+    }
+  }
+
+  JsonObject createNestedObject(const char* key) const {
+    JsonVariant v = member(key, true);
+    if (!v.node()) return JsonObject();
+    v.node()->Type = JsonNode::Object;
+    return JsonObject(v.node());
+  }
+  JsonArray createNestedArray(const char* key) const {
+    JsonVariant v = member(key, true);
+    if (!v.node()) return JsonArray();
+    v.node()->Type = JsonNode::Array;
+    return JsonArray(v.node());
+  }
+
+private:
+  // An existing member, or a new (null) member when create is set and the document has room.
+  JsonVariant member(const char* key, bool create) const {
+    if (!Node) return JsonVariant();
+    for (auto& m : Node->Members) {
+      if (strcmp(m.first, key) == 0) return JsonVariant(m.second.get());
+    }
+    if (!create) return JsonVariant();
+    JsonNode* value = jsonNewNode(Node->Doc);
+    if (!value) return JsonVariant();
+    Node->Members.emplace_back(Node->Doc->keep(key), std::unique_ptr<JsonNode>(value));
+    return JsonVariant(value);
+  }
+  JsonNode* Node;
+};
+
+inline JsonObject JsonArray::createNestedObject() {
+  JsonVariant item = addItem();
+  if (!item.node()) return JsonObject();
+  item.node()->Type = JsonNode::Object;
+  return JsonObject(item.node());
+}
+
+inline JsonArray JsonArray::createNestedArray() {
+  JsonVariant item = addItem();
+  if (!item.node()) return JsonArray();
+  item.node()->Type = JsonNode::Array;
+  return JsonArray(item.node());
+}
+
+inline void JsonVariant::copyFrom(const JsonNode& source) {
+  reset();
+  Node->Type = source.Type;
+  Node->B = source.B;
+  Node->I = source.I;
+  Node->F = source.F;
+  if (source.Type == JsonNode::Text && !Node->Doc->reserve(source.S.size() + 1)) { Node->Type = JsonNode::Null; return; }
+  Node->S = source.S;
+  if (source.Type == JsonNode::Object) {
+    JsonObject target(Node);
+    for (auto& m : source.Members) target[m.first] = JsonVariant(m.second.get());
+  } else if (source.Type == JsonNode::Array) {
+    for (auto& item : source.Items) {
+      JsonNode* copy = jsonNewNode(Node->Doc);
+      if (!copy) return;
+      Node->Items.emplace_back(copy);
+      JsonVariant target(copy);
+      target = JsonVariant(item.get());
+    }
+  }
+}
+
+inline JsonVariant JsonVariant::operator[](const char* key) const { return JsonObject(Node)[key]; }
+inline JsonVariant JsonVariant::operator[](int i) const { return JsonArray(Node)[(size_t) i]; }
+
+template <> inline JsonObject JsonDocument::to<JsonObject>() { clear(); Root.Type = JsonNode::Object; return JsonObject(&Root); }
+template <> inline JsonArray JsonDocument::to<JsonArray>() { clear(); Root.Type = JsonNode::Array; return JsonArray(&Root); }
+template <> inline JsonObject JsonDocument::as<JsonObject>() { return JsonObject(&Root); }
+template <> inline JsonArray JsonDocument::as<JsonArray>() { return JsonArray(&Root); }
+
+template <> inline long JsonVariant::as<long>() const { return !Node ? 0 : Node->Type == JsonNode::Float ? (long) Node->F : (long) Node->I; }
+template <> inline int JsonVariant::as<int>() const { return (int) as<long>(); }
+template <> inline unsigned JsonVariant::as<unsigned>() const { return (unsigned) as<long>(); }
+template <> inline double JsonVariant::as<double>() const { return !Node ? 0 : Node->Type == JsonNode::Float ? Node->F : (double) Node->I; }
+template <> inline float JsonVariant::as<float>() const { return (float) as<double>(); }
+template <> inline bool JsonVariant::as<bool>() const { return Node && (Node->Type == JsonNode::Bool ? Node->B : Node->I != 0); }
+template <> inline const char* JsonVariant::as<const char*>() const { return Node && Node->Type == JsonNode::Text ? Node->S.c_str() : nullptr; }
+template <> inline JsonObject JsonVariant::as<JsonObject>() const { return JsonObject(Node); }
+template <> inline JsonArray JsonVariant::as<JsonArray>() const { return JsonArray(Node); }
+
+// Serialization, compact like serializeJson.
+inline void jsonWrite(const JsonNode* node, std::string& out) {
+  char number[32];
+  if (!node) { out += "null"; return; }
+  switch (node->Type) {
+    case JsonNode::Null:  out += "null"; break;
+    case JsonNode::Bool:  out += node->B ? "true" : "false"; break;
+    case JsonNode::Int:   out += std::to_string(node->I); break;
+    case JsonNode::Float: snprintf(number, sizeof(number), "%.9g", node->F); out += number; break;
+    case JsonNode::Text:
+      out += '"';
+      for (char c : node->S) {
+        switch (c) {
+          case '"':  out += "\\\""; break;
+          case '\\': out += "\\\\"; break;
+          case '\n': out += "\\n"; break;
+          case '\r': out += "\\r"; break;
+          case '\t': out += "\\t"; break;
+          default:   out += c;
+        }
+      }
+      out += '"';
+      break;
+    case JsonNode::Object:
+      out += '{';
+      for (size_t i = 0; i < node->Members.size(); i++) {
+        if (i > 0) out += ',';
+        JsonNode key;
+        key.Type = JsonNode::Text;
+        key.S = node->Members[i].first;
+        jsonWrite(&key, out);
+        out += ':';
+        jsonWrite(node->Members[i].second.get(), out);
+      }
+      out += '}';
+      break;
+    case JsonNode::Array:
+      out += '[';
+      for (size_t i = 0; i < node->Items.size(); i++) {
+        if (i > 0) out += ',';
+        jsonWrite(node->Items[i].get(), out);
+      }
+      out += ']';
+      break;
+  }
+}
+
+inline std::string jsonText(JsonVariant v) { std::string out; jsonWrite(v.node(), out); return out; }
+inline std::string jsonText(JsonDocument& doc) { std::string out; jsonWrite(&doc.Root, out); return out; }
+
+inline size_t serializeJson(JsonVariant v, Print& out) { std::string s = jsonText(v); return out.write((const uint8_t*) s.data(), s.size()); }
+inline size_t serializeJson(JsonObject v, Print& out) { return serializeJson((JsonVariant) v, out); }
+inline size_t serializeJson(JsonArray v, Print& out) { return serializeJson((JsonVariant) v, out); }
+inline size_t serializeJson(JsonDocument& doc, Print& out) { return serializeJson(JsonVariant(&doc.Root), out); }
+
+// Like the library: writes at most size-1 characters and a terminator, returns the characters written.
+inline size_t serializeJson(JsonDocument& doc, char* buffer, size_t size) {
+  std::string s = jsonText(doc);
+  if (size == 0) return 0;
+  size_t n = std::min(s.size(), size - 1);
+  memcpy(buffer, s.data(), n);
+  buffer[n] = 0;
+  return n;
+}
+
+inline size_t measureJson(JsonDocument& doc) { return jsonText(doc).size(); }
+inline size_t measureJson(JsonVariant v) { return jsonText(v).size(); }
@@ -0,0 +1,25 @@
+/*******************************************************************************
+ * ArduinoOTA (host shim)
+ * - Only what OTA.h needs to build: no invitations are ever received.
+********************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <functional>
+
+typedef enum {OTA_AUTH_ERROR, OTA_BEGIN_ERROR, OTA_CONNECT_ERROR, OTA_RECEIVE_ERROR, OTA_END_ERROR} ota_error_t;
+#define U_FLASH 0
+#define U_SPIFFS 100
+
+class ArduinoOTAClass {
+public:
+  ArduinoOTAClass& onStart(std::function<void()>) { return *this; }
+  ArduinoOTAClass& onEnd(std::function<void()>) { return *this; }
+  ArduinoOTAClass& onProgress(std::function<void(unsigned int, unsigned int)>) { return *this; }
+  ArduinoOTAClass& onError(std::function<void(ota_error_t)>) { return *this; }
+  void setHostname(const char*) {}
+  void setRebootOnSuccess(bool) {}
+  void begin() {}
+  void handle() {}
+  int getCommand() { return U_FLASH; }
+};
+inline ArduinoOTAClass ArduinoOTA;
@@ -0,0 +1,5 @@
+/*******************************************************************************
+ * ESPmDNS (host shim)
+ * - Nothing used by the tested code.
+********************************************************************************/
+#pragma once
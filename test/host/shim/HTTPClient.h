@@ -0,0 +1,38 @@
+/*******************************************************************************
+ * HTTPClient (host shim)
+ * - GET answers hostHttp: status code, Content-Length (the size of the stream data unless set) and headers.
+ *   The body is the WiFiClient stream (hostStream). The URL of the last request is kept.
+********************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+#include <map>
+
+#define HTTP_CODE_OK 200
+
+struct HostHttp {
+  int Code = HTTP_CODE_OK;
+  int Size = -1;                                  // Content-Length, -1 = size of hostStream.Data.
+  std::map<std::string, std::string> Headers;     // Response headers.
+  std::string Url;                                // URL of the last request.
+};
+inline HostHttp hostHttp;
+
+class HTTPClient {
+public:
+  bool begin(const char* url) { hostHttp.Url = url; return true; }
+  void collectHeaders(const char* keys[], size_t count) { _keys.assign(keys, keys + count); }
+  int GET() { hostStream.Offset = 0; hostStream.ReadCount = 0; return hostHttp.Code; }
+  int getSize() { return hostHttp.Size >= 0 ? hostHttp.Size : (int) hostStream.Data.size(); }
+  String header(const char* name) {
+    bool collected = std::find(_keys.begin(), _keys.end(), std::string(name)) != _keys.end();
+    auto h = hostHttp.Headers.find(name);
+    return collected && h != hostHttp.Headers.end() ? String(h->second) : String();
+  }
+  WiFiClient* getStreamPtr() { return &_client; }
+  void end() {}
+
+private:
+  std::vector<std::string> _keys;
+  WiFiClient _client;
+};
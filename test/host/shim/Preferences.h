@@ -0,0 +1,44 @@
+/*******************************************************************************
+ * Preferences (host shim)
+ * - NVS namespaces kept in hostNvs, which outlives the Preferences object: a "reboot" in a test is reading
+ *   them back with a new Preferences. Only the types the firmware stores are supported.
+********************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <map>
+#include <string>
+
+inline std::map<std::string, std::map<std::string, std::string>> hostNvs;
+
+class Preferences {
+  std::string Namespace;
+  bool ReadOnly = true;
+  bool Open = false;
+
+  const std::string* find(const char* key) {
+    auto ns = hostNvs.find(Namespace);
+    if (!Open || ns == hostNvs.end()) return NULL;
+    auto value = ns->second.find(key);
+    return value == ns->second.end() ? NULL : &value->second;
+  }
+  size_t put(const char* key, const std::string& value) {
+    if (!Open || ReadOnly) return 0;
+    hostNvs[Namespace][key] = value;
+    return value.size();
+  }
+
+public:
+  bool begin(const char* name, bool readOnly = false) { Namespace = name; ReadOnly = readOnly; Open = true; return true; }
+  void end() { Open = false; }
+  bool clear() { if (!Open || ReadOnly) return false; hostNvs.erase(Namespace); return true; }
+
+  size_t putInt(const char* key, int value) { return put(key, std::to_string(value)); }
+  size_t putBool(const char* key, bool value) { return put(key, value ? "1" : "0"); }
+  size_t putFloat(const char* key, float value) { return put(key, std::to_string(value)); }
+  size_t putString(const char* key, const char* value) { return put(key, value); }
+
+  int getInt(const char* key, int defaultValue = 0) { auto v = find(key); return v ? atoi(v->c_str()) : defaultValue; }
+  bool getBool(const char* key, bool defaultValue = false) { auto v = find(key); return v ? *v == "1" : defaultValue; }
+  float getFloat(const char* key, float defaultValue = 0) { auto v = find(key); return v ? atof(v->c_str()) : defaultValue; }
+  bool isKey(const char* key) { return find(key) != NULL; }
+};
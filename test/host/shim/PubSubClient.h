@@ -0,0 +1,54 @@
+/*******************************************************************************
+ * PubSubClient (host shim)
+ * - The publish calls of the library, on a fake socket that records each write: beginPublish writes the header,
+ *   write goes straight to the socket, endPublish checks the length announced. publish copies the header and the
+ *   payload into the client buffer and writes that once, and fails if it does not fit (like the library).
+********************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <string>
+#include <vector>
+
+const int hostMqttMaxHeader = 5;                                  // MQTT_MAX_HEADER_SIZE
+
+class PubSubClient : public Print {
+public:
+  bool Connected = true;
+  uint16_t BufferSize = 256;
+  std::vector<size_t> Writes;                                     // Size of each socket write.
+  std::string Payload;                                            // Payload of the last publish.
+  size_t Announced = 0;                                           // Payload length given to beginPublish.
+  bool Retained = false;
+
+  bool setBufferSize(uint16_t size) { BufferSize = size; return true; }
+  uint16_t getBufferSize() { return BufferSize; }
+  bool connected() { return Connected; }
+
+  bool publish(const char* topic, const uint8_t* payload, unsigned int length, bool retained = false) {
+    if (!Connected || BufferSize < hostMqttMaxHeader + 2 + strlen(topic) + length) return false;
+    Writes.clear();
+    Writes.push_back(hostMqttMaxHeader + 2 + strlen(topic) + length);
+    Payload.assign((const char*) payload, length);
+    Retained = retained;
+    return true;
+  }
+
+  bool beginPublish(const char* topic, unsigned int length, bool retained) {
+    if (!Connected) return false;
+    Writes.clear();
+    Writes.push_back(hostMqttMaxHeader + 2 + strlen(topic));
+    Payload.clear();
+    Announced = length;
+    Retained = retained;
+    return true;
+  }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* data, size_t size) override {
+    Writes.push_back(size);
+    Payload.append((const char*) data, size);
+    return size;
+  }
+
+  int endPublish() { return Connected && Payload.size() == Announced ? 1 : 0; }
+};
@@ -0,0 +1,36 @@
+/*******************************************************************************
+ * WiFi (host shim)
+ * - Never connected. WiFiClient is the stream of a pulled image: hostStream, read in pieces of Reads (bytes,
+ *   cycled; 0 or none = as much as asked), like the TCP segments a readBytes call gets before its timeout.
+********************************************************************************/
+#pragma once
+#include <Arduino.h>
+#include <vector>
+
+struct HostStream {
+  std::string Data;                               // Bytes the server sends.
+  size_t Offset = 0;                              // Bytes read so far.
+  std::vector<size_t> Reads;                      // Size of the successive reads (cycled).
+  size_t ReadCount = 0;                           // Number of reads.
+};
+inline HostStream hostStream;
+
+class WiFiClient {
+public:
+  size_t readBytes(uint8_t* buffer, size_t length) {
+    HostStream& s = hostStream;
+    size_t piece = s.Reads.empty() ? 0 : s.Reads[s.ReadCount % s.Reads.size()];
+    size_t n = min(min(length, piece ? piece : length), s.Data.size() - s.Offset);
+    memcpy(buffer, s.Data.data() + s.Offset, n);
+    s.Offset += n;
+    s.ReadCount++;
+    return n;                                     // 0: nothing more sent (timeout).
+  }
+};
+
+class WiFiClass {
+public:
+  bool isConnected() { return false; }
+  uint8_t* macAddress(uint8_t* mac) { memset(mac, 0, 6); return mac; }
+};
+inline WiFiClass WiFi;
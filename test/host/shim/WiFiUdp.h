@@ -0,0 +1,5 @@
+/*******************************************************************************
+ * WiFiUdp (host shim)
+ * - Nothing used by the tested code.
+********************************************************************************/
+#pragma once
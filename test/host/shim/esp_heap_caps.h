@@ -0,0 +1,14 @@
+/*******************************************************************************
+ * esp_heap_caps (host shim)
+ * - Heap figures set by the test.
+********************************************************************************/
+#pragma once
+#include <stdint.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+inline uint32_t hostHeapFree = 0;
+inline uint32_t hostHeapMinFree = 0;
+inline uint32_t hostHeapLargest = 0;
+inline uint32_t heap_caps_get_free_size(uint32_t) { return hostHeapFree; }
+inline uint32_t heap_caps_get_minimum_free_size(uint32_t) { return hostHeapMinFree; }
+inline uint32_t heap_caps_get_largest_free_block(uint32_t) { return hostHeapLargest; }
@@ -0,0 +1,14 @@
+/*******************************************************************************
+ * esp_ipc (host shim)
+ * - The function runs at once in the calling thread. The core it was meant for is kept.
+********************************************************************************/
+#pragma once
+#include <esp_timer.h>
+
+typedef void (*esp_ipc_func_t)(void* arg);
+inline uint32_t hostIpcCore = UINT32_MAX;
+inline esp_err_t esp_ipc_call_blocking(uint32_t core, esp_ipc_func_t func, void* arg) {
+  hostIpcCore = core;
+  func(arg);
+  return 0;
+}
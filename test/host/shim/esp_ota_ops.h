@@ -0,0 +1,19 @@
+/*******************************************************************************
+ * esp_ota_ops (host shim)
+ * - The running image is always valid: nothing to roll back.
+********************************************************************************/
+#pragma once
+#include <esp_timer.h>
+
+typedef enum {ESP_OTA_IMG_NEW, ESP_OTA_IMG_PENDING_VERIFY, ESP_OTA_IMG_VALID, ESP_OTA_IMG_INVALID, ESP_OTA_IMG_ABORTED,
+              ESP_OTA_IMG_UNDEFINED} esp_ota_img_states_t;
+typedef struct { uint32_t address; uint32_t size; char label[17]; } esp_partition_t;
+
+inline esp_partition_t hostRunningPartition = {0x10000, 0x140000, "app0"};
+inline const esp_partition_t* esp_ota_get_running_partition() { return &hostRunningPartition; }
+inline esp_err_t esp_ota_get_state_partition(const esp_partition_t*, esp_ota_img_states_t* state) {
+  *state = ESP_OTA_IMG_VALID;
+  return ESP_OK;
+}
+inline esp_err_t esp_ota_mark_app_valid_cancel_rollback() { return ESP_OK; }
+inline esp_err_t esp_ota_mark_app_invalid_rollback_and_reboot() { return ESP_OK; }
@@ -0,0 +1,15 @@
+/*******************************************************************************
+ * esp_task_wdt (host shim)
+ * - The task watchdog calls of the motor task, counted. The configuration of the last init is kept.
+********************************************************************************/
+#pragma once
+#include <esp_timer.h>
+
+inline int hostWdtInits = 0;
+inline uint32_t hostWdtTimeout = 0;
+inline bool hostWdtPanic = false;
+inline esp_err_t esp_task_wdt_init(uint32_t timeout, bool panic) { hostWdtInits++; hostWdtTimeout = timeout; hostWdtPanic = panic; return 0; }
+inline int hostWdtAdds = 0;
+inline int hostWdtResets = 0;
+inline esp_err_t esp_task_wdt_add(TaskHandle_t) { hostWdtAdds++; return 0; }
+inline esp_err_t esp_task_wdt_reset() { hostWdtResets++; return 0; }
@@ -0,0 +1,20 @@
+/*******************************************************************************
+ * esp_timer (host shim)
+ * - Timers are created but never fire on their own: a test calls the callback. esp_timer_get_time is the fake clock.
+********************************************************************************/
+#pragma once
+#include <Arduino.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+typedef void (*esp_timer_cb_t)(void* arg);
+typedef struct { esp_timer_cb_t Callback; void* Arg; uint64_t Period; } *esp_timer_handle_t;
+typedef struct { esp_timer_cb_t callback; void* arg; int dispatch_method; const char* name; bool skip_unhandled_events; } esp_timer_create_args_t;
+
+inline int64_t esp_timer_get_time() { return (int64_t) hostClock; }
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* handle) {
+  *handle = new std::remove_pointer<esp_timer_handle_t>::type{args->callback, args->arg, 0};
+  return 0;
+}
+inline esp_err_t esp_timer_start_periodic(esp_timer_handle_t handle, uint64_t period) { handle->Period = period; return 0; }
+inline esp_err_t esp_timer_stop(esp_timer_handle_t handle) { handle->Period = 0; return 0; }
@@ -0,0 +1,84 @@
+/*******************************************************************************
+ * rom/miniz (host shim)
+ * - tinfl_decompress of the ROM on top of zlib (link with -lz), with the contract of the ROM inflater enforced:
+ *   - the output buffer is the wrapping 32KB dictionary: the output continues where the previous call left
+ *     it (wrapping at the end), and the bytes in it are not changed by the caller. The ROM inflater reads its
+ *     back-references from there, so a caller that breaks this gets a corrupt image; the shim fails instead.
+ *   - without TINFL_FLAG_HAS_MORE_INPUT, input that ends before the end of the stream fails.
+ * - Counts the dictionary wraps and the calls without TINFL_FLAG_HAS_MORE_INPUT, and keeps the total input handed
+ *   in by the first of those (hostTinflEndInput).
+********************************************************************************/
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <zlib.h>
+
+#define TINFL_LZ_DICT_SIZE 32768
+enum { TINFL_FLAG_PARSE_ZLIB_HEADER = 1, TINFL_FLAG_HAS_MORE_INPUT = 2, TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF = 4,
+       TINFL_FLAG_COMPUTE_ADLER32 = 8 };
+typedef enum { TINFL_STATUS_BAD_PARAM = -3, TINFL_STATUS_ADLER32_MISMATCH = -2, TINFL_STATUS_FAILED = -1,
+               TINFL_STATUS_DONE = 0, TINFL_STATUS_NEEDS_MORE_INPUT = 1, TINFL_STATUS_HAS_MORE_OUTPUT = 2 } tinfl_status;
+
+typedef struct {
+  uint32_t m_state;                               // 0 = not started, 1 = inflating, 2 = ended.
+  z_stream Z;
+  uint64_t Out;                                   // Bytes output so far.
+  uint8_t Dict[TINFL_LZ_DICT_SIZE];               // What the output buffer must hold.
+} tinfl_decompressor;
+#define tinfl_init(r) do { (r)->m_state = 0; } while (0)
+
+inline int hostTinflWraps = 0;
+inline int hostTinflEndCalls = 0;
+inline uint64_t hostTinflEndInput = 0;
+
+inline tinfl_status tinfl_decompress(tinfl_decompressor* r, const uint8_t* pIn_buf_next, size_t* pIn_buf_size,
+                                     uint8_t* pOut_buf_start, uint8_t* pOut_buf_next, size_t* pOut_buf_size,
+                                     const uint32_t decomp_flags) {
+  size_t size = pOut_buf_next - pOut_buf_start + *pOut_buf_size;
+  if ((decomp_flags & TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF) || size != TINFL_LZ_DICT_SIZE || r->m_state == 2) {
+    *pIn_buf_size = *pOut_buf_size = 0;
+    return TINFL_STATUS_BAD_PARAM;
+  }
+  if (r->m_state == 0) {
+    memset(&r->Z, 0, sizeof(r->Z));
+    inflateInit2(&r->Z, decomp_flags & TINFL_FLAG_PARSE_ZLIB_HEADER ? 15 : -15);
+    r->Out = 0;
+    r->m_state = 1;
+  }
+  size_t pos = r->Out & (TINFL_LZ_DICT_SIZE - 1);
+  size_t held = r->Out < TINFL_LZ_DICT_SIZE ? r->Out : TINFL_LZ_DICT_SIZE;
+  if ((size_t) (pOut_buf_next - pOut_buf_start) != pos || memcmp(pOut_buf_start, r->Dict, held) != 0) {
+    *pIn_buf_size = *pOut_buf_size = 0;
+    inflateEnd(&r->Z);
+    r->m_state = 2;
+    return TINFL_STATUS_FAILED;                   // Dictionary not kept: the ROM inflater would output garbage.
+  }
+
+  r->Z.next_in = (Bytef*) pIn_buf_next;
+  r->Z.avail_in = *pIn_buf_size;
+  r->Z.next_out = pOut_buf_next;
+  r->Z.avail_out = *pOut_buf_size;
+  int z = inflate(&r->Z, Z_NO_FLUSH);
+  *pIn_buf_size -= r->Z.avail_in;
+  *pOut_buf_size -= r->Z.avail_out;
+  memcpy(r->Dict + pos, pOut_buf_next, *pOut_buf_size);
+  r->Out += *pOut_buf_size;
+  if (*pOut_buf_size > 0 && (r->Out & (TINFL_LZ_DICT_SIZE - 1)) == 0) hostTinflWraps++;
+  if (!(decomp_flags & TINFL_FLAG_HAS_MORE_INPUT)) {
+    if (hostTinflEndCalls++ == 0) hostTinflEndInput = r->Z.total_in + r->Z.avail_in;
+  }
+
+  tinfl_status status;
+  if (z == Z_STREAM_END) status = TINFL_STATUS_DONE;
+  else if (z == Z_DATA_ERROR && r->Z.msg && strstr(r->Z.msg, "check")) status = TINFL_STATUS_ADLER32_MISMATCH;
+  else if (z != Z_OK && z != Z_BUF_ERROR) status = TINFL_STATUS_FAILED;
+  else if (r->Z.avail_out == 0) status = TINFL_STATUS_HAS_MORE_OUTPUT;
+  else if (decomp_flags & TINFL_FLAG_HAS_MORE_INPUT) status = TINFL_STATUS_NEEDS_MORE_INPUT;
+  else status = TINFL_STATUS_FAILED;              // Input ended before the end of the stream.
+  if (status <= TINFL_STATUS_DONE) {
+    inflateEnd(&r->Z);
+    r->m_state = 2;
+  }
+  return status;
+}
@@ -0,0 +1,24 @@
+/*******************************************************************************
+ * soc/gpio_struct.h (host shim)
+ * - The GPIO registers used by the driver cut-off, on hostPin: out_w1tc clears the output levels of its mask.
+********************************************************************************/
+#pragma once
+#include <Arduino.h>
+
+struct HostW1tc {
+  int Base;                                                       // First GPIO of the register.
+  HostW1tc& operator=(uint32_t mask) {
+    for (int bit = 0; bit < 32 && Base + bit < 40; bit++) {
+      if (mask & (1UL << bit)) hostPin[Base + bit] = LOW;
+    }
+    return *this;
+  }
+};
+
+struct HostGpio {
+  uint32_t in;
+  struct { uint32_t data; } in1;
+  HostW1tc out_w1tc {0};
+  struct { HostW1tc val {32}; } out1_w1tc;
+};
+inline HostGpio GPIO;
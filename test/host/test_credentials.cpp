@@ -0,0 +1,140 @@
+/*******************************************************************************
+ * test_credentials
+ * - setCredential and parseWiFiSetup (WiFiSetup command): malformed SSID/password values are refused and leave
+ *   the stored credentials as they were, and a soak of 100k random commands never writes outside the buffers
+ *   and always leaves terminated credentials that agree with a plain reference parse.
+********************************************************************************/
+#include <Arduino.h>
+#include <TelnetStream.h>
+#include <chrono>
+#include <random>
+#include "configuration.h"
+#include "Settings.h"
+#include "HostTest.h"
+
+// The credential buffers of Config, with guard bytes around them.
+struct Guarded {
+  uint8_t Before[16];
+  char SSID[credSSIDLength];
+  char Password[credPasswordLength];
+  uint8_t After[16];
+};
+
+Guarded cred;
+
+void resetCred() {
+  memset(&cred, 0xA5, sizeof(cred));
+  strcpy(cred.SSID, "home");
+  strcpy(cred.Password, "secret123");
+}
+
+bool guardsIntact() {
+  for (int i = 0; i < 16; i++) {
+    if (cred.Before[i] != 0xA5 || cred.After[i] != 0xA5) return false;
+  }
+  return true;
+}
+
+credResult parse(const std::string& value) {
+  return parseWiFiSetup(value.data(), value.size(), cred.SSID, cred.Password);
+}
+
+bool unchanged() {
+  return strcmp(cred.SSID, "home") == 0 && strcmp(cred.Password, "secret123") == 0 && guardsIntact();
+}
+
+// Reference: the rules of parseWiFiSetup, written out plainly.
+credResult expected(const std::string& value, std::string& ssid, std::string& password) {
+  if (value == "default") return credDefault;
+  size_t split = value.find('/');
+  if (split == std::string::npos || split == 0) return credInvalid;
+  for (unsigned char c : value) {
+    if (c < 0x20 || c == 0x7F) return credInvalid;
+  }
+  ssid = value.substr(0, split);
+  password = value.substr(split + 1);
+  if (ssid.size() > 32 || password.size() > 64) return credTooLong;
+  if (!password.empty() && password.size() < 8) return credInvalid;
+  if (password.size() == 64 && password.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) return credInvalid;
+  return credSet;
+}
+
+int main() {
+  // setCredential: fits, or buffer untouched.
+  char buffer[8];
+  strcpy(buffer, "keep");
+  CHECK(setCredential(buffer, sizeof(buffer), "1234567", 7) && strcmp(buffer, "1234567") == 0);
+  CHECK(!setCredential(buffer, sizeof(buffer), "12345678", 8) && strcmp(buffer, "1234567") == 0);
+  CHECK(setCredential(buffer, sizeof(buffer), "abcdef", 2) && strcmp(buffer, "ab") == 0);   // Not terminated input.
+  CHECK(setCredential(buffer, sizeof(buffer), "", 0) && buffer[0] == 0);
+
+  // Valid values.
+  resetCred();
+  CHECK(parse("office/password1") == credSet && strcmp(cred.SSID, "office") == 0 && strcmp(cred.Password, "password1") == 0);
+  CHECK(parse("guest/") == credSet && strcmp(cred.SSID, "guest") == 0 && cred.Password[0] == 0);   // Open network.
+  CHECK(parse("lab/pass/word") == credSet && strcmp(cred.Password, "pass/word") == 0);            // Split at the first "/".
+  CHECK(parse("default/password1") == credSet && strcmp(cred.SSID, "default") == 0);
+  CHECK(parse(std::string(32, 's') + "/" + std::string(63, 'p')) == credSet && strlen(cred.SSID) == 32 && strlen(cred.Password) == 63);
+  CHECK(parse("wifi/" + std::string(64, 'a')) == credSet && strlen(cred.Password) == 64);         // Hex key.
+  CHECK(parse("caf\xc3\xa9/password1") == credSet && strcmp(cred.SSID, "caf\xc3\xa9") == 0);      // UTF-8 SSID.
+  CHECK(parse("default") == credDefault);
+  CHECK(guardsIntact());
+
+  // Malformed values: refused, credentials as they were.
+  struct { std::string Value; credResult Result; } malformed[] = {
+    { "", credInvalid },
+    { "/", credInvalid },
+    { "/password1", credInvalid },                                  // Empty SSID.
+    { "office", credInvalid },                                      // No password part.
+    { "defaults", credInvalid },
+    { "office/short", credInvalid },                                // Passphrase under 8 characters.
+    { "wifi/" + std::string(64, 'z'), credInvalid },                // 64 characters, not hex.
+    { std::string(33, 's') + "/password1", credTooLong },
+    { "office/" + std::string(65, 'p'), credTooLong },
+    { std::string("off\0ice/password1", 17), credInvalid },         // NUL would cut the stored SSID.
+    { std::string("office/pass\0word1", 17), credInvalid },
+    { "office/pass\nword1", credInvalid },
+    { "off\x7f" "ice/password1", credInvalid },
+  };
+  for (auto& m : malformed) {
+    resetCred();
+    CHECK(parse(m.Value) == m.Result);
+    CHECK(unchanged());
+  }
+
+  // Soak: random "<ssid>/<password>" commands around the length limits, some with a stray byte, and "default".
+  std::mt19937 random(20221016);
+  const char printable[] = "abcXYZ0129f /-_.";
+  int results[4] = {0, 0, 0, 0};
+  int mismatches = 0;
+  auto start = std::chrono::steady_clock::now();
+  resetCred();
+  std::string lastSsid = "home", lastPassword = "secret123";
+  for (int n = 0; n < 100000; n++) {
+    std::string value;
+    if (random() % 32 == 0) {
+      value = "default";
+    } else {
+      int ssidLength = random() % 40;
+      int passwordLength = random() % 4 == 0 ? 64 : random() % 72;
+      for (int i = 0; i < ssidLength; i++) value += printable[random() % (sizeof(printable) - 1)];
+      if (random() % 16 != 0) value += '/';
+      for (int i = 0; i < passwordLength; i++) value += printable[random() % 11];   // Mostly hex digits.
+    }
+    if (random() % 8 == 0) value.insert(random() % (value.size() + 1), 1, (char) (random() & 0xFF));
+    std::string ssid, password;
+    credResult want = expected(value, ssid, password);
+    credResult got = parse(value);
+    results[got]++;
+    if (got != want) mismatches++;
+    if (got == credSet) { lastSsid = ssid; lastPassword = password; }
+    if (cred.SSID != lastSsid || cred.Password != lastPassword || !guardsIntact()) mismatches++;
+  }
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  CHECK(mismatches == 0);
+  CHECK(results[credSet] > 1000 && results[credInvalid] > 1000 && results[credTooLong] > 1000 && results[credDefault] > 1000);
+  printf("  soak: 100000 commands in %.0f ms (host): %d set, %d invalid, %d too long, %d default, %d mismatches\n",
+         ms, results[credSet], results[credInvalid], results[credTooLong], results[credDefault], mismatches);
+
+  return hostTestDone("test_credentials");
+}
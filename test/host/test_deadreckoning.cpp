@@ -0,0 +1,142 @@
+/*******************************************************************************
+ * test_deadreckoning
+ * - The time-based position estimate on a simulated blind without rotation sensor: calibrated like the device
+ *   (full runs with the soft-start ramp), MQTT moves stopped on the estimate, re-sync and error at the switches.
+ * - Prints the re-sync error after repeated partial moves, for a motor whose speed is proportional to the duty
+ *   cycle (the assumption of the estimate), one with a dead band, and one slower than when it was calibrated.
+********************************************************************************/
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <random>
+#include "configuration.h"
+#include "DeadReckoning.h"
+#include "HostTest.h"
+
+BlindChannel channel;
+BlindChannel* ch = &channel;
+
+// Simulated blind: travel times at full speed (ms), speed per duty cycle (0..1).
+const double openTime = 30000, closeTime = 25000;
+int deadBand = 0;                                 // Duty cycle below which the motor does not turn.
+double slower = 0;                                // Speed lost since the calibration (fraction).
+double truePosition = 0;                          // Permille.
+
+double speedFactor(int duty) {
+  if (duty <= deadBand) return 0;
+  return (1 - slower) * (duty - deadBand) / (255.0 - deadBand);
+}
+
+// Run in the direction until the estimate stops the move, or a limit switch is reached. Returns the run time (ms).
+unsigned long move(blindsAction action, int target) {
+  ch->mtr.Action = action;
+  ch->mtr.targetPosition = target;
+  ch->mtr.IsRunning = true;
+  ch->dutyCycle = rampStartDuty;
+  ch->swcOpen.Set = ch->swcClosed.Set = false;
+  unsigned long start = millis();
+  for (unsigned long ms = 1; ; ms++) {
+    hostAdvance(1000);
+    if (ms % rampStepDuration == 0) ch->dutyCycle = min(ch->dutyCycle + 1, 255);
+    double delta = 1000.0 * speedFactor(ch->dutyCycle) / (action == actBlindsOpen ? openTime : closeTime);
+    truePosition = action == actBlindsOpen ? truePosition + delta : truePosition - delta;
+    if (truePosition >= 1000) { truePosition = 1000; ch->swcOpen.Set = true; break; }
+    if (truePosition <= 0) { truePosition = 0; ch->swcClosed.Set = true; break; }
+    if (ms % planControlPeriod == 0 && deadReckonUpdate(ch, millis())) break;
+  }
+  ch->mtr.IsRunning = false;
+  deadReckonUpdate(ch, millis());                 // Stopped: re-sync if at a switch.
+  return millis() - start;
+}
+
+// Calibrate like the device: home to CLOSED, run to OPEN, run back to CLOSED (ramp included in the times).
+void calibrate() {
+  memset(&channel, 0, sizeof(channel));
+  ch->mtr.Owner = ownMQTT;
+  move(actBlindsClose, 0);
+  ch->Cfg.Cal_OpenTime = move(actBlindsOpen, 1000);
+  ch->Cfg.Cal_CloseTime = move(actBlindsClose, 0);
+  ch->estLastUpdate = millis();
+  memset(estStats, 0, sizeof(estStats));
+}
+
+int main() {
+  // Not used without calibration, or with a rotation sensor.
+  memset(&channel, 0, sizeof(channel));
+  CHECK(!deadReckonCalibrated(ch) && deadReckonPosition(ch) == -1);
+  ch->Cfg.Cal_OpenTime = ch->Cfg.Cal_CloseTime = 20000;
+  ch->Cfg.Open_MaxRotations = 100;
+  CHECK(!deadReckonCalibrated(ch));
+  ch->Cfg.Open_MaxRotations = 0;
+  CHECK(deadReckonCalibrated(ch) && !deadReckonReady(ch));
+
+  // Calibration of the ideal motor: the times include the ramp, the estimate takes the ramp loss off again.
+  calibrate();
+  CHECK(fabs(ch->Cfg.Cal_OpenTime - (openTime + estRampLoss)) < 5);
+  CHECK(fabs(ch->Cfg.Cal_CloseTime - (closeTime + estRampLoss)) < 5);
+  CHECK(deadReckonReady(ch) && deadReckonPosition(ch) == 0 && estStats[0].Count == 0);
+
+  // A move to the middle stops on the estimate, a move to an end runs on to the switch.
+  move(actBlindsOpen, 500);
+  CHECK(abs(deadReckonPosition(ch) - 500) <= 1 && fabs(truePosition - 500) < 2);
+  move(actBlindsOpen, 1000);
+  CHECK(ch->swcOpen.Set && deadReckonPosition(ch) == 1000 && estStats[0].Count == 1 && abs(estStats[0].LastError) <= 2);
+
+  // Only the switch in the direction of travel re-syncs a running channel.
+  ch->mtr.IsRunning = true;
+  ch->mtr.Action = actBlindsClose;
+  ch->estPosition = 800;
+  ch->swcOpen.Set = true;
+  deadReckonUpdate(ch, millis());
+  CHECK(ch->estPosition <= 800);
+  ch->mtr.IsRunning = false;
+
+  // Button moves are not stopped on the estimate.
+  ch->mtr.Owner = ownButton;
+  move(actBlindsClose, 300);
+  CHECK(ch->swcClosed.Set && deadReckonPosition(ch) == 0);
+  ch->mtr.Owner = ownMQTT;
+
+  // Error at the switch after N random partial moves, per motor model.
+  struct { const char* Name; int DeadBand; double Slower; int MaxError; } models[] = {
+    {"proportional", 0, 0, 5}, {"dead band 40", 40, 0, 1000}, {"3% slower", 0, 0.03, 1000},
+  };
+  printf("  error after N partial moves (permille, 50 runs): at the switch mean / max, [true error of the estimate max]\n");
+  printf("  motor           N=1                N=5                N=20\n");
+  for (auto& model : models) {
+    deadBand = 0;
+    slower = 0;
+    calibrate();                                  // Calibrated as the motor was.
+    deadBand = model.DeadBand;
+    slower = model.Slower;
+    std::mt19937 rng(3);
+    printf("  %-14s", model.Name);
+    for (int n : {1, 5, 20}) {
+      double sum = 0;
+      int worst = 0;
+      double worstTrue = 0;
+      for (int r = 0; r < 50; r++) {
+        move(actBlindsClose, 0);                  // Start synced at CLOSED.
+        for (int i = 0; i < n; i++) {
+          int target = 100 + rng() % 801;
+          int position = deadReckonPosition(ch);
+          if (target != position) move(target > position ? actBlindsOpen : actBlindsClose, target);
+        }
+        worstTrue = max(worstTrue, fabs(ch->estPosition - truePosition));
+        move(actBlindsClose, 0);                  // Re-sync at CLOSED: records the error.
+        sum += abs(estStats[0].LastError);
+        worst = max(worst, abs(estStats[0].LastError));
+      }
+      CHECK(worst <= model.MaxError);
+      CHECK(model.DeadBand == 0 || n == 1 || worst > 0);     // An estimate ahead of the blinds is recorded at the switch.
+      printf("  %4.1f / %-3d [%3.0f]", sum / 50, worst, worstTrue);
+    }
+    printf("\n");
+  }
+
+  StaticJsonDocument<256> doc;
+  JsonObject errors = doc.to<JsonObject>();
+  deadReckonToJson(errors);
+  CHECK(errors["0"].as<JsonArray>().size() == 4 && errors["0"][3].as<int>() == estStats[0].MaxError);
+
+  return hostTestDone("test_deadreckoning");
+}
@@ -0,0 +1,143 @@
+/*******************************************************************************
+ * test_groupmove
+ * - Start and arrival skew bookkeeping of a group move (members only, each arrival once), the speed scaling of a
+ *   "sync" group move (groupDutyMax), and the held start of members clamped at groupMinDuty (groupHoldTime).
+ * - Prints the arrival skew of random group moves at full speed, and "sync" with and without a learned speed
+ *   (held or early), for motors whose speed is proportional to the duty cycle (the assumption of the scaling).
+********************************************************************************/
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <random>
+#include "configuration.h"
+#include "GroupMove.h"
+#include "HostTest.h"
+
+const double fullSpeed = 2.0;                     // Rotations per second at duty cycle 255 (simulated motor).
+int badStarts = 0;                                // Simulated group moves with wrong running/held/early members.
+
+// Run a group move with the given distances (rotations), returns its arrival skew (ms). Learned: the speed of the
+// motors was learned, so clamped members of a "sync" move are held.
+unsigned long simulate(const int* distance, int count, bool sync, bool learned = true) {
+  int maxDistance = 0;
+  for (int i = 0; i < count; i++) maxDistance = max(maxDistance, distance[i]);
+
+  uint64_t start = hostClock;
+  uint64_t arrival[maxChannels];
+  uint8_t held = 0, early = 0;
+  for (int i = 0; i < count; i++) {
+    int duty = sync ? groupDutyMax(distance[i], maxDistance) : 255;
+    unsigned long hold = sync ? groupHoldTime(distance[i], maxDistance, learned ? fullSpeed : 0) : 0;
+    if (hold > 0) held |= 1 << i;
+    else if (sync && groupClamped(distance[i], maxDistance)) early |= 1 << i;
+    arrival[i] = start + hold * 1000ULL + (uint64_t) (1e6 * distance[i] / (fullSpeed * duty / 255));
+  }
+  groupBegin((1 << count) - 1, sync);
+  groupStarted(((1 << count) - 1) & ~held, 0, held, early);
+  if (groupRunning != (1 << count) - 1 || groupStats.Held != held || groupStats.Early != early) badStarts++;
+  for (int done = 0; done < count; done++) {
+    int next = -1;
+    for (int i = 0; i < count; i++) {
+      if ((groupRunning & (1 << i)) && (next < 0 || arrival[i] < arrival[next])) next = i;
+    }
+    hostClock = max(hostClock, arrival[next]);
+    groupArrived(next);
+  }
+  hostAdvance(1000);
+  return groupStats.ArrivalSkew;
+}
+
+int main() {
+  // Bookkeeping.
+  CHECK(!groupMoveActive());
+  groupBegin(0x05, false);
+  CHECK(groupMoveActive() && groupPending && groupMembers == 0x05);
+  hostAdvance(1000000);
+  groupStarted(0x05, 37);
+  CHECK(!groupPending && groupRunning == 0x05 && groupStats.StartSkew == 37);
+  groupArrived(1);                                // Not a member.
+  CHECK(groupRunning == 0x05 && groupFirstArrival == 0);
+  hostAdvance(250000);
+  groupArrived(0);
+  groupArrived(0);                                // Second stop of the same member.
+  CHECK(groupRunning == 0x04 && groupStats.Count == 0);
+  hostAdvance(400000);
+  groupArrived(2);
+  CHECK(!groupMoveActive() && groupStats.Count == 1 && groupStats.ArrivalSkew == 400);
+  CHECK(groupStats.MaxArrivalSkew == 400);
+
+  groupBegin(0x03, false);
+  groupStarted(0x03, 12);
+  hostAdvance(1000);
+  groupArrived(1);
+  hostAdvance(100000);
+  groupArrived(0);
+  CHECK(groupStats.Count == 2 && groupStats.ArrivalSkew == 100 && groupStats.MaxArrivalSkew == 400);
+
+  StaticJsonDocument<256> doc;
+  JsonObject group = doc.to<JsonObject>();
+  groupToJson(group);
+  CHECK(group["n"].as<int>() == 2 && group["start_us"].as<int>() == 12);
+  CHECK(group["arrive_ms"].as<int>() == 100 && group["arrive_max_ms"].as<int>() == 400);
+  CHECK(group["held"].as<int>() == 0 && group["early"].as<int>() == 0);
+
+  // Held members: started when their hold time expired (once), or dropped when started or stopped otherwise.
+  groupBegin(0x07, true);
+  groupStarted(0x01, 5, 0x06, 0);
+  CHECK(groupRunning == 0x07 && groupHeld == 0x06 && groupTakeDue() == 0);
+  groupHoldExpired(1);
+  groupHoldExpired(0);                            // Not held.
+  CHECK(groupDue == 0x02 && groupTakeDue() == 0x02 && groupHeld == 0x04 && groupTakeDue() == 0);
+  CHECK(groupUnhold(2) && !groupUnhold(2) && groupHeld == 0);
+  groupHoldExpired(2);                            // Expired after the hold was dropped.
+  CHECK(groupTakeDue() == 0 && groupMoveActive());
+  groupArrived(0); groupArrived(1); groupArrived(2);
+  CHECK(!groupMoveActive() && groupStats.Held == 0x06);
+  doc.clear();
+  group = doc.to<JsonObject>();
+  groupToJson(group);
+  CHECK(group["held"].as<int>() == 0x06);
+
+  // Speed scaling.
+  CHECK(groupDutyMax(80, 80) == 255);
+  CHECK(groupDutyMax(40, 80) == 127);
+  CHECK(groupDutyMax(1, 80) == groupMinDuty);
+  CHECK(groupDutyMax(0, 80) == 255);              // Unknown distance: full speed.
+  CHECK(groupDutyMax(10, 0) == 255);
+  CHECK(!groupClamped(80, 80) && !groupClamped(40, 80) && groupClamped(1, 80) && !groupClamped(0, 80));
+  CHECK(groupHoldTime(40, 80, 2.0) == 0);          // Not clamped: scaled, not held.
+  CHECK(groupHoldTime(1, 80, 0) == 0);             // Speed not learned: not held.
+  CHECK(groupHoldTime(20, 80, 2.0) == (unsigned long) (1000 * (80 - 20 * 255.0 / groupMinDuty) / 2.0));
+
+  // Equal distances arrive together, with or without scaling.
+  int same[maxChannels] = {30, 30, 30, 30};
+  CHECK(simulate(same, maxChannels, false) == 0 && simulate(same, maxChannels, true) == 0);
+  // Distances within the scaling range arrive (almost) together only when scaled.
+  int spread[maxChannels] = {80, 60, 50, 40};
+  unsigned long plain = simulate(spread, maxChannels, false);
+  unsigned long synced = simulate(spread, maxChannels, true);
+  CHECK(plain == 20000 && synced < 200);
+
+  // Random group moves of 2..maxChannels members, 1..120 rotations.
+  std::mt19937 rng(42);
+  const int moves = 10000;
+  double sumPlain = 0, sumSync = 0, sumEarly = 0;
+  unsigned long maxPlain = 0, maxSync = 0, maxEarly = 0;
+  int slower = 0;                                 // Moves with more skew when scaled.
+  for (int n = 0; n < moves; n++) {
+    int count = 2 + rng() % (maxChannels - 1);
+    int distance[maxChannels];
+    for (int i = 0; i < count; i++) distance[i] = 1 + rng() % 120;
+    unsigned long p = simulate(distance, count, false);
+    unsigned long s = simulate(distance, count, true);
+    unsigned long e = simulate(distance, count, true, false);
+    if (s > p || e > p) slower++;
+    sumPlain += p; sumSync += s; sumEarly += e;
+    maxPlain = max(maxPlain, p); maxSync = max(maxSync, s); maxEarly = max(maxEarly, e);
+  }
+  CHECK(slower == 0 && maxSync < 500 && badStarts == 0);
+  printf("  %d random group moves, arrival skew (ms): full speed mean %.0f max %lu\n", moves, sumPlain / moves, maxPlain);
+  printf("  sync, clamped members held: mean %.0f max %lu\n", sumSync / moves, maxSync);
+  printf("  sync, speed not learned (clamped members early): mean %.0f max %lu\n", sumEarly / moves, maxEarly);
+
+  return hostTestDone("test_groupmove");
+}
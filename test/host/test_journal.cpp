@@ -0,0 +1,79 @@
+/*******************************************************************************
+ * test_journal
+ * - The motor journal with several channels running at once: rotations, current and stop reason stay with their
+ *   channel, the last run is found per channel, and the ring buffer keeps the newest journalSize runs.
+ * - Prints the host time of the journal calls of one motor task pass as channels are added.
+********************************************************************************/
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <chrono>
+#include "configuration.h"
+#include "MotorJournal.h"
+#include "HostTest.h"
+
+int main() {
+  // All channels run at once, interleaved.
+  for (int ch = 0; ch < maxChannels; ch++) {
+    journalRunStart(ch, ownMQTT, actBlindsOpen, ch * 10);
+  }
+  for (int step = 0; step < 10; step++) {
+    hostAdvance(100000);
+    for (int ch = 0; ch < maxChannels; ch++) {
+      for (int r = 0; r <= ch; r++) journalRotation(ch);
+      journalCurrentSample(ch, 100 * (ch + 1) + step);
+    }
+  }
+  for (int ch = maxChannels - 1; ch >= 0; ch--) {
+    journalRunStop(ch, ch == 0 ? stpLimitOpen : stpMQTT, ch * 10 + 5);
+  }
+  CHECK(journalUnpublished == maxChannels);
+  for (int ch = 0; ch < maxChannels; ch++) {
+    MotorRun run;
+    CHECK(journalLastRun(ch, &run));
+    CHECK(run.Channel == ch && run.Rotations == 10 * (ch + 1));
+    CHECK(run.PeakCurrent == 100 * (ch + 1) + 9 && run.MeanCurrent == 100 * (ch + 1) + 4);
+    CHECK(run.StartPosition == ch * 10 && run.EndPosition == ch * 10 + 5 && run.StopTime - run.StartTime == 1000);
+    CHECK(run.Reason == (ch == 0 ? stpLimitOpen : stpMQTT));
+  }
+  CHECK(journalStopCount[stpLimitOpen] == 1 && journalStopCount[stpMQTT] == (unsigned long) maxChannels - 1);
+
+  // A stop without a run (e.g. a second stop flag) records nothing.
+  journalRunStop(1, stpButton, 0);
+  CHECK(journalUnpublished == maxChannels && journalStopCount[stpButton] == 0);
+
+  // Batches, oldest first.
+  StaticJsonDocument<2048> doc;
+  JsonArray runs = doc.to<JsonArray>();
+  CHECK(journalToJson(runs, 10) == journalBatchSize);
+  CHECK(runs[0]["ch"].as<int>() == maxChannels - 1 && runs[0]["rsn"].as<const char*>() == std::string("MQTT"));
+  CHECK(journalUnpublished == maxChannels - journalBatchSize);
+
+  // Ring buffer: the newest journalSize runs are kept, per channel the last one is found.
+  for (int n = 0; n < journalSize * 3; n++) {
+    journalRunStart(n % 2, ownButton, actBlindsClose, n);
+    journalRunStop(n % 2, stpButton, n);
+  }
+  CHECK(journalUnpublished == journalSize);
+  MotorRun run;
+  CHECK(journalLastRun(0, &run) && run.EndPosition == journalSize * 3 - 2);
+  CHECK(journalLastRun(1, &run) && run.EndPosition == journalSize * 3 - 1);
+  CHECK(!journalLastRun(2, &run));                    // Pushed out of the buffer.
+
+  // Journal calls of one motor task pass (start, rotation, current sample, stop per running channel).
+  for (int channels = 1; channels <= maxChannels; channels++) {
+    const int passes = 200000;
+    auto start = std::chrono::steady_clock::now();
+    for (int p = 0; p < passes; p++) {
+      for (int ch = 0; ch < channels; ch++) {
+        if (p % 100 == 0) journalRunStart(ch, ownMQTT, actBlindsOpen, 0);
+        journalRotation(ch);
+        journalCurrentSample(ch, p & 1023);
+        if (p % 100 == 99) journalRunStop(ch, stpMQTT, 100);
+      }
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / passes;
+    printf("  %d channel(s): %.1f ns per pass, %.1f ns per channel (host)\n", channels, ns, ns / channels);
+  }
+
+  return hostTestDone("test_journal");
+}
@@ -0,0 +1,160 @@
+/*******************************************************************************
+ * test_jsondelta
+ * - Delta tracking of the config and app_state messages: only changed fields stay, the channel number is kept,
+ *   a dropped baseline (failed publish, MQTT connect) or an expired interval makes the next report a snapshot,
+ *   the channel trackers hold the channel settings only, and the shared settings, embedded in the snapshot of every
+ *   channel, go out once when any channel's snapshot does not have them yet.
+ * - Prints the payload of a full state report against a typical delta.
+********************************************************************************/
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "configuration.h"
+#include "JsonDelta.h"
+#include "HostTest.h"
+
+int uptime = 100;
+int heap = 181234;
+
+void stateFields(JsonObject doc) {
+  doc["Version"] = "v221016.0";
+  doc["IP Address"] = "192.168.2.18";
+  doc["RSSI (dBm)"] = -61;
+  doc["Uptime"] = uptime;
+  doc["Free Heap Memory"] = heap;
+  JsonObject stops = doc.createNestedObject("Stop Reasons");
+  stops["LimitOpen"] = 3;
+  stops["Button"] = 1;
+  JsonArray publish = doc.createNestedArray("Publish (us)");
+  publish.add(4000);
+  publish.add(850);
+}
+
+void sharedFields(JsonObject doc, int stateInterval) {
+  doc["AllowRemoteControl"] = true;
+  doc["StateInterval"] = stateInterval;
+  doc["SSID"] = "network";
+}
+
+void channelFields(JsonObject doc, int channel, int preset) {
+  doc["Channel"] = channel;
+  doc["ButtonPreset"] = preset;
+  doc["OpenDuration"] = 20;
+}
+
+int main() {
+  StaticJsonDocument<1024> doc;
+  JsonObject obj = doc.to<JsonObject>();
+
+  // No baseline: snapshot due.
+  DeltaTracker state = {};
+  CHECK(deltaSnapshotDue(state));
+  stateFields(obj);
+  size_t fullLength = measureJson(doc);
+  deltaSnapshot(state, obj);
+  CHECK(!deltaSnapshotDue(state));
+  CHECK(state.Count == 7);
+
+  // Nothing changed: nothing to publish.
+  obj = doc.to<JsonObject>();
+  stateFields(obj);
+  CHECK(deltaReduce(state, obj) == 0);
+  CHECK(obj.size() == 0);
+
+  // Two values changed: only those stay.
+  uptime = 160;
+  heap = 180002;
+  obj = doc.to<JsonObject>();
+  stateFields(obj);
+  CHECK(deltaReduce(state, obj) == 2);
+  CHECK(obj.size() == 2 && obj.containsKey("Uptime") && obj.containsKey("Free Heap Memory"));
+  size_t deltaLength = measureJson(doc);
+  printf("  state: full %u bytes, delta (uptime, heap) %u bytes\n", (unsigned) fullLength, (unsigned) deltaLength);
+
+  // A nested value that changed goes out as a whole.
+  obj = doc.to<JsonObject>();
+  stateFields(obj);
+  obj["Stop Reasons"]["Button"] = 2;
+  CHECK(deltaReduce(state, obj) == 1);
+  CHECK(obj.size() == 1 && obj["Stop Reasons"].as<JsonObject>().size() == 2);
+
+  // Dropped baseline (failed publish, MQTT connect) or expired interval: snapshot due.
+  state.Baseline = false;
+  CHECK(deltaSnapshotDue(state));
+  obj = doc.to<JsonObject>();
+  stateFields(obj);
+  deltaSnapshot(state, obj);
+  CHECK(!deltaSnapshotDue(state));
+  hostAdvance((uint64_t) deltaSnapshotInterval * 60 * 1000000 - 1000);
+  CHECK(!deltaSnapshotDue(state));
+  hostAdvance(1000);
+  CHECK(deltaSnapshotDue(state));
+
+  // Config: the channel trackers hold the channel fields only, the shared fields are tracked once.
+  DeltaTracker channel[2] = {};
+  DeltaTracker shared = {};
+  for (int ch = 0; ch < 2; ch++) {
+    obj = doc.to<JsonObject>();
+    channelFields(obj, ch, -1);
+    deltaSnapshot(channel[ch], obj);
+    CHECK(channel[ch].Count == 3);
+  }
+  obj = doc.to<JsonObject>();
+  sharedFields(obj, 60);
+  deltaSnapshot(shared, obj);
+  CHECK(shared.Count == 3);
+
+  // StateInterval changed (through channel 1): one shared delta, no channel deltas.
+  for (int ch = 0; ch < 2; ch++) {
+    obj = doc.to<JsonObject>();
+    channelFields(obj, ch, -1);
+    CHECK(deltaReduce(channel[ch], obj, "Channel") == 0);
+  }
+  obj = doc.to<JsonObject>();
+  sharedFields(obj, 30);
+  CHECK(deltaReduce(shared, obj) == 1);
+  CHECK(jsonText(doc) == "{\"StateInterval\":30}");
+  obj = doc.to<JsonObject>();
+  sharedFields(obj, 30);
+  CHECK(deltaReduce(shared, obj) == 0);
+
+  // Shared settings per channel topic: a snapshot of channel 0 with a new value does not hide the change from
+  // channel 1, which gets it once from the shared delta. A channel without a baseline (snapshot due) is skipped.
+  DeltaTracker sharedOf[3] = {};
+  DeltaTracker* sharedTrackers[3] = {&sharedOf[0], &sharedOf[1], &sharedOf[2]};
+  for (int ch = 0; ch < 2; ch++) {
+    obj = doc.to<JsonObject>();
+    sharedFields(obj, 60);
+    deltaSnapshot(sharedOf[ch], obj);
+  }
+  obj = doc.to<JsonObject>();
+  sharedFields(obj, 15);
+  deltaSnapshot(sharedOf[0], obj);                // Channel 0 snapshot (getconfig) after the change.
+  obj = doc.to<JsonObject>();
+  sharedFields(obj, 15);
+  CHECK(deltaReduceAny(sharedTrackers, 3, obj) == 1);
+  CHECK(jsonText(doc) == "{\"StateInterval\":15}");
+  CHECK(sharedOf[2].Count == 0);
+  obj = doc.to<JsonObject>();
+  sharedFields(obj, 15);
+  CHECK(deltaReduceAny(sharedTrackers, 3, obj) == 0 && obj.size() == 0);
+
+  // ButtonPreset of channel 1 changed: its delta keeps the channel number.
+  obj = doc.to<JsonObject>();
+  channelFields(obj, 1, 50);
+  CHECK(deltaReduce(channel[1], obj, "Channel") == 1);
+  CHECK(jsonText(doc) == "{\"Channel\":1,\"ButtonPreset\":50}");
+
+  // More fields than the tracker holds: the extra ones are always reported as changed.
+  DeltaTracker small = {};
+  obj = doc.to<JsonObject>();
+  char names[deltaMaxFields + 2][16];
+  for (int i = 0; i < deltaMaxFields + 2; i++) {
+    snprintf(names[i], sizeof(names[i]), "f%d", i);
+    obj[(const char*) names[i]] = i;
+  }
+  deltaSnapshot(small, obj);
+  CHECK(small.Count == deltaMaxFields);
+  CHECK(deltaReduce(small, obj) == 2);
+
+  return hostTestDone("test_jsondelta");
+}
@@ -0,0 +1,113 @@
+/*******************************************************************************
+ * test_latencytrace
+ * - Stage deltas of a traced command land in the right histograms (also across a cycle counter wrap), stages
+ *   out of order are not traced, and the histogram percentiles bound the exact percentiles (at most 12.5% over).
+ * - Prints the percentile error on a spread of command latencies.
+********************************************************************************/
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "LatencyTrace.h"
+#include "HostTest.h"
+
+// Run one command through the stages, with the given time (us) spent before each stage after the first.
+void trace(const uint32_t (&us)[latCOUNT - 1]) {
+  latencyMark(latReceived);
+  for (int stage = latQueued; stage < latCOUNT; stage++) {
+    hostAdvance(us[stage - 1]);
+    latencyMark((latencyStage) stage);
+  }
+}
+
+uint32_t exactPercentile(std::vector<uint32_t> samples, int percentile) {
+  std::sort(samples.begin(), samples.end());
+  size_t rank = (samples.size() * percentile + 99) / 100;
+  return samples[rank - 1];
+}
+
+int main() {
+  // Buckets: below 8 us one per value, then 8 sub-buckets per power of 2.
+  LatencyHistogram hist = {};
+  latencyAdd(hist, 0);
+  latencyAdd(hist, 1);
+  latencyAdd(hist, 3);
+  latencyAdd(hist, 1024);
+  latencyAdd(hist, 1151);
+  latencyAdd(hist, 1152);
+  latencyAdd(hist, 0xFFFFFFFF);
+  CHECK(hist.Bucket[0] == 1 && hist.Bucket[1] == 1 && hist.Bucket[3] == 1 && hist.Bucket[latencyBuckets - 1] == 1);
+  CHECK(hist.Bucket[latencyBucket(1024)] == 2 && hist.Bucket[latencyBucket(1024) + 1] == 1);
+  CHECK(hist.Count == 7 && hist.Max == 0xFFFFFFFF);
+
+  // Every sample up to the last bucket lies in its bucket, at most 1/8 below the upper bound, buckets in order.
+  int misplaced = 0;
+  for (uint32_t us = 0; us < (1UL << latencyOctaves); us++) {
+    int bucket = latencyBucket(us);
+    uint32_t upper = latencyBucketUpper(bucket);
+    if (upper < us || upper - us > us / latencySubBuckets ||
+        (bucket > 0 && latencyBucketUpper(bucket - 1) >= us)) misplaced++;
+  }
+  CHECK(misplaced == 0);
+  CHECK(latencyBucket((1UL << latencyOctaves) - 1) == latencyBuckets - 1);
+
+  // A traced command: each stage delta and the total.
+  hostClock = 1000000;
+  trace({120, 900, 40, 3});
+  CHECK(latencyHist[latQueued].Count == 1 && latencyHist[latQueued].Max == 120);
+  CHECK(latencyHist[latPicked].Max == 900 && latencyHist[latStarted].Max == 40 && latencyHist[latApplied].Max == 3);
+  CHECK(latencyHist[latReceived].Count == 1 && latencyHist[latReceived].Max == 1063);
+
+  // Stages out of order (a button start never passed MQTT) are not traced; a new receipt restarts the trace.
+  latencyReset();
+  latencyMark(latPicked);
+  latencyMark(latStarted);
+  latencyMark(latApplied);
+  CHECK(latencyHist[latReceived].Count == 0);
+  latencyMark(latReceived);
+  hostAdvance(50);
+  latencyMark(latQueued);
+  latencyMark(latReceived);                       // Next command before the first reached the motor.
+  hostAdvance(10);
+  latencyMark(latPicked);                         // Does not follow latReceived: ignored.
+  CHECK(latencyLastStage == latReceived);
+  CHECK(latencyHist[latQueued].Count == 0);
+
+  // Across the cycle counter wrap (every 2^32 / 240 MHz = 17.9 s).
+  latencyReset();
+  hostClock = (uint64_t) 0xFFFFFFFF / hostCpuMhz - 500;
+  trace({300, 300, 300, 300});
+  CHECK(latencyHist[latReceived].Max == 1200);
+
+  // Percentiles of a spread of latencies (log-normal around 2 ms, tail to 100 ms) against the exact values.
+  latencyReset();
+  std::mt19937 random(27);
+  std::lognormal_distribution<double> spread(log(2000.0), 1.0);
+  std::vector<uint32_t> totals;
+  for (int n = 0; n < 20000; n++) {
+    uint32_t us[latCOUNT - 1];
+    uint32_t total = 0;
+    for (int i = 0; i < latCOUNT - 1; i++) {
+      us[i] = (uint32_t) std::min(spread(random) / 4, 100000.0);
+      total += us[i];
+    }
+    trace(us);
+    totals.push_back(total);
+  }
+  LatencyHistogram& total = latencyHist[latReceived];
+  CHECK(total.Count == 20000);
+  for (int p : {50, 90, 99}) {
+    uint32_t exact = exactPercentile(totals, p);
+    uint32_t approx = latencyPercentile(total, p);
+    CHECK(approx >= exact && approx <= exact + exact / 8);      // Upper bound of the bucket: within 12.5%.
+    printf("  p%d: exact %u us, histogram %u us (+%.0f%%)\n", p, exact, approx, 100.0 * (approx - exact) / exact);
+  }
+  CHECK(latencyPercentile(total, 100) == total.Max);
+
+  StaticJsonDocument<512> doc;
+  latencyStagesToJson(doc.to<JsonObject>());
+  CHECK(doc.as<JsonObject>().size() == 5 && doc.as<JsonObject>()["total"]["n"].as<long>() == 20000);
+
+  return hostTestDone("test_latencytrace");
+}
@@ -0,0 +1,324 @@
+/*******************************************************************************
+ * test_motionplanner
+ * - The trapezoidal profile (continuous, ends at the distance, triangular for short moves), the speed learner,
+ *   and planned moves on a simulated motor: exact and wrongly learned speed, and a storm of retargets.
+ * - Retargets: re-planned from the planned position and speed (continuous), a shortened target decelerates at once
+ *   and ends at the target at speed 0, and a reversal (retargetMove, retargetStep) decelerates, waits the dead-time
+ *   and restarts towards the latest target.
+ * - Prints the plan error and run time figures of the simulated moves.
+********************************************************************************/
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <esp_timer.h>
+#include <random>
+#include <vector>
+#include "configuration.h"
+#include "MotorJournal.h"
+#include "TimerWheel.h"
+#include "MotorDriver.h"
+#include "MotionPlanner.h"
+#include "HostTest.h"
+
+BlindChannel channel;
+BlindChannel* ch = &channel;
+
+// Simulated motor: the speed follows the duty cycle (first order, motorLag), trueSpeed rotations/s at 255.
+const double motorLag = 0.15;                     // s
+double trueSpeed = 2.0;
+double motorSpeed = 0;
+double motorTravel = 0;
+int dutyOutOfRange = 0;                           // Control steps with the duty cycle outside planMinDuty..dutyMax.
+
+void resetChannel(int position, int target) {
+  memset(&channel, 0, sizeof(channel));
+  ch->Pin = &channelPins[0];
+  ch->pwmChannel_Open = 0;
+  ch->pwmChannel_Close = 1;
+  ch->Cfg.Open_MaxRotations = 120;
+  ch->dutyMax = 255;
+  ch->dutyCycle = rampStartDuty;
+  ch->learnedSpeed = 2.0;
+  ch->mtr.Owner = ownMQTT;
+  ch->mtr.Action = actBlindsOpen;
+  ch->mtr.IsRunning = true;
+  ch->mtr.currentPosition = position;
+  ch->mtr.targetPosition = target;
+  motorSpeed = 0;
+  motorTravel = 0;
+}
+
+// One control period: move the motor (in the direction of the action), count the rotations, run the control step.
+void step() {
+  hostAdvance(planControlPeriod * 1000);
+  double dt = planControlPeriod / 1000.0;
+  double duty = ch->mtr.IsRunning ? ch->dutyCycle : 0;
+  motorSpeed += (trueSpeed * duty / 255 - motorSpeed) * dt / motorLag;
+  motorTravel += motorSpeed * dt;
+  while (motorTravel >= 1) {
+    motorTravel -= 1;
+    ch->mtr.currentPosition += (ch->mtr.Action == actBlindsClose) ? -1 : 1;
+    ch->lastRotationDebounceTime = millis();
+  }
+  planLearnSpeed(ch);
+  if (ch->plan.Active) {
+    planControl(ch);
+    if (ch->dutyCycle < planMinDuty || ch->dutyCycle > ch->dutyMax) dutyOutOfRange++;
+  }
+}
+
+// Check the rest of the current plan from t (s): continuous and monotonic, ends at the distance at speed 0, never
+// beyond it. Returns false if not.
+bool profileValid(float t) {
+  float speed, last = planPosition(ch->plan, t, &speed);
+  float end = ch->plan.Tstart + ch->plan.Tacc + ch->plan.Tcruise + ch->plan.Tdec;
+  bool ok = true;
+  for (; t <= end + 0.5; t += 0.001) {
+    float p = planPosition(ch->plan, t, &speed);
+    ok &= p - last > -1e-4 && p - last < 0.0021 && p < ch->plan.Distance + 1e-3;
+    last = p;
+  }
+  return ok && fabs(last - ch->plan.Distance) < 1e-3 && speed == 0;
+}
+
+// Planned position jump at a retarget to the given target (rotations).
+float retargetJump(int target) {
+  float speed, t = (millis() - ch->plan.StartTime) / 1000.0;
+  float before = planPosition(ch->plan, t, &speed);
+  ch->mtr.targetPosition = target;
+  planRetarget(ch);
+  return fabsf(planPosition(ch->plan, t, &speed) - before);
+}
+
+// Run until the rotation count reaches the target (the motor task stop), returns the run time (ms).
+unsigned long runToTarget() {
+  unsigned long start = millis();
+  while (ch->mtr.currentPosition < ch->mtr.targetPosition && millis() - start < 300000) step();
+  planStop(ch);
+  return millis() - start;
+}
+
+// The motor task side of a reversal: step it every control period, stop and (re)start the motor as MotorReverse
+// does. Returns when the reversal is done. Records the duty cycles of the deceleration and the time without drive.
+std::vector<int> decelDuty;
+unsigned long offTime;
+void runReversal(int position = 0, bool useCount = true) {
+  unsigned long stopped = 0;
+  decelDuty.clear();
+  offTime = 0;
+  while (ch->retarget.Phase != rtgNone && millis() < 1000000000UL) {
+    step();
+    switch (retargetStep(ch, useCount ? ch->mtr.currentPosition : position)) {
+      case rtsStop:
+        planStop(ch);
+        ch->mtr.IsRunning = false;
+        ch->dutyCycle = 0;
+        stopped = millis();
+        break;
+      case rtsStart:
+        ch->mtr.IsRunning = true;
+        ch->dutyCycle = rampStartDuty;
+        if (!planStart(ch)) ch->dutyCycle = 255;
+        offTime = millis() - stopped;
+        break;
+      default:
+        if (ch->retarget.Phase == rtgDecel) decelDuty.push_back(ch->dutyCycle);
+        break;
+    }
+  }
+}
+
+int main() {
+  // Profile: continuous, monotonic, ends at the distance.
+  resetChannel(10, 70);
+  CHECK(planStart(ch) && ch->plan.Tcruise > 0 && ch->plan.Vmax == 2.0f);
+  float speed, last = 0, total = ch->plan.Tacc + ch->plan.Tcruise + ch->plan.Tdec;
+  float maxStep = 0, minStep = 0;
+  for (float t = 0; t <= total + 0.5; t += 0.001) {
+    float p = planPosition(ch->plan, t, &speed);
+    maxStep = max(maxStep, p - last);
+    minStep = min(minStep, p - last);
+    last = p;
+  }
+  CHECK(fabs(last - 60) < 1e-3 && minStep > -1e-4 && maxStep < 0.0021 && speed == 0);
+
+  resetChannel(10, 11);                           // Too short to reach the learned speed.
+  CHECK(planStart(ch) && ch->plan.Tcruise == 0 && ch->plan.Vmax < ch->learnedSpeed);
+  CHECK(fabs(planPosition(ch->plan, ch->plan.Tacc + ch->plan.Tdec, &speed) - 1) < 1e-4);
+
+  // Not planned: other owner, speed not learned, unknown position, no distance.
+  resetChannel(10, 70); ch->mtr.Owner = ownButton;      CHECK(!planStart(ch));
+  resetChannel(10, 70); ch->learnedSpeed = 0;           CHECK(!planStart(ch));
+  resetChannel(-1, 70);                                 CHECK(!planStart(ch));
+  resetChannel(10, 10);                                 CHECK(!planStart(ch));
+
+  // Speed learner: only intervals between rotations both seen at full duty.
+  resetChannel(0, 100);
+  ch->learnedSpeed = 0;
+  ch->dutyCycle = 255;
+  for (int r = 0; r < 10; r++) {
+    hostAdvance(400000);
+    ch->mtr.currentPosition++;
+    ch->lastRotationDebounceTime = millis();
+    planLearnSpeed(ch);
+  }
+  CHECK(fabs(ch->learnedSpeed - 2.5) < 1e-3);
+  ch->dutyCycle = 200;
+  for (int r = 0; r < 3; r++) {
+    hostAdvance(800000);
+    ch->mtr.currentPosition++;
+    ch->lastRotationDebounceTime = millis();
+    planLearnSpeed(ch);
+  }
+  CHECK(fabs(ch->learnedSpeed - 2.5) < 1e-3);
+
+  // Planned moves on the simulated motor. The speed learned (2.0) is wrong for the slower and faster motors; the
+  // second move of those starts with the speed learned during the first.
+  printf("  move (rotations)                plan (ms)  run (ms)  max error  samples\n");
+  struct { const char* Name; int From, To; double Speed; bool Again; float MaxError; } moves[] = {
+    {"60, speed learned", 10, 70, 2.0, false, 1.5}, {"2, speed learned", 10, 12, 2.0, false, 1.5},
+    {"60, motor 20% slower", 10, 70, 1.6, false, 15}, {"60, motor 20% slower, again", 10, 70, 1.6, true, 1.5},
+    {"60, motor 20% faster", 10, 70, 2.4, false, 3}, {"60, motor 20% faster, again", 10, 70, 2.4, true, 1.5},
+  };
+  float learned = 2.0;
+  for (auto& m : moves) {
+    resetChannel(m.From, m.To);
+    if (m.Again) ch->learnedSpeed = learned;
+    trueSpeed = m.Speed;
+    dutyOutOfRange = 0;
+    CHECK(planStart(ch));
+    unsigned long run = runToTarget();
+    learned = ch->learnedSpeed;
+    int planMs = (int) ((ch->plan.Tacc + ch->plan.Tcruise + ch->plan.Tdec) * 1000);
+    CHECK(ch->mtr.currentPosition == m.To && ch->plan.Done && !ch->plan.Active && dutyOutOfRange == 0);
+    CHECK(ch->plan.MaxError < m.MaxError);
+    printf("  %-31s %9d %9lu %10.2f %8d\n", m.Name, planMs, run, ch->plan.MaxError, ch->plan.SampleCount);
+  }
+  trueSpeed = 2.0;
+
+  StaticJsonDocument<1024> doc;
+  JsonObject summary = doc.to<JsonObject>();
+  planToJson(summary, ch);
+  CHECK(summary["dist"].as<int>() == 60 && summary["endErr"].as<float>() == 0);
+  CHECK(summary["err"].as<JsonArray>().size() == (size_t) ch->plan.SampleCount);
+
+  // Retarget, same direction: the re-plan continues from the planned position and speed.
+  resetChannel(0, 60);
+  planStart(ch);
+  for (int r = 0; r < 200; r++) step();           // Cruising.
+  CHECK(retargetJump(100) < 1e-3 && profileValid((millis() - ch->plan.StartTime) / 1000.0));
+  float t;
+  int ahead;
+  do {                                            // A target closer than the stopping distance (0.8 rotations).
+    step();
+    t = (millis() - ch->plan.StartTime) / 1000.0;
+    float planned = planPosition(ch->plan, t, &speed);
+    ahead = (int) ceil(planned);
+    if (ahead - planned < 0.05) ahead = -1;
+  } while (ahead < 0 || ahead - planPosition(ch->plan, t, &speed) > 0.5);
+  CHECK(speed > 1.5 && ahead < ch->plan.Distance);
+  CHECK(retargetJump(ahead) < 1e-3 && profileValid(t) && ch->plan.Tacc == 0 && ch->plan.Tcruise == 0);
+  CHECK(ch->plan.Tdec < planDecelTime / 1000.0);   // Harder than the normal deceleration.
+  runToTarget();
+  CHECK(ch->mtr.currentPosition == ahead);
+  float shortSpeed = motorSpeed;                    // Speed when the rotation count reached the target.
+
+  resetChannel(0, 60);                              // While decelerating to the first target: lengthened again.
+  planStart(ch);
+  while (millis() - ch->plan.StartTime < (ch->plan.Tacc + ch->plan.Tcruise + 0.3) * 1000) step();
+  CHECK(retargetJump(90) < 1e-3 && profileValid((millis() - ch->plan.StartTime) / 1000.0) && ch->plan.V0 > 0);
+  runToTarget();
+  CHECK(ch->mtr.currentPosition == 90 && ch->plan.MaxError < 1.5);
+
+  resetChannel(0, 60);                              // Target the plan already passed: the plan ends there.
+  planStart(ch);
+  for (int r = 0; r < 300; r++) step();
+  t = (millis() - ch->plan.StartTime) / 1000.0;
+  ch->mtr.targetPosition = (int) planPosition(ch->plan, t, &speed) - 1;
+  planRetarget(ch);
+  CHECK(planPosition(ch->plan, t, &speed) == ch->plan.Distance && speed == 0);
+
+  // Retarget storm: a new target in the same direction every 50 ms for 3 s (slider dragged), then the last one.
+  // Every third target is shortened to just ahead of the rotation count.
+  std::mt19937 rng(7);
+  float maxJump = 0, maxStormError = 0;
+  unsigned long maxRun = 0;
+  int storms = 200;
+  int missed = 0, invalid = 0;
+  for (int n = 0; n < storms; n++) {
+    resetChannel(0, 40);
+    dutyOutOfRange = 0;
+    planStart(ch);
+    for (int r = 0; r < 300; r++) {
+      step();
+      if (r % 5 == 4) {
+        t = (millis() - ch->plan.StartTime) / 1000.0;
+        float planned = planPosition(ch->plan, t, &speed);
+        int target = ch->mtr.currentPosition + ((r % 15 == 14) ? 1 + rng() % 3 : 1 + rng() % 60);
+        float jump = retargetJump(target);
+        if (target > planned) maxJump = max(maxJump, jump);
+        if (!profileValid(t)) invalid++;
+      }
+    }
+    ch->mtr.targetPosition = ch->mtr.currentPosition + 1 + rng() % 60;
+    planRetarget(ch);
+    maxRun = max(maxRun, runToTarget() + 3000);      // 3 s of retargets before.
+    if (ch->mtr.currentPosition != ch->mtr.targetPosition) missed++;
+    maxStormError = max(maxStormError, ch->plan.MaxError);
+    CHECK(dutyOutOfRange == 0);
+  }
+  CHECK(missed == 0 && invalid == 0 && maxJump < 1e-3);
+  printf("  %d retarget storms (60 retargets each): max error %.2f rot, max planned position jump %.4f rot, "
+         "longest move %lu ms\n", storms, maxStormError, maxJump, maxRun);
+  printf("  shortened target: motor speed at the target %.2f rot/s (at planMinDuty %.2f, learned speed %.1f)\n",
+         shortSpeed, ch->learnedSpeed * planMinDuty / 255, ch->learnedSpeed);
+
+  // Reversal: decelerate to 0 over retargetDecelTime, driver off for retargetDeadTime, restart to the target.
+  resetChannel(0, 60);
+  planStart(ch);
+  while (ch->mtr.currentPosition < 30) step();
+  retargetMove(ch, actBlindsClose, 10);
+  CHECK(ch->retarget.Phase == rtgDecel && !ch->plan.Active && ch->mtr.targetPosition == 60);
+  int from = ch->mtr.currentPosition;
+  retargetMove(ch, actBlindsClose, 5);            // Newer target during the reversal replaces the pending one.
+  runReversal();
+  bool falling = decelDuty.size() >= (size_t) (retargetDecelTime / planControlPeriod) - 1;
+  for (size_t i = 1; i < decelDuty.size(); i++) falling &= decelDuty[i] <= decelDuty[i - 1];
+  CHECK(falling && decelDuty.back() < 255 * planControlPeriod / retargetDecelTime * 2);
+  CHECK(offTime >= (unsigned long) retargetDeadTime && offTime < (unsigned long) retargetDeadTime + 2 * planControlPeriod);
+  CHECK(ch->mtr.IsRunning && ch->mtr.Action == actBlindsClose && ch->mtr.targetPosition == 5 && ch->mtr.Owner == ownMQTT);
+  CHECK(ch->mtr.currentPosition >= from);         // Coasted on in the old direction, did not reverse under drive.
+  CHECK(ch->plan.Active && ch->plan.Distance == ch->mtr.currentPosition - 5);
+  while (ch->mtr.currentPosition > 5 && millis() < 1000000000UL) step();
+  CHECK(ch->mtr.currentPosition == 5);
+
+  // Reversal that ends where the blinds already are, or at a limit switch set: no restart.
+  resetChannel(20, 60);
+  ch->mtr.IsRunning = true;
+  retargetMove(ch, actBlindsClose, 0);
+  ch->retarget.Target = 20;
+  runReversal(20, false);
+  CHECK(!ch->mtr.IsRunning && ch->retarget.Phase == rtgNone);
+  resetChannel(20, 60);
+  retargetMove(ch, actBlindsClose, 0);
+  ch->swcClosed.Set = true;
+  runReversal();
+  CHECK(!ch->mtr.IsRunning);
+
+  // Position unknown: the direction of the request. Started by something else during the dead-time: left alone.
+  resetChannel(20, 60);
+  retargetMove(ch, actBlindsClose, -1);
+  runReversal(-1, false);
+  CHECK(ch->mtr.IsRunning && ch->mtr.Action == actBlindsClose && !ch->plan.Active);
+  resetChannel(20, 60);
+  retargetMove(ch, actBlindsClose, 0);
+  while (ch->retarget.Phase != rtgDeadTime) {
+    step();
+    if (retargetStep(ch, ch->mtr.currentPosition) == rtsStop) ch->mtr.IsRunning = false;
+  }
+  ch->mtr.IsRunning = true;                       // A button press.
+  ch->mtr.Owner = ownButton;
+  hostAdvance(retargetDeadTime * 1000);
+  CHECK(retargetStep(ch, ch->mtr.currentPosition) == rtsNone && ch->retarget.Phase == rtgNone && ch->mtr.Owner == ownButton);
+
+  return hostTestDone("test_motionplanner");
+}
@@ -0,0 +1,136 @@
+/*******************************************************************************
+ * test_motordriver
+ * - The LEDC backend of MotorDriver.h on the host pins: direction and duty, coast and brake stops (brake released
+ *   by the timer wheel after driverBrakeTime), the stopping distance per mode, and the limit switch cut-off.
+********************************************************************************/
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <esp_timer.h>
+#include "configuration.h"
+#include "MotorJournal.h"
+#include "TimerWheel.h"
+#include "MotorDriver.h"
+#include "HostTest.h"
+
+BlindChannel channel;
+BlindChannel* ch = &channel;
+const ChannelPins& pin = channelPins[0];
+
+bool enabled() { return hostPin[pin.REN] == HIGH && hostPin[pin.LEN] == HIGH; }
+bool disabled() { return hostPin[pin.REN] == LOW && hostPin[pin.LEN] == LOW; }
+
+void tick(int ms) {
+  for (int i = 0; i < ms / wheelTick; i++) {
+    hostAdvance(wheelTick * 1000);
+    onTimerWheel(NULL);
+    driverService(ch);
+  }
+}
+
+// A run of the given rotations, stopped, followed by the rotations the motor turns on after the stop.
+void run(int rotations, int after, bool wasRunning = true) {
+  journalRunStart(0, ownMQTT, actBlindsOpen, 0);
+  driverEnable(ch);
+  driverDuty(ch, actBlindsOpen, 255);
+  for (int r = 0; r < rotations; r++) journalRotation(0);
+  driverStop(ch, wasRunning);
+  for (int r = 0; r < after; r++) journalRotation(0);
+  tick(driverStopSettleTime);
+  journalRotation(0);                             // Counted after the settle time: not part of the stopping distance.
+  journalRunStop(0, stpMQTT, rotations);
+}
+
+int main() {
+  wheelSetup();
+  hostTask = (TaskHandle_t) 2;
+  ch->Pin = &pin;
+  ch->pwmChannel_Open = 0;
+  ch->pwmChannel_Close = 1;
+  ch->Cfg.Open_MaxRotations = 120;
+  driverSetup(ch);
+  CHECK(disabled() && ch->enMask == ((1UL << pin.REN) | (1UL << pin.LEN)) && ch->enMask1 == 0);
+
+  // Direction and duty.
+  driverEnable(ch);
+  driverDuty(ch, actBlindsOpen, 200);
+  CHECK(enabled() && hostLedc[0] == 200 && hostLedc[1] == 0);
+  driverDuty(ch, actBlindsClose, 120);
+  CHECK(hostLedc[0] == 0 && hostLedc[1] == 120);
+
+  // Coast: disabled at once.
+  driverStop(ch, true);
+  CHECK(disabled() && hostLedc[0] == 0 && hostLedc[1] == 0);
+
+  // Brake: both outputs low with the driver enabled, disabled after driverBrakeTime.
+  ch->Cfg.BrakeOnStop = true;
+  driverEnable(ch);
+  driverDuty(ch, actBlindsOpen, 255);
+  driverStop(ch, true);
+  CHECK(enabled() && hostLedc[0] == 0 && hostLedc[1] == 0);
+  tick(driverBrakeTime - 2 * wheelTick);
+  CHECK(enabled());
+  tick(3 * wheelTick);
+  CHECK(disabled());
+
+  // A new run during the brake ends the brake: the brake timer does not disable the new run.
+  driverEnable(ch);
+  driverStop(ch, true);
+  tick(driverBrakeTime / 2);
+  driverEnable(ch);
+  tick(driverBrakeTime);
+  CHECK(enabled());
+  driverStop(ch, false);                          // Not running (e.g. stop flag while stopped): coast.
+  CHECK(disabled());
+  tick(driverStopSettleTime);
+
+  // Stopping distance per mode: [coast avg, n, brake avg, n].
+  memset(stopDistanceSum, 0, sizeof(stopDistanceSum));
+  memset(stopDistanceCount, 0, sizeof(stopDistanceCount));
+  ch->Cfg.BrakeOnStop = false;
+  run(30, 3);
+  run(30, 4);
+  ch->Cfg.BrakeOnStop = true;
+  run(30, 1);
+  run(30, 0);
+  run(30, 5, false);                              // Not running: not measured.
+  ch->Cfg.Open_MaxRotations = 0;                  // No rotation sensor: not measured.
+  run(30, 5);
+  ch->Cfg.Open_MaxRotations = 120;
+  StaticJsonDocument<256> doc;
+  JsonObject distance = doc.to<JsonObject>();
+  driverStopDistanceToJson(distance);
+  JsonArray modes = distance["0"].as<JsonArray>();
+  CHECK(modes.size() == 4);
+  CHECK(modes[0].as<double>() == 3.5 && modes[1].as<int>() == 2 && modes[2].as<double>() == 0.5 && modes[3].as<int>() == 2);
+
+  // Limit switch cut-off: enable low from the interrupt, counted once, stop delay measured by driverStop.
+  ch->Cfg.BrakeOnStop = false;
+  driverEnable(ch);
+  driverDuty(ch, actBlindsOpen, 255);
+  uint32_t entry = ESP.getCycleCount();
+  hostAdvance(1);
+  driverCutoff(ch, entry);
+  CHECK(disabled() && hostLedc[0] == 255);        // PWM left to the motor task.
+  driverCutoff(ch, entry);                        // Bounce of the same switch.
+  CHECK(cutoffStats.Count == 1 && cutoffStats.MaxCycles == hostCpuMhz);
+  hostAdvance(1500);
+  driverStop(ch, true);
+  CHECK(ch->cutoffTime == 0 && cutoffStats.MaxStop == 1500 && hostLedc[0] == 0);
+
+  // A brake stop after a cut-off brakes: the driver is enabled again for the brake.
+  ch->Cfg.BrakeOnStop = true;
+  driverEnable(ch);
+  driverCutoff(ch, ESP.getCycleCount());
+  hostAdvance(800);
+  driverStop(ch, true);
+  CHECK(enabled() && cutoffStats.Count == 2 && cutoffStats.SumStop == 2300);
+  tick(driverBrakeTime + wheelTick);
+  CHECK(disabled());
+
+  JsonObject cutoff = doc.to<JsonObject>();
+  driverCutoffToJson(cutoff);
+  CHECK(cutoff["n"].as<int>() == 2 && cutoff["stop_us"][0].as<int>() == 1150 && cutoff["stop_us"][1].as<int>() == 1500);
+  CHECK(cutoff["enLow_ns"][1].as<int>() == 1000);
+
+  return hostTestDone("test_motordriver");
+}
@@ -0,0 +1,95 @@
+/*******************************************************************************
+ * test_mqttpublish
+ * - publishJson streamed (default) and buffered (PUBLISH_BUFFERED), both built here: the streamed payload is
+ *   the serialized document byte for byte, in mqttChunkSize socket writes, with the announced length. Payloads
+ *   larger than the client buffer only go out streamed. A failed publish returns 0.
+ * - Prints the socket writes and the payload buffer on the stack for both.
+********************************************************************************/
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <PubSubClient.h>
+#include <esp_timer.h>
+#include "configuration.h"
+namespace streamed {
+#include "MqttPublish.h"
+}
+#define PUBLISH_BUFFERED
+namespace buffered {
+#include "MqttPublish.h"
+}
+#include "HostTest.h"
+
+const char* topic = "livingroom/blinds/app_state";
+
+// A document with the given number of fields, like app_state.
+void fill(DynamicJsonDocument& doc, int fields) {
+  JsonObject obj = doc.to<JsonObject>();
+  char key[16];
+  for (int i = 0; i < fields; i++) {
+    snprintf(key, sizeof(key), "Field %d", i);
+    obj[key] = i * 1000 + 7;
+  }
+}
+
+int main() {
+  PubSubClient client;
+  client.setBufferSize(mqttBufferSize);
+  DynamicJsonDocument doc(8192);
+
+  // Streamed: every size, also exact multiples of the chunk size.
+  int wrongPayload = 0, wrongWrites = 0, largest = 0;
+  for (int fields = 0; fields < 120; fields++) {
+    fill(doc, fields);
+    std::string expected = jsonText(doc);
+    size_t length = streamed::publishJson(client, topic, doc, true);
+    size_t chunks = (expected.size() + mqttChunkSize - 1) / mqttChunkSize;
+    if (length != expected.size() || client.Payload != expected || client.Announced != length || !client.Retained) wrongPayload++;
+    if (client.Writes.size() != 1 + chunks) wrongWrites++;
+    for (size_t i = 1; i + 1 < client.Writes.size(); i++) if (client.Writes[i] != (size_t) mqttChunkSize) wrongWrites++;
+    largest = max(largest, (int) length);
+  }
+  CHECK(wrongPayload == 0 && wrongWrites == 0 && largest > mqttBufferSize);
+  CHECK(streamed::publishStats.Count == 120 && streamed::publishStats.MaxLength == (uint32_t) largest);
+
+  // Buffered: the same payload in one write, as long as it fits the client buffer.
+  for (int fields = 0; fields < 120; fields++) {
+    fill(doc, fields);
+    std::string expected = jsonText(doc);
+    size_t length = buffered::publishJson(client, topic, doc, false);
+    bool fits = hostMqttMaxHeader + 2 + strlen(topic) + expected.size() <= (size_t) mqttBufferSize;
+    if (fits) {
+      CHECK(length == expected.size() && client.Payload == expected && client.Writes.size() == 1);
+    } else {
+      CHECK(length == 0);
+    }
+  }
+
+  // Not connected: 0, counted.
+  client.Connected = false;
+  fill(doc, 10);
+  CHECK(streamed::publishJson(client, topic, doc) == 0 && buffered::publishJson(client, topic, doc) == 0);
+  CHECK(streamed::publishStats.Count == 121);
+  client.Connected = true;
+
+  StaticJsonDocument<128> stats;
+  JsonArray figures = stats.to<JsonArray>();
+  streamed::publishToJson(figures);
+  CHECK(figures[0].as<int>() == 121 && figures[3].as<int>() == largest);
+
+  printf("  payload (bytes)  mode      socket writes  payload buffer on stack (bytes)\n");
+  for (int fields : {8, 40, 80}) {
+    fill(doc, fields);
+    size_t length = streamed::publishJson(client, topic, doc);
+    printf("  %15u  streamed  %13u  %31d\n", (unsigned) length, (unsigned) client.Writes.size(), mqttChunkSize);
+    client.Writes.clear();
+    if (buffered::publishJson(client, topic, doc) == length) {
+      printf("  %15s  buffered  %13u  %31d\n", "", (unsigned) client.Writes.size(), mqttBufferSize);
+    } else {
+      printf("  %15s  buffered  %13s  %31d\n", "", "fails", mqttBufferSize);
+    }
+  }
+  printf("  largest payload that fits buffered: %d bytes (streamed: no limit)\n",
+         mqttBufferSize - hostMqttMaxHeader - 2 - (int) strlen(topic));
+
+  return hostTestDone("test_mqttpublish");
+}
@@ -0,0 +1,146 @@
+/*******************************************************************************
+ * test_ota
+ * - A pulled, compressed image: a generated image larger than 64KB, packed by tools/ota_image.py, streamed
+ *   through otaInflate in reads of several sizes and compared byte for byte with the written image. Back-references
+ *   up to the full 32KB dictionary make the inflater read across the dictionary wrap, and the last reads check
+ *   that TINFL_FLAG_HAS_MORE_INPUT is cleared exactly when all input is received. A stream that ends early, a
+ *   truncated and a corrupted image fail.
+ * - otaPull: the image MD5 from the x-MD5 header is checked when flashed, an image without it is refused.
+ * - Prints the image and packed size and the host time to inflate it.
+********************************************************************************/
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <chrono>
+#include <random>
+#include "configuration.h"
+#include "OTA.h"
+#include "HostTest.h"
+
+const char* imagePath = "build/ota_image.bin";
+
+// Firmware-like image: incompressible runs, repeated text, and copies of earlier data from up to 32KB back.
+std::string makeImage(size_t size) {
+  std::mt19937 rng(47);
+  std::string image;
+  while (image.size() < size) {
+    int kind = rng() % 3;
+    if (kind == 0) {
+      for (int n = 500 + rng() % 2500; n > 0; n--) image += (char) rng();
+    } else if (kind == 1) {
+      for (int n = 20 + rng() % 80; n > 0; n--) image += "ledc_set_duty(channel, duty); ";
+    } else if (image.size() > TINFL_LZ_DICT_SIZE) {
+      size_t from = image.size() - (TINFL_LZ_DICT_SIZE - rng() % 2000);
+      image += image.substr(from, 100 + rng() % 1900);
+    }
+  }
+  return image;
+}
+
+std::string readFile(const std::string& path) {
+  std::string data;
+  if (FILE* f = fopen(path.c_str(), "rb")) {
+    char buffer[4096];
+    for (size_t n; (n = fread(buffer, 1, sizeof(buffer), f)) > 0; ) data.append(buffer, n);
+    fclose(f);
+  }
+  return data;
+}
+
+// Pack the image with the tool. Returns the MD5 it reports ("" if it failed).
+std::string packImage(const std::string& image) {
+  FILE* f = fopen(imagePath, "wb");
+  if (f == nullptr) return "";
+  fwrite(image.data(), 1, image.size(), f);
+  fclose(f);
+  std::string out;
+  if (FILE* p = popen((std::string("python3 ../../tools/ota_image.py pack ") + imagePath).c_str(), "r")) {
+    char line[256];
+    while (fgets(line, sizeof(line), p)) out += line;
+    if (pclose(p) != 0) return "";
+  }
+  size_t at = out.find("md5 ");
+  return at == std::string::npos ? "" : out.substr(at + 4, 32);
+}
+
+// Stream data through otaInflate, as otaPull does after Update.begin. length = announced size.
+bool inflate(const std::string& data, uint32_t length, std::vector<size_t> reads) {
+  otaStatus.Received = 0;
+  otaStatus.Size = 0;
+  otaStatus.Progress = 0;
+  hostStream.Data = data;
+  hostStream.Offset = 0;
+  hostStream.ReadCount = 0;
+  hostStream.Reads = reads;
+  hostTinflWraps = 0;
+  hostTinflEndCalls = 0;
+  hostTinflEndInput = 0;
+  Update.begin();
+  WiFiClient client;
+  return otaInflate(&client, length);
+}
+
+// Pull an image over the shimmed HTTP client.
+void pull(const char* url, const std::string& data, const char* md5) {
+  hostStream.Data = data;
+  hostStream.Reads = {};
+  hostHttp.Headers.clear();
+  if (md5) hostHttp.Headers["x-MD5"] = md5;
+  Update.Image.clear();
+  Update.Running = false;
+  otaPull(url);
+}
+
+int main() {
+  std::string image = makeImage(200000);
+  std::string md5 = packImage(image);
+  std::string packed = readFile(std::string(imagePath) + ".zz");
+  CHECK(image.size() > 65536 && packed.size() > 65536);
+  CHECK(md5 == hostMd5((const uint8_t*) image.data(), image.size()));
+
+  // Byte for byte, with full reads (the last one short), odd sizes, and single bytes.
+  std::vector<std::vector<size_t>> patterns = {{}, {1, 7, 1024, 300, 13}, {1}, {otaRxBufferSize - 1}};
+  for (auto& reads : patterns) {
+    auto start = std::chrono::steady_clock::now();
+    bool ok = inflate(packed, packed.size(), reads);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    CHECK(ok);
+    CHECK(std::string(Update.Image.begin(), Update.Image.end()) == image);
+    CHECK(otaStatus.Received == packed.size() && otaStatus.Size == image.size());
+    CHECK(hostTinflWraps == (int) (image.size() / TINFL_LZ_DICT_SIZE));
+    CHECK(hostTinflEndCalls > 0 && hostTinflEndInput == packed.size());        // Flag cleared with all input in.
+    printf("  reads %-18s %zu -> %zu bytes (%.1f%%), %zu reads, %d wraps, inflate %.1fms\n",
+           reads.empty() ? "full" : std::to_string(reads[0]).append(reads.size() > 1 ? ",.." : "").c_str(),
+           packed.size(), image.size(), 100.0 * packed.size() / image.size(), hostStream.ReadCount,
+           hostTinflWraps, ms);
+  }
+
+  // The stream ends early: receive timeout.
+  CHECK(!inflate(packed.substr(0, packed.size() - 500), packed.size(), {}));
+  CHECK(otaStatus.Received == packed.size() - 500);
+  // Truncated image: the inflater runs out of input at the end.
+  CHECK(!inflate(packed.substr(0, packed.size() - 500), packed.size() - 500, {}));
+  CHECK(hostTinflEndCalls > 0);
+  // Corrupted image.
+  std::string corrupt = packed;
+  corrupt[packed.size() / 2] ^= 0x55;
+  CHECK(!inflate(corrupt, corrupt.size(), {1024}));
+
+  // otaPull: the motors stop at once, the MD5 of the decompressed image is checked.
+  hostDelayHook = [] { otaStatus.MotorsStopped = true; };
+  pull("http://host:8070/ota_image.bin.zz", packed, md5.c_str());
+  CHECK(otaStatus.Phase == otaDone && Update.Md5 == md5);
+  CHECK(std::string(Update.Image.begin(), Update.Image.end()) == image);
+  pull("http://host:8070/ota_image.bin", image, md5.c_str());
+  CHECK(otaStatus.Phase == otaDone && otaStatus.Size == image.size() && !Update.Aborted);
+  CHECK(std::string(Update.Image.begin(), Update.Image.end()) == image);
+
+  std::string wrong = md5;
+  wrong[0] = wrong[0] == '0' ? '1' : '0';
+  pull("http://host:8070/ota_image.bin.zz", packed, wrong.c_str());
+  CHECK(otaStatus.Phase == otaFailed && otaStatus.Error == OTA_END_ERROR);
+  pull("http://host:8070/ota_image.bin.zz", packed, nullptr);
+  CHECK(otaStatus.Phase == otaFailed && otaStatus.Error == OTA_BEGIN_ERROR);
+  CHECK(!Update.Running && Update.Image.empty() && hostStream.ReadCount == 0);
+
+  return hostTestDone("test_ota");
+}
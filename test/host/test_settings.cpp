@@ -0,0 +1,70 @@
+/*******************************************************************************
+ * test_settings
+ * - settingInt range checks, and the int settings in NVS: a cleared ButtonPreset (-1) must still be cleared
+ *   after a reboot, a rejected value must leave the stored one.
+********************************************************************************/
+#include <Arduino.h>
+#include <TelnetStream.h>
+#include "configuration.h"
+#include "Settings.h"
+#include "HostTest.h"
+
+// What the ButtonPreset command does (remoteAppAction), and what loadChannelConfig reads back after a reboot.
+bool setButtonPreset(const char* text, int* ramValue) {
+  int value;
+  if (!settingInt(text, -1, 100, &value)) return false;
+  *ramValue = value;
+  updatePreferences("ch0", "ButtonPreset", String(value).c_str(), "int");
+  return true;
+}
+
+int bootButtonPreset() {
+  Preferences nvs;
+  nvs.begin("ch0", true);
+  int value = nvs.getInt("ButtonPreset", -1);
+  nvs.end();
+  return value;
+}
+
+int main() {
+  int value = 7;
+
+  // Whole numbers within the range only, value untouched otherwise.
+  CHECK(settingInt("-1", -1, 100, &value) && value == -1);
+  CHECK(settingInt("100", -1, 100, &value) && value == 100);
+  CHECK(settingInt("0", 0, INT32_MAX, &value) && value == 0);
+  value = 7;
+  const char* invalid[] = { "", "-", "-2", "101", "abc", "5x", "5 ", "1.5", "0x10", "99999999999", "-99999999999" };
+  for (const char* text : invalid) {
+    CHECK(!settingInt(text, -1, 100, &value));
+  }
+  CHECK(value == 7);
+  CHECK(!settingInt("-1", 0, INT32_MAX, &value));                 // Negative durations are rejected by their command.
+
+  // Set, reboot, clear, reboot.
+  int ram = -1;
+  CHECK(bootButtonPreset() == -1);                                // Never set: default none.
+  CHECK(setButtonPreset("50", &ram) && ram == 50);
+  CHECK(bootButtonPreset() == 50);
+  CHECK(setButtonPreset("-1", &ram) && ram == -1);
+  CHECK(bootButtonPreset() == -1);                                // Cleared preset stays cleared.
+  Preferences nvs;
+  nvs.begin("ch0", true);
+  CHECK(nvs.isKey("ButtonPreset") && nvs.getInt("ButtonPreset", 42) == -1);   // Stored, not just the default.
+  nvs.end();
+
+  // A rejected command leaves RAM and NVS as they were.
+  CHECK(setButtonPreset("30", &ram) && bootButtonPreset() == 30);
+  CHECK(!setButtonPreset("-5", &ram) && ram == 30 && bootButtonPreset() == 30);
+  CHECK(!setButtonPreset("3O", &ram) && ram == 30 && bootButtonPreset() == 30);
+
+  // updatePreferences itself stores any int, and refuses what is not one.
+  updatePreferences("app", "StateInterval", "-3", "int");
+  updatePreferences("app", "LuxInterval", "12abc", "int");
+  nvs.begin("app", true);
+  CHECK(nvs.getInt("StateInterval", 0) == -3);
+  CHECK(!nvs.isKey("LuxInterval"));
+  nvs.end();
+
+  return hostTestDone("test_settings");
+}
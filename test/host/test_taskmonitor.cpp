@@ -0,0 +1,81 @@
+/*******************************************************************************
+ * test_taskmonitor
+ * - Stack high-water marks and the recommended stack size, heap figures, and the wake-up jitter of a fixed-rate
+ *   task (vTaskDelayUntil) with injected late wake-ups: each late tick counted once, at its own lateness.
+ * - Prints the measured jitter figures against the injected ones.
+********************************************************************************/
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <esp_timer.h>
+#include <random>
+#include "configuration.h"
+#include "TaskMonitor.h"
+#include "HostTest.h"
+
+int main() {
+  // Stacks: the lowest free stack is kept, the recommendation is used + 25% + margin, in 256 byte steps.
+  taskMonitorRegister("motor", (TaskHandle_t) 1, 4096);
+  taskMonitorRegister("none", NULL, 4096);        // No handle: not registered.
+  CHECK(monitorTaskCount == 1);
+  hostStackFree[1] = 3000;
+  taskMonitorCollect();
+  hostStackFree[1] = 3500;
+  taskMonitorCollect();
+  CHECK(monitorTasks[0].MinFreeStack == 3000);
+  CHECK(taskMonitorRecommendedStack(monitorTasks[0]) == 2048);    // 1096 + 274 + 512 = 1882 -> 2048
+  for (int i = 0; i < monitorMaxTasks + 2; i++) taskMonitorRegister("extra", (TaskHandle_t) 2, 2048);
+  CHECK(monitorTaskCount == monitorMaxTasks);
+
+  // Heap: fragmentation from the largest block.
+  hostHeapFree = 200000;
+  hostHeapMinFree = 150000;
+  hostHeapLargest = 120000;
+  taskMonitorCollect();
+  CHECK(monitorHeap.Fragmentation == 40 && monitorHeap.MinFreeHeap == 150000);
+
+  StaticJsonDocument<512> doc;
+  JsonObject tasks = doc.to<JsonObject>();
+  taskMonitorToJson(tasks);
+  CHECK(tasks["motor"][0].as<int>() == 4096 && tasks["motor"][1].as<int>() == 3000 && tasks["motor"][2].as<int>() == 2048);
+
+  // Jitter: a vTaskDelayUntil task, on schedule every period (+ small noise), with some late wake-ups.
+  // vTaskDelayUntil keeps the schedule, the tick after a late one is on time again.
+  const uint32_t period = planControlPeriod * 1000;
+  const int ticks = 100000;
+  std::mt19937 rng(5);
+  uint32_t injectedMax = 0, injectedLate = 0;
+  uint64_t injectedSum = 0;
+  int64_t start = 1000000;
+  for (int n = 0; n < ticks; n++) {
+    uint32_t lateness = rng() % 50;                                 // Wake-up noise (us).
+    if (rng() % 100 == 0) lateness = 500 + rng() % 4500;            // 1%: woken late (e.g. WiFi interrupt).
+    if (n > 0) {                                                     // The first tick is the reference.
+      injectedSum += lateness;
+      injectedMax = max(injectedMax, lateness);
+      if (lateness > (uint32_t) jitterLateThreshold) injectedLate++;
+    } else {
+      lateness = 0;
+    }
+    taskJitterSample(motionJitter, start + (int64_t) n * period + lateness, period);
+  }
+  JsonArray jitter = doc.to<JsonArray>();
+  taskJitterToJson(jitter, motionJitter);
+  printf("  %d ticks       n      avg (us)  max (us)  late\n", ticks);
+  printf("  injected  %7d  %8.1f  %8u  %4u\n", ticks - 1, (double) injectedSum / (ticks - 1), injectedMax, injectedLate);
+  printf("  measured  %7u  %8u  %8u  %4u\n", motionJitter.Count, jitter[1].as<unsigned>(), motionJitter.Max, motionJitter.Late);
+  CHECK(motionJitter.Count == (uint32_t) ticks - 1);
+  CHECK(motionJitter.Max == injectedMax && motionJitter.Late == injectedLate);
+  CHECK(motionJitter.Sum == injectedSum);
+
+  // A task that overran its period: vTaskDelayUntil returns at once, until it is back on schedule.
+  motionJitter.ResetRequest = true;
+  taskJitterSample(motionJitter, start, period);
+  CHECK(motionJitter.Count == 0);                 // Reset, new reference.
+  taskJitterSample(motionJitter, start + 3 * period, period);       // Two periods overrun.
+  taskJitterSample(motionJitter, start + 3 * period + 10, period);  // Catching up.
+  taskJitterSample(motionJitter, start + 3 * period + 20, period);
+  taskJitterSample(motionJitter, start + 4 * period, period);       // On schedule.
+  CHECK(motionJitter.Count == 4 && motionJitter.Max == 2 * period && motionJitter.Late == 2);
+
+  return hostTestDone("test_taskmonitor");
+}
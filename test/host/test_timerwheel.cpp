@@ -0,0 +1,125 @@
+/*******************************************************************************
+ * test_timerwheel
+ * - Expiry at the right tick (also beyond one wheel turn), periodic timers, cancel, callbacks called with the
+ *   wheel unlocked, an expiry dropped when the timer is cancelled or armed again by an earlier callback of the
+ *   same tick, and the wheelMaxDue overflow moving to the next tick.
+ * - Prints the host time of a tick.
+********************************************************************************/
+#include <Arduino.h>
+#include <chrono>
+#include "configuration.h"
+#include "TimerWheel.h"
+#include "HostTest.h"
+
+int calls[64];
+int lockedCalls = 0;
+uint32_t lastTick[64];
+
+void onCount(void* arg) {
+  int i = (int) (intptr_t) arg;
+  calls[i]++;
+  lastTick[i] = wheelNow;
+  if (muxWheel.Locked != 0) lockedCalls++;
+}
+
+WheelTimer timers[64];
+void onCancelNext(void* arg) {
+  onCount(arg);
+  wheelCancel(timers[1]);                         // Due in the same tick, collected already.
+  wheelArm(timers[2], 5);                         // Due in the same tick: moves 5 ms on.
+}
+
+void tick(int n) {
+  for (int i = 0; i < n; i++) {
+    hostAdvance(wheelTick * 1000);
+    onTimerWheel(NULL);
+  }
+}
+
+int main() {
+  wheelSetup();
+  CHECK(tmrWheel->Period == wheelTick * 1000ULL);
+  hostTask = (TaskHandle_t) 2;                    // The tick runs as the esp_timer task, the test as another task.
+
+  // One-shot: called once, at its tick. Also beyond one wheel turn.
+  for (int i = 0; i < 3; i++) wheelInit(timers[i], onCount, (void*) (intptr_t) i);
+  uint32_t start = wheelNow;
+  wheelArm(timers[0], 10);
+  wheelArm(timers[1], wheelSlots * 3 + 7);
+  wheelArm(timers[2], 0);                         // Earliest: the next tick.
+  tick(1);
+  CHECK(calls[2] == 1);
+  tick(8);
+  CHECK(calls[0] == 0);
+  tick(1);
+  CHECK(calls[0] == 1 && lastTick[0] == start + 10);
+  tick(wheelSlots * 4);
+  CHECK(calls[0] == 1 && calls[1] == 1 && lastTick[1] == start + wheelSlots * 3 + 7);
+  CHECK(calls[2] == 1);
+
+  // Periodic (the debounce sampler: every tick), and cancel.
+  memset(calls, 0, sizeof(calls));
+  wheelInit(timers[3], onCount, (void*) 3);
+  wheelInit(timers[4], onCount, (void*) 4);
+  wheelArm(timers[3], debounceSampleInterval, debounceSampleInterval);
+  wheelArm(timers[4], heartbeatCheckInterval, heartbeatCheckInterval);
+  tick(1000);
+  CHECK(calls[3] == 1000 / debounceSampleInterval);
+  CHECK(calls[4] == 1000 / heartbeatCheckInterval);
+  wheelCancel(timers[3]);
+  wheelCancel(timers[4]);
+  tick(1000);
+  CHECK(calls[3] == 1000 / debounceSampleInterval && calls[4] == 1000 / heartbeatCheckInterval);
+  CHECK(lockedCalls == 0);                        // Never called with the wheel locked.
+
+  // A callback cancels and re-arms timers that expire in the same tick, after it.
+  memset(calls, 0, sizeof(calls));
+  wheelInit(timers[0], onCancelNext, (void*) 0);
+  wheelInit(timers[1], onCount, (void*) 1);
+  wheelInit(timers[2], onCount, (void*) 2);
+  wheelArm(timers[2], 20);                        // Linked first: called last (slot list is LIFO).
+  wheelArm(timers[1], 20);
+  wheelArm(timers[0], 20);
+  tick(20);
+  CHECK(calls[0] == 1 && calls[1] == 0 && calls[2] == 0);
+  tick(5);
+  CHECK(calls[1] == 0 && calls[2] == 1);
+
+  // Cancel from the task calling the callbacks does not wait for itself.
+  hostTask = wheelTask;
+  timers[1].Running = true;
+  wheelCancel(timers[1]);
+  timers[1].Running = false;
+  hostTask = (TaskHandle_t) 2;
+
+  // More than wheelMaxDue timers in one tick: the rest are called on the next tick.
+  memset(calls, 0, sizeof(calls));
+  const int many = wheelMaxDue + 4;
+  for (int i = 0; i < many; i++) {
+    wheelInit(timers[i], onCount, (void*) (intptr_t) i);
+    wheelArm(timers[i], 3);
+  }
+  tick(3);
+  int called = 0;
+  for (int i = 0; i < many; i++) called += calls[i];
+  CHECK(called == wheelMaxDue);
+  tick(1);
+  called = 0;
+  for (int i = 0; i < many; i++) called += calls[i] == 1;
+  CHECK(called == many);
+
+  // Host time of a tick with wheelMaxDue periodic timers due, and of an idle tick.
+  for (int i = 0; i < wheelMaxDue; i++) wheelArm(timers[i], 1, 1);
+  auto t0 = std::chrono::steady_clock::now();
+  tick(100000);
+  auto t1 = std::chrono::steady_clock::now();
+  for (int i = 0; i < wheelMaxDue; i++) wheelCancel(timers[i]);
+  tick(100000);
+  auto t2 = std::chrono::steady_clock::now();
+  printf("  tick (host): %.0f ns with %d timers due, %.0f ns idle\n",
+         std::chrono::duration<double, std::nano>(t1 - t0).count() / 100000, wheelMaxDue,
+         std::chrono::duration<double, std::nano>(t2 - t1).count() / 100000);
+  CHECK(lockedCalls == 0);
+
+  return hostTestDone("test_timerwheel");
+}
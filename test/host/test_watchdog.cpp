@@ -0,0 +1,110 @@
+/*******************************************************************************
+ * test_watchdog
+ * - The motor task fail-safe on simulated hangs: the motor task feeds the heartbeat every pass, the supervisor
+ *   ISR runs on its own hardware timer and cuts the enable pins of the running channel (driverDisable), once per
+ *   hang. The timer wheel is never ticked: the supervisor does not depend on it.
+ * - Prints per hang length how often the fail-safe tripped, and the time from the hang to the cut.
+********************************************************************************/
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <esp_timer.h>
+#include <esp_ipc.h>
+#include <random>
+#include "configuration.h"
+#include "MotorJournal.h"
+#include "TimerWheel.h"
+#include "MotorDriver.h"
+#include "MotorWatchdog.h"
+#include "HostTest.h"
+
+BlindChannel channel;
+BlindChannel* ch = &channel;
+portMUX_TYPE muxTimer = portMUX_INITIALIZER_UNLOCKED;
+int64_t cutTime = 0;                              // Time of the last cut (us, 0 = none).
+int cuts = 0;
+
+// The supervisor as in main (isrTimerWatchdog), for one channel.
+void isrTimerWatchdog() {
+  if (!watchdogFailSafe(esp_timer_get_time())) return;
+  if (!ch->mtr.IsRunning) return;
+  driverDisable(ch);
+  cutTime = esp_timer_get_time();
+  cuts++;
+  portENTER_CRITICAL_ISR(&muxTimer);
+  watchdogTrips++;
+  watchdogTripped = true;
+  portEXIT_CRITICAL_ISR(&muxTimer);
+}
+
+// Run for the given time (ms). The motor task passes every motorTaskInterval, unless hung.
+void run(int ms, bool hung) {
+  for (int i = 0; i < ms; i++) {
+    hostAdvance(1000);
+    hostTimerTick();
+    if (!hung && i % motorTaskInterval == 0) watchdogFeed();
+  }
+}
+
+int main() {
+  wheelSetup();
+  hostTask = (TaskHandle_t) 2;
+  ch->Pin = &channelPins[0];
+  driverSetup(ch);
+  watchdogStart(isrTimerWatchdog);
+  CHECK(hostTimer[watchdogTimer].Isr == isrTimerWatchdog && hostTimer[watchdogTimer].Alarm == heartbeatCheckInterval * 1000ULL);
+  CHECK(hostIpcCore == (uint32_t) watchdogCore && watchdogCore != coreMotorTask);
+
+  // Not started: no heartbeat, no trip.
+  run(2000, true);
+  CHECK(cuts == 0 && heartbeatMaxGap == 0);
+  CHECK(watchdogRegister());
+  CHECK(hostWdtInits == 1 && hostWdtPanic && hostWdtTimeout == (uint32_t) taskWatchdogTimeout && hostWdtAdds == 1);
+  run(1000, false);
+  CHECK(hostWdtResets == 1000 && heartbeatMaxGap <= (uint32_t) motorTaskInterval * 1000);
+
+  // Motor stopped: a hang is recorded, nothing to cut.
+  run(1000, true);
+  run(100, false);
+  CHECK(cuts == 0 && heartbeatMaxGap >= 900000);
+
+  // Hangs of several lengths, at a random phase to the supervisor timer.
+  printf("  hang (ms)  tripped  hang to cut (ms) min / max\n");
+  std::mt19937 rng(11);
+  int hangs[] = {100, 400, 499, 500, 550, 600, 700, 1000, 5000};
+  for (int hang : hangs) {
+    int tripped = 0;
+    int64_t minCut = INT64_MAX, maxCut = 0;
+    for (int n = 0; n < 100; n++) {
+      run(rng() % heartbeatCheckInterval, false);
+      ch->mtr.IsRunning = true;
+      driverEnable(ch);
+      int before = cuts;
+      int64_t start = esp_timer_get_time();
+      run(hang, true);
+      int64_t end = esp_timer_get_time();
+      run(200, false);                            // Recovers.
+      CHECK(cuts - before <= 1);                  // Once per hang.
+      if (cuts > before) {
+        tripped++;
+        CHECK(hostPin[ch->Pin->REN] == LOW && hostPin[ch->Pin->LEN] == LOW && cutTime <= end + motorTaskInterval * 1000);
+        minCut = min(minCut, cutTime - start);
+        maxCut = max(maxCut, cutTime - start);
+      } else {
+        CHECK(hostPin[ch->Pin->REN] == HIGH);
+      }
+      ch->mtr.IsRunning = false;
+    }
+    if (hang + motorTaskInterval <= heartbeatTimeout) CHECK(tripped == 0);        // Heartbeat gap: hang + one pass.
+    if (hang >= heartbeatTimeout + heartbeatCheckInterval) CHECK(tripped == 100);
+    if (tripped > 0) CHECK(maxCut <= (heartbeatTimeout + heartbeatCheckInterval) * 1000LL);
+    if (tripped > 0) printf("  %9d  %7d  %8lld / %lld\n", hang, tripped, (long long) minCut / 1000, (long long) maxCut / 1000);
+    else printf("  %9d  %7d\n", hang, tripped);
+  }
+
+  StaticJsonDocument<128> doc;
+  JsonArray heartbeat = doc.to<JsonArray>();
+  watchdogToJson(heartbeat);
+  CHECK(heartbeat[0].as<int>() >= 5000 && heartbeat[1].as<int>() == cuts);
+
+  return hostTestDone("test_watchdog");
+}
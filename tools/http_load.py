@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""
+http_load.py - Load test of the BlindsControl HTTP API.
+
+Runs a number of clients (one keep-alive connection each) against an endpoint for a fixed time, and reports
+the requests per second and the latency (p50/p95/p99/max). The device allows httpMaxConnections connections
+(configuration.h); more clients than that make the device close the least recently used connection, which
+shows up as reconnects.
+
+Without a device, --sim runs the load test against the host stand-in of the API (http_sim.py): same connection
+limit, command queue and main-loop answered reads, with the loop pass time set by --loop-ms.
+
+Example:
+  python3 http_load.py 192.168.1.50 --clients 2 --seconds 20
+  python3 http_load.py --sim --clients 2 --path /api/state --loop-ms 5
+  python3 http_load.py 192.168.1.50 --path /api/state
+  python3 http_load.py 192.168.1.50 --method POST --path /api/stop --body ""
+
+Only the GET endpoints and /api/stop are safe to hammer: POST /api/position moves the blinds.
+"""
+import argparse
+import http.client
+import threading
+import time
+
+import http_sim
+
+
+def client(args, deadline, latencies, counters, lock):
+    conn = None
+    own = []
+    errors = 0
+    busy = 0
+    reconnects = 0
+    while time.monotonic() < deadline:
+        if conn is None:
+            conn = http.client.HTTPConnection(args.host, args.port, timeout=args.timeout)
+            reconnects += 1
+        start = time.monotonic()
+        try:
+            conn.request(args.method, args.path, body=args.body if args.method != "GET" else None)
+            response = conn.getresponse()
+            response.read()
+            if response.status == 503:
+                busy += 1
+            elif response.status >= 400:
+                errors += 1
+            own.append(time.monotonic() - start)
+        except (OSError, http.client.HTTPException):
+            errors += 1
+            conn.close()
+            conn = None
+    if conn is not None:
+        conn.close()
+    with lock:
+        latencies.extend(own)
+        counters["errors"] += errors
+        counters["busy"] += busy
+        counters["reconnects"] += reconnects - 1
+
+
+def percentile(values, p):
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Load test of the BlindsControl HTTP API.")
+    parser.add_argument("host", nargs="?", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--path", default="/api/position")
+    parser.add_argument("--method", default="GET")
+    parser.add_argument("--body", default="")
+    parser.add_argument("--clients", type=int, default=1)
+    parser.add_argument("--seconds", type=float, default=10)
+    parser.add_argument("--timeout", type=float, default=5)
+    parser.add_argument("--sim", action="store_true", help="run against the host stand-in (http_sim.py)")
+    http_sim.add_arguments(parser)
+    args = parser.parse_args()
+    if args.sim:
+        args.bind = args.host
+        args.port = 0
+        args.port = http_sim.start(args)
+
+    latencies = []
+    counters = {"errors": 0, "busy": 0, "reconnects": 0}
+    lock = threading.Lock()
+    deadline = time.monotonic() + args.seconds
+    threads = [threading.Thread(target=client, args=(args, deadline, latencies, counters, lock)) for _ in range(args.clients)]
+    start = time.monotonic()
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    elapsed = time.monotonic() - start
+
+    print("%s %s: %d clients, %.1fs%s" % (args.method, args.path, args.clients, elapsed,
+                                          " (simulator, loop %.1fms)" % args.loop_ms if args.sim else ""))
+    if not latencies:
+        print("no responses (errors=%d)" % counters["errors"])
+        return
+    latencies.sort()
+    print("requests: %d (%.1f/s), busy (503): %d, errors: %d, reconnects: %d" % (
+        len(latencies), len(latencies) / elapsed, counters["busy"], counters["errors"], counters["reconnects"]))
+    print("latency ms: p50=%.1f p95=%.1f p99=%.1f max=%.1f" % tuple(1000 * v for v in (
+        percentile(latencies, 50), percentile(latencies, 95), percentile(latencies, 99), latencies[-1])))
+
+
+if __name__ == "__main__":
+    main()
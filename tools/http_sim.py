@@ -0,0 +1,218 @@
+#!/usr/bin/env python3
+"""
+http_sim.py - Host stand-in of the BlindsControl HTTP API, to run http_load.py without a device.
+
+Models the parts of the device that set its throughput and latency:
+  - one server task that handles one request at a time (esp_http_server), with at most httpMaxConnections open
+    connections; the least recently used connection is closed when a new one arrives and all are in use.
+  - commands (POST) are queued for the main loop (httpQueueLength), answered 202 once queued, 503 when full.
+  - reads (GET) are queued for the main loop (one at a time), which builds the answer on its next pass; the server
+    task waits for it (httpQueryTimeout, then 504 and the query is withdrawn) and streams it in httpChunkSize chunks.
+  - the main loop passes every --loop-ms, and takes --build-ms to build an answer.
+The answers have the size of the device answers, not their values.
+
+Example:
+  python3 http_sim.py --port 8080
+  python3 http_load.py 127.0.0.1 --port 8080 --clients 2
+  python3 http_load.py --sim --clients 2              (starts the simulator itself)
+"""
+import argparse
+import collections
+import json
+import queue
+import select
+import socket
+import threading
+import time
+
+MAX_CONNECTIONS = 3       # httpMaxConnections
+QUEUE_LENGTH = 4          # httpQueueLength
+QUERY_TIMEOUT = 2.0       # httpQueryTimeout (s)
+CHUNK_SIZE = 256          # httpChunkSize
+
+
+def answer(path):
+    if path == "/api/position":
+        return {"ch": 0, "state": "open", "percentage": 42, "running": False}
+    if path == "/api/config":
+        return {"Channel": 0, "AllowRemoteControl": True, "AllowRemoteBleep": True, "MinLuxReportDelta": 10,
+                "LuxInterval": 5, "TempInterval": 15, "StateInterval": 60, "DebounceDurSwitches": 30,
+                "DebounceDurRelease": 30, "DebounceDurMotor": 200, "ButtonHold": 600, "ButtonLong": 1500,
+                "ButtonDouble": 400, "ButtonPreset": 50, "RotationLimits": True, "BrakeOnStop": False,
+                "HomingMode": "command", "HomingTime": "03:00", "OpenDuration": 60, "MaxOpenRotations": 120,
+                "MaxCurrentLimit": 2500, "MaxRunDuration": 90, "SSID": "network"}
+    if path == "/api/metrics":
+        stage = {"n": 100, "p50": 143, "p99": 1151, "max": 1650}
+        return {k: dict(stage) for k in ("queue", "pickup", "start", "pwm", "total")} | {
+            "group": {"n": 3, "start_us": 41, "arrive_ms": 180, "arrive_max_ms": 420, "held": 2, "early": 0},
+            "cutoff": {"n": 12, "enLow_ns": [850, 1400], "stop_us": [900, 2100]},
+            "gesture": {g: [10, 120, 900] for g in ("press", "click", "double", "hold", "long", "jogend")}}
+    if path == "/api/state":
+        return {"Version": "v221016.0", "IP Address": "192.168.2.18", "SSID": "network", "RSSI (dBm)": -61,
+                "wifi (%)": 78, "Core Temperature (°C)": 52, "Uptime": "3d4:05:06", "Start Reason": "POWERON_RESET",
+                "Free Heap Memory": 181234, "Min Free Heap": 170112, "Largest Free Block": 110580,
+                "Heap Fragmentation (%)": 39,
+                "Task Stacks": {t: [4096, 1400, 3584] for t in ("loop", "motor", "motion", "ota", "http")},
+                "Stop Reasons": {r: 3 for r in ("LimitOpen", "LimitClosed", "Button", "TimerOpen", "Rotations", "MQTT")},
+                "Cmd Latency (us)": {"n": 100, "p50": 1151, "p99": 4607, "max": 5210},
+                "Stop Distance (rot)": {"0": [1.4, 12, 0.6, 8]}, "Debounce (us)": {"limit": [40, 30000, 31000],
+                "button": [80, 30000, 32000]}, "Estimate Error (‰)": {}, "Motor Heartbeat": [12, 0],
+                "Control Jitter (us)": [600000, 45, 980, 0], "Publish (us)": [4000, 850, 4100, 1100]}
+    return None
+
+
+class Loop(threading.Thread):
+    """The main loop: takes the queued commands and the queued read every pass."""
+
+    def __init__(self, args):
+        super().__init__(daemon=True)
+        self.args = args
+        self.commands = queue.Queue(QUEUE_LENGTH)
+        self.queries = queue.Queue(1)
+        self.executed = 0
+
+    def run(self):
+        while True:
+            time.sleep(self.args.loop_ms / 1000)
+            while True:
+                try:
+                    self.commands.get_nowait()
+                    self.executed += 1
+                except queue.Empty:
+                    break
+            try:
+                path, done = self.queries.get_nowait()
+            except queue.Empty:
+                continue
+            time.sleep(self.args.build_ms / 1000)
+            done.put(json.dumps(answer(path), ensure_ascii=False).encode())
+
+
+class Server:
+    """The server task: select over at most MAX_CONNECTIONS sockets, one request at a time."""
+
+    def __init__(self, args, loop):
+        self.args = args
+        self.loop = loop
+        self.listener = socket.create_server((args.bind, args.port))
+        self.port = self.listener.getsockname()[1]
+        self.connections = collections.OrderedDict()      # socket -> receive buffer, least recently used first
+
+    def serve_forever(self):
+        while True:
+            readable, _, _ = select.select([self.listener] + list(self.connections), [], [])
+            for sock in readable:
+                if sock is self.listener:
+                    self.accept()
+                else:
+                    self.receive(sock)
+
+    def accept(self):
+        conn, _ = self.listener.accept()
+        conn.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        if len(self.connections) >= MAX_CONNECTIONS:
+            oldest = next(iter(self.connections))
+            self.close(oldest)
+        self.connections[conn] = b""
+
+    def close(self, sock):
+        self.connections.pop(sock, None)
+        sock.close()
+
+    def receive(self, sock):
+        try:
+            data = sock.recv(4096)
+        except OSError:
+            data = b""
+        if not data:
+            self.close(sock)
+            return
+        self.connections.move_to_end(sock)
+        buffer = self.connections[sock] + data
+        while b"\r\n\r\n" in buffer:
+            head, rest = buffer.split(b"\r\n\r\n", 1)
+            lines = head.decode(errors="replace").split("\r\n")
+            length = 0
+            for line in lines[1:]:
+                name, _, value = line.partition(":")
+                if name.strip().lower() == "content-length":
+                    length = int(value.strip())
+            if len(rest) < length:
+                break
+            buffer = rest[length:]
+            method, target = lines[0].split(" ")[:2]
+            try:
+                self.handle(sock, method, target.split("?")[0])
+            except OSError:
+                self.close(sock)
+                return
+        self.connections[sock] = buffer
+
+    def handle(self, sock, method, path):
+        if method == "POST" and path in ("/api/position", "/api/stop"):
+            try:
+                self.loop.commands.put_nowait(path)
+                self.send(sock, "202 Accepted", b'{"ch":0,"queued":"stop"}')
+            except queue.Full:
+                self.send(sock, "503 Service Unavailable", b"busy")
+        elif method == "GET" and answer(path) is not None:
+            done = queue.Queue(1)
+            try:
+                self.loop.queries.put_nowait((path, done))
+            except queue.Full:
+                self.send(sock, "503 Service Unavailable", b"busy")
+                return
+            try:
+                self.send(sock, "200 OK", done.get(timeout=QUERY_TIMEOUT), chunked=True)
+            except queue.Empty:
+                try:
+                    self.loop.queries.get_nowait()        # not taken by the loop: withdraw it
+                except queue.Empty:
+                    pass
+                self.send(sock, "504 Gateway Timeout", b"no answer")
+        else:
+            self.send(sock, "404 Not Found", b"not found")
+
+    def send(self, sock, status, body, chunked=False):
+        if not chunked:
+            sock.sendall(b"HTTP/1.1 %s\r\nContent-Length: %d\r\n\r\n%s" % (status.encode(), len(body), body))
+            return
+        sock.sendall(b"HTTP/1.1 %s\r\nContent-Type: application/json\r\nTransfer-Encoding: chunked\r\n\r\n" % status.encode())
+        for offset in range(0, len(body), CHUNK_SIZE):
+            chunk = body[offset:offset + CHUNK_SIZE]
+            sock.sendall(b"%x\r\n%s\r\n" % (len(chunk), chunk))
+        sock.sendall(b"0\r\n\r\n")
+
+
+def add_arguments(parser):
+    parser.add_argument("--loop-ms", type=float, default=5, help="main loop pass time (ms)")
+    parser.add_argument("--build-ms", type=float, default=1, help="time to build an answer (ms)")
+
+
+def start(args):
+    """Start the simulator in the background, returns the port it listens on."""
+    loop = Loop(args)
+    loop.start()
+    server = Server(args, loop)
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    return server.port
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Host stand-in of the BlindsControl HTTP API.")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--bind", default="127.0.0.1")
+    add_arguments(parser)
+    args = parser.parse_args()
+    loop = Loop(args)
+    loop.start()
+    server = Server(args, loop)
+    print("simulator on http://%s:%d (loop %.1fms)" % (args.bind, server.port, args.loop_ms))
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""
+ota_image.py - Compressed OTA images for BlindsControl.
+
+  pack   Compress a firmware image (zlib, level 9) into <image>.zz. The ESP32 inflates it while it is
+         received (appcmd "update:<url>"), so less data goes over a weak WiFi link.
+  serve  Serve images over HTTP, as a local stand-in for the OTA sender. Every download is logged with its
+         size, transfer time and throughput. --rate limits the throughput, to compare the plain and the
+         compressed image at the speed of a weak link. The MD5 of the image (of the decompressed image for a
+         .zz) is sent in the x-MD5 header: the device refuses an image without it, and checks it when flashed.
+
+Example:
+  python3 ota_image.py pack .pio/build/esp32dev/firmware.bin
+  python3 ota_image.py serve .pio/build/esp32dev/firmware.bin .pio/build/esp32dev/firmware.bin.zz --rate 40
+  mosquitto_pub -t livingroom/blinds/appcmd -m "update:http://<host>:8070/firmware.bin.zz"
+
+The device publishes the result on livingroom/blinds/ota: bytes received and written, and the time spent
+receiving (rx_ms), inflating (inflate_ms) and writing the flash (flash_ms).
+"""
+import argparse
+import hashlib
+import http.server
+import os
+import socket
+import sys
+import time
+import zlib
+
+CHUNK = 1024
+
+
+def pack(args):
+    with open(args.image, "rb") as f:
+        data = f.read()
+    packed = zlib.compress(data, 9)
+    out = args.output or args.image + ".zz"
+    with open(out, "wb") as f:
+        f.write(packed)
+    print("%s: %d -> %d bytes (%.1f%%), md5 %s" % (out, len(data), len(packed), 100.0 * len(packed) / len(data),
+                                                   hashlib.md5(data).hexdigest()))
+
+
+def image_md5(path, data):
+    """MD5 of the image as flashed: a .zz image is decompressed first."""
+    return hashlib.md5(zlib.decompress(data) if path.endswith(".zz") else data).hexdigest()
+
+
+def serve(args):
+    images = {"/" + os.path.basename(path): path for path in args.images}
+    rate = args.rate * 1024 if args.rate else 0
+
+    class Handler(http.server.BaseHTTPRequestHandler):
+        def do_GET(self):
+            path = images.get(self.path)
+            if path is None:
+                self.send_error(404)
+                return
+            with open(path, "rb") as f:
+                data = f.read()
+            self.send_response(200)
+            self.send_header("Content-Type", "application/octet-stream")
+            self.send_header("Content-Length", str(len(data)))
+            self.send_header("x-MD5", image_md5(path, data))
+            self.end_headers()
+
+            start = time.monotonic()
+            for offset in range(0, len(data), CHUNK):
+                self.wfile.write(data[offset:offset + CHUNK])
+                if rate:
+                    ahead = (offset + CHUNK) / rate - (time.monotonic() - start)
+                    if ahead > 0:
+                        time.sleep(ahead)
+            elapsed = time.monotonic() - start
+            print("%s: %d bytes in %.2fs (%.1f KB/s)" % (self.path, len(data), elapsed, len(data) / 1024 / max(elapsed, 1e-6)),
+                  flush=True)
+
+        def log_message(self, format, *args):
+            sys.stderr.write("%s - %s\n" % (self.address_string(), format % args))
+
+    server = http.server.HTTPServer((args.bind, args.port), Handler)
+    host = socket.gethostbyname(socket.gethostname()) if args.bind == "0.0.0.0" else args.bind
+    for name in images:
+        print("appcmd: update:http://%s:%d%s" % (host, args.port, name))
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compressed OTA images for BlindsControl.")
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("pack", help="compress a firmware image into <image>.zz")
+    p.add_argument("image")
+    p.add_argument("-o", "--output")
+    p.set_defaults(func=pack)
+
+    s = sub.add_parser("serve", help="serve images over HTTP (local stand-in OTA sender)")
+    s.add_argument("images", nargs="+")
+    s.add_argument("--port", type=int, default=8070)
+    s.add_argument("--bind", default="0.0.0.0")
+    s.add_argument("--rate", type=float, default=0, help="limit the throughput (KB/s), 0 = unlimited")
+    s.set_defaults(func=serve)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()